@@ -1,5 +1,7 @@
 #pragma once
 
+class RenderGraph;
+
 class ISampleApp
 {
 public:
@@ -7,4 +9,7 @@ public:
 	virtual void OnInitialize() = 0;
 	virtual void OnDrawFrame() = 0;
 	virtual void OnCleanup() = 0;
+
+	//フレームをRenderGraphで組み立てる場合はそのグラフ(統計の出力用。OnCleanupまで有効)
+	virtual const RenderGraph* GetRenderGraph() const { return nullptr; }
 };
\ No newline at end of file
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <vector>
+
+#include "glm/glm.hpp"
+#include "vulkan/vulkan.h"
+
+#include "ISampleApp.h"
+#include "core/ImageResource.h"
+#include "core/BufferResource.h"
+#include "core/ResourceUploader.h"
+
+//大量のオブジェクトの描画コマンドを複数スレッドで記録するベンチマーク
+//一定フレーム毎に記録スレッド数を切り替え、1フレームあたりの記録時間を出力する
+//オブジェクト毎の行列はバインドレスヒープから参照し、描画毎にはプッシュ定数だけを切り替える
+class ParallelDrawApp : public ISampleApp
+{
+public:
+	virtual void OnInitialize() override;
+	virtual void OnDrawFrame() override;
+	virtual void OnCleanup() override;
+
+	static constexpr uint32_t GridSize = 128;                     //GridSize^2 個のオブジェクトを描画
+	static constexpr uint32_t ObjectCount = GridSize * GridSize;
+	static constexpr uint32_t FramesPerStep = 120;                //1つのスレッド数で計測するフレーム数
+
+	struct Vertex
+	{
+		glm::vec3 position;
+		glm::vec3 normal;
+		glm::vec3 color;
+	};
+	//SimpleCubeのシェーダーと同じレイアウト(mtxWorldは使わず、オブジェクト毎の行列はストレージバッファから読む)
+	struct SceneConstants
+	{
+		glm::mat4 mtxWorld;
+		glm::mat4 mtxView;
+		glm::mat4 mtxProj;
+		glm::vec4 lightDir;
+		glm::vec4 eyePosition;
+	};
+	//cube_bindless.vertのプッシュ定数
+	struct DrawConstants
+	{
+		uint32_t transformBufferIndex; //バインドレスヒープ上の行列のバッファ
+		uint32_t objectIndex;
+	};
+
+private:
+	void CreateCubeGeometry();
+	void CreatePipelineLayout();
+	void CreateDescriptorSets();
+	void UpdateDescriptorSets();
+	//同時処理フレーム数に合わせて作成・破棄する
+	void ResizeTransformBuffers();
+	void CreateDepthBuffer();
+	void CreateGraphicsPipeline();
+
+	//計測結果を出力し、次のスレッド数へ切り替える
+	void AdvanceBenchmarkStep();
+
+	ResourceUploader m_resourceUploader{};
+
+	VkPipeline m_pipeline = VK_NULL_HANDLE; //PipelineRegistryから取得したもの
+	VkPipelineLayout m_pipelineLayout = VK_NULL_HANDLE; //PipelineLayoutCacheから取得したもの(破棄しない)
+	VkDescriptorSetLayout m_descriptorSetLayout = VK_NULL_HANDLE; //同上
+
+	struct
+	{
+		std::shared_ptr<VertexBuffer> vertexBuffer;
+		std::shared_ptr<IndexBuffer>  indexBuffer;
+
+		uint32_t indexCount;
+	} m_cube{};
+
+	//フレーム共通の定数はフレームのリングから確保し、UNIFORM_BUFFER_DYNAMICのオフセットで指す(set 0)
+	VkDescriptorSet m_descriptorSet = VK_NULL_HANDLE;
+	uint64_t m_uniformRingGeneration = 0; //m_descriptorSetに書き込んだリングのバッファ
+	//オブジェクト毎のワールド行列。GPUが読んでいる間に書き換えないよう同時処理フレーム数分持つ(set 1のヒープから参照)
+	//フレーム数が実行中に変わった場合は、次のフレームの先頭で合わせる
+	std::vector<std::shared_ptr<StorageBuffer>> m_transformBuffers; //[フレーム]
+
+	std::shared_ptr<DepthBuffer> m_depthBuffer;
+
+	//計測
+	std::vector<uint32_t> m_threadSteps;  //計測するスレッド数の一覧
+	uint32_t m_stepIndex = 0;
+	uint32_t m_stepFrameCount = 0;
+	double m_stepRecordSeconds = 0.0;
+};
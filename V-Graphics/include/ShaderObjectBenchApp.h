@@ -0,0 +1,96 @@
+#pragma once
+
+#include <vector>
+
+#include "glm/glm.hpp"
+#include "vulkan/vulkan.h"
+
+#include "ISampleApp.h"
+#include "core/ImageResource.h"
+#include "core/BufferResource.h"
+#include "core/ResourceUploader.h"
+#include "core/ShaderObject.h"
+
+//パイプラインとVK_EXT_shader_objectを比べるベンチマーク
+//SimpleCubeのシェーダーで、カリングと深度比較の組み合わせを描画毎に切り替えながら大量のキューブを描画する
+//パイプライン : 組み合わせ毎にステートを焼き込んだパイプラインを作り、描画毎に結び付け直す
+//シェーダーオブジェクト : シェーダーは1回だけ結び付け、描画毎にステートの設定コマンドだけを記録する
+//初期化時に最初の1つが使えるようになるまでの時間を、一定フレーム毎に方式を切り替えて記録時間を出力する
+class ShaderObjectBenchApp : public ISampleApp
+{
+public:
+	virtual void OnInitialize() override;
+	virtual void OnDrawFrame() override;
+	virtual void OnCleanup() override;
+
+	static constexpr uint32_t GridSize = 64;                      //GridSize^2 個のオブジェクトを描画
+	static constexpr uint32_t ObjectCount = GridSize * GridSize;
+	static constexpr uint32_t FramesPerStep = 120;                //1つの方式で計測するフレーム数
+
+	struct Vertex
+	{
+		glm::vec3 position;
+		glm::vec3 normal;
+		glm::vec3 color;
+	};
+	//SimpleCubeのシェーダーと同じレイアウト
+	struct ObjectConstants
+	{
+		glm::mat4 mtxWorld;
+		glm::mat4 mtxView;
+		glm::mat4 mtxProj;
+		glm::vec4 lightDir;
+		glm::vec4 eyePosition;
+	};
+
+	//描画毎に切り替えるステートの組み合わせ
+	struct StateVariant
+	{
+		VkCullModeFlags cullMode;
+		VkCompareOp depthCompareOp;
+	};
+
+private:
+	enum class DrawMode
+	{
+		Pipeline,
+		ShaderObject,
+	};
+
+	void CreateCubeGeometry();
+	void CreatePipelineLayout();
+	void CreateDescriptorSets();
+	void UpdateDescriptorSets();
+	void CreateDepthBuffer();
+	void CreatePipelines();
+	void CreateShaderObject();
+
+	//計測結果を出力し、次の方式へ切り替える
+	void AdvanceBenchmarkStep();
+
+	ResourceUploader m_resourceUploader{};
+
+	VkPipelineLayout m_pipelineLayout = VK_NULL_HANDLE; //PipelineLayoutCacheから取得したもの(破棄しない)
+	VkDescriptorSetLayout m_descriptorSetLayout = VK_NULL_HANDLE; //同上
+	std::vector<VkPipeline> m_pipelines;            //StateVariant毎(登録簿を通さず直接作成したもの)
+	std::shared_ptr<ShaderObject> m_shaderObject;   //非対応のデバイスではnullptr
+
+	struct
+	{
+		std::shared_ptr<VertexBuffer> vertexBuffer;
+		std::shared_ptr<IndexBuffer>  indexBuffer;
+
+		uint32_t indexCount;
+	} m_cube{};
+
+	VkDescriptorSet m_descriptorSet = VK_NULL_HANDLE;
+	uint64_t m_uniformRingGeneration = 0; //m_descriptorSetに書き込んだリングのバッファ
+
+	std::shared_ptr<DepthBuffer> m_depthBuffer;
+
+	//計測
+	std::vector<DrawMode> m_modeSteps;
+	uint32_t m_stepIndex = 0;
+	uint32_t m_stepFrameCount = 0;
+	double m_stepRecordSeconds = 0.0;
+};
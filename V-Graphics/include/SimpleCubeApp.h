@@ -1,6 +1,7 @@
 #pragma once
 
 #include <array>
+#include <vector>
 
 #include "glm/glm.hpp"
 #include "vulkan/vulkan.h"
@@ -9,6 +10,8 @@
 #include "core/ImageResource.h"
 #include "core/BufferResource.h"
 #include "core/ResourceUploader.h"
+#include "core/PipelineRegistry.h"
+#include "core/RenderGraph.h"
 
 class SimpleCubeApp : public ISampleApp
 {
@@ -16,6 +19,7 @@ public:
 	virtual void OnInitialize() override;
 	virtual void OnDrawFrame() override;
 	virtual void OnCleanup() override;
+	virtual const RenderGraph* GetRenderGraph() const override { return &m_renderGraph; }
 
 	struct Vertex
 	{
@@ -31,20 +35,24 @@ public:
 		glm::vec4 lightDir;
 		glm::vec4 eyePosition;
 	};
+	//cube.fragの特殊化定数
+	struct FragmentSpecialization
+	{
+		float shininess = 20.0f; //constant_id = 0
+	};
 
 private:
 	void CreateCubeGeometry();
 	void CreateSphereGeometry();
-	void CreateDescriptorSetLayout();
-	void CreateUniformBuffers();
+	void CreatePipelineLayout();
 	void CreateDescriptorSets();
-	void CreateDepthBuffer();
+	void UpdateDescriptorSets();
 	void CreateGraphicsPipeline();
 
 	ResourceUploader m_resourceUploader{};
 
-	VkPipeline m_pipeline = VK_NULL_HANDLE;
-	VkPipelineLayout m_pipelineLayout = VK_NULL_HANDLE;
+	PipelineHandle m_pipeline; //作成が完了するまでは描画を省く
+	VkPipelineLayout m_pipelineLayout = VK_NULL_HANDLE; //PipelineLayoutCacheから取得したもの(破棄しない)
 
 	struct
 	{
@@ -53,10 +61,11 @@ private:
 
 		uint32_t indexCount;
 	} m_cube{};
-	VkDescriptorSetLayout m_descriptorSetLayout = VK_NULL_HANDLE;
+	VkDescriptorSetLayout m_descriptorSetLayout = VK_NULL_HANDLE; //PipelineLayoutCacheから取得したもの(破棄しない)
 
-	std::array<std::shared_ptr<UniformBuffer>, 2> m_uniformBuffers;
-	std::array<VkDescriptorSet, 2> m_descriptorSets;
+	VkDescriptorSet m_descriptorSet = VK_NULL_HANDLE; //フレームの定数用リングを動的オフセットで参照する
+	uint64_t m_uniformRingGeneration = 0; //m_descriptorSetに書き込んだリングのバッファ
 
-	std::shared_ptr<DepthBuffer> m_depthBuffer;
+	static constexpr VkFormat DepthFormat = VK_FORMAT_D32_SFLOAT;
+	RenderGraph m_renderGraph; //深度バッファはグラフの一時イメージ
 };
\ No newline at end of file
@@ -25,5 +25,5 @@ private:
 
 	std::shared_ptr<VertexBuffer> m_vertexBuffer;
 	VkPipeline m_pipeline = VK_NULL_HANDLE;
-	VkPipelineLayout m_pipelineLayout = VK_NULL_HANDLE;
+	VkPipelineLayout m_pipelineLayout = VK_NULL_HANDLE; //PipelineLayoutCacheから取得したもの(破棄しない)
 };
\ No newline at end of file
@@ -1,12 +1,12 @@
 #pragma once
 #include <filesystem>
 
-//eNX`f[^, VF[_[R[h, ff[^Ȃǂuꂽt@CpX舵߂̎dg
+//テクスチャデータ, シェーダーコード, モデルデータなどが置かれたファイルパス情報を取り扱うための仕組み
 
-//AZbg̃[gpXݒ
+//アセットのルートパスを設定
 void SetAssetRootPath(const std::filesystem::path& path);
 
-//݂̃AZbg[gpX擾
+//現在のアセットルートパスを取得
 std::filesystem::path GetAssetRootPath();
 
 enum class AssetType
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <stdint.h>
+
+//ディスクリプタインデキシングによるバインドレス用のグローバルなディスクリプタヒープ
+//ストレージバッファ, サンプルイメージ, サンプラーの大きな配列を1つのセットに持ち、
+//登録したリソースには解放まで変わらないインデックスを割り当てる
+//シェーダーはこのインデックスで配列を参照するため、シーン全体を1回のバインドで描画できる
+//セットのレイアウトはPipelineLayoutCacheに登録されるため、リフレクションで作るレイアウトは、下のような実行時の大きさの配列だけのセットであればどのset番号でもこのレイアウトを使う
+//
+//  layout(set = N, binding = 0) buffer Buffers { ... } g_buffers[];
+//  layout(set = N, binding = 1) uniform texture2D g_textures[];
+//  layout(set = N, binding = 2) uniform sampler g_samplers[];
+class BindlessHeap
+{
+public:
+    static constexpr uint32_t InvalidIndex = UINT32_MAX;
+
+    enum Binding
+    {
+        StorageBufferBinding = 0,
+        SampledImageBinding,
+        SamplerBinding,
+        BindingMax,
+    };
+
+    BindlessHeap() = default;
+    ~BindlessHeap() = default;
+
+    BindlessHeap(const BindlessHeap&) = delete;
+    BindlessHeap& operator=(const BindlessHeap&) = delete;
+
+    //配列の大きさはデバイスの上限に合わせて縮める
+    bool Initialize(VkDevice device, VkPhysicalDevice physicalDevice);
+    void Cleanup();
+
+    //登録してインデックスを得る(空きがなければInvalidIndex)
+    //UPDATE_AFTER_BINDのため、記録済みのコマンドバッファがあっても登録できる
+    uint32_t RegisterStorageBuffer(const VkDescriptorBufferInfo& bufferInfo);
+    uint32_t RegisterSampledImage(VkImageView imageView, VkImageLayout layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+    uint32_t RegisterSampler(VkSampler sampler);
+
+    //インデックスを返却する
+    //処理中のフレームが参照している可能性があるため、現在のフレームの完了後に再利用する
+    void Release(Binding binding, uint32_t index);
+
+    VkDescriptorSetLayout GetDescriptorSetLayout() const { return m_layout; }
+    const std::vector<VkDescriptorSetLayoutBinding>& GetSetLayoutBindings() const { return m_bindings; }
+    VkDescriptorSet GetDescriptorSet() const { return m_descriptorSet; }
+    uint32_t GetCapacity(Binding binding) const { return m_slots[binding].capacity; }
+
+    //ヒープのセットをバインドする
+    void Bind(VkCommandBuffer commandBuffer, VkPipelineBindPoint bindPoint, VkPipelineLayout pipelineLayout, uint32_t setIndex = 0) const;
+
+private:
+    //インデックスの割り当て状況
+    struct Slots
+    {
+        uint32_t capacity = 0;
+        uint32_t nextIndex = 0;                 //未使用の先頭
+        std::vector<uint32_t> freeIndices;      //再利用可能
+        std::deque<std::pair<uint64_t, uint32_t>> retiredIndices; //[タイムライン値, インデックス]の返却待ち
+    };
+
+    uint32_t AllocateIndex(Binding binding);
+
+    static constexpr VkDescriptorType DescriptorTypes[BindingMax] = {
+        VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+        VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE,
+        VK_DESCRIPTOR_TYPE_SAMPLER,
+    };
+    //デバイスの上限が許す場合の配列の大きさ
+    static constexpr uint32_t DesiredCapacities[BindingMax] = { 65536, 65536, 1024 };
+
+    VkDevice m_device = VK_NULL_HANDLE;
+    VkDescriptorSetLayout m_layout = VK_NULL_HANDLE;
+    std::vector<VkDescriptorSetLayoutBinding> m_bindings;
+    VkDescriptorPool m_pool = VK_NULL_HANDLE;
+    VkDescriptorSet m_descriptorSet = VK_NULL_HANDLE;
+
+    Slots m_slots[BindingMax];
+    std::mutex m_mutex;
+};
@@ -10,13 +10,28 @@ public:
     virtual VkBuffer GetVkBuffer() const = 0;
     virtual VkDeviceSize GetBufferSize() const = 0;
 
-    virtual void SetAccessFlags(const VkAccessFlags flags) = 0;
-    virtual VkAccessFlags GetAccessFlags() const = 0;
-
+    //最後に記録したコマンドでの状態(CommandBuffer::RequireBufferStateが記録終了時に更新する)
+    //ステージが0の場合は、まだGPUで使われていないものとして扱う
+    virtual void SetAccessFlags(const VkAccessFlags2 flags) = 0;
+    virtual VkAccessFlags2 GetAccessFlags() const = 0;
+    virtual void SetStageFlags(const VkPipelineStageFlags2 flags) = 0;
+    virtual VkPipelineStageFlags2 GetStageFlags() const = 0;
+
+    //メモリは作成時にマップしたままのため、Mapは保持しているポインタを返すだけ
+    //Unmapはマップを解除せず、ノンコヒーレントなメモリであればバッファ全体をフラッシュする
     virtual void* Map() = 0;
     virtual void Unmap() = 0;
 
+    //ノンコヒーレント(HOST_CACHEDなど)なメモリ用。範囲はnonCoherentAtomSize単位に広げられる
+    //Flush : CPUの書き込みをGPUから見えるようにする / Invalidate : GPUの書き込みをCPUから見えるようにする
+    virtual void Flush(VkDeviceSize offset = 0, VkDeviceSize size = VK_WHOLE_SIZE) = 0;
+    virtual void Invalidate(VkDeviceSize offset = 0, VkDeviceSize size = VK_WHOLE_SIZE) = 0;
+
     virtual VkDescriptorBufferInfo GetDescriptorInfo() const = 0;
+
+    //バインドレスヒープ上のストレージバッファのインデックス(初回呼び出し時に登録する)
+    //STORAGE_BUFFERの用途で作成していない場合, ヒープが使えない場合はBindlessHeap::InvalidIndex
+    virtual uint32_t GetBindlessIndex() = 0;
 };
 
 template<typename T>
@@ -30,22 +45,31 @@ public:
     virtual void Cleanup();
 
     bool IsHostAccessible() const override { return (m_memProps & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) != 0; }
-    VkAccessFlags GetAccessFlags() const override { return m_accessFlags; }
-    void SetAccessFlags(const VkAccessFlags flags) override { m_accessFlags = flags; }
+    VkAccessFlags2 GetAccessFlags() const override { return m_accessFlags; }
+    void SetAccessFlags(const VkAccessFlags2 flags) override { m_accessFlags = flags; }
+    VkPipelineStageFlags2 GetStageFlags() const override { return m_stageFlags; }
+    void SetStageFlags(const VkPipelineStageFlags2 flags) override { m_stageFlags = flags; }
 
     VkBuffer GetVkBuffer() const override { return m_buffer; }
     VkDeviceSize GetBufferSize() const override { return m_size; }
 
+    void Flush(VkDeviceSize offset = 0, VkDeviceSize size = VK_WHOLE_SIZE) override;
+    void Invalidate(VkDeviceSize offset = 0, VkDeviceSize size = VK_WHOLE_SIZE) override;
+
     VkDescriptorBufferInfo GetDescriptorInfo() const override;
+    uint32_t GetBindlessIndex() override;
 protected:
     BufferResource() = default;
 
     bool CreateBuffer(const VkBufferCreateInfo& createInfo, VkMemoryPropertyFlags memProps);
     VkBuffer m_buffer{};
-    VkDeviceMemory m_memory{};
+    DeviceAllocation m_allocation{};
     VkDeviceSize m_size{};
     VkMemoryPropertyFlags m_memProps{};
-    VkAccessFlags m_accessFlags = VK_ACCESS_NONE;
+    VkBufferUsageFlags m_usage{};
+    VkAccessFlags2 m_accessFlags = VK_ACCESS_2_NONE;
+    VkPipelineStageFlags2 m_stageFlags = VK_PIPELINE_STAGE_2_NONE;
+    uint32_t m_bindlessIndex = BindlessHeap::InvalidIndex;
 };
 
 
@@ -56,19 +80,43 @@ void BufferResource<T>::Cleanup()
     VulkanContext& context = VulkanContext::Get();
     VkDevice device = context.GetVkDevice();
 
-    if (m_buffer != VK_NULL_HANDLE)
+    if (m_bindlessIndex != BindlessHeap::InvalidIndex)
     {
-        vkDestroyBuffer(device, m_buffer, nullptr);
-        m_buffer = VK_NULL_HANDLE;
+        context.GetBindlessHeap()->Release(BindlessHeap::StorageBufferBinding, m_bindlessIndex);
+        m_bindlessIndex = BindlessHeap::InvalidIndex;
     }
-    if (m_memory != VK_NULL_HANDLE)
+    if (m_buffer != VK_NULL_HANDLE || m_allocation.memory != VK_NULL_HANDLE)
     {
-        vkFreeMemory(device, m_memory, nullptr);
-        m_memory = VK_NULL_HANDLE;
+        //記録済みのコマンドが参照している可能性があるため、GPUが現在のフレームを終えてから破棄する
+        context.DeferDestroy([device, buffer = m_buffer, allocation = m_allocation]() mutable
+        {
+            if (buffer != VK_NULL_HANDLE)
+            {
+                vkDestroyBuffer(device, buffer, nullptr);
+            }
+            if (allocation.memory != VK_NULL_HANDLE)
+            {
+                VulkanContext::Get().GetMemoryAllocator().Free(allocation);
+            }
+        });
+        m_buffer = VK_NULL_HANDLE;
+        m_allocation = DeviceAllocation{};
     }
     m_size = 0;
 }
 
+template<typename T>
+void BufferResource<T>::Flush(VkDeviceSize offset, VkDeviceSize size)
+{
+    VulkanContext::Get().GetMemoryAllocator().Flush(m_allocation, offset, size);
+}
+
+template<typename T>
+void BufferResource<T>::Invalidate(VkDeviceSize offset, VkDeviceSize size)
+{
+    VulkanContext::Get().GetMemoryAllocator().Invalidate(m_allocation, offset, size);
+}
+
 template<typename T>
 VkDescriptorBufferInfo BufferResource<T>::GetDescriptorInfo() const
 {
@@ -80,6 +128,19 @@ VkDescriptorBufferInfo BufferResource<T>::GetDescriptorInfo() const
     };
 }
 
+template<typename T>
+uint32_t BufferResource<T>::GetBindlessIndex()
+{
+    auto* heap = VulkanContext::Get().GetBindlessHeap();
+    if (m_bindlessIndex == BindlessHeap::InvalidIndex &&
+        heap != nullptr &&
+        (m_usage & VK_BUFFER_USAGE_STORAGE_BUFFER_BIT) != 0)
+    {
+        m_bindlessIndex = heap->RegisterStorageBuffer(GetDescriptorInfo());
+    }
+    return m_bindlessIndex;
+}
+
 template<typename T>
 bool BufferResource<T>::CreateBuffer(const VkBufferCreateInfo& createInfo, VkMemoryPropertyFlags memProps)
 {
@@ -92,25 +153,15 @@ bool BufferResource<T>::CreateBuffer(const VkBufferCreateInfo& createInfo, VkMem
         return false;
     }
 
-    // Get required memory size for the buffer
-    VkMemoryRequirements memRequirements;
-    vkGetBufferMemoryRequirements(device, m_buffer, &memRequirements);
-
-    VkMemoryAllocateInfo allocInfo{
-        .sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
-        .allocationSize = memRequirements.size,
-        .memoryTypeIndex = context.FindMemoryType(memRequirements, memProps),
-    };
-
-    result = vkAllocateMemory(device, &allocInfo, nullptr, &m_memory);
-    if (result != VK_SUCCESS)
+    // Sub-allocate from a shared memory block and bind it
+    if (!context.GetMemoryAllocator().AllocateForBuffer(m_buffer, memProps, m_allocation))
     {
         return false;
     }
 
-    vkBindBufferMemory(device, m_buffer, m_memory, 0);
     m_size = createInfo.size;
     m_memProps = memProps;
+    m_usage = createInfo.usage;
 
     return true;
 }
@@ -128,7 +179,7 @@ public:
 
     bool Initialize(VkDeviceSize size, VkMemoryPropertyFlags memProps);
 
-    //Create, Initialize1xŏ邽߂̍쐬֐
+    //Create, Initializeを1度で処理するための作成関数
     static std::shared_ptr<VertexBuffer> Create(VkDeviceSize size, VkMemoryPropertyFlags memProps)
     {
         auto buffer = GPUResourceBase::Create();
@@ -149,13 +200,14 @@ public:
     virtual void* Map() override;
     virtual void Unmap() override;
 
-    bool Initialize(VkDeviceSize size);
+    //memPropsにHOST_CACHEDなどノンコヒーレントな組み合わせを指定した場合は、書き込み後にFlushが必要
+    bool Initialize(VkDeviceSize size, VkMemoryPropertyFlags memProps = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
 
-    // Create, Initialize1xŏ邽߂̍쐬֐
-    static std::shared_ptr<StagingBuffer> Create(VkDeviceSize size)
+    // Create, Initializeを1度で処理するための作成関数
+    static std::shared_ptr<StagingBuffer> Create(VkDeviceSize size, VkMemoryPropertyFlags memProps = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT)
     {
         auto buffer = GPUResourceBase::Create();
-        if (!buffer->Initialize(size)) { return nullptr; }
+        if (!buffer->Initialize(size, memProps)) { return nullptr; }
         return buffer;
     }
 };
@@ -173,7 +225,7 @@ public:
 
     bool Initialize(VkDeviceSize size, VkMemoryPropertyFlags memProps);
 
-    // Create, Initialize1xŏ邽߂̍쐬֐
+    // Create, Initializeを1度で処理するための作成関数
     static std::shared_ptr<IndexBuffer> Create(VkDeviceSize size, VkMemoryPropertyFlags memProps)
     {
         auto buffer = GPUResourceBase::Create();
@@ -192,13 +244,37 @@ public:
     virtual void* Map() override;
     virtual void Unmap() override;
 
-    bool Initialize(VkDeviceSize size);
+    //memPropsにHOST_CACHEDなどノンコヒーレントな組み合わせを指定した場合は、書き込み後にFlushが必要
+    bool Initialize(VkDeviceSize size, VkMemoryPropertyFlags memProps = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
 
-    // Create, Initialize1xŏ邽߂̍쐬֐
-    static std::shared_ptr<UniformBuffer> Create(VkDeviceSize size)
+    // Create, Initializeを1度で処理するための作成関数
+    static std::shared_ptr<UniformBuffer> Create(VkDeviceSize size, VkMemoryPropertyFlags memProps = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT)
     {
         auto buffer = GPUResourceBase::Create();
-        if (!buffer->Initialize(size)) { return nullptr; }
+        if (!buffer->Initialize(size, memProps)) { return nullptr; }
+        return buffer;
+    }
+};
+
+//シェーダーから読み書きするストレージバッファ(バインドレスでのオブジェクト毎のデータなど)
+class StorageBuffer : public BufferResource<StorageBuffer>
+{
+    friend class GPUResourceBase<StorageBuffer>;
+private:
+    StorageBuffer() = default;
+public:
+    virtual ~StorageBuffer() = default;
+
+    virtual void* Map() override;
+    virtual void Unmap() override;
+
+    bool Initialize(VkDeviceSize size, VkMemoryPropertyFlags memProps);
+
+    // Create, Initializeを1度で処理するための作成関数
+    static std::shared_ptr<StorageBuffer> Create(VkDeviceSize size, VkMemoryPropertyFlags memProps)
+    {
+        auto buffer = GPUResourceBase::Create();
+        if (!buffer->Initialize(size, memProps)) { return nullptr; }
         return buffer;
     }
 };
@@ -1,15 +1,28 @@
 #pragma once
 
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
 #include "core/VulkanContext.h"
 #include "core/ImageBarrier.h"
 
+class ShaderObject;
+class IImageResource;
+class IBufferResource;
+
 class CommandBuffer
 {
 public:
-    CommandBuffer(VkCommandBuffer commandBuffer);
+    //commandPool は解放時に返却する先
+    //省略時はプールのリセットでまとめて回収されるものとして個別には解放しない
+    CommandBuffer(VkCommandBuffer commandBuffer, VkCommandPool commandPool = VK_NULL_HANDLE);
     virtual ~CommandBuffer();
 
     void Begin(VkCommandBufferUsageFlags usageFlag = 0);
+    //動的レンダリングの内側で実行される二次コマンドバッファとして記録を開始する
+    void BeginSecondary(const VkCommandBufferInheritanceRenderingInfo& inheritanceRendering);
+    //保留中のバリアを発行し、追跡したリソースの状態をリソースへ書き戻してから記録を終える
     void End();
     void Reset();
 
@@ -18,9 +31,115 @@ public:
     operator VkCommandBuffer() { return m_commandBuffer; }
     operator VkCommandBuffer() const { return m_commandBuffer; }
 
+    //リソースを次に使う時の状態(レイアウト, ステージ, アクセス)を指定する
+    //バリアはすぐには発行せず、次の描画, ディスパッチ, コピー, レンダリング開始, 記録終了時に
+    //保留中のものをまとめて1回のvkCmdPipelineBarrier2で発行する
+    //読み取り同士でレイアウトも同じ場合など、既に満たしている状態への遷移は省く
+    //discardContentsは以前の内容が不要な場合(クリアする描画先など)にUNDEFINEDから遷移させる
+    //リソースの状態は記録順に引き継がれるため、同じリソースを使うコマンドバッファは提出順に記録すること
+    //記録を終えるまでリソースを破棄しないこと
+    void RequireImageState(IImageResource& image, VkImageLayout layout,
+        VkPipelineStageFlags2 stage, VkAccessFlags2 access, bool discardContents = false);
+    void RequireBufferState(IBufferResource& buffer, VkPipelineStageFlags2 stage, VkAccessFlags2 access);
+
+    //状態を追跡しないイメージ(スワップチェインのイメージなど)の遷移。保留中のバリアに加える
     void TransitionLayout(VkImage image, const VkImageSubresourceRange& range,
         const ImageLayoutTransition& transition);
 
+    //保留中のバリアを直ちに発行する(vkCmd*を直接記録する前に呼ぶ)
+    void FlushBarriers();
+
+    //保留中のバリアを発行してから記録するコマンド
+    void BeginRendering(const VkRenderingInfo& renderingInfo);
+    void EndRendering();
+    void Draw(uint32_t vertexCount, uint32_t instanceCount = 1, uint32_t firstVertex = 0, uint32_t firstInstance = 0);
+    void DrawIndexed(uint32_t indexCount, uint32_t instanceCount = 1, uint32_t firstIndex = 0,
+        int32_t vertexOffset = 0, uint32_t firstInstance = 0);
+    void Dispatch(uint32_t groupCountX, uint32_t groupCountY = 1, uint32_t groupCountZ = 1);
+    void CopyBuffer(VkBuffer src, VkBuffer dst, const VkBufferCopy& region);
+    void CopyBufferToImage(VkBuffer src, VkImage dst, VkImageLayout dstLayout, const VkBufferImageCopy& region);
+
+    //拡張ダイナミックステート(GraphicsPipelineBuilder::UseDynamicState)で作成したパイプラインの描画前に設定する
+    //二次コマンドバッファには引き継がれないため、それぞれで設定すること
+    //extentを指定する版はGraphicsPipelineBuilder::SetViewportと同じく上下を反転し、シザーは全体とする
+    void SetViewport(VkExtent2D extent);
+    void SetViewport(const VkViewport& viewport, const VkRect2D& scissor);
+    void SetCullMode(VkCullModeFlags cullMode);
+    void SetFrontFace(VkFrontFace frontFace);
+    void SetPrimitiveTopology(VkPrimitiveTopology topology);
+    void SetDepthTestEnable(bool enable);
+    void SetDepthWriteEnable(bool enable);
+    void SetDepthCompareOp(VkCompareOp compareOp);
+
+    //VK_EXT_shader_object(ShaderObject)で描画する場合は、上の拡張ダイナミックステートに加えて以下も設定する
+    //SetShaderObjectDefaultsは描画毎に変えることの少ないステートをまとめて既定値(パイプラインの既定と同じ)にする
+    //(深度バイアス, ステンシル, プリミティブリスタートなどは無効, 塗りつぶし, 1サンプル, ブレンドなし)
+    void BindShaderObject(const ShaderObject& shaderObject);
+    void SetShaderObjectDefaults();
+    void SetVertexInput(
+        const VkVertexInputBindingDescription* bindings,
+        uint32_t bindingCount,
+        const VkVertexInputAttributeDescription* attributes,
+        uint32_t attributeCount);
+    void SetPolygonMode(VkPolygonModeEXT polygonMode);
+    void SetRasterizationSamples(VkSampleCountFlagBits samples);
+    //カラーアタッチメント0のブレンドの有効化, 式, 書き込みマスク
+    void SetColorBlend(const VkPipelineColorBlendAttachmentState& state);
+
+    //二次コマンドバッファを並び順に実行する
+    void ExecuteCommands(const std::vector<std::shared_ptr<CommandBuffer>>& commandBuffers);
+
+    //二次コマンドバッファへ [begin, end) の範囲の描画を記録する関数
+    using SecondaryRecordFunc = std::function<void(CommandBuffer& secondary, uint32_t begin, uint32_t end)>;
+
+    //動的レンダリングのパスをワーカースレッドで分担して記録する
+    //[0, itemCount) を taskCount 個(0の場合はスレッド数)に分割し、各範囲を現在のフレームの
+    //スレッド別プールから得た二次コマンドバッファへ記録した後、範囲の順番通りに実行する
+    //ビューポートなどの動的ステートは引き継がれないため、record内で設定すること
+    void RecordRenderingParallel(const VkRenderingInfo& renderingInfo,
+        const VkCommandBufferInheritanceRenderingInfo& inheritanceRendering,
+        uint32_t itemCount, const SecondaryRecordFunc& record, uint32_t taskCount = 0);
+
 private:
+    //記録中のリソースのアクセス状態
+    //write* : 最後の書き込み(レイアウト遷移を含む)。後の読み書きはこれを待つ
+    //read*  : 最後の書き込みの後、バリアで見えるようにした読み取り。後の書き込みはこれも待つ
+    struct AccessState
+    {
+        VkPipelineStageFlags2 writeStage;
+        VkAccessFlags2 writeAccess;
+        VkPipelineStageFlags2 readStage;
+        VkAccessFlags2 readAccess;
+        int32_t pendingIndex; //保留中のバリアの位置(なければ-1)
+    };
+    struct ImageState
+    {
+        IImageResource* resource;
+        VkImageLayout layout;
+        AccessState access;
+    };
+    struct BufferState
+    {
+        IBufferResource* resource;
+        AccessState access;
+    };
+
+    //リソースに記録されている最後の使われ方から状態を作る
+    static AccessState MakeAccessState(VkPipelineStageFlags2 stage, VkAccessFlags2 access);
+    //stage, accessで使うためにバリアが必要か判定し、必要な場合は待つ対象をsrcStage, srcAccessに返す
+    //stateは使った後のものへ更新する
+    static bool UpdateAccessState(AccessState& state, bool layoutChange,
+        VkPipelineStageFlags2 stage, VkAccessFlags2 access,
+        VkPipelineStageFlags2& srcStage, VkAccessFlags2& srcAccess);
+
+    //追跡した状態をリソースへ書き戻して忘れる
+    void WriteBackStates();
+
     VkCommandBuffer m_commandBuffer{};
+    VkCommandPool m_commandPool{};
+
+    std::unordered_map<VkImage, ImageState> m_imageStates;
+    std::unordered_map<VkBuffer, BufferState> m_bufferStates;
+    std::vector<VkImageMemoryBarrier2> m_pendingImageBarriers;
+    std::vector<VkBufferMemoryBarrier2> m_pendingBufferBarriers;
 };
\ No newline at end of file
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <stdint.h>
+
+class CommandBuffer;
+
+//フレーム(または提出)単位で使い回すTRANSIENTコマンドプールのリング
+//スロット毎・スレッド毎(WorkerThreadPoolのスレッド番号)にプールを持ち、コマンドバッファは確保済みのものを先頭から順に払い出す
+//スロットのGPU処理が完了した時点でプールごとリセットするため、個別の解放, リセットは行わない
+class CommandPoolRing
+{
+public:
+    CommandPoolRing() = default;
+    ~CommandPoolRing() = default;
+
+    CommandPoolRing(const CommandPoolRing&) = delete;
+    CommandPoolRing& operator=(const CommandPoolRing&) = delete;
+
+    //threadCount はワーカースレッド数+1(番号0はワーカー以外のスレッド)
+    bool Initialize(VkDevice device, uint32_t queueFamilyIndex, uint32_t slotCount, uint32_t threadCount);
+    //GPUが全スロットの使用を終えてから呼ぶ
+    void Cleanup();
+
+    //使用するスロットを切り替え、そのスロットの全プールをリセットする
+    //スロットを前回使用した提出の完了後に呼ぶこと
+    void BeginSlot(uint32_t slot);
+
+    //現在のスロットから呼び出しスレッド用のコマンドバッファを払い出す
+    //次に同じスロットがBeginSlotされるまで有効
+    //番号0のプールは共有されるため、ワーカー以外で呼び出せるのは1スレッド(メインスレッド)のみ
+    std::shared_ptr<CommandBuffer> Acquire(VkCommandBufferLevel level = VK_COMMAND_BUFFER_LEVEL_PRIMARY);
+
+    uint32_t GetSlotCount() const { return uint32_t(m_slots.size()); }
+    uint32_t GetCurrentSlot() const { return m_currentSlot.load(std::memory_order_acquire); }
+
+private:
+    //1スレッドが1スロットで使用するプール
+    struct ThreadPool
+    {
+        VkCommandPool pool = VK_NULL_HANDLE;
+        std::vector<std::shared_ptr<CommandBuffer>> buffers[2]; //[PRIMARY, SECONDARY]
+        uint32_t usedCount[2] = {};
+    };
+    struct Slot
+    {
+        std::vector<std::unique_ptr<ThreadPool>> threadPools; //[スレッド番号] 初回使用時に作成
+    };
+
+    ThreadPool* GetThreadPool(uint32_t slot);
+
+    VkDevice m_device = VK_NULL_HANDLE;
+    uint32_t m_queueFamilyIndex = 0;
+    std::atomic<uint32_t> m_currentSlot = 0;
+
+    std::vector<Slot> m_slots;
+};
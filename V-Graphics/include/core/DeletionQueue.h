@@ -0,0 +1,38 @@
+#pragma once
+
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <stdint.h>
+
+//GPUが参照し終えたVulkanオブジェクトを後から破棄するためのキュー
+//破棄処理をタイムライン値と共に登録し、GPUがその値を完了した時点でまとめて実行する
+//これにより記録済みのコマンドが参照しているリソースも、デバイスの待機なしに手放せる
+class DeletionQueue
+{
+public:
+    using Deleter = std::function<void()>;
+
+    DeletionQueue() = default;
+    ~DeletionQueue() = default;
+
+    DeletionQueue(const DeletionQueue&) = delete;
+    DeletionQueue& operator=(const DeletionQueue&) = delete;
+
+    //timelineValueの完了後に実行する破棄処理を登録する(複数スレッドから呼び出し可能)
+    void Push(uint64_t timelineValue, Deleter deleter);
+
+    //completedValueまでに登録された破棄処理を実行する
+    void Collect(uint64_t completedValue);
+
+    //登録済みの全ての破棄処理を実行する(GPUがアイドル状態であること)
+    void Flush();
+
+    size_t GetPendingCount() const;
+
+private:
+    void Execute(std::deque<std::pair<uint64_t, Deleter>>& entries);
+
+    std::deque<std::pair<uint64_t, Deleter>> m_entries; //[タイムライン値, 破棄処理](値の昇順)
+    mutable std::mutex m_mutex;
+};
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <vector>
+#include <mutex>
+#include <unordered_map>
+#include <stdint.h>
+
+//ディスクリプタの種類の構成比(1セットあたりの平均個数)
+struct DescriptorPoolRatio
+{
+    VkDescriptorType type;
+    float ratio;
+};
+
+//同じ構成比のディスクリプタプールを必要に応じて追加していくアロケータ
+//プールが枯渇(VK_ERROR_OUT_OF_POOL_MEMORY, FRAGMENTED_POOL)した場合は、より大きなプールを作って確保し直す
+//・フレーム用 : Resetで全プールをまとめてリセットする(個別の解放はできない)
+//・常駐用     : FREE_DESCRIPTOR_SET_BITを付けて作り、Freeで個別に解放する
+class DescriptorAllocator
+{
+public:
+    //1プールあたりのセット数の上限(プールを追加する度に倍にしていく)
+    static constexpr uint32_t MaxSetsPerPool = 4096;
+
+    DescriptorAllocator() = default;
+    ~DescriptorAllocator() = default;
+
+    DescriptorAllocator(const DescriptorAllocator&) = delete;
+    DescriptorAllocator& operator=(const DescriptorAllocator&) = delete;
+
+    void Initialize(VkDevice device, uint32_t initialSets, const std::vector<DescriptorPoolRatio>& ratios, bool freeable);
+    void Cleanup();
+
+    //確保に失敗するのはデバイスメモリが尽きた場合のみ
+    bool Allocate(VkDescriptorSetLayout layout, VkDescriptorSet& descriptorSet, const void* pNext = nullptr);
+    //常駐用のみ
+    void Free(VkDescriptorSet descriptorSet);
+    //フレーム用 : 全プールをリセットし、確保した全セットを無効にする
+    void Reset();
+
+    uint32_t GetPoolCount() const { return uint32_t(m_fullPools.size() + m_readyPools.size()); }
+
+private:
+    VkDescriptorPool CreatePool(uint32_t setCount);
+    VkDescriptorPool GetReadyPool();
+
+    VkDevice m_device = VK_NULL_HANDLE;
+    std::vector<DescriptorPoolRatio> m_ratios;
+    bool m_freeable = false;
+    uint32_t m_setsPerPool = 0;
+
+    std::vector<VkDescriptorPool> m_readyPools; //まだ空きがあると思われるプール(末尾から使う)
+    std::vector<VkDescriptorPool> m_fullPools;  //枯渇したプール
+    std::unordered_map<VkDescriptorSet, VkDescriptorPool> m_ownerPools; //常駐用 : セットの確保元
+    std::mutex m_mutex;
+};
@@ -0,0 +1,172 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <stdint.h>
+
+//大きなVkDeviceMemoryブロックからバッファ, イメージ用の領域を切り出すアロケータ
+//メモリタイプ毎にプールを持ち、ブロック内はバディ方式で管理する
+
+struct MemoryBlock;
+
+//リソースの種類(bufferImageGranularityを守るため、リニアとノンリニアでブロックを分ける)
+enum class AllocationKind
+{
+    Linear = 0,     //バッファ, リニアイメージ
+    Optimal,        //OPTIMALタイリングのイメージ
+    AllocationKindMax,
+};
+
+//メモリタイプの選択条件
+//requiredを全て持つタイプのうち、preferredを多く持ち、notPreferredを持たないものを優先する
+struct MemoryUsage
+{
+    VkMemoryPropertyFlags required = 0;
+    VkMemoryPropertyFlags preferred = 0;
+    VkMemoryPropertyFlags notPreferred = 0;
+
+    //必須のプロパティのみの指定から条件を作る
+    //GPU専用のリソースはHOST_VISIBLEを避け(ReBAR, UMAで小さなヒープを消費しないため)、
+    //CPUから書き込むだけのリソースはHOST_CACHEDを避ける
+    static MemoryUsage FromProperties(VkMemoryPropertyFlags properties);
+};
+
+//切り出された領域の情報
+struct DeviceAllocation
+{
+    VkDeviceMemory memory = VK_NULL_HANDLE;
+    VkDeviceSize   offset = 0;
+    VkDeviceSize   size = 0;
+    uint32_t       memoryTypeIndex = 0;
+    void*          mappedData = nullptr;  //HOST_VISIBLEの場合は常にマップ済みの先頭アドレス
+
+    //アロケータ内部での管理情報
+    MemoryBlock*   block = nullptr;      //nullptrの場合は専用割り当て
+    uint32_t       level = 0;
+};
+
+class DeviceMemoryAllocator
+{
+public:
+    //1ブロックの最大サイズ(小さなヒープではヒープサイズに合わせて縮小する)
+    static constexpr VkDeviceSize DefaultBlockSize = 64ull * 1024 * 1024;
+    //バディ分割の最小単位
+    //nonCoherentAtomSizeの上限(256)以上とし、ノンコヒーレントなメモリでもフラッシュ範囲が隣の領域へはみ出さないようにする
+    static constexpr VkDeviceSize MinAllocationSize = 256;
+
+    //ヒープ毎の統計情報
+    struct HeapStatistics
+    {
+        uint32_t blockCount = 0;            //確保済みVkDeviceMemoryの数(専用割り当て含む)
+        uint32_t allocationCount = 0;       //切り出した領域の数
+        VkDeviceSize blockBytes = 0;        //確保済みVkDeviceMemoryの合計サイズ
+        VkDeviceSize allocationBytes = 0;   //切り出した領域の合計サイズ
+    };
+
+    //ヒープ毎の予算と使用量
+    //VK_EXT_memory_budgetが使えない場合は、ヒープサイズの8割を予算, このアロケータの確保量を使用量とする
+    struct HeapBudget
+    {
+        VkDeviceSize heapSize = 0;
+        VkDeviceSize budget = 0;    //このプロセスが使用できる目安
+        VkDeviceSize usage = 0;     //このプロセスの使用量(前回の取得以降の確保分を加算した推定値)
+    };
+
+    DeviceMemoryAllocator();
+    ~DeviceMemoryAllocator();
+
+    DeviceMemoryAllocator(const DeviceMemoryAllocator&) = delete;
+    DeviceMemoryAllocator& operator=(const DeviceMemoryAllocator&) = delete;
+
+    //memoryBudget : VK_EXT_memory_budgetをデバイスで有効にしている場合はtrue
+    void Initialize(VkDevice device, VkPhysicalDevice physicalDevice, bool memoryBudget = false);
+    void Cleanup();
+
+    //メモリ要件を満たす領域を確保
+    //新たなVkDeviceMemoryが必要な場合は予算内に収まるタイプを優先度順に選び、
+    //全て予算を超える場合は予算を無視して優先度順に確保を試みる
+    bool Allocate(const VkMemoryRequirements& requirements, const MemoryUsage& usage,
+        AllocationKind kind, DeviceAllocation& allocation);
+    bool Allocate(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties,
+        AllocationKind kind, DeviceAllocation& allocation)
+    {
+        return Allocate(requirements, MemoryUsage::FromProperties(properties), kind, allocation);
+    }
+    void Free(DeviceAllocation& allocation);
+
+    //確保とバインドをまとめて行う
+    bool AllocateForBuffer(VkBuffer buffer, const MemoryUsage& usage, DeviceAllocation& allocation);
+    bool AllocateForImage(VkImage image, VkImageTiling tiling, const MemoryUsage& usage, DeviceAllocation& allocation);
+    bool AllocateForBuffer(VkBuffer buffer, VkMemoryPropertyFlags properties, DeviceAllocation& allocation)
+    {
+        return AllocateForBuffer(buffer, MemoryUsage::FromProperties(properties), allocation);
+    }
+    bool AllocateForImage(VkImage image, VkImageTiling tiling, VkMemoryPropertyFlags properties, DeviceAllocation& allocation)
+    {
+        return AllocateForImage(image, tiling, MemoryUsage::FromProperties(properties), allocation);
+    }
+
+    //条件に最も適したメモリタイプを返す(予算は考慮しない。該当なしはUINT32_MAX)
+    uint32_t FindMemoryTypeIndex(uint32_t memoryTypeBits, const MemoryUsage& usage) const;
+
+    //HOST_COHERENTでないメモリに対し、CPUの書き込みをGPUから見えるようにする(Flush)
+    //GPUの書き込みをCPUから見えるようにする(Invalidate)
+    //範囲はnonCoherentAtomSize単位に広げる。コヒーレントなメモリでは何もしない
+    void Flush(const DeviceAllocation& allocation, VkDeviceSize offset = 0, VkDeviceSize size = VK_WHOLE_SIZE) const;
+    void Invalidate(const DeviceAllocation& allocation, VkDeviceSize offset = 0, VkDeviceSize size = VK_WHOLE_SIZE) const;
+    bool IsHostCoherent(uint32_t memoryTypeIndex) const;
+
+    std::vector<HeapStatistics> GetHeapStatistics() const;
+
+    //VK_EXT_memory_budgetから予算と使用量を取得し直す(フレーム毎に呼ぶ)
+    void UpdateBudget();
+    std::vector<HeapBudget> GetHeapBudgets() const;
+    bool IsMemoryBudgetSupported() const { return m_memoryBudgetSupported; }
+
+private:
+    struct MemoryPool
+    {
+        VkDeviceSize blockSize = 0;
+        std::vector<std::unique_ptr<MemoryBlock>> blocks;
+    };
+
+    //ドライバから取得した予算情報
+    struct BudgetSnapshot
+    {
+        VkDeviceSize budget = 0;
+        VkDeviceSize usage = 0;
+        VkDeviceSize blockBytes = 0;    //取得時点でのこのアロケータの確保量
+    };
+
+    //条件に合うタイプを優先度順に並べる
+    std::vector<uint32_t> GetMemoryTypeCandidates(uint32_t memoryTypeBits, const MemoryUsage& usage) const;
+    //指定タイプから確保する(withinBudgetがtrueなら、予算を超える新規のVkDeviceMemoryは確保しない)
+    bool AllocateFromType(const VkMemoryRequirements& requirements, uint32_t memoryTypeIndex,
+        AllocationKind kind, bool withinBudget, DeviceAllocation& allocation);
+    bool IsWithinBudget(uint32_t memoryTypeIndex, VkDeviceSize size) const;
+    HeapBudget GetHeapBudget(uint32_t heapIndex) const;
+    void FetchBudget();
+
+    MemoryBlock* CreateBlock(uint32_t memoryTypeIndex, VkDeviceSize size);
+    void DestroyBlock(MemoryBlock* block);
+    bool AllocateDedicated(const VkMemoryRequirements& requirements, uint32_t memoryTypeIndex, DeviceAllocation& allocation);
+
+    MemoryPool& GetPool(uint32_t memoryTypeIndex, AllocationKind kind);
+    bool IsHostVisible(uint32_t memoryTypeIndex) const;
+    //割り当て内の範囲をフラッシュ, 無効化用のアトム境界に揃えた範囲に変換する
+    VkMappedMemoryRange GetMappedRange(const DeviceAllocation& allocation, VkDeviceSize offset, VkDeviceSize size) const;
+
+    VkDevice m_device = VK_NULL_HANDLE;
+    VkPhysicalDevice m_physicalDevice = VK_NULL_HANDLE;
+    VkPhysicalDeviceMemoryProperties m_memoryProperties{};
+    VkDeviceSize m_bufferImageGranularity = 1;
+    VkDeviceSize m_nonCoherentAtomSize = 1;
+
+    std::vector<MemoryPool> m_pools;   //[memoryTypeIndex * AllocationKindMax + kind]
+    std::vector<HeapStatistics> m_heapStats;
+    std::vector<BudgetSnapshot> m_budgets;  //[heapIndex]
+    bool m_memoryBudgetSupported = false;
+    mutable std::mutex m_mutex;
+};
@@ -5,7 +5,7 @@ template<typename T>
 class GPUResourceBase
 {
 public:
-    // Rs[͋֎~
+    // コピーは禁止
     GPUResourceBase(const GPUResourceBase&) = delete;
     GPUResourceBase& operator=(const GPUResourceBase&) = delete;
 
@@ -13,5 +13,5 @@ public:
 
     static std::shared_ptr<T> Create() { return std::shared_ptr<T>(new T()); }
 protected:
-    GPUResourceBase() = default;    // Create֐ō쐬𐧌邽
+    GPUResourceBase() = default;    // Create関数で作成を制限するため
 };
\ No newline at end of file
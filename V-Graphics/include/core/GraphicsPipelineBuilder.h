@@ -3,69 +3,134 @@
 #include <vulkan/vulkan.h>
 #include <vector>
 
+#include "core/SpecializationConstants.h"
+
 class GraphicsPipelineBuilder
 {
 public:
+    // vkCreateGraphicsPipelinesに渡す作成情報と、それが指すステート
+    // 自身のメンバーを指すためコピー, 移動はできない
+    struct CreateInfo
+    {
+        CreateInfo() = default;
+        CreateInfo(const CreateInfo&) = delete;
+        CreateInfo& operator=(const CreateInfo&) = delete;
+
+        VkGraphicsPipelineCreateInfo pipeline{};
+        VkPipelineVertexInputStateCreateInfo vertexInputState{};
+        VkPipelineViewportStateCreateInfo viewportState{};
+        VkPipelineColorBlendStateCreateInfo colorBlendState{};
+        VkPipelineDynamicStateCreateInfo dynamicState{};
+        VkPipelineRenderingCreateInfo renderingInfo{};
+        std::vector<VkPipelineShaderStageCreateInfo> stages;
+        std::vector<VkSpecializationInfo> specializationInfos; // stagesと同じ並び
+        std::vector<VkShaderModuleCreateInfo> moduleInfos;      // stagesと同じ並び(VK_KHR_maintenance5でモジュールの代わりに渡す)
+
+        // パイプラインライブラリとして作成する場合に使う
+        VkGraphicsPipelineLibraryCreateInfoEXT libraryInfo{};
+    };
+
     GraphicsPipelineBuilder();
 
-    // eXe[Wǉ
+    // 各ステージ追加
     GraphicsPipelineBuilder& AddShaderStage(VkShaderStageFlagBits stage, VkShaderModule module, const char* entry = "main");
+    // 特殊化定数を指定して追加する。値もステートのハッシュに含むため、値毎に別のパイプラインとして登録される
+    GraphicsPipelineBuilder& AddShaderStage(VkShaderStageFlagBits stage, VkShaderModule module,
+        const SpecializationConstants& constants, const char* entry = "main");
 
-    // _̓CAEg
+    // 頂点入力レイアウト
     GraphicsPipelineBuilder& SetVertexInput(
         const VkVertexInputBindingDescription* bindings,
         uint32_t bindingCount,
         const VkVertexInputAttributeDescription* attributes,
         uint32_t attributeCount);
 
-    // r[|[gƃVU[
+    // ビューポートとシザー
     GraphicsPipelineBuilder& SetViewport(VkExtent2D extent);
     GraphicsPipelineBuilder& SetViewport(VkViewport& viewport, VkRect2D scissor);
 
-    // ufBOݒ
+    // Vulkan 1.3の拡張ダイナミックステートを使う
+    // ビューポート, シザー(個数も含む), カリング, 表面の向き, トポロジー, デプステスト・書き込み・比較関数を
+    // パイプラインに焼き込まず、描画時にCommandBufferの各Set関数で設定する
+    // これらの値はステートのハッシュにも含めないため、違いだけのパイプラインは1つにまとまる
+    // (トポロジーは点, 線, 三角形, パッチの区分のみパイプラインに残る)
+    GraphicsPipelineBuilder& UseDynamicState(bool enable = true);
+    bool IsDynamicStateEnabled() const { return m_dynamicStateEnabled; }
+
+    VkPipelineLayout GetPipelineLayout() const { return m_pipelineLayout; }
+
+    // ブレンディング設定
     void SetColorBlendAttachmentState(const VkPipelineColorBlendAttachmentState& state);
 
-    // X^CYݒ
+    // ラスタライズ設定
     void SetRasterizationState(const VkPipelineRasterizationStateCreateInfo& state);
 
-    // fvXEXeVݒ
+    // デプス・ステンシル設定
     void SetDepthStencilState(const VkPipelineDepthStencilStateCreateInfo& state);
 
-    // CAEg
+    // レイアウト
     GraphicsPipelineBuilder& SetPipelineLayout(VkPipelineLayout layout);
 
-    // VkRenderPassgpꍇ̐ݒ
+    // VkRenderPassを使用する場合の設定
     GraphicsPipelineBuilder& UseRenderPass(VkRenderPass renderPass, uint32_t subpass);
 
-    // DynamicRenderinggpꍇ̐ݒ
+    // DynamicRenderingを使用する場合の設定
     GraphicsPipelineBuilder& UseDynamicRendering(VkFormat colorFormat, VkFormat depthFormat = VK_FORMAT_UNDEFINED);
 
-    // pCvC쐬
-    VkPipeline Build();
+    // パイプライン作成
+    VkPipeline Build() const;
+
+    // 作成情報を書き出す(ビルダーが破棄されるまで有効)
+    // 複数のパイプラインを1回のvkCreateGraphicsPipelinesでまとめて作成する場合に使う
+    void WriteCreateInfo(CreateInfo& createInfo) const;
+    // partsの部分だけをVK_EXT_graphics_pipeline_libraryのライブラリとして作成する作成情報を書き出す
+    // 最適化したリンクもできるよう、リンク時最適化の情報を保持させる
+    void WriteLibraryCreateInfo(CreateInfo& createInfo, VkGraphicsPipelineLibraryFlagsEXT parts) const;
+    // builders[i]からpipelines[i]を作成する(1つでも失敗した場合は全て破棄してVK_NULL_HANDLEを入れる)
+    static VkResult BuildBatch(const GraphicsPipelineBuilder* const* builders, uint32_t count, VkPipeline* pipelines);
 
-    // ̓AZuύX(ebZ[VȂǂŎgp)
+    // 入力アセンブリを変更(テッセレーションなどで使用)
     GraphicsPipelineBuilder& SetInputAssembly(const VkPipelineInputAssemblyStateCreateInfo& state);
 
-    // ebZ[V̐ݒ
+    // テッセレーション情報の設定
     GraphicsPipelineBuilder& SetTessellation(bool enable, const VkPipelineTessellationStateCreateInfo& state);
+
+    // 作成されるパイプラインを決める全ステートのハッシュ(PipelineRegistryのキー)
+    // ShaderModuleCacheのシェーダーモジュールはSPIR-Vの内容で区別する
+    // それ以外のモジュール, レイアウトはハンドルで区別するため、登録中のパイプラインが参照するものは破棄しないこと
+    // stateを指定すると、ハッシュしたステートを書き出す(ハッシュの衝突を見分けるため)
+    uint64_t GetStateHash(std::vector<uint8_t>* state = nullptr) const;
+    // ライブラリの1つの部分を決めるステートのハッシュ(部分の種類も含む)。stateはGetStateHashと同様
+    uint64_t GetLibraryStateHash(VkGraphicsPipelineLibraryFlagBitsEXT part, std::vector<uint8_t>* state = nullptr) const;
+
+    // 追加したステージのシェーダーモジュール
+    std::vector<VkShaderModule> GetShaderModules() const;
 private:
+    // index番目のステージのシェーダー, エントリポイント, 特殊化定数をハッシュに加える
+    void HashShaderStage(Hasher& hasher, size_t index) const;
+    // ライブラリの部分毎のステートをハッシュに加える(全て合わせるとGetStateHashになる)
+    void HashVertexInputState(Hasher& hasher) const;
+    void HashPreRasterizationState(Hasher& hasher) const;
+    void HashFragmentShaderState(Hasher& hasher) const;
+    void HashFragmentOutputState(Hasher& hasher) const;
+    void HashMultisampleState(Hasher& hasher) const;
+    void HashRenderingState(Hasher& hasher, bool includeFormats) const;
+
     VkDevice m_device;
 
     std::vector<VkPipelineShaderStageCreateInfo> m_shaderStages;
+    std::vector<SpecializationConstants> m_specializations; // m_shaderStagesと同じ並び(指定なしは空)
 
-    VkPipelineVertexInputStateCreateInfo m_vertexInputState{};
     std::vector<VkVertexInputBindingDescription> m_bindingDescriptions;
     std::vector<VkVertexInputAttributeDescription> m_attributeDescriptions;
 
     VkPipelineInputAssemblyStateCreateInfo m_inputAssemblyState{};
-    VkPipelineViewportStateCreateInfo m_viewportState{};
     VkViewport m_viewport{};
     VkRect2D m_scissor{};
 
     VkPipelineRasterizationStateCreateInfo m_rasterizerState{};
     VkPipelineMultisampleStateCreateInfo m_multisampleState{};
     VkPipelineColorBlendAttachmentState m_colorBlendAttachment{};
-    VkPipelineColorBlendStateCreateInfo m_colorBlendState{};
     VkPipelineDepthStencilStateCreateInfo m_depthStencilState{};
 
     bool m_tessellationEnabled = false;
@@ -75,6 +140,8 @@ private:
     VkFormat m_colorFormat = VK_FORMAT_UNDEFINED;
     VkFormat m_depthFormat = VK_FORMAT_UNDEFINED;
 
+    bool m_dynamicStateEnabled = false;
+
     bool m_useRenderPass = false;
     VkRenderPass m_renderPass = VK_NULL_HANDLE;
     uint32_t m_subpass = 0;
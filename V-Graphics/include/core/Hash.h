@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+//FNV-1aによる64bitハッシュ
+//構造体のパディングを含めないよう、状態をフィールド単位で積み上げてキーを作る
+//recordを指定すると加えた内容も書き出す。ハッシュが一致した登録と内容を比べ、衝突を見分けるために使う
+class Hasher
+{
+public:
+    Hasher() = default;
+    explicit Hasher(std::vector<uint8_t>* record) : m_record(record) {}
+
+    Hasher& AddBytes(const void* data, size_t size)
+    {
+        auto bytes = static_cast<const uint8_t*>(data);
+        for (size_t i = 0; i < size; ++i)
+        {
+            m_hash ^= bytes[i];
+            m_hash *= Prime;
+        }
+        if (m_record != nullptr)
+        {
+            m_record->insert(m_record->end(), bytes, bytes + size);
+        }
+        return *this;
+    }
+
+    //数値, 列挙値, Vulkanのハンドル
+    template<typename T> requires std::is_arithmetic_v<T> || std::is_enum_v<T> || std::is_pointer_v<T>
+    Hasher& Add(T value)
+    {
+        return AddBytes(&value, sizeof(T));
+    }
+
+    //長さも加え、連続する文字列の区切りを区別する
+    Hasher& AddString(std::string_view str)
+    {
+        Add(str.size());
+        return AddBytes(str.data(), str.size());
+    }
+
+    uint64_t Get() const { return m_hash; }
+
+private:
+    static constexpr uint64_t OffsetBasis = 14695981039346656037ull;
+    static constexpr uint64_t Prime = 1099511628211ull;
+
+    uint64_t m_hash = OffsetBasis;
+    std::vector<uint8_t>* m_record = nullptr;
+};
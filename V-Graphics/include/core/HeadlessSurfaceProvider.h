@@ -0,0 +1,19 @@
+#pragma once
+
+#include "ISurfaceProvider.h"
+
+//ウィンドウを持たない環境(サーバー, ベンチマーク)向けのサーフェスプロバイダ
+//サーフェスは作成せず、指定解像度のオフスクリーンスワップチェインで描画する
+class HeadlessSurfaceProvider : public ISurfaceProvider
+{
+public:
+    HeadlessSurfaceProvider(uint32_t width, uint32_t height);
+    VkSurfaceKHR CreateSurface(VkInstance instance) override;
+    uint32_t GetFramebufferWidth() const override;
+    uint32_t GetFramebufferHeight() const override;
+    bool IsHeadless() const override { return true; }
+
+private:
+    uint32_t m_width;
+    uint32_t m_height;
+};
@@ -9,4 +9,7 @@ public:
     virtual VkSurfaceKHR CreateSurface(VkInstance instance) = 0;
     virtual uint32_t GetFramebufferWidth() const = 0;
     virtual uint32_t GetFramebufferHeight() const = 0;
+
+    //trueの場合はサーフェスを作成せず、オフスクリーンのイメージへ描画する
+    virtual bool IsHeadless() const { return false; }
 };
\ No newline at end of file
@@ -11,14 +11,14 @@ struct ImageLayoutTransition
     VkPipelineStageFlags srcStage;
     VkPipelineStageFlags dstStage;
 
-    //`ł悭gCAEg͈ȉ֐ŗeՂɓ悤ɂ
+    //描画でよく使うレイアウトは以下関数で容易に得られるようにする
 
-    //UndefinedԂ`ƂẴCAEg
+    //Undefined状態から描画先としてのレイアウトへ
     static ImageLayoutTransition FromUndefinedToColorAttachment();
 
-    //PresentSrcԂ`ƂẴCAEg
+    //PresentSrc状態から描画先としてのレイアウトへ
     static ImageLayoutTransition FromPresentSrcToColorAttachment();
 
-    //`悩PresentSrc̏ԃCAEg
+    //描画先からPresentSrcの状態レイアウトへ
     static ImageLayoutTransition FromColorToPresent();
 };
\ No newline at end of file
@@ -5,16 +5,31 @@
 class IImageResource
 {
 public:
+    virtual ~IImageResource() = default;
+
     virtual VkFormat GetFormat() const = 0;
     virtual VkExtent2D GetExtent() const = 0;
     virtual uint32_t GetMipmapCount() const = 0;
 
     virtual VkImage GetVkImage() const = 0;
-    virtual void SetAccessFlag(const VkAccessFlags flags) = 0;
-    virtual VkAccessFlags GetAccessFlags() const = 0;
+    virtual VkImageView GetVkImageView() const = 0;
+    //イメージ全体(全ミップ, 全レイヤー)の範囲
+    virtual VkImageSubresourceRange GetSubresourceRange() const = 0;
+
+    //最後に記録したコマンドでの状態(CommandBuffer::RequireImageStateが記録終了時に更新する)
+    //ステージが0の場合は、まだGPUで使われていないものとして扱う
+    virtual void SetAccessFlag(const VkAccessFlags2 flags) = 0;
+    virtual VkAccessFlags2 GetAccessFlags() const = 0;
+    virtual void SetStageFlags(const VkPipelineStageFlags2 flags) = 0;
+    virtual VkPipelineStageFlags2 GetStageFlags() const = 0;
 
     virtual void SetLayout(VkImageLayout layout) = 0;
     virtual VkImageLayout GetLayout() const = 0;
+
+    //バインドレスヒープ上のサンプルイメージのインデックス(初回呼び出し時に登録する)
+    //シェーダーからはREAD_ONLY_OPTIMALレイアウトで参照する
+    //SAMPLEDの用途で作成していない場合, ヒープが使えない場合はBindlessHeap::InvalidIndex
+    virtual uint32_t GetBindlessIndex() = 0;
 };
 
 template<typename T>
@@ -31,24 +46,80 @@ public:
     virtual uint32_t GetMipmapCount() const override { return m_mipLevels; }
 
     virtual VkImage GetVkImage() const override { return m_image; }
-    virtual void SetAccessFlag(const VkAccessFlags flags) { m_accessFlags = flags; }
-    virtual VkAccessFlags GetAccessFlags() const { return m_accessFlags; }
+    virtual VkImageSubresourceRange GetSubresourceRange() const override { return m_subresourceRange; }
+    virtual void SetAccessFlag(const VkAccessFlags2 flags) { m_accessFlags = flags; }
+    virtual VkAccessFlags2 GetAccessFlags() const { return m_accessFlags; }
+    virtual void SetStageFlags(const VkPipelineStageFlags2 flags) { m_stageFlags = flags; }
+    virtual VkPipelineStageFlags2 GetStageFlags() const { return m_stageFlags; }
 
     virtual void SetLayout(VkImageLayout layout) { m_layout = layout; }
     virtual VkImageLayout GetLayout() const { return m_layout; }
 
+    virtual uint32_t GetBindlessIndex() override
+    {
+        auto* heap = VulkanContext::Get().GetBindlessHeap();
+        if (m_bindlessIndex == BindlessHeap::InvalidIndex &&
+            heap != nullptr &&
+            (m_usage & VK_IMAGE_USAGE_SAMPLED_BIT) != 0)
+        {
+            m_bindlessIndex = heap->RegisterSampledImage(GetVkImageView(), VK_IMAGE_LAYOUT_READ_ONLY_OPTIMAL);
+        }
+        return m_bindlessIndex;
+    }
+
 protected:
     ImageResource() = default;
 
+    //イメージ, ビュー, メモリをGPUが現在のフレームを終えてから破棄するよう登録する
+    //派生クラスのCleanupから呼ぶ
+    void DeferDestroyImage(VkImageView imageView)
+    {
+        if (m_image == VK_NULL_HANDLE && imageView == VK_NULL_HANDLE && m_allocation.memory == VK_NULL_HANDLE)
+        {
+            return;
+        }
+        auto& vulkanCtx = VulkanContext::Get();
+        vulkanCtx.DeferDestroy([device = vulkanCtx.GetVkDevice(), image = m_image, imageView, allocation = m_allocation]() mutable
+        {
+            if (imageView != VK_NULL_HANDLE)
+            {
+                vkDestroyImageView(device, imageView, nullptr);
+            }
+            if (image != VK_NULL_HANDLE)
+            {
+                vkDestroyImage(device, image, nullptr);
+            }
+            if (allocation.memory != VK_NULL_HANDLE)
+            {
+                VulkanContext::Get().GetMemoryAllocator().Free(allocation);
+            }
+        });
+        m_image = VK_NULL_HANDLE;
+        m_allocation = DeviceAllocation{};
+    }
+
+    //派生クラスのCleanupでビューの破棄前に呼ぶ
+    void ReleaseBindlessIndex()
+    {
+        if (m_bindlessIndex != BindlessHeap::InvalidIndex)
+        {
+            VulkanContext::Get().GetBindlessHeap()->Release(BindlessHeap::SampledImageBinding, m_bindlessIndex);
+            m_bindlessIndex = BindlessHeap::InvalidIndex;
+        }
+    }
+
     VkImage m_image = VK_NULL_HANDLE;
-    VkDeviceMemory m_memory = VK_NULL_HANDLE;
+    DeviceAllocation m_allocation{};
     VkImageSubresourceRange m_subresourceRange{};
-    VkAccessFlags m_accessFlags = VK_ACCESS_NONE;
+    VkAccessFlags2 m_accessFlags = VK_ACCESS_2_NONE;
+    VkPipelineStageFlags2 m_stageFlags = VK_PIPELINE_STAGE_2_NONE;
     VkImageLayout m_layout = VK_IMAGE_LAYOUT_UNDEFINED;
 
     VkFormat m_format = VK_FORMAT_UNDEFINED;
     VkExtent2D m_extent{};
     uint32_t m_mipLevels{};
+    VkImageUsageFlags m_usage{};
+    uint32_t m_bindlessIndex = BindlessHeap::InvalidIndex;
 };
 
 class DepthBuffer : public ImageResource<DepthBuffer>
@@ -60,9 +131,9 @@ public:
 
     bool Initialize(VkExtent2D extent, VkFormat depthFormat);
 
-    VkImageView GetVkImageView() const { return m_imageView; }
+    VkImageView GetVkImageView() const override { return m_imageView; }
 
-    // Create, Initialize1xŏ邽߂̍쐬֐
+    // Create, Initializeを1度で処理するための作成関数
     static std::shared_ptr<DepthBuffer> Create(VkExtent2D extent, VkFormat depthFormat)
     {
         auto image = GPUResourceBase::Create();
@@ -72,4 +143,57 @@ public:
 private:
     VkImageView m_imageView{};
 };
-        
\ No newline at end of file
+
+//カラーアタッチメントとして描画先に使用するイメージ
+class ColorBuffer : public ImageResource<ColorBuffer>
+{
+    friend class GPUResourceBase<ColorBuffer>;
+public:
+    virtual ~ColorBuffer() { Cleanup(); }
+    virtual void Cleanup() override;
+
+    bool Initialize(VkExtent2D extent, VkFormat colorFormat, VkImageUsageFlags usage);
+
+    VkImageView GetVkImageView() const override { return m_imageView; }
+
+    // Create, Initializeを1度で処理するための作成関数
+    static std::shared_ptr<ColorBuffer> Create(VkExtent2D extent, VkFormat colorFormat,
+        VkImageUsageFlags usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT)
+    {
+        auto image = GPUResourceBase::Create();
+        if (!image->Initialize(extent, colorFormat, usage)) { return nullptr; }
+        return image;
+    }
+private:
+    VkImageView m_imageView{};
+};
+        
+
+//メモリを所有しないイメージ
+//RenderGraphが寿命の重ならない一時イメージ同士で同じメモリを割り当ててからビューを作成する
+class TransientImage : public ImageResource<TransientImage>
+{
+    friend class GPUResourceBase<TransientImage>;
+public:
+    virtual ~TransientImage() { Cleanup(); }
+    //メモリは割り当てた側が解放する
+    virtual void Cleanup() override;
+
+    //イメージのみ作成する(メモリはBindMemoryで後からバインドする)
+    bool Initialize(VkExtent2D extent, VkFormat format, VkImageUsageFlags usage, VkImageAspectFlags aspect);
+    VkMemoryRequirements GetMemoryRequirements() const;
+    //memoryのoffsetの位置にバインドしてビューを作成する
+    bool BindMemory(VkDeviceMemory memory, VkDeviceSize offset);
+
+    VkImageView GetVkImageView() const override { return m_imageView; }
+
+    // Create, Initializeを1度で処理するための作成関数
+    static std::shared_ptr<TransientImage> Create(VkExtent2D extent, VkFormat format, VkImageUsageFlags usage, VkImageAspectFlags aspect)
+    {
+        auto image = GPUResourceBase::Create();
+        if (!image->Initialize(extent, format, usage, aspect)) { return nullptr; }
+        return image;
+    }
+private:
+    VkImageView m_imageView{};
+};
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+
+//ファイルを読み取り専用でメモリにマップする
+//内容はページ単位で必要になった時に読み込まれ、同じファイルを開いている他のマップとは物理メモリを共有する
+class MappedFile
+{
+public:
+    MappedFile() = default;
+    ~MappedFile() { Close(); }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    //開けない場合, 空のファイルはfalse
+    bool Open(const std::filesystem::path& path);
+    void Close();
+
+    bool IsOpen() const { return m_data != nullptr; }
+    const void* GetData() const { return m_data; }
+    size_t GetSize() const { return m_size; }
+
+private:
+    const void* m_data = nullptr;
+    size_t m_size = 0;
+#if defined(_WIN32)
+    void* m_file = nullptr;    //HANDLE
+    void* m_mapping = nullptr; //HANDLE
+#else
+    int m_fd = -1;
+#endif
+};
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <memory>
+
+#include "core/Swapchain.h"
+#include "core/ImageResource.h"
+
+//サーフェスを持たないヘッドレス環境向けのスワップチェイン
+//自前で確保したイメージを順番に描画先として切り替え、Presentは行わない
+class OffscreenSwapchain : public Swapchain
+{
+public:
+    //処理中のフレームが使うイメージを上書きしないよう、同時処理フレーム数+1枚以上を確保する
+    static constexpr uint32_t MinImageCount = 3;
+    static constexpr VkFormat ImageFormat = VK_FORMAT_B8G8R8A8_UNORM;
+
+    OffscreenSwapchain() = default;
+    virtual ~OffscreenSwapchain() = default;
+
+    bool Recreate(uint32_t newWidth, uint32_t newHeight) override;
+    void Cleanup() override;
+
+    VkResult AcquireNextImage() override;
+    VkResult QueuePresent(VkQueue queuePresent) override;
+
+    VkSemaphore GetPresentCompleteSemaphore() const override { return VK_NULL_HANDLE; }
+    VkSemaphore GetRenderCompleteSemaphore() const override { return VK_NULL_HANDLE; }
+
+    //描画結果の読み出し用に描画先イメージを取得
+    std::shared_ptr<ColorBuffer> GetColorBuffer(uint32_t index) const { return m_colorBuffers[index]; }
+
+private:
+    std::vector<std::shared_ptr<ColorBuffer>> m_colorBuffers;
+    uint64_t m_acquireCount = 0;
+};
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <filesystem>
+#include <shared_mutex>
+#include <unordered_map>
+#include <vector>
+
+//パイプラインのコンパイル結果を起動をまたいで再利用するためのキャッシュ
+//起動時にファイルから読み込み、終了時に書き出す
+//ファイルのヘッダー(ベンダー, デバイス, キャッシュUUID)が現在のデバイスと一致しない場合は空のキャッシュから始める
+//ワーカースレッドでのコンパイル結果はスレッド毎のキャッシュに溜め、書き出し時に本体へ統合する
+class PipelineCache
+{
+public:
+    PipelineCache() = default;
+    ~PipelineCache() = default;
+
+    PipelineCache(const PipelineCache&) = delete;
+    PipelineCache& operator=(const PipelineCache&) = delete;
+
+    //filePathが空の場合はファイルへの読み書きを行わない
+    bool Initialize(VkDevice device, const VkPhysicalDeviceProperties& properties, const std::filesystem::path& filePath);
+    //ファイルに書き出してから破棄する
+    void Cleanup();
+
+    //ワーカースレッドのキャッシュを本体に統合し、現在の内容をファイルに書き出す
+    //(書き込み途中のファイルを残さないよう一時ファイルから置き換える)
+    bool Save();
+
+    //キャッシュを使ってパイプラインを作成する
+    //マージと排他にするため、キャッシュを使う作成はここを経由すること
+    //ワーカースレッドからの呼び出しは、本体にあるものはそのまま作成し、コンパイルが必要なものだけをスレッドのキャッシュで作成する
+    VkResult CreateGraphicsPipelines(uint32_t count, const VkGraphicsPipelineCreateInfo* createInfos, VkPipeline* pipelines);
+
+    VkPipelineCache GetVkPipelineCache() const { return m_cache; }
+    //読み込んだデータが現在のデバイスで有効だったか
+    bool IsLoadedFromFile() const { return m_loadedFromFile; }
+
+private:
+    //ファイルを読み込み、ヘッダーが現在のデバイスと一致する場合のみデータを返す
+    std::vector<char> LoadFile() const;
+    //本体の内容を取り出す(失敗時は空)
+    std::vector<char> GetData();
+    //呼び出したワーカースレッドのキャッシュ(初回に空で作成する)。ワーカー以外のスレッドではVK_NULL_HANDLE
+    VkPipelineCache GetWorkerCache();
+    //ワーカースレッドのキャッシュを本体に統合する
+    void MergeWorkerCaches();
+    bool IsCompatible(const std::vector<char>& data) const;
+
+    VkDevice m_device = VK_NULL_HANDLE;
+    VkPipelineCache m_cache = VK_NULL_HANDLE;
+    std::unordered_map<uint32_t, VkPipelineCache> m_workerCaches; //スレッド番号 -> そのスレッドでコンパイルしたものだけのキャッシュ
+    std::filesystem::path m_filePath;
+
+    uint32_t m_vendorID = 0;
+    uint32_t m_deviceID = 0;
+    uint8_t m_cacheUUID[VK_UUID_SIZE]{};
+    bool m_loadedFromFile = false;
+
+    //作成(共有)とマージ, ワーカーのキャッシュの登録(排他)の同期
+    std::shared_mutex m_mutex;
+};
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <atomic>
+#include <mutex>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+class PipelineReflection;
+
+//ディスクリプタセットレイアウトとパイプラインレイアウトを内容で共有するキャッシュ(ハッシュが一致したものは内容も比べる)
+//同じ内容のレイアウトは同じハンドルになるため、パイプライン同士の互換性が保たれ、切り替え時にセットを結び直さずに済む
+//作成したレイアウトはCleanupまで保持する(取得した側は破棄しないこと)
+class PipelineLayoutCache
+{
+public:
+    struct Stats
+    {
+        uint64_t hits = 0;   //作成済みのレイアウトを返した回数
+        uint64_t misses = 0; //レイアウトを新たに作成した回数
+        uint32_t setLayoutCount = 0;
+        uint32_t pipelineLayoutCount = 0;
+    };
+    //リフレクションから作成したレイアウト
+    struct Layout
+    {
+        VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
+        std::vector<VkDescriptorSetLayout> setLayouts; //set番号順
+    };
+
+    PipelineLayoutCache() = default;
+    ~PipelineLayoutCache() = default;
+
+    PipelineLayoutCache(const PipelineLayoutCache&) = delete;
+    PipelineLayoutCache& operator=(const PipelineLayoutCache&) = delete;
+
+    void Initialize(VkDevice device);
+    //保持しているレイアウトを直ちに破棄する(デバイスがアイドルの状態で呼ぶ)
+    void Cleanup();
+
+    //同じ内容のものがあれば返し、なければ作成する(作成できない場合は例外)
+    //bindingsはbinding順に並べ替えてから比べる
+    VkDescriptorSetLayout AcquireSetLayout(std::span<const VkDescriptorSetLayoutBinding> bindings);
+    VkPipelineLayout AcquirePipelineLayout(std::span<const VkDescriptorSetLayout> setLayouts,
+        std::span<const VkPushConstantRange> pushConstantRanges);
+    //リフレクションの全セットのレイアウトと、それらを使うパイプラインレイアウト
+    //間の使われていないset番号は空のレイアウトで埋める
+    //登録したレイアウト(RegisterSetLayout)で賄えるセットは、新たに作成せずそのレイアウトを使う
+    Layout Acquire(const PipelineReflection& reflection);
+
+    //外部で作成したセットレイアウト(バインドレスヒープなど)をその内容と共に登録する(Cleanupでも破棄しない)
+    //シェーダーが宣言したbindingが全て実行時の大きさの配列で、同じ種類で含まれている場合のみ使う
+    //(登録したレイアウトはUPDATE_AFTER_BINDのプールが必要なため、通常のbindingのセットには使わない)
+    void RegisterSetLayout(VkDescriptorSetLayout setLayout, std::span<const VkDescriptorSetLayoutBinding> bindings);
+
+    Stats GetStats() const;
+
+private:
+    struct SetLayoutEntry
+    {
+        VkDescriptorSetLayout setLayout = VK_NULL_HANDLE;
+        std::vector<VkDescriptorSetLayoutBinding> bindings; //binding順。pImmutableSamplersは比べず、下に複製して持つ
+        std::vector<VkSampler> immutableSamplers;            //bindingsの順に連結したもの
+    };
+    struct PipelineLayoutEntry
+    {
+        VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
+        std::vector<VkDescriptorSetLayout> setLayouts;
+        std::vector<VkPushConstantRange> pushConstantRanges;
+    };
+
+    //bindingsを賄える登録済みのレイアウト(なければVK_NULL_HANDLE)
+    VkDescriptorSetLayout FindRegisteredSetLayout(std::span<const VkDescriptorSetLayoutBinding> bindings);
+
+    VkDevice m_device = VK_NULL_HANDLE;
+
+    mutable std::mutex m_mutex;
+    std::unordered_map<uint64_t, SetLayoutEntry> m_setLayouts;           //バインディングのハッシュ -> レイアウト
+    std::unordered_map<uint64_t, PipelineLayoutEntry> m_pipelineLayouts; //セットレイアウト, プッシュ定数のハッシュ -> レイアウト
+    std::vector<SetLayoutEntry> m_registeredSetLayouts;                  //外部で作成したもの(immutableSamplersは使わない)
+
+    std::atomic<uint64_t> m_hits = 0;
+    std::atomic<uint64_t> m_misses = 0;
+};
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <atomic>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+class GraphicsPipelineBuilder;
+
+//VK_EXT_graphics_pipeline_libraryによる高速リンク
+//パイプラインを頂点入力, プリラスタライズ, フラグメントシェーダー, フラグメント出力の4つの部分に分けてライブラリとして作成・保持し、
+//組み合わせのパイプラインはリンクだけで作る。フラグメントシェーダーや頂点入力だけが異なるパイプラインは、他の部分を使い回せる
+//拡張機能が使えない場合は通常の一括作成を行う
+class PipelineLibrary
+{
+public:
+    struct Stats
+    {
+        uint64_t partHits = 0;       //作成済みの部分を使い回した回数
+        uint64_t partMisses = 0;     //部分を新たに作成した回数
+        uint64_t linkCount = 0;      //リンクで作成したパイプライン数
+        uint64_t optimizedCount = 0; //リンク時最適化を行ったパイプライン数
+        uint32_t libraryCount = 0;   //保持しているライブラリ数
+    };
+
+    PipelineLibrary() = default;
+    ~PipelineLibrary() = default;
+
+    PipelineLibrary(const PipelineLibrary&) = delete;
+    PipelineLibrary& operator=(const PipelineLibrary&) = delete;
+
+    void Initialize(VkDevice device, bool supported);
+    //保持しているライブラリを破棄する(リンクしたパイプラインは別途破棄すること)
+    void Cleanup();
+
+    bool IsSupported() const { return m_supported; }
+
+    //builderの各部分をライブラリから取得(なければ作成)してリンクする。非対応であれば通常通り作成する
+    //optimizeを指定するとリンク時最適化を行う。描画は速くなるが時間がかかるため、ワーカースレッドで使う
+    //複数スレッドから同時に呼び出せる
+    VkPipeline Link(const GraphicsPipelineBuilder& builder, bool optimize = false);
+
+    Stats GetStats() const;
+
+private:
+    struct Part
+    {
+        VkPipeline library = VK_NULL_HANDLE;
+        std::vector<uint8_t> state; //ハッシュしたステート(衝突したものと区別するため)
+    };
+
+    VkPipeline GetOrCreatePart(const GraphicsPipelineBuilder& builder, VkGraphicsPipelineLibraryFlagBitsEXT part);
+    //ステートが一致する部分を探す(ロックを取った状態で呼ぶ)
+    std::unordered_map<uint64_t, Part>::iterator FindPart(uint64_t key, const std::vector<uint8_t>& state);
+
+    VkDevice m_device = VK_NULL_HANDLE;
+    bool m_supported = false;
+
+    mutable std::mutex m_mutex;
+    std::unordered_map<uint64_t, Part> m_parts; //部分のステートのハッシュ -> ライブラリ
+
+    std::atomic<uint64_t> m_partHits = 0;
+    std::atomic<uint64_t> m_partMisses = 0;
+    std::atomic<uint64_t> m_linkCount = 0;
+    std::atomic<uint64_t> m_optimizedCount = 0;
+};
@@ -0,0 +1,139 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "core/GraphicsPipelineBuilder.h"
+
+//バックグラウンドで作成中のパイプラインへの参照
+//作成の完了前はGetが代わりのパイプライン(フォールバック)を返すため、描画側は待たずに済む
+class PipelineHandle
+{
+public:
+    PipelineHandle() = default;
+
+    bool IsValid() const { return m_future.valid(); }
+    //作成が終わったか(失敗した場合も含む)
+    bool IsReady() const
+    {
+        return IsValid() && m_future.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+    }
+    //作成済みであればパイプラインを、まだであればfallbackを返す(待機しない)
+    //リンク時最適化を行ったものが出来上がっていれば、そちらを返す
+    VkPipeline Get(VkPipeline fallback = VK_NULL_HANDLE) const
+    {
+        if (!IsReady())
+        {
+            return fallback;
+        }
+        VkPipeline optimized = m_optimized ? m_optimized->load() : VK_NULL_HANDLE;
+        return optimized != VK_NULL_HANDLE ? optimized : m_future.get();
+    }
+    //作成の完了を待って返す(失敗時はVK_NULL_HANDLE)
+    VkPipeline Wait() const
+    {
+        if (!IsValid())
+        {
+            return VK_NULL_HANDLE;
+        }
+        m_future.wait();
+        return Get();
+    }
+
+private:
+    friend class PipelineRegistry;
+
+    uint64_t m_key = 0;
+    uint64_t m_id = 0;
+    std::shared_future<VkPipeline> m_future;
+    std::shared_ptr<std::atomic<VkPipeline>> m_optimized; //AcquireFastLinkedで後から差し替えるもの
+};
+
+//同じステートのパイプラインを1つにまとめて共有する登録簿
+//GraphicsPipelineBuilderのステートのハッシュをキーに、ステートが一致する作成済みのものがあれば既存のパイプラインを返す
+//参照カウントで管理し、最後のReleaseでフレームの完了後に破棄する
+class PipelineRegistry
+{
+public:
+    struct Stats
+    {
+        uint64_t hits = 0;     //既存のパイプラインを返した回数
+        uint64_t misses = 0;   //新たに作成した回数
+        uint32_t pipelineCount = 0;
+        uint32_t pendingCount = 0; //バックグラウンドで作成中の数
+    };
+
+    PipelineRegistry() = default;
+    ~PipelineRegistry() = default;
+
+    PipelineRegistry(const PipelineRegistry&) = delete;
+    PipelineRegistry& operator=(const PipelineRegistry&) = delete;
+
+    void Initialize(VkDevice device);
+    //残っているパイプラインを直ちに破棄する(デバイスがアイドルで、ワーカーの作成が終わった状態で呼ぶ)
+    void Cleanup();
+
+    //同じステートのパイプラインがあれば参照を増やして返し、なければ作成する(失敗時はVK_NULL_HANDLE)
+    //他スレッドが作成中のものは完了を待つ
+    VkPipeline Acquire(const GraphicsPipelineBuilder& builder);
+    //登録がなければワーカースレッドで作成を始め、待たずにハンドルを返す
+    //ビルダーは複製して渡すため、呼び出し後に破棄してよい
+    PipelineHandle AcquireAsync(const GraphicsPipelineBuilder& builder);
+    //未登録のものをワーカー数に分割し、各ワーカーで1回のvkCreateGraphicsPipelinesにまとめて作成する
+    //戻り値はbuildersと同じ順序
+    std::vector<PipelineHandle> AcquireBatch(const std::vector<GraphicsPipelineBuilder>& builders);
+    //登録がなければPipelineLibraryの部分をリンクして作成する。リンクは軽いため、戻った時点で使用できる
+    //optimizeInBackgroundを指定すると、リンク時最適化を行ったものをワーカーで作成し、完了後はハンドルがそちらを返す
+    //パイプラインライブラリが使えない場合はAcquireAsyncと同様にワーカーで通常の作成を行う
+    PipelineHandle AcquireFastLinked(const GraphicsPipelineBuilder& builder, bool optimizeInBackground = true);
+
+    //Acquire, AcquireAsync, AcquireBatchで得た参照を1つ手放す
+    void Release(VkPipeline pipeline);
+    void Release(const PipelineHandle& handle);
+
+    Stats GetStats() const;
+
+private:
+    struct Entry
+    {
+        std::shared_future<VkPipeline> future;
+        std::shared_ptr<std::atomic<VkPipeline>> optimized;
+        uint32_t refCount = 0;
+        uint64_t id = 0; //作成の完了時に、登録が作り直されていないか確かめるため
+        std::vector<uint8_t> state; //ハッシュしたステート(衝突したものと区別するため)
+        std::shared_ptr<const void> shaderModules; //ShaderModuleCacheのモジュールの参照
+    };
+    struct PendingBuild
+    {
+        uint64_t key;
+        uint64_t id;
+        std::promise<VkPipeline> promise;
+        std::shared_ptr<const void> shaderModules; //作成が終わるまでモジュールを破棄させない
+    };
+
+    //同じステートが登録済みであれば参照を増やしてハンドルを返し、なければ作成待ちとして登録する
+    //登録時はbuilderのシェーダーモジュールの参照を持つため、呼び出し側はAcquire後すぐにモジュールを手放してよい
+    PipelineHandle Lookup(const GraphicsPipelineBuilder& builder, std::vector<PendingBuild>& pendingBuilds);
+    //作成結果を登録に反映し、待っている側に通知する
+    void Complete(PendingBuild& pendingBuild, VkPipeline pipeline);
+    //リンク時最適化を行ったパイプラインを登録に加える
+    void CompleteOptimized(uint64_t key, uint64_t id, VkPipeline pipeline);
+    //参照を1つ減らし、なくなれば登録を外す(ロックを取った状態で呼ぶ)
+    void ReleaseEntry(std::unordered_map<uint64_t, Entry>::iterator it);
+
+    VkDevice m_device = VK_NULL_HANDLE;
+
+    mutable std::mutex m_mutex;
+    std::unordered_map<uint64_t, Entry> m_entries;
+    std::unordered_map<VkPipeline, uint64_t> m_keys; //Release用の逆引き
+    uint64_t m_nextId = 0;
+
+    std::atomic<uint64_t> m_hits = 0;
+    std::atomic<uint64_t> m_misses = 0;
+};
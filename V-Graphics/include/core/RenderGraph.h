@@ -0,0 +1,211 @@
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "core/VulkanContext.h"
+#include "core/ImageResource.h"
+
+class IBufferResource;
+
+//フレームのパスと、それらが読み書きするイメージ, バッファの宣言から記録を組み立てるレンダーグラフ
+// - 出力(インポートしたリソース, SetSideEffectを指定したパス)に寄与しないパスを省く
+// - 宣言からCommandBuffer::RequireImageState/RequireBufferStateを呼び、必要なバリアだけをパス毎にまとめて発行する
+// - 寿命の重ならない一時イメージには同じメモリを割り当てる
+//毎フレーム Reset → Import*, CreateImage, AddPass → Compile → Execute の順に組み立て直す
+//一時イメージとメモリは、一時イメージの内容と寿命が前回と同じであれば使い回す
+class RenderGraph
+{
+public:
+    using ImageHandle = uint32_t;
+    using BufferHandle = uint32_t;
+    static constexpr uint32_t InvalidHandle = UINT32_MAX;
+
+    //インポートしたイメージの使用前, 使用後の状態
+    struct ResourceState
+    {
+        VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
+        VkPipelineStageFlags2 stage = VK_PIPELINE_STAGE_2_NONE;
+        VkAccessFlags2 access = VK_ACCESS_2_NONE;
+    };
+    //グラフの中でのみ使う一時イメージ(用途のフラグはパスの宣言から決める)
+    struct ImageDesc
+    {
+        VkExtent2D extent{};
+        VkFormat format = VK_FORMAT_UNDEFINED;
+    };
+    struct Stats
+    {
+        uint32_t passCount = 0;
+        uint32_t culledPassCount = 0;
+        uint32_t transientImageCount = 0;
+        uint32_t memorySlotCount = 0;       //一時イメージに割り当てたメモリ領域の数
+        VkDeviceSize transientBytes = 0;    //割り当てたメモリの合計
+        VkDeviceSize unaliasedBytes = 0;    //一時イメージ毎に割り当てた場合の合計
+    };
+
+    //パスの読み書きを宣言する。宣言した順に状態を要求する
+    class PassBuilder
+    {
+    public:
+        //描画先。loadOpがLOADの場合は以前の内容を読む
+        PassBuilder& WriteColor(ImageHandle image, VkAttachmentLoadOp loadOp, VkClearColorValue clearColor = {});
+        PassBuilder& WriteDepth(ImageHandle image, VkAttachmentLoadOp loadOp, float clearDepth = 1.0f);
+        //深度テストのみ行う(書き込まない)
+        PassBuilder& ReadDepth(ImageHandle image);
+        //シェーダーからサンプルする(READ_ONLY_OPTIMAL)
+        PassBuilder& SampleImage(ImageHandle image, VkPipelineStageFlags2 stage = VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT);
+        //ストレージイメージとして読み書きする(GENERAL)。discardContentsは全体を書き換える場合
+        PassBuilder& WriteStorageImage(ImageHandle image, VkPipelineStageFlags2 stage = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+            bool discardContents = false);
+        //コピー, ブリットの転送元, 転送先
+        PassBuilder& CopySource(ImageHandle image);
+        PassBuilder& CopyDestination(ImageHandle image, bool discardContents = true);
+        //バッファへの書き込みは一部の更新もあるため、以前の内容も読むものとして扱う
+        PassBuilder& ReadBuffer(BufferHandle buffer, VkPipelineStageFlags2 stage, VkAccessFlags2 access);
+        PassBuilder& WriteBuffer(BufferHandle buffer, VkPipelineStageFlags2 stage, VkAccessFlags2 access);
+        //出力に寄与しなくても省かない(読み戻し, クエリなど)
+        PassBuilder& SetSideEffect();
+
+    private:
+        friend class RenderGraph;
+        PassBuilder(RenderGraph& graph, uint32_t passIndex) : m_graph(graph), m_passIndex(passIndex) {}
+
+        PassBuilder& UseImage(ImageHandle image, VkImageLayout layout, VkPipelineStageFlags2 stage,
+            VkAccessFlags2 access, VkImageUsageFlags usage, bool read, bool write);
+
+        RenderGraph& m_graph;
+        uint32_t m_passIndex;
+    };
+
+    using SetupFunc = std::function<void(PassBuilder& builder)>;
+    //描画先を宣言したパスは、グラフが動的レンダリングを開始した中で呼ぶ
+    using ExecuteFunc = std::function<void(CommandBuffer& commandBuffer)>;
+
+    RenderGraph() = default;
+    ~RenderGraph() { Cleanup(); }
+
+    RenderGraph(const RenderGraph&) = delete;
+    RenderGraph& operator=(const RenderGraph&) = delete;
+
+    //一時イメージとメモリの破棄を、GPUが現在のフレームを終えてから行うよう登録する
+    void Cleanup();
+    //パスとリソースの宣言を消す(一時イメージとメモリは次のCompileで使い回すため残す)
+    void Reset();
+
+    //状態はCommandBufferの追跡を引き継ぐ。finalStateのlayoutがUNDEFINEDでなければ、最後にその状態へ遷移する
+    ImageHandle ImportImage(const std::string& name, IImageResource& image, const ResourceState& finalState);
+    //状態を追跡していないイメージ(スワップチェインのイメージなど)。initialStateから使い始め、最後にfinalStateへ遷移する
+    ImageHandle ImportImage(const std::string& name, VkImage image, VkImageView imageView, VkFormat format,
+        VkExtent2D extent, const ResourceState& initialState, const ResourceState& finalState);
+    BufferHandle ImportBuffer(const std::string& name, IBufferResource& buffer);
+    ImageHandle CreateImage(const std::string& name, const ImageDesc& desc);
+
+    //宣言した順に実行する
+    void AddPass(const std::string& name, const SetupFunc& setup, ExecuteFunc execute);
+
+    //不要なパスを省き、一時イメージを割り当てる(宣言に矛盾がある, メモリが確保できない場合は例外)
+    void Compile();
+    //パスを記録する。記録したコマンドバッファのEndまでグラフをResetしないこと
+    void Execute(CommandBuffer& commandBuffer);
+
+    //Execute中にビューなどを得る(省かれて割り当てられなかった一時イメージはnullptr)
+    IImageResource* GetImage(ImageHandle image) const;
+    const Stats& GetStats() const { return m_stats; }
+
+private:
+    struct ImageUsage
+    {
+        ImageHandle image;
+        VkImageLayout layout;
+        VkPipelineStageFlags2 stage;
+        VkAccessFlags2 access;
+        VkImageUsageFlags usageFlags;
+        bool read;  //以前の内容に依存する
+        bool write;
+    };
+    struct BufferUsage
+    {
+        BufferHandle buffer;
+        VkPipelineStageFlags2 stage;
+        VkAccessFlags2 access;
+        bool write;
+    };
+    struct Attachment
+    {
+        ImageHandle image = InvalidHandle;
+        VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
+        VkAttachmentLoadOp loadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+        VkClearValue clearValue{};
+    };
+    struct Pass
+    {
+        std::string name;
+        ExecuteFunc execute;
+        std::vector<ImageUsage> imageUsages;
+        std::vector<BufferUsage> bufferUsages;
+        std::vector<Attachment> colorAttachments;
+        Attachment depthAttachment;
+        bool sideEffect = false;
+        bool culled = false;
+    };
+    struct ImageNode
+    {
+        std::string name;
+        IImageResource* resource = nullptr;
+        std::unique_ptr<IImageResource> external;   //状態を追跡していないイメージのラッパー
+        bool imported = false;
+        ResourceState initialState;
+        ResourceState finalState;
+
+        //一時イメージのみ
+        ImageDesc desc;
+        VkImageUsageFlags usage = 0;
+        uint32_t firstPass = UINT32_MAX;
+        uint32_t lastPass = 0;
+        VkPipelineStageFlags2 lastStage = VK_PIPELINE_STAGE_2_NONE; //最後の書き込みとその後の読み取り
+        VkAccessFlags2 lastAccess = VK_ACCESS_2_NONE;
+        uint32_t physicalIndex = UINT32_MAX;
+    };
+    struct BufferNode
+    {
+        std::string name;
+        IBufferResource* resource = nullptr;
+    };
+    //一時イメージの実体。同じslotのイメージはメモリを共有する
+    struct PhysicalImage
+    {
+        std::shared_ptr<TransientImage> image;
+        VkDeviceSize size = 0;
+        uint32_t slot = 0;
+        uint32_t node = 0;  //今回のグラフでのイメージのノード番号
+    };
+    struct MemorySlot
+    {
+        DeviceAllocation allocation;
+        VkMemoryRequirements requirements{};
+        std::vector<uint32_t> images;   //m_physicalImagesの番号(使い始める順)
+        //前回のExecuteで最後にこのメモリを使ったイメージの使われ方
+        VkPipelineStageFlags2 lastStage = VK_PIPELINE_STAGE_2_NONE;
+        VkAccessFlags2 lastAccess = VK_ACCESS_2_NONE;
+    };
+
+    void CullPasses();
+    void ComputeLifetimes();
+    //一時イメージの内容, 寿命が変わった場合に作り直し、寿命の重ならないものへ同じメモリを割り当てる
+    void AllocateTransientImages();
+    void ReleaseTransientImages();
+
+    std::vector<Pass> m_passes;
+    std::vector<ImageNode> m_images;
+    std::vector<BufferNode> m_buffers;
+
+    std::vector<PhysicalImage> m_physicalImages;
+    std::vector<MemorySlot> m_memorySlots;
+    uint64_t m_transientKey = 0;
+    bool m_compiled = false;
+
+    Stats m_stats{};
+};
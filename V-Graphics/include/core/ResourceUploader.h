@@ -1,4 +1,11 @@
+#include <deque>
+
 #include "core/BufferResource.h"
+#include "core/StagingRing.h"
+#include "core/CommandPoolRing.h"
+
+//アップロードの完了を識別する番号(アップロード用タイムラインセマフォの値)
+using UploadTicket = uint64_t;
 
 class ResourceUploader
 {
@@ -6,21 +13,49 @@ public:
     ResourceUploader() = default;
     ~ResourceUploader() = default;
 
-    bool Initialize();
+    bool Initialize(VkDeviceSize stagingSize = StagingRing::DefaultSize);
     void Cleanup();
 
+    // ステージングリングへ書き込み、転送を登録する
+    // リングより大きなデータは分割して流し込む(空きがなくなれば途中で転送を実行する)
     bool UploadBuffer(IBufferResource* target, const void* pData, size_t size, VkAccessFlags nextAccessMask);
 
-    // o^Ă]܂Ƃ߂Ďs
-    // ssASĂ̓]ɏ߂
+    // 登録されている転送処理をまとめて転送キューへ提出する(完了は待たない)
+    // 次のフレームの提出は返されたチケットの完了を待機してから実行される
+    UploadTicket Submit();
+
+    // チケットの転送が完了しているか
+    bool IsComplete(UploadTicket ticket) const;
+    // チケットの転送完了まで待機する
+    void Wait(UploadTicket ticket);
+
+    // 登録されている転送処理をまとめて実行する
+    // 同期実行を行い、全ての転送処理が完了後に処理が戻る
     void SubmitAndWait();
+
+    VkSemaphore GetTimelineSemaphore() const { return m_timelineSemaphore; }
 private:
     struct PendingTransfer
     {
-        std::shared_ptr<StagingBuffer> stagingBuffer;
+        VkBuffer         stagingBuffer;
+        VkDeviceSize     srcOffset;
         IBufferResource* destinationBuffer;
+        VkDeviceSize     dstOffset;
+        VkDeviceSize     size;
         VkAccessFlags    dstAccessMask;
     };
+    //コマンドプールを使い回す提出の数(これを超える場合は古い提出の完了を待つ)
+    static constexpr uint32_t CommandSlotCount = 4;
+
+    //完了した提出のリング領域を回収する
+    void RetireCompleted();
+
     std::vector<PendingTransfer> m_transferEntries;
-    VkFence m_transferFence = VK_NULL_HANDLE;
-};
\ No newline at end of file
+    std::deque<UploadTicket> m_inflightTickets;
+
+    CommandPoolRing m_commandPools; //[チケット % CommandSlotCount]
+    VkSemaphore m_timelineSemaphore = VK_NULL_HANDLE;
+    UploadTicket m_lastTicket = 0;
+
+    StagingRing m_stagingRing;
+};
@@ -1,11 +1,18 @@
 #pragma once
 
 #include <filesystem>
+#include <vector>
 
 #include "core/VulkanContext.h"
 
 namespace loader
 {
-    //SPIR-Vǂݎ
+    //SPIR-Vのバイナリを読み取る(VK_EXT_shader_objectなど、モジュールを介さずに渡す場合に使う)
+    std::vector<uint32_t> LoadShaderCode(const std::filesystem::path& shaderSpvPath);
+
+    //SPIR-Vを読み取る
+    //VulkanContextのShaderModuleCacheから取得するため、同じ内容のファイルは1つのモジュールを共有する
+    //不要になったらvkDestroyShaderModuleではなくReleaseShaderModuleで手放すこと
     VkShaderModule LoadShaderModule(const std::filesystem::path& shaderSpvPath);
+    void ReleaseShaderModule(VkShaderModule shaderModule);
 };
\ No newline at end of file
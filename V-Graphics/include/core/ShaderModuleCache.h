@@ -0,0 +1,94 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <atomic>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "core/ShaderReflection.h"
+
+//SPIR-Vの内容でまとめたシェーダーモジュールの共有キャッシュ
+//ファイルはメモリにマップして読み、内容のハッシュが同じモジュールは1つを参照カウントで共有する
+//SPIR-Vは複製してから扱い、マップは読み込みの間だけ開く(実行中にシェーダーを書き換えても保持している内容は変わらない)
+//同じパスの読み込みは、ファイルが更新されていなければマップもハッシュ計算もせずに返す
+//モジュールの作成時にSPIR-Vを解析し、レイアウトと頂点入力を組み立てるためのリフレクションを持つ
+//VK_KHR_maintenance5が使える場合、GraphicsPipelineBuilderはモジュールの代わりにSPIR-Vを直接パイプラインに渡す
+class ShaderModuleCache
+{
+public:
+    struct Stats
+    {
+        uint64_t hits = 0;      //作成済みのモジュールを返した回数
+        uint64_t misses = 0;    //モジュールを新たに作成した回数
+        uint32_t moduleCount = 0;
+        uint64_t codeSize = 0;  //保持しているSPIR-Vの合計バイト数
+    };
+
+    ShaderModuleCache() = default;
+    ~ShaderModuleCache() = default;
+
+    ShaderModuleCache(const ShaderModuleCache&) = delete;
+    ShaderModuleCache& operator=(const ShaderModuleCache&) = delete;
+
+    void Initialize(VkDevice device, bool inlineModuleSupported);
+    //残っているモジュールを直ちに破棄する(PipelineRegistryのCleanup後に呼ぶ)
+    void Cleanup();
+
+    //パイプライン作成時にVkShaderModuleCreateInfoを直接渡せるか(VK_KHR_maintenance5)
+    bool IsInlineModuleSupported() const { return m_inlineModuleSupported; }
+
+    //内容が同じモジュールがあれば参照を増やして返し、なければ作成する(読めない, 作成できない場合は例外)
+    VkShaderModule Acquire(const std::filesystem::path& path);
+    VkShaderModule Acquire(const uint32_t* code, size_t codeSize);
+    //Acquireで得た参照を1つ手放し、なくなれば破棄する
+    void Release(VkShaderModule module);
+
+    //modulesのうちこのキャッシュのものの参照を増やし、戻り値の破棄時にまとめて手放す
+    //パイプラインの作成中, 登録中にモジュールが破棄されないよう、PipelineRegistryが使う
+    std::shared_ptr<const void> Retain(const std::vector<VkShaderModule>& modules);
+
+    //キャッシュのモジュールであれば内容のハッシュを返す(それ以外は0)
+    //モジュールを作り直してもハッシュは変わらないため、パイプラインのステートのキーに使う
+    uint64_t GetContentHash(VkShaderModule module) const;
+    //キャッシュのモジュールのSPIR-V(参照を持っている間は有効)。それ以外は空
+    std::span<const uint32_t> GetCode(VkShaderModule module) const;
+    //読み込み時に解析したリフレクション(参照を持っている間は有効)
+    //キャッシュのモジュールでない, 解析できなかった場合はnullptr
+    const ShaderReflection* GetReflection(VkShaderModule module) const;
+
+    Stats GetStats() const;
+
+private:
+    struct Entry
+    {
+        VkShaderModule module = VK_NULL_HANDLE;
+        uint32_t refCount = 0;
+        std::vector<uint32_t> code;
+        ShaderReflection reflection;
+    };
+    struct PathEntry
+    {
+        uint64_t key = 0;
+        std::filesystem::file_time_type lastWriteTime;
+    };
+
+    //codeの内容の登録を探し、なければcodeを引き取って作成する(ロックを取った状態で呼ぶ)
+    uint64_t AcquireCode(std::vector<uint32_t>&& code);
+    void ReleaseLocked(VkShaderModule module);
+
+    VkDevice m_device = VK_NULL_HANDLE;
+    bool m_inlineModuleSupported = false;
+
+    mutable std::mutex m_mutex;
+    std::unordered_map<uint64_t, Entry> m_entries;        //内容のハッシュ -> モジュール
+    std::unordered_map<VkShaderModule, uint64_t> m_keys;  //逆引き
+    std::unordered_map<std::string, PathEntry> m_paths;   //読み込んだパス -> 内容のハッシュ
+
+    std::atomic<uint64_t> m_hits = 0;
+    std::atomic<uint64_t> m_misses = 0;
+};
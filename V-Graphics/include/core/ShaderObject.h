@@ -0,0 +1,86 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <memory>
+#include <vector>
+
+#include "core/GPUResourceBase.h"
+#include "core/SpecializationConstants.h"
+
+//VK_EXT_shader_objectのコマンド
+//拡張機能のコマンドはローダーから直接呼べないため、デバイス作成後にLoadで取得する
+struct ShaderObjectFunctions
+{
+    PFN_vkCreateShadersEXT createShaders{};
+    PFN_vkDestroyShaderEXT destroyShader{};
+    PFN_vkCmdBindShadersEXT cmdBindShaders{};
+
+    //パイプラインに焼き込まれていたステートのうち、Vulkan 1.3のコアにない設定コマンド
+    PFN_vkCmdSetVertexInputEXT cmdSetVertexInput{};
+    PFN_vkCmdSetPolygonModeEXT cmdSetPolygonMode{};
+    PFN_vkCmdSetRasterizationSamplesEXT cmdSetRasterizationSamples{};
+    PFN_vkCmdSetSampleMaskEXT cmdSetSampleMask{};
+    PFN_vkCmdSetAlphaToCoverageEnableEXT cmdSetAlphaToCoverageEnable{};
+    PFN_vkCmdSetAlphaToOneEnableEXT cmdSetAlphaToOneEnable{};
+    PFN_vkCmdSetLogicOpEnableEXT cmdSetLogicOpEnable{};
+    PFN_vkCmdSetDepthClampEnableEXT cmdSetDepthClampEnable{};
+    PFN_vkCmdSetColorBlendEnableEXT cmdSetColorBlendEnable{};
+    PFN_vkCmdSetColorBlendEquationEXT cmdSetColorBlendEquation{};
+    PFN_vkCmdSetColorWriteMaskEXT cmdSetColorWriteMask{};
+
+    void Load(VkDevice device);
+};
+
+//VK_EXT_shader_objectでリンクしたシェーダーの組
+//パイプラインを作らないため作成は速いが、描画前に全てのステートをCommandBufferで設定する必要がある
+//(BindShaderObjectの後、SetShaderObjectDefaultsと拡張ダイナミックステートの各Set関数, SetVertexInputを呼ぶ)
+class ShaderObject : public GPUResourceBase<ShaderObject>
+{
+public:
+    virtual ~ShaderObject() { Cleanup(); }
+    //記録済みのコマンドが参照している可能性があるため、フレームの完了後に破棄する
+    void Cleanup();
+
+    bool HasStage(VkShaderStageFlagBits stage) const;
+    //作成したステージを結び付け、それ以外のグラフィックスステージは外す
+    void Bind(VkCommandBuffer commandBuffer) const;
+
+private:
+    friend GPUResourceBase<ShaderObject>;
+    friend class ShaderObjectBuilder;
+    ShaderObject() = default;
+
+    VkDevice m_device = VK_NULL_HANDLE;
+    std::vector<VkShaderStageFlagBits> m_stages;
+    std::vector<VkShaderEXT> m_shaders;
+};
+
+//GraphicsPipelineBuilderに対応する、シェーダーオブジェクトの作成
+//パイプラインレイアウトの代わりに、セットレイアウトとプッシュ定数の範囲を各シェーダーに渡す
+class ShaderObjectBuilder
+{
+public:
+    //SPIR-Vはloader::LoadShaderCodeで読み込んだもの
+    ShaderObjectBuilder& AddShaderStage(VkShaderStageFlagBits stage, std::vector<uint32_t> code, const char* entry = "main");
+    ShaderObjectBuilder& AddShaderStage(VkShaderStageFlagBits stage, std::vector<uint32_t> code,
+        const SpecializationConstants& constants, const char* entry = "main");
+
+    ShaderObjectBuilder& SetDescriptorSetLayouts(const VkDescriptorSetLayout* setLayouts, uint32_t count);
+    ShaderObjectBuilder& SetPushConstantRanges(const VkPushConstantRange* ranges, uint32_t count);
+
+    //全ステージを1回のvkCreateShadersEXTでリンクして作成する(失敗時, 非対応時はnullptr)
+    std::shared_ptr<ShaderObject> Build() const;
+
+private:
+    struct Stage
+    {
+        VkShaderStageFlagBits stage;
+        std::vector<uint32_t> code;
+        const char* entry;
+        SpecializationConstants constants;
+    };
+
+    std::vector<Stage> m_stages;
+    std::vector<VkDescriptorSetLayout> m_setLayouts;
+    std::vector<VkPushConstantRange> m_pushConstantRanges;
+};
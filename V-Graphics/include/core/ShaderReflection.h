@@ -0,0 +1,92 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <cstdint>
+#include <map>
+#include <span>
+#include <vector>
+
+//SPIR-Vから読み取ったシェーダーステージのインターフェース
+//ディスクリプタのバインディング, プッシュ定数の範囲, 頂点ステージの入力を取り出す
+class ShaderReflection
+{
+public:
+    struct DescriptorBinding
+    {
+        uint32_t set = 0;
+        uint32_t binding = 0;
+        VkDescriptorType type = VK_DESCRIPTOR_TYPE_MAX_ENUM;
+        uint32_t count = 1; //実行時の大きさの配列は0
+    };
+    struct VertexInput
+    {
+        uint32_t location = 0;
+        VkFormat format = VK_FORMAT_UNDEFINED;
+        uint32_t size = 0; //1つの頂点あたりのバイト数
+    };
+
+    //最初のエントリポイントのステージとして解析する(SPIR-Vでない, 対応していない型がある場合はfalse)
+    bool Parse(std::span<const uint32_t> code);
+
+    bool IsValid() const { return m_stage != 0; }
+    VkShaderStageFlagBits GetStage() const { return m_stage; }
+    //set, binding順
+    const std::vector<DescriptorBinding>& GetDescriptorBindings() const { return m_bindings; }
+    //プッシュ定数ブロックのうち、このステージが宣言している範囲(なければsizeが0)
+    const VkPushConstantRange& GetPushConstantRange() const { return m_pushConstantRange; }
+    //頂点ステージの入力(location順)。組み込み変数は含まない
+    const std::vector<VertexInput>& GetVertexInputs() const { return m_vertexInputs; }
+
+private:
+    VkShaderStageFlagBits m_stage{};
+    std::vector<DescriptorBinding> m_bindings;
+    VkPushConstantRange m_pushConstantRange{};
+    std::vector<VertexInput> m_vertexInputs;
+};
+
+//パイプラインの全ステージのリフレクションをまとめ、レイアウトと頂点入力を組み立てる
+//作成はPipelineLayoutCache::Acquireで行い、同じ内容のレイアウトは共有される
+class PipelineReflection
+{
+public:
+    struct VertexInputState
+    {
+        VkVertexInputBindingDescription binding{};
+        std::vector<VkVertexInputAttributeDescription> attributes;
+    };
+
+    //同じset, bindingを複数ステージが使う場合はステージのフラグをまとめる(種類, 数が異なる場合は例外)
+    PipelineReflection& AddStage(const ShaderReflection& reflection);
+    //ShaderModuleCacheが読み込み時に解析した結果を加える(キャッシュのモジュールでない, 解析できていない場合は例外)
+    PipelineReflection& AddShaderModule(VkShaderModule module);
+
+    //SPIR-Vからは区別できないものを指定する
+    //動的オフセットのユニフォームバッファ(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC)や、実行時の大きさの配列の数など
+    PipelineReflection& SetDescriptorType(uint32_t set, uint32_t binding, VkDescriptorType type);
+    PipelineReflection& SetDescriptorCount(uint32_t set, uint32_t binding, uint32_t count);
+
+    //使われている最大のset番号+1
+    uint32_t GetSetCount() const;
+    //set番目のレイアウトのバインディング(binding順。使われていないsetは空)
+    std::vector<VkDescriptorSetLayoutBinding> GetSetLayoutBindings(uint32_t set) const;
+    //全ステージのプッシュ定数を1つの範囲にまとめたもの(なければ空)
+    std::vector<VkPushConstantRange> GetPushConstantRanges() const;
+    //頂点ステージの入力をlocation順に1つのバインディングへ詰めて並べた頂点入力
+    //頂点の構造体のメンバーをシェーダーの入力と同じ順に並べておけばそのまま使える
+    VertexInputState GetVertexInputState(uint32_t binding = 0) const;
+
+private:
+    struct Binding
+    {
+        VkDescriptorType type;
+        uint32_t count;
+        VkShaderStageFlags stageFlags;
+    };
+    static uint64_t BindingKey(uint32_t set, uint32_t binding) { return (uint64_t(set) << 32) | binding; }
+
+    std::map<uint64_t, Binding> m_bindings; //(set, binding)順
+    std::map<uint64_t, VkDescriptorType> m_typeOverrides;
+    std::map<uint64_t, uint32_t> m_countOverrides;
+    VkPushConstantRange m_pushConstantRange{};
+    std::vector<ShaderReflection::VertexInput> m_vertexInputs;
+};
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <vector>
+
+#include "core/Hash.h"
+
+//特殊化定数の値を持つメンバーと、シェーダー側のconstant_idの組
+//例 : SpecializationConstant<&SimpleCubeApp::FragmentSpecialization::shininess>{ 0 } (cube.fragのSHININESS)
+template<auto Member>
+struct SpecializationConstant
+{
+    uint32_t constantId;
+};
+
+//シェーダーステージに渡す特殊化定数(VkSpecializationInfo)の値
+//定数の値をまとめた構造体と、そのメンバー毎のconstant_idから作る
+//メンバーの型はシェーダーの定数と同じ大きさのスカラーに限り、コンパイル時に確かめる
+//(boolはVkBool32, intはint32_t, uintはuint32_t, float, double, int64_t, uint64_t)
+class SpecializationConstants
+{
+public:
+    SpecializationConstants() = default;
+
+    template<typename T, auto... Members>
+    static SpecializationConstants Create(const T& values, SpecializationConstant<Members>... constants)
+    {
+        static_assert(std::is_trivially_copyable_v<T>, "specialization values must be trivially copyable");
+        static_assert((std::is_same_v<typename MemberPointer<decltype(Members)>::Class, T> && ...),
+            "specialization constant must be a member of the value struct");
+        static_assert((IsScalar<typename MemberPointer<decltype(Members)>::Value> && ...),
+            "specialization constant must be a 32 or 64 bit scalar (use VkBool32 for bool)");
+
+        SpecializationConstants result;
+        result.m_data.resize(sizeof(T));
+        std::memcpy(result.m_data.data(), &values, sizeof(T));
+        (result.AddEntry(constants.constantId, MemberOffset<Members>(values),
+            sizeof(typename MemberPointer<decltype(Members)>::Value)), ...);
+        return result;
+    }
+
+    bool IsEmpty() const { return m_entries.empty(); }
+
+    //このオブジェクトが破棄, 変更されるまで有効
+    VkSpecializationInfo GetInfo() const
+    {
+        return VkSpecializationInfo{
+            .mapEntryCount = uint32_t(m_entries.size()),
+            .pMapEntries = m_entries.data(),
+            .dataSize = m_data.size(),
+            .pData = m_data.data(),
+        };
+    }
+
+    //constant_idと値をハッシュに加える(構造体のパディングは含めない)
+    void AddToHash(Hasher& hasher) const
+    {
+        hasher.Add(m_entries.size());
+        for (const auto& entry : m_entries)
+        {
+            hasher.Add(entry.constantID).AddBytes(m_data.data() + entry.offset, entry.size);
+        }
+    }
+
+private:
+    template<typename M> struct MemberPointer;
+    template<typename C, typename V> struct MemberPointer<V C::*>
+    {
+        using Class = C;
+        using Value = V;
+    };
+
+    template<typename V>
+    static constexpr bool IsScalar =
+        std::is_same_v<V, int32_t> || std::is_same_v<V, uint32_t> || std::is_same_v<V, float> ||
+        std::is_same_v<V, int64_t> || std::is_same_v<V, uint64_t> || std::is_same_v<V, double>;
+
+    template<auto Member, typename T>
+    static uint32_t MemberOffset(const T& values)
+    {
+        return uint32_t(reinterpret_cast<const uint8_t*>(&(values.*Member)) - reinterpret_cast<const uint8_t*>(&values));
+    }
+
+    void AddEntry(uint32_t constantId, uint32_t offset, size_t size)
+    {
+        assert(std::none_of(m_entries.begin(), m_entries.end(),
+            [constantId](const VkSpecializationMapEntry& entry) { return entry.constantID == constantId; }) &&
+            "duplicate specialization constant id");
+        m_entries.push_back(VkSpecializationMapEntry{ .constantID = constantId, .offset = offset, .size = size });
+    }
+
+    std::vector<VkSpecializationMapEntry> m_entries;
+    std::vector<uint8_t> m_data;
+};
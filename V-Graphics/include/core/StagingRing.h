@@ -0,0 +1,62 @@
+#pragma once
+
+#include <deque>
+#include <memory>
+
+#include "core/BufferResource.h"
+
+//常時マップされた固定サイズのステージングバッファをリングとして使い回す仕組み
+//確保した領域はチケット(提出番号)に紐づけ、GPUがそのチケットを完了した時点で再利用する
+class StagingRing
+{
+public:
+    static constexpr VkDeviceSize DefaultSize = 16ull * 1024 * 1024;
+    static constexpr VkDeviceSize CopyAlignment = 16;
+
+    struct Region
+    {
+        VkBuffer     buffer = VK_NULL_HANDLE;
+        VkDeviceSize offset = 0;
+        VkDeviceSize size = 0;
+        void*        mapped = nullptr;
+    };
+
+    StagingRing() = default;
+    ~StagingRing() = default;
+
+    bool Initialize(VkDeviceSize size = DefaultSize);
+    void Cleanup();
+
+    //最大 size バイトの連続領域を確保する(空きが足りなければ確保できた分だけ返す)
+    //空きが全くなければfalse
+    bool Allocate(VkDeviceSize size, Region& region);
+    //書き込んだ領域をGPUから見えるようにする(ノンコヒーレントなメモリの場合のみ必要)
+    void Flush(const Region& region);
+
+    //ここまでに確保した領域を、指定チケットの提出で使用するものとして締める
+    void CloseSubmission(uint64_t ticket);
+
+    //完了済みチケットまでの領域を再利用可能にする
+    void Reclaim(uint64_t completedTicket);
+
+    //未提出の確保があるか
+    bool HasOpenRegions() const { return m_head != m_closedHead; }
+    VkDeviceSize GetCapacity() const { return m_capacity; }
+
+private:
+    struct Submission
+    {
+        uint64_t ticket;
+        uint64_t head;  //このチケットが使用している領域の終端(仮想オフセット)
+    };
+
+    std::shared_ptr<StagingBuffer> m_buffer;
+    uint8_t* m_mapped = nullptr;
+    VkDeviceSize m_capacity = 0;
+
+    //リング上の位置は単調増加の仮想オフセットで管理し、容量で割った余りを実オフセットとする
+    uint64_t m_head = 0;        //次に書き込む位置
+    uint64_t m_tail = 0;        //GPUが使用中の最古の位置
+    uint64_t m_closedHead = 0;  //提出済みの終端
+    std::deque<Submission> m_submissions;
+};
@@ -8,12 +8,23 @@ class Swapchain
 {
 public:
     Swapchain() = default;
+    virtual ~Swapchain() = default;
 
-    bool Recreate(uint32_t newWidth, uint32_t newHeight);
-    void Cleanup();
+    //古いスワップチェインをoldSwapchainとして引き継いで作り直す
+    //古いイメージビュー, セマフォは処理中のフレームの完了後に破棄されるため、デバイスの待機は不要
+    virtual bool Recreate(uint32_t newWidth, uint32_t newHeight);
+    virtual void Cleanup();
 
-    VkResult AcquireNextImage();
-    VkResult QueuePresent(VkQueue queuePresent);
+    //次のRecreateから使用する表示モード(非対応の場合は近いモード, 最終的にはFIFOを使う)
+    //MAILBOX, IMMEDIATEは低レイテンシ, FIFO_RELAXEDは垂直同期に間に合わなかったフレームを即座に表示する
+    void SetPresentMode(VkPresentModeKHR presentMode) { m_desiredPresentMode = presentMode; }
+    VkPresentModeKHR GetPresentMode() const { return m_presentMode; }
+
+    //次のRecreateから使用するイメージ数(0は表示モードから自動決定, サーフェスの上下限に収める)
+    void SetDesiredImageCount(uint32_t count) { m_desiredImageCount = count; }
+
+    virtual VkResult AcquireNextImage();
+    virtual VkResult QueuePresent(VkQueue queuePresent);
 
     operator const VkSwapchainKHR() { return m_swapchain; }
 
@@ -25,23 +36,33 @@ public:
     VkImage  GetCurrentImage() const { return m_images[m_currentIndex]; }
     VkImageView  GetCurrentView() const { return m_imageViews[m_currentIndex]; }
 
-    VkSemaphore GetPresentCompleteSemaphore() const;
-    VkSemaphore GetRenderCompleteSemaphore() const;
+    //VK_NULL_HANDLE の場合は待機, シグナル不要であることを示す
+    virtual VkSemaphore GetPresentCompleteSemaphore() const;
+    virtual VkSemaphore GetRenderCompleteSemaphore() const;
     std::vector<VkImageView> GetImageViews() const { return m_imageViews; }
 
-private:
+protected:
     void CreateFrameContext();
     void DestroyFrameContext();
 
+    VkPresentModeKHR SelectPresentMode() const;
+    uint32_t SelectImageCount(const VkSurfaceCapabilitiesKHR& caps, VkPresentModeKHR presentMode) const;
+    //現在のスワップチェインと付随するリソースを、処理中のフレームの完了後に破棄するよう登録する
+    void RetireResources();
+
     VkSwapchainKHR m_swapchain = VK_NULL_HANDLE;
     uint32_t m_currentIndex = 0;
 
+    VkPresentModeKHR m_desiredPresentMode = VK_PRESENT_MODE_FIFO_KHR;
+    VkPresentModeKHR m_presentMode = VK_PRESENT_MODE_FIFO_KHR;
+    uint32_t m_desiredImageCount = 0;
+
     VkSurfaceFormatKHR m_imageFormat{};
     VkExtent2D m_imageExtent{};
     std::vector<VkImage> m_images;
     std::vector<VkImageView> m_imageViews;
 
-    //1v[e[V܂łɕKvƂȂ铯IuWFNg܂Ƃ߂
+    //1プレゼンテーション処理までに必要となる同期オブジェクトをまとめたもの
     struct FrameContext
     {
         VkSemaphore renderComplete = VK_NULL_HANDLE;
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <memory>
+
+#include "core/BufferResource.h"
+
+//フレーム単位で使い捨てる定数用のリニアアロケータ
+//常時マップされた1つの大きなユニフォームバッファをスロット(フレーム)数に分割し、スロット内を先頭から切り出していく
+//切り出した領域はUNIFORM_BUFFER_DYNAMICの動的オフセットで参照するため、全オブジェクトで1つのディスクリプタセットを共有できる
+class UniformRing
+{
+public:
+    static constexpr VkDeviceSize DefaultSlotSize = 8ull * 1024 * 1024;
+
+    struct Allocation
+    {
+        void*    mapped = nullptr;  //書き込み先(確保できなかった場合はnullptr)
+        uint32_t dynamicOffset = 0; //vkCmdBindDescriptorSetsに渡す動的オフセット
+    };
+
+    UniformRing() = default;
+    ~UniformRing() = default;
+
+    UniformRing(const UniformRing&) = delete;
+    UniformRing& operator=(const UniformRing&) = delete;
+
+    bool Initialize(uint32_t slotCount, VkDeviceSize slotSize = DefaultSlotSize);
+    //GPUが全スロットの使用を終えてから呼ぶ
+    void Cleanup();
+
+    //使用するスロットを切り替え、先頭から確保し直す
+    //スロットを前回使用した提出の完了後に呼ぶこと
+    void BeginSlot(uint32_t slot);
+
+    //現在のスロットからminUniformBufferOffsetAlignmentに揃えた領域を切り出す
+    //複数スレッドから同時に呼び出せる。スロットの容量が尽きた場合はmappedがnullptr
+    Allocation Allocate(VkDeviceSize size);
+
+    template<typename T>
+    Allocation Push(const T& data)
+    {
+        auto allocation = Allocate(sizeof(T));
+        if (allocation.mapped != nullptr)
+        {
+            std::memcpy(allocation.mapped, &data, sizeof(T));
+        }
+        return allocation;
+    }
+
+    //現在のスロットへの書き込みをGPUから見えるようにする(提出前に呼ぶ)
+    void Flush();
+
+    //UNIFORM_BUFFER_DYNAMICのディスクリプタに設定する情報
+    //rangeはシェーダーが1回の確保から参照する大きさ(GetMaxRange以下)
+    VkDescriptorBufferInfo GetDescriptorInfo(VkDeviceSize range) const;
+    VkDeviceSize GetMaxRange() const { return m_maxRange; }
+
+    //Initialize毎に変わる値。ディスクリプタに書き込んだバッファが作り直されていないか確かめる
+    uint64_t GetGeneration() const { return m_generation; }
+
+    uint32_t GetSlotCount() const { return m_slotCount; }
+    VkDeviceSize GetSlotSize() const { return m_slotSize; }
+    VkDeviceSize GetAlignment() const { return m_alignment; }
+    VkDeviceSize GetUsedSize() const { return std::min(m_used.load(), m_slotSize); }
+
+private:
+    std::shared_ptr<UniformBuffer> m_buffer;
+    uint8_t* m_mapped = nullptr;
+
+    VkDeviceSize m_slotSize = 0;
+    VkDeviceSize m_alignment = 1;
+    VkDeviceSize m_maxRange = 0;
+    uint32_t m_slotCount = 0;
+    uint32_t m_currentSlot = 0;
+    uint64_t m_generation = 0; //Cleanupでも戻さない
+    std::atomic<VkDeviceSize> m_used = 0; //現在のスロットで確保済みの大きさ
+};
@@ -7,17 +7,31 @@
 #include <stdint.h>
 #include <string>
 #include <cstring>
+#include <filesystem>
 
 #include "core/CommandBuffer.h"
+#include "core/DeviceMemoryAllocator.h"
+#include "core/CommandPoolRing.h"
+#include "core/WorkerThreadPool.h"
+#include "core/DescriptorAllocator.h"
+#include "core/BindlessHeap.h"
+#include "core/DeletionQueue.h"
+#include "core/PipelineCache.h"
+#include "core/PipelineRegistry.h"
+#include "core/PipelineLibrary.h"
+#include "core/ShaderObject.h"
+#include "core/ShaderModuleCache.h"
+#include "core/PipelineLayoutCache.h"
 
 class Swapchain;
 class CommandBuffer;
 class ISurfaceProvider;
+class UniformRing;
 
 class VulkanContext
 {
 public:
-	static constexpr uint32_t MaxInflightFrames = 2;
+	static constexpr uint32_t DefaultMaxInflightFrames = 2;
 	static VulkanContext& Get();
 
 	void Initialize(const char* appName, ISurfaceProvider* surfaceProvider);
@@ -25,45 +39,137 @@ public:
 
 	void RecreateSwapchain();
 
-	//eVulkanIuWFNg擾
+	//各種Vulkanオブジェクト取得
 	VkInstance GetVkInstance() const { return m_vkInstance; }
 	VkDevice GetVkDevice() const { return m_vkDevice; }
 	VkPhysicalDevice GetVkPhysicalDevice() const { return m_vkPhysicalDevice; }
-	VkDescriptorPool GetVkDescriptorPool() const { return m_descriptorPool; }
+	const VkPhysicalDeviceProperties& GetPhysicalDeviceProperties() const { return m_physicalDeviceProperties; }
 
 	VkQueue GetGraphicsQueue() const { return m_graphicsQueue; }
 	uint32_t GetGraphicsFamily() const { return m_graphicsQueueFamilyIndex; }
 	uint32_t GetPresentFamily() const { return m_presentQueueFamilyIndex; }
 
+	//転送専用キューがなければグラフィックスキューと同じものを返す
+	VkQueue GetTransferQueue() const { return m_transferQueue; }
+	uint32_t GetTransferFamily() const { return m_transferQueueFamilyIndex; }
+	bool HasDedicatedTransferQueue() const { return m_transferQueueFamilyIndex != m_graphicsQueueFamilyIndex; }
+
 	VkCommandPool GetCommandPool() const { return m_commandPool; }
 	VkSurfaceKHR GetSurface() const { return m_surface; }
 
-	//R}hobt@쐬
+	//サーフェスを持たずオフスクリーンで描画しているか
+	bool IsHeadless() const;
+
+	//デバイス拡張機能がサポートされているか
+	bool IsDeviceExtensionSupported(const char* extensionName) const;
+
+	//コマンドバッファ作成(共有プールから確保し、破棄時に解放する長寿命用)
 	std::shared_ptr<CommandBuffer> CreateCommandBuffer();
+	//現在のフレームのプールから呼び出しスレッド用のコマンドバッファを払い出す
+	//このフレームコンテキストが再利用されるまで有効(解放不要)
+	std::shared_ptr<CommandBuffer> AcquireFrameCommandBuffer(VkCommandBufferLevel level = VK_COMMAND_BUFFER_LEVEL_PRIMARY);
 
-	//fBXNv^Zbgm, 
+	//ディスクリプタセット確保, 解放(常駐用プールから確保する長寿命用)
 	VkDescriptorSet AllocateDescriptorSet(VkDescriptorSetLayout layout);
 	void FreeDescriptorSet(VkDescriptorSet descriptorSet);
+	//現在のフレームのプールからディスクリプタセットを確保する
+	//このフレームコンテキストが再利用される時にプールごとリセットされる(解放不要)
+	VkDescriptorSet AllocateFrameDescriptorSet(VkDescriptorSetLayout layout);
+	DescriptorAllocator& GetDescriptorAllocator() { return m_descriptorAllocator; }
 
-	//`t[Pʂň܂Ƃ߂
+	//フレーム単位の定数用リニアアロケータ(UNIFORM_BUFFER_DYNAMICで参照する)
+	//AcquireNextImageで現在のフレームのスロットに切り替わり、SubmitPresentで書き込みがフラッシュされる
+	//同時処理フレーム数を変更するとバッファが作り直されるため、参照するディスクリプタセットも更新し直すこと
+	UniformRing& GetFrameUniformRing() { return *m_frameUniformRing; }
+
+	//ディスクリプタインデキシングによるバインドレスのヒープ(非対応のデバイスではnullptr)
+	BindlessHeap* GetBindlessHeap() { return m_bindlessHeap.get(); }
+	bool IsBindlessSupported() const { return m_bindlessSupported; }
+
+	//描画フレーム単位で扱う情報をまとめたもの
 	struct FrameContext
 	{
 		std::shared_ptr<CommandBuffer> commandBuffer;
-		VkFence inflightFence = VK_NULL_HANDLE;
+		std::shared_ptr<CommandBuffer> acquireCommandBuffer; //キュー所有権の取得用
+		uint64_t timelineValue = 0; //このフレームの提出完了時にシグナルされるタイムライン値
+		std::unique_ptr<DescriptorAllocator> descriptorAllocator; //フレーム内でのみ使うディスクリプタセット用
 	};
 	FrameContext* GetCurrentFrameContext() { return &m_frameContext[m_currentFrameIndex]; }
 	uint32_t GetCurrentFrameIndex() const { return m_currentFrameIndex; }
-	VkResult AcquireNextImage(); //`\ȃXbv`FCC[W̐؂ւ
 
-	//݂̃t[ReLXg̃R}hsAv[e[V𔭍s
+	//同時に処理中とするフレーム数(レイテンシとスループットの調整用)
+	//処理中のフレームの完了を待ってからフレームコンテキストを作り直す
+	//定数用のリングのバッファも作り直されるため、リングを指すディスクリプタはGetGenerationの変化を見て書き直すこと
+	void SetMaxInflightFrames(uint32_t count);
+	uint32_t GetMaxInflightFrames() const { return m_maxInflightFrames; }
+
+	//フレームの提出毎に単調増加する値をシグナルするデバイス共通のタイムラインセマフォ
+	VkSemaphore GetTimelineSemaphore() const { return m_timelineSemaphore; }
+	uint64_t GetCompletedTimelineValue() const;
+	uint64_t GetSubmittedTimelineValue() const { return m_submittedTimelineValue; }
+	//記録中のフレームが提出時にシグナルする値
+	uint64_t GetCurrentFrameTimelineValue() const { return m_submittedTimelineValue + 1; }
+	//指定値の完了を待機する(タイムアウト時はfalse)
+	bool WaitTimelineValue(uint64_t value, uint64_t timeout = UINT64_MAX) const;
+	VkResult AcquireNextImage(); //描画可能なスワップチェインイメージの切り替え
+
+	//現在のフレームコンテキストのコマンドを実行し、プレゼンテーションを発行
 	void SubmitPresent();
 
-	//wR}hobt@sAҋ@
+	//次のSubmitPresentで待機するセマフォを登録(タイムラインセマフォでは待機値を指定)
+	void AddFrameWaitSemaphore(VkSemaphore semaphore, uint64_t value, VkPipelineStageFlags2 stageMask);
+
+	//他キューファミリーから解放されたバッファの所有権取得を、次のフレームの先頭で実行する
+	void AddQueueOwnershipAcquire(const VkBufferMemoryBarrier2& barrier);
+
+	//指定コマンドバッファを実行し、完了を待機
 	void SubmitAndWait(std::shared_ptr<CommandBuffer> commandBuffer);
 
 	std::unique_ptr<Swapchain>& GetSwapchain() { return m_swapchain; }
 
+	//スワップチェインの表示モード, イメージ数(0は自動)
+	//作成済みであれば古いスワップチェインを引き継いで作り直す(処理中のフレームは待たない)
+	void SetPresentMode(VkPresentModeKHR presentMode);
+	void SetSwapchainImageCount(uint32_t count);
+
+	//予算は考慮せず、条件に最も適したメモリタイプを返す(該当なしは例外)
 	uint32_t FindMemoryType(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties) const;
+	uint32_t FindMemoryType(const VkMemoryRequirements& requirements, const MemoryUsage& usage) const;
+
+	//記録中のフレームの完了後に実行する破棄処理を登録する
+	//フレームの途中でも、コマンドが参照しているリソースをデバイスの待機なしに解放できる
+	void DeferDestroy(DeletionQueue::Deleter deleter);
+
+	//バッファ, イメージのメモリはこのアロケータから切り出す
+	//ヒープ毎の予算はフレーム毎(AcquireNextImage)に取得し直す
+	DeviceMemoryAllocator& GetMemoryAllocator() { return *m_memoryAllocator; }
+
+	//パイプライン作成に使う、起動をまたいで保持するキャッシュ
+	//Initializeでディレクトリ内のファイルから読み込み、Cleanupで書き出す(空のパスではファイルを使わない)
+	PipelineCache& GetPipelineCache() { return m_pipelineCache; }
+	void SetPipelineCacheDirectory(const std::filesystem::path& directory) { m_pipelineCacheDirectory = directory; }
+	//同じステートのパイプラインを共有する登録簿(Cleanup時に残っているものはまとめて破棄する)
+	PipelineRegistry& GetPipelineRegistry() { return m_pipelineRegistry; }
+	//VK_EXT_graphics_pipeline_libraryによる部分毎のライブラリと高速リンク(非対応時は通常の作成になる)
+	//SetPipelineLibraryEnabled(false)をInitialize前に呼ぶと、対応していても使わない
+	PipelineLibrary& GetPipelineLibrary() { return m_pipelineLibrary; }
+	void SetPipelineLibraryEnabled(bool enabled) { m_pipelineLibraryEnabled = enabled; }
+	//SPIR-Vの内容で共有するシェーダーモジュール(loader::LoadShaderModuleはここから取得する)
+	ShaderModuleCache& GetShaderModuleCache() { return m_shaderModuleCache; }
+	//内容で共有するディスクリプタセットレイアウト, パイプラインレイアウト(Cleanupまで保持する)
+	PipelineLayoutCache& GetPipelineLayoutCache() { return m_pipelineLayoutCache; }
+	//VK_EXT_shader_objectによるパイプラインを使わない描画(ShaderObject)が使えるか
+	//拡張機能のコマンドはローダーから直接呼べないため、デバイスから取得したものを使う
+	bool IsShaderObjectSupported() const { return m_shaderObjectSupported; }
+	const ShaderObjectFunctions& GetShaderObjectFunctions() const { return m_shaderObjectFunctions; }
+
+	//デバイス作成時に有効にした機能(サポートされているものは全て有効)
+	const VkPhysicalDeviceFeatures& GetEnabledFeatures() const { return m_physDevFeatures.features; }
+
+	//コマンドの並列記録などに使うワーカースレッド
+	//既定ではコア数-1個(呼び出しスレッドと合わせてコア数)を起動する
+	WorkerThreadPool& GetWorkerThreadPool() { return m_workerThreadPool; }
+	void SetWorkerThreadCount(uint32_t count);
 
 	std::function<void(std::vector<const char*>&)> GetWindowSystemExtensions;
 
@@ -79,12 +185,18 @@ private:
 	void CreateLogicalDevice();
 	void CreateDebugMessenger();
 	void CreateCommandPool();
-	void CreateDescriptorPool();
+	void CreatePipelineCache();
+	void CreateDescriptorAllocator();
+	void CreateBindlessHeap();
+	static const std::vector<DescriptorPoolRatio>& GetDefaultDescriptorRatios();
 
+	void CreateTimelineSemaphore();
 	void CreateFrameContexts();
 	void DestroyFrameContexts();
 
 	void AdvanceFrame();
+	//サーフェスの現在の大きさでスワップチェインを作り直す
+	void ResizeSwapchain();
 	void BuildVkFeatures();
 
 	ISurfaceProvider* m_surfaceProvider{};
@@ -95,19 +207,50 @@ private:
 	VkQueue         m_graphicsQueue{};
 	uint32_t        m_graphicsQueueFamilyIndex{};
 	uint32_t        m_presentQueueFamilyIndex{};
+	VkQueue         m_transferQueue{};
+	uint32_t        m_transferQueueFamilyIndex{};
 	VkPhysicalDeviceMemoryProperties m_memoryProperties{};
 	VkPhysicalDeviceProperties m_physicalDeviceProperties{};
+	std::vector<VkExtensionProperties> m_deviceExtensions;
 
 	VkSurfaceKHR    m_surface{};
 	VkCommandPool   m_commandPool{};
-	VkDescriptorPool m_descriptorPool{};
+	DescriptorAllocator m_descriptorAllocator; //常駐用
+	std::unique_ptr<BindlessHeap> m_bindlessHeap;
+	bool m_bindlessSupported = false;
 	std::vector<FrameContext> m_frameContext;
+	CommandPoolRing m_frameCommandPools; //[フレーム][スレッド]のTRANSIENTプール
+	std::unique_ptr<UniformRing> m_frameUniformRing;
+	DeletionQueue m_deletionQueue;
+	PipelineCache m_pipelineCache;
+	PipelineRegistry m_pipelineRegistry;
+	PipelineLibrary m_pipelineLibrary;
+	bool m_pipelineLibraryEnabled = true;
+	bool m_pipelineLibrarySupported = false;
+	bool m_shaderObjectSupported = false;
+	bool m_maintenance5Supported = false;
+	ShaderModuleCache m_shaderModuleCache;
+	PipelineLayoutCache m_pipelineLayoutCache;
+	ShaderObjectFunctions m_shaderObjectFunctions{};
+	std::filesystem::path m_pipelineCacheDirectory = "cache/";
+	std::vector<VkSemaphoreSubmitInfo> m_pendingFrameWaits;
+	std::vector<VkBufferMemoryBarrier2> m_pendingAcquireBarriers;
 	std::unique_ptr<Swapchain> m_swapchain;
+	VkPresentModeKHR m_presentMode = VK_PRESENT_MODE_FIFO_KHR;
+	uint32_t m_swapchainImageCount = 0;
+	bool m_swapchainSuboptimal = false;
+	std::unique_ptr<DeviceMemoryAllocator> m_memoryAllocator;
+	WorkerThreadPool m_workerThreadPool;
+	uint32_t m_workerThreadCount = UINT32_MAX; //UINT32_MAXは自動
 
 	VkDebugUtilsMessengerEXT m_debugMessenger{};
 	PFN_vkSetDebugUtilsObjectNameEXT m_pfnSetDebugUtilsObjectNameEXT{};
 
 	uint32_t m_currentFrameIndex = 0;
+	uint32_t m_maxInflightFrames = DefaultMaxInflightFrames;
+
+	VkSemaphore m_timelineSemaphore{};
+	uint64_t m_submittedTimelineValue = 0;
 
 	VkPhysicalDeviceFeatures2 m_physDevFeatures
 	{
@@ -125,6 +268,18 @@ private:
 	{
 	  .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES
 	};
+	VkPhysicalDeviceGraphicsPipelineLibraryFeaturesEXT m_graphicsPipelineLibraryFeatures
+	{
+	  .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_GRAPHICS_PIPELINE_LIBRARY_FEATURES_EXT
+	};
+	VkPhysicalDeviceShaderObjectFeaturesEXT m_shaderObjectFeatures
+	{
+	  .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SHADER_OBJECT_FEATURES_EXT
+	};
+	VkPhysicalDeviceMaintenance5FeaturesKHR m_maintenance5Features
+	{
+	  .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MAINTENANCE_5_FEATURES_KHR
+	};
 	VkPhysicalDeviceShaderAtomicFloatFeaturesEXT m_atomicFloatFeatures
 	{
 	  .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SHADER_ATOMIC_FLOAT_FEATURES_EXT
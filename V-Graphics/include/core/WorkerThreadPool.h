@@ -0,0 +1,45 @@
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <stdint.h>
+
+//固定数のワーカースレッドでジョブを実行するスレッドプール
+class WorkerThreadPool
+{
+public:
+    WorkerThreadPool() = default;
+    ~WorkerThreadPool();
+
+    WorkerThreadPool(const WorkerThreadPool&) = delete;
+    WorkerThreadPool& operator=(const WorkerThreadPool&) = delete;
+
+    //threadCount が0の場合は全ての処理を呼び出しスレッドで行う
+    void Initialize(uint32_t threadCount);
+    //投入済みのジョブを全て実行してからスレッドを終了する
+    void Cleanup();
+
+    uint32_t GetThreadCount() const { return uint32_t(m_threads.size()); }
+    //呼び出しスレッドの番号。ワーカーは1からスレッド数まで、それ以外のスレッドは0
+    static uint32_t GetCurrentThreadIndex();
+
+    //ジョブを投入する(完了は待たない)
+    void Enqueue(std::function<void()> job);
+
+    //func(taskIndex) を [0, taskCount) について並列に実行し、全ての完了を待つ
+    //呼び出しスレッドも実行に加わる
+    void ParallelFor(uint32_t taskCount, const std::function<void(uint32_t)>& func);
+
+private:
+    void WorkerMain(uint32_t threadIndex);
+
+    std::vector<std::thread> m_threads;
+    std::deque<std::function<void()>> m_jobs;
+    std::mutex m_mutex;
+    std::condition_variable m_condition;
+    bool m_stopping = false;
+};
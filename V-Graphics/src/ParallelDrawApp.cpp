@@ -0,0 +1,437 @@
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <thread>
+#include <chrono>
+#include <iostream>
+#include <stdexcept>
+
+#include "glm/ext.hpp"
+
+#include "ParallelDrawApp.h"
+#include "core/Swapchain.h"
+#include "core/ImageResource.h"
+#include "core/ShaderLoader.h"
+#include "core/AssetPath.h"
+#include "core/GraphicsPipelineBuilder.h"
+#include "core/ShaderReflection.h"
+#include "core/UniformRing.h"
+#include "core/BindlessHeap.h"
+
+void ParallelDrawApp::OnInitialize()
+{
+    if (VulkanContext::Get().GetBindlessHeap() == nullptr)
+    {
+        throw std::runtime_error("ParallelDraw requires descriptor indexing for the bindless heap");
+    }
+
+    m_resourceUploader.Initialize();
+
+    CreateDepthBuffer();
+    CreateCubeGeometry();
+    CreatePipelineLayout();
+
+    CreateDescriptorSets();
+    ResizeTransformBuffers();
+
+    CreateGraphicsPipeline();
+
+    //1, 2, 4, ... と倍にしながら、使用可能な全スレッドまで計測する
+    const uint32_t maxThreads = VulkanContext::Get().GetWorkerThreadPool().GetThreadCount() + 1;
+    for (uint32_t threads = 1; threads < maxThreads; threads *= 2)
+    {
+        m_threadSteps.push_back(threads);
+    }
+    m_threadSteps.push_back(maxThreads);
+}
+
+void ParallelDrawApp::OnDrawFrame()
+{
+    static const auto startTime = std::chrono::steady_clock::now();
+    const float time = std::chrono::duration<float>(std::chrono::steady_clock::now() - startTime).count();
+
+    auto& vulkanCtx = VulkanContext::Get();
+    auto& swapchain = vulkanCtx.GetSwapchain();
+    auto extent = swapchain->GetExtent();
+
+    if (vulkanCtx.AcquireNextImage() != VK_SUCCESS)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        return;
+    }
+
+    //同時処理フレーム数の変更でリングが作り直されていれば、セットを書き直す(処理中のフレームはない)
+    if (m_uniformRingGeneration != vulkanCtx.GetFrameUniformRing().GetGeneration())
+    {
+        UpdateDescriptorSets();
+    }
+    //行列のバッファもフレーム数に合わせる
+    if (m_transformBuffers.size() != vulkanCtx.GetMaxInflightFrames())
+    {
+        ResizeTransformBuffers();
+    }
+
+    auto* frameCtx = vulkanCtx.GetCurrentFrameContext();
+
+    //全オブジェクト共通の定数
+    SceneConstants sceneConstants{};
+    auto eyePos = glm::vec3(0, GridSize * 0.6f, GridSize * 0.9f);
+    sceneConstants.mtxWorld = glm::mat4(1.0f);
+    sceneConstants.mtxView = glm::lookAt(eyePos, glm::vec3(0, 0, 0), glm::vec3(0, 1, 0));
+    sceneConstants.mtxProj = glm::perspectiveFov(
+        glm::radians(45.0f),
+        float(extent.width), float(extent.height),
+        0.1f, 1000.0f);
+    sceneConstants.lightDir = glm::vec4(glm::normalize(glm::vec3(0.3f, 1.0f, 0.5f)), 0.0f);
+    sceneConstants.eyePosition = glm::vec4(eyePos, 0);
+    auto sceneAllocation = vulkanCtx.GetFrameUniformRing().Push(sceneConstants);
+
+    //このフレームの行列のバッファ(AcquireNextImageで前回の使用の完了を待っている)
+    auto& transformBuffer = m_transformBuffers[vulkanCtx.GetCurrentFrameIndex()];
+    auto* transforms = static_cast<glm::mat4*>(transformBuffer->Map());
+    const uint32_t transformBufferIndex = transformBuffer->GetBindlessIndex();
+    auto* bindlessHeap = vulkanCtx.GetBindlessHeap();
+
+    auto& commandBuffer = frameCtx->commandBuffer;
+    commandBuffer->Begin();
+
+    VkImageSubresourceRange range{
+        .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+        .baseMipLevel = 0, .levelCount = 1,
+        .baseArrayLayer = 0, .layerCount = 1,
+    };
+    commandBuffer->TransitionLayout(
+        swapchain->GetCurrentImage(), range,
+        ImageLayoutTransition::FromUndefinedToColorAttachment()
+    );
+    // 深度バッファは毎フレームクリアするため以前の内容は不要。前フレームの書き込みとの順序はトラッカーが保証する
+    commandBuffer->RequireImageState(*m_depthBuffer, VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL,
+        VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT,
+        VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+        true);
+
+    VkRenderingAttachmentInfo colorAttachment{
+        .sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO,
+        .imageView = swapchain->GetCurrentView(),
+        .imageLayout = VK_IMAGE_LAYOUT_ATTACHMENT_OPTIMAL,
+        .loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR,
+        .storeOp = VK_ATTACHMENT_STORE_OP_STORE,
+        .clearValue = VkClearValue{.color = {{0.1f, 0.1f, 0.2f, 0.0f}} }
+    };
+    VkRenderingAttachmentInfo depthAttachment{
+        .sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO,
+        .imageView = m_depthBuffer->GetVkImageView(),
+        .imageLayout = VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL,
+        .loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR,
+        .storeOp = VK_ATTACHMENT_STORE_OP_STORE,
+        .clearValue = {.depthStencil = { 1.0f, 0 } }
+    };
+    VkRenderingInfo renderingInfo{
+        .sType = VK_STRUCTURE_TYPE_RENDERING_INFO,
+        .renderArea = { {0, 0}, extent },
+        .layerCount = 1,
+        .colorAttachmentCount = 1,
+        .pColorAttachments = &colorAttachment,
+        .pDepthAttachment = &depthAttachment,
+    };
+    //二次コマンドバッファが描画する先のフォーマット
+    VkFormat colorFormat = swapchain->GetFormat().format;
+    VkCommandBufferInheritanceRenderingInfo inheritanceRendering{
+        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_RENDERING_INFO,
+        .colorAttachmentCount = 1,
+        .pColorAttachmentFormats = &colorFormat,
+        .depthAttachmentFormat = m_depthBuffer->GetFormat(),
+        .rasterizationSamples = VK_SAMPLE_COUNT_1_BIT,
+    };
+
+    //各スレッドは担当範囲の行列をバッファに書き込み、そのまま描画コマンドを記録する
+    auto recordObjects = [&](CommandBuffer& secondary, uint32_t begin, uint32_t end)
+    {
+        if (sceneAllocation.mapped == nullptr)
+        {
+            return;
+        }
+
+        vkCmdBindPipeline(secondary, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipeline);
+        secondary.SetViewport(extent);
+        secondary.SetPrimitiveTopology(VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST);
+        secondary.SetCullMode(VK_CULL_MODE_BACK_BIT);
+        secondary.SetFrontFace(VK_FRONT_FACE_COUNTER_CLOCKWISE);
+        secondary.SetDepthTestEnable(true);
+        secondary.SetDepthWriteEnable(true);
+        secondary.SetDepthCompareOp(VK_COMPARE_OP_LESS);
+
+        auto vb = m_cube.vertexBuffer->GetVkBuffer();
+        VkDeviceSize offsets[] = { 0 };
+        vkCmdBindVertexBuffers(secondary, 0, 1, &vb, offsets);
+        vkCmdBindIndexBuffer(secondary, m_cube.indexBuffer->GetVkBuffer(), 0, VK_INDEX_TYPE_UINT32);
+
+        //セットは二次コマンドバッファ毎に1度だけバインドし、オブジェクトはプッシュ定数の番号で切り替える
+        vkCmdBindDescriptorSets(secondary, VK_PIPELINE_BIND_POINT_GRAPHICS,
+            m_pipelineLayout,
+            0, 1, &m_descriptorSet,
+            1, &sceneAllocation.dynamicOffset);
+        bindlessHeap->Bind(secondary, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipelineLayout, 1);
+
+        for (uint32_t i = begin; i < end; ++i)
+        {
+            const float x = float(i % GridSize) - GridSize * 0.5f;
+            const float z = float(i / GridSize) - GridSize * 0.5f;
+            glm::mat4 mtxWorld = glm::translate(glm::mat4(1.0f), glm::vec3(x, 0.0f, z));
+            mtxWorld = glm::rotate(mtxWorld, time + i * 0.01f, glm::vec3(0.0f, 1.0f, 0.0f));
+            transforms[i] = glm::scale(mtxWorld, glm::vec3(0.6f));
+
+            DrawConstants drawConstants{
+                .transformBufferIndex = transformBufferIndex,
+                .objectIndex = i,
+            };
+            vkCmdPushConstants(secondary, m_pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(drawConstants), &drawConstants);
+            secondary.DrawIndexed(m_cube.indexCount);
+        }
+    };
+
+    const uint32_t threads = m_threadSteps[m_stepIndex];
+    const auto recordStart = std::chrono::steady_clock::now();
+    commandBuffer->RecordRenderingParallel(renderingInfo, inheritanceRendering, ObjectCount, recordObjects, threads);
+    m_stepRecordSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - recordStart).count();
+    transformBuffer->Unmap();
+
+    commandBuffer->TransitionLayout(
+        swapchain->GetCurrentImage(), range,
+        ImageLayoutTransition::FromColorToPresent()
+    );
+    commandBuffer->End();
+    vulkanCtx.SubmitPresent();
+
+    if (++m_stepFrameCount == FramesPerStep)
+    {
+        AdvanceBenchmarkStep();
+    }
+}
+
+void ParallelDrawApp::OnCleanup()
+{
+    auto& vulkanCtx = VulkanContext::Get();
+
+    // パイプラインは登録簿が最後の参照の解放時に破棄を遅延する
+    vulkanCtx.GetPipelineRegistry().Release(m_pipeline);
+    m_pipeline = VK_NULL_HANDLE;
+
+    // 処理中のフレームが参照しているため、ディスクリプタはフレームの完了後に解放する
+    vulkanCtx.DeferDestroy([descriptorSet = m_descriptorSet]()
+    {
+        VulkanContext::Get().FreeDescriptorSet(descriptorSet);
+    });
+    m_descriptorSet = VK_NULL_HANDLE;
+
+    // バッファ, イメージも内部で破棄が遅延される(ヒープのインデックスも同時に返却される)
+    m_transformBuffers.clear();
+    m_cube.vertexBuffer.reset();
+    m_cube.indexBuffer.reset();
+
+    m_depthBuffer->Cleanup();
+    m_depthBuffer.reset();
+
+    m_resourceUploader.Cleanup();
+}
+
+void ParallelDrawApp::AdvanceBenchmarkStep()
+{
+    std::cout << "[ParallelDraw] threads=" << m_threadSteps[m_stepIndex]
+        << " objects=" << ObjectCount
+        << " record=" << (m_stepRecordSeconds * 1000.0 / m_stepFrameCount) << " ms/frame" << std::endl;
+
+    m_stepIndex = (m_stepIndex + 1) % uint32_t(m_threadSteps.size());
+    m_stepFrameCount = 0;
+    m_stepRecordSeconds = 0.0;
+}
+
+void ParallelDrawApp::CreateDepthBuffer()
+{
+    auto& vulkanCtx = VulkanContext::Get();
+    auto& swapchain = vulkanCtx.GetSwapchain();
+    auto extent = swapchain->GetExtent();
+    m_depthBuffer = DepthBuffer::Create(extent, VK_FORMAT_D32_SFLOAT);
+}
+
+void ParallelDrawApp::CreateCubeGeometry()
+{
+    const glm::vec3 A(-0.5f, 0.5f, 0.5f), B(-0.5f, -0.5f, 0.5f),
+        C(0.5f, 0.5f, 0.5f), D(0.5f, -0.5f, 0.5f),
+        E(-0.5f, 0.5f, -0.5f), F(-0.5f, -0.5f, -0.5f),
+        G(0.5f, 0.5f, -0.5f), H(0.5f, -0.5f, -0.5f);
+
+    std::vector<Vertex> vertices =
+    {
+        // front
+        { A, { 0.0f, 0.0f, 1.0f }, { 1.0f, 0.0f, 1.0f } },
+        { B, { 0.0f, 0.0f, 1.0f }, { 1.0f, 0.0f, 0.0f } },
+        { C, { 0.0f, 0.0f, 1.0f }, { 1.0f, 1.0f, 1.0f } },
+        { D, { 0.0f, 0.0f, 1.0f }, { 1.0f, 1.0f, 0.0f } },
+        // back
+        { E, { 0.0f, 0.0f, -1.0f }, { 0.0f, 0.0f, 1.0f } },
+        { F, { 0.0f, 0.0f, -1.0f }, { 0.0f, 0.0f, 0.0f } },
+        { G, { 0.0f, 0.0f, -1.0f }, { 0.0f, 1.0f, 1.0f } },
+        { H, { 0.0f, 0.0f, -1.0f }, { 0.0f, 1.0f, 0.0f } },
+        // right
+        { C, { 1.0f, 0.0f, 0.0f }, { 1.0f, 1.0f, 1.0f } },
+        { D, { 1.0f, 0.0f, 0.0f }, { 1.0f, 1.0f, 0.0f } },
+        { G, { 1.0f, 0.0f, 0.0f }, { 0.0f, 1.0f, 1.0f } },
+        { H, { 1.0f, 0.0f, 0.0f }, { 0.0f, 1.0f, 0.0f } },
+        // left
+        { E, { -1.0f, 0.0f, 0.0f }, { 0.0f, 0.0f, 1.0f } },
+        { F, { -1.0f, 0.0f, 0.0f }, { 0.0f, 0.0f, 0.0f } },
+        { A, { -1.0f, 0.0f, 0.0f }, { 1.0f, 0.0f, 1.0f } },
+        { B, { -1.0f, 0.0f, 0.0f }, { 1.0f, 0.0f, 0.0f } },
+        // top
+        { E, { 0.0f, 1.0f, 0.0f }, { 0.0f, 0.0f, 1.0f } },
+        { A, { 0.0f, 1.0f, 0.0f }, { 1.0f, 0.0f, 1.0f } },
+        { G, { 0.0f, 1.0f, 0.0f }, { 0.0f, 1.0f, 1.0f } },
+        { C, { 0.0f, 1.0f, 0.0f }, { 1.0f, 1.0f, 1.0f } },
+        // bottom
+        { B, { 0.0f, -1.0f, 0.0f }, { 1.0f, 0.0f, 0.0f } },
+        { F, { 0.0f, -1.0f, 0.0f }, { 0.0f, 0.0f, 0.0f } },
+        { D, { 0.0f, -1.0f, 0.0f }, { 1.0f, 1.0f, 0.0f } },
+        { H, { 0.0f, -1.0f, 0.0f }, { 0.0f, 1.0f, 0.0f } },
+    };
+    std::vector<uint32_t> indices = {
+        0, 1, 2, 2, 1, 3,       // front
+        6, 7, 4, 4, 7, 5,       // back
+        8, 9, 10, 10, 9, 11,    // right
+        12, 13, 14, 14, 13, 15, // left
+        16, 17, 18, 18, 17, 19, // top
+        20, 21, 22, 22, 21, 23, // bottom
+    };
+
+    VkDeviceSize bufferSize;
+    VkMemoryPropertyFlags memProps = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+    bufferSize = sizeof(Vertex) * vertices.size();
+    m_cube.vertexBuffer = VertexBuffer::Create(bufferSize, memProps);
+    m_resourceUploader.UploadBuffer(m_cube.vertexBuffer.get(), vertices.data(), bufferSize, VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT);
+
+    bufferSize = sizeof(uint32_t) * indices.size();
+    m_cube.indexBuffer = IndexBuffer::Create(bufferSize, memProps);
+    m_resourceUploader.UploadBuffer(m_cube.indexBuffer.get(), indices.data(), bufferSize, VK_ACCESS_INDEX_READ_BIT);
+    m_cube.indexCount = uint32_t(indices.size());
+
+    // 完了は待たず、最初のフレームの提出で転送完了を待機させる
+    m_resourceUploader.Submit();
+}
+
+void ParallelDrawApp::CreatePipelineLayout()
+{
+    //レイアウトはシェーダーのリフレクションから組み立てる
+    //set 1のストレージバッファ配列は、キャッシュに登録されたバインドレスヒープのレイアウトになる
+    auto& vulkanCtx = VulkanContext::Get();
+    VkShaderModule vertShaderModule = loader::LoadShaderModule(GetAssetPath(AssetType::Shader, "parallelDraw/cube_bindless.vert.spv"));
+    VkShaderModule fragShaderModule = loader::LoadShaderModule(GetAssetPath(AssetType::Shader, "simpleCube/cube.frag.spv"));
+
+    PipelineReflection reflection;
+    reflection.AddShaderModule(vertShaderModule).AddShaderModule(fragShaderModule);
+    reflection.SetDescriptorType(0, 0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC);
+    auto layout = vulkanCtx.GetPipelineLayoutCache().Acquire(reflection);
+    if (layout.setLayouts.size() != 2 || layout.setLayouts[1] != vulkanCtx.GetBindlessHeap()->GetDescriptorSetLayout())
+    {
+        throw std::runtime_error("cube_bindless.vert does not match the bindless heap layout");
+    }
+    m_descriptorSetLayout = layout.setLayouts[0];
+    m_pipelineLayout = layout.pipelineLayout;
+
+    loader::ReleaseShaderModule(vertShaderModule);
+    loader::ReleaseShaderModule(fragShaderModule);
+}
+
+void ParallelDrawApp::CreateDescriptorSets()
+{
+    //全フレームでフレームのリングを指す1つのセットを共有する
+    auto& vulkanCtx = VulkanContext::Get();
+    m_descriptorSet = vulkanCtx.AllocateDescriptorSet(m_descriptorSetLayout);
+    UpdateDescriptorSets();
+}
+
+void ParallelDrawApp::UpdateDescriptorSets()
+{
+    auto& vulkanCtx = VulkanContext::Get();
+    auto& uniformRing = vulkanCtx.GetFrameUniformRing();
+    auto bufferInfo = uniformRing.GetDescriptorInfo(sizeof(SceneConstants));
+    VkWriteDescriptorSet write{
+        .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+        .dstSet = m_descriptorSet,
+        .dstBinding = 0,
+        .dstArrayElement = 0,
+        .descriptorCount = 1,
+        .descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,
+        .pBufferInfo = &bufferInfo,
+    };
+    vkUpdateDescriptorSets(vulkanCtx.GetVkDevice(), 1, &write, 0, nullptr);
+    m_uniformRingGeneration = uniformRing.GetGeneration();
+}
+
+void ParallelDrawApp::ResizeTransformBuffers()
+{
+    //余った分は破棄が遅延される(ヒープのインデックスも同時に返却される)
+    auto& vulkanCtx = VulkanContext::Get();
+    const uint32_t frameCount = vulkanCtx.GetMaxInflightFrames();
+    if (m_transformBuffers.size() > frameCount)
+    {
+        m_transformBuffers.resize(frameCount);
+    }
+
+    //CPUが毎フレーム書き込むため、ホストから見えるメモリに置いてヒープに登録しておく
+    while (m_transformBuffers.size() < frameCount)
+    {
+        auto buffer = StorageBuffer::Create(sizeof(glm::mat4) * ObjectCount,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+        if (buffer == nullptr || buffer->Map() == nullptr || buffer->GetBindlessIndex() == BindlessHeap::InvalidIndex)
+        {
+            throw std::runtime_error("failed to create transform buffer!");
+        }
+        m_transformBuffers.push_back(buffer);
+    }
+}
+
+void ParallelDrawApp::CreateGraphicsPipeline()
+{
+    auto& vulkanCtx = VulkanContext::Get();
+    auto& swapchain = vulkanCtx.GetSwapchain();
+
+    //フラグメントシェーダーはSimpleCubeのものを使い回す(ユニフォームブロックは動的オフセットでも同じ)
+    VkShaderModule vertShaderModule = loader::LoadShaderModule(GetAssetPath(AssetType::Shader, "parallelDraw/cube_bindless.vert.spv"));
+    VkShaderModule fragShaderModule = loader::LoadShaderModule(GetAssetPath(AssetType::Shader, "simpleCube/cube.frag.spv"));
+
+    auto vertexInput = PipelineReflection{}.AddShaderModule(vertShaderModule).GetVertexInputState();
+    assert(vertexInput.binding.stride == sizeof(Vertex) && "Vertex does not match cube_bindless.vert inputs");
+
+    GraphicsPipelineBuilder builder{};
+    builder.AddShaderStage(VK_SHADER_STAGE_VERTEX_BIT, vertShaderModule);
+    builder.AddShaderStage(VK_SHADER_STAGE_FRAGMENT_BIT, fragShaderModule);
+    builder.SetVertexInput(&vertexInput.binding, 1, vertexInput.attributes.data(), uint32_t(vertexInput.attributes.size()));
+    builder.UseDynamicState();
+    builder.SetPipelineLayout(m_pipelineLayout);
+
+    VkPipelineDepthStencilStateCreateInfo depthStencilState{
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO,
+        .depthTestEnable = VK_TRUE,
+        .depthWriteEnable = VK_TRUE,
+        .depthCompareOp = VK_COMPARE_OP_LESS,
+    };
+    builder.SetDepthStencilState(depthStencilState);
+
+    VkPipelineRasterizationStateCreateInfo rasterizerState{
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO,
+        .depthClampEnable = VK_FALSE,
+        .rasterizerDiscardEnable = VK_FALSE,
+        .polygonMode = VK_POLYGON_MODE_FILL,
+        .cullMode = VK_CULL_MODE_BACK_BIT,
+        .frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE,
+        .depthBiasEnable = VK_FALSE,
+        .lineWidth = 1.0f,
+    };
+    builder.SetRasterizationState(rasterizerState);
+    builder.UseDynamicRendering(swapchain->GetFormat().format, m_depthBuffer->GetFormat());
+
+    m_pipeline = vulkanCtx.GetPipelineRegistry().Acquire(builder);
+
+    loader::ReleaseShaderModule(vertShaderModule);
+    loader::ReleaseShaderModule(fragShaderModule);
+}
@@ -0,0 +1,465 @@
+#include <cmath>
+#include <cstring>
+#include <thread>
+#include <chrono>
+#include <iostream>
+#include <iterator>
+#include <stdexcept>
+
+#include "glm/ext.hpp"
+
+#include "ShaderObjectBenchApp.h"
+#include "core/Swapchain.h"
+#include "core/ImageResource.h"
+#include "core/ShaderLoader.h"
+#include "core/AssetPath.h"
+#include "core/GraphicsPipelineBuilder.h"
+#include "core/ShaderReflection.h"
+#include "core/UniformRing.h"
+
+namespace
+{
+    //描画毎に順に切り替えるステートの組み合わせ
+    const ShaderObjectBenchApp::StateVariant StateVariants[] = {
+        { VK_CULL_MODE_BACK_BIT, VK_COMPARE_OP_LESS },
+        { VK_CULL_MODE_NONE, VK_COMPARE_OP_LESS },
+        { VK_CULL_MODE_FRONT_BIT, VK_COMPARE_OP_LESS },
+        { VK_CULL_MODE_BACK_BIT, VK_COMPARE_OP_LESS_OR_EQUAL },
+        { VK_CULL_MODE_NONE, VK_COMPARE_OP_LESS_OR_EQUAL },
+        { VK_CULL_MODE_FRONT_BIT, VK_COMPARE_OP_LESS_OR_EQUAL },
+    };
+
+    const VkVertexInputBindingDescription VertexBinding{
+        .binding = 0,
+        .stride = sizeof(ShaderObjectBenchApp::Vertex),
+        .inputRate = VK_VERTEX_INPUT_RATE_VERTEX
+    };
+    const VkVertexInputAttributeDescription VertexAttributes[] = {
+        {.location = 0, .binding = 0, .format = VK_FORMAT_R32G32B32_SFLOAT, .offset = offsetof(ShaderObjectBenchApp::Vertex, position) },
+        {.location = 1, .binding = 0, .format = VK_FORMAT_R32G32B32_SFLOAT, .offset = offsetof(ShaderObjectBenchApp::Vertex, normal) },
+        {.location = 2, .binding = 0, .format = VK_FORMAT_R32G32B32_SFLOAT, .offset = offsetof(ShaderObjectBenchApp::Vertex, color) },
+    };
+
+    double ElapsedMilliseconds(std::chrono::steady_clock::time_point start)
+    {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+}
+
+void ShaderObjectBenchApp::OnInitialize()
+{
+    m_resourceUploader.Initialize();
+
+    CreateDepthBuffer();
+    CreateCubeGeometry();
+    CreatePipelineLayout();
+
+    CreateDescriptorSets();
+
+    CreatePipelines();
+    CreateShaderObject();
+
+    m_modeSteps.push_back(DrawMode::Pipeline);
+    if (m_shaderObject)
+    {
+        m_modeSteps.push_back(DrawMode::ShaderObject);
+    }
+}
+
+void ShaderObjectBenchApp::OnDrawFrame()
+{
+    static const auto startTime = std::chrono::steady_clock::now();
+    const float time = std::chrono::duration<float>(std::chrono::steady_clock::now() - startTime).count();
+
+    auto& vulkanCtx = VulkanContext::Get();
+    auto& swapchain = vulkanCtx.GetSwapchain();
+    auto extent = swapchain->GetExtent();
+
+    if (vulkanCtx.AcquireNextImage() != VK_SUCCESS)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        return;
+    }
+
+    //同時処理フレーム数の変更でリングが作り直されていれば、セットを書き直す(処理中のフレームはない)
+    if (m_uniformRingGeneration != vulkanCtx.GetFrameUniformRing().GetGeneration())
+    {
+        UpdateDescriptorSets();
+    }
+
+    auto* frameCtx = vulkanCtx.GetCurrentFrameContext();
+
+    //全オブジェクト共通の定数
+    ObjectConstants sharedConstants{};
+    auto eyePos = glm::vec3(0, GridSize * 0.6f, GridSize * 0.9f);
+    sharedConstants.mtxView = glm::lookAt(eyePos, glm::vec3(0, 0, 0), glm::vec3(0, 1, 0));
+    sharedConstants.mtxProj = glm::perspectiveFov(
+        glm::radians(45.0f),
+        float(extent.width), float(extent.height),
+        0.1f, 1000.0f);
+    sharedConstants.lightDir = glm::vec4(glm::normalize(glm::vec3(0.3f, 1.0f, 0.5f)), 0.0f);
+    sharedConstants.eyePosition = glm::vec4(eyePos, 0);
+
+    auto& commandBuffer = frameCtx->commandBuffer;
+    commandBuffer->Begin();
+
+    VkImageSubresourceRange range{
+        .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+        .baseMipLevel = 0, .levelCount = 1,
+        .baseArrayLayer = 0, .layerCount = 1,
+    };
+    commandBuffer->TransitionLayout(
+        swapchain->GetCurrentImage(), range,
+        ImageLayoutTransition::FromUndefinedToColorAttachment()
+    );
+    // 深度バッファは毎フレームクリアするため以前の内容は不要。前フレームの書き込みとの順序はトラッカーが保証する
+    commandBuffer->RequireImageState(*m_depthBuffer, VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL,
+        VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT,
+        VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+        true);
+
+    VkRenderingAttachmentInfo colorAttachment{
+        .sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO,
+        .imageView = swapchain->GetCurrentView(),
+        .imageLayout = VK_IMAGE_LAYOUT_ATTACHMENT_OPTIMAL,
+        .loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR,
+        .storeOp = VK_ATTACHMENT_STORE_OP_STORE,
+        .clearValue = VkClearValue{.color = {{0.1f, 0.1f, 0.2f, 0.0f}} }
+    };
+    VkRenderingAttachmentInfo depthAttachment{
+        .sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO,
+        .imageView = m_depthBuffer->GetVkImageView(),
+        .imageLayout = VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL,
+        .loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR,
+        .storeOp = VK_ATTACHMENT_STORE_OP_STORE,
+        .clearValue = {.depthStencil = { 1.0f, 0 } }
+    };
+    VkRenderingInfo renderingInfo{
+        .sType = VK_STRUCTURE_TYPE_RENDERING_INFO,
+        .renderArea = { {0, 0}, extent },
+        .layerCount = 1,
+        .colorAttachmentCount = 1,
+        .pColorAttachments = &colorAttachment,
+        .pDepthAttachment = &depthAttachment,
+    };
+
+    //定数の書き込みは両方式で同じため、記録時間に含めないよう先に済ませる
+    auto& uniformRing = vulkanCtx.GetFrameUniformRing();
+    std::vector<uint32_t> dynamicOffsets;
+    dynamicOffsets.reserve(ObjectCount);
+    for (uint32_t i = 0; i < ObjectCount; ++i)
+    {
+        const float x = float(i % GridSize) - GridSize * 0.5f;
+        const float z = float(i / GridSize) - GridSize * 0.5f;
+        ObjectConstants constants = sharedConstants;
+        constants.mtxWorld = glm::translate(glm::mat4(1.0f), glm::vec3(x, 0.0f, z));
+        constants.mtxWorld = glm::rotate(constants.mtxWorld, time + i * 0.01f, glm::vec3(0.0f, 1.0f, 0.0f));
+        constants.mtxWorld = glm::scale(constants.mtxWorld, glm::vec3(0.6f));
+        auto allocation = uniformRing.Push(constants);
+        if (allocation.mapped == nullptr)
+        {
+            break;
+        }
+        dynamicOffsets.push_back(allocation.dynamicOffset);
+    }
+
+    const DrawMode mode = m_modeSteps[m_stepIndex];
+    const auto recordStart = std::chrono::steady_clock::now();
+    commandBuffer->BeginRendering(renderingInfo);
+
+    if (mode == DrawMode::ShaderObject)
+    {
+        //パイプラインに焼き込まれていたステートを全て設定する
+        commandBuffer->BindShaderObject(*m_shaderObject);
+        commandBuffer->SetShaderObjectDefaults();
+        commandBuffer->SetVertexInput(&VertexBinding, 1, VertexAttributes, uint32_t(std::size(VertexAttributes)));
+        commandBuffer->SetViewport(extent);
+        commandBuffer->SetPrimitiveTopology(VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST);
+        commandBuffer->SetFrontFace(VK_FRONT_FACE_COUNTER_CLOCKWISE);
+        commandBuffer->SetDepthTestEnable(true);
+        commandBuffer->SetDepthWriteEnable(true);
+    }
+
+    auto vb = m_cube.vertexBuffer->GetVkBuffer();
+    VkDeviceSize offsets[] = { 0 };
+    vkCmdBindVertexBuffers(*commandBuffer, 0, 1, &vb, offsets);
+    vkCmdBindIndexBuffer(*commandBuffer, m_cube.indexBuffer->GetVkBuffer(), 0, VK_INDEX_TYPE_UINT32);
+
+    for (uint32_t i = 0; i < uint32_t(dynamicOffsets.size()); ++i)
+    {
+        const uint32_t variantIndex = i % uint32_t(std::size(StateVariants));
+        if (mode == DrawMode::Pipeline)
+        {
+            vkCmdBindPipeline(*commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipelines[variantIndex]);
+        }
+        else
+        {
+            commandBuffer->SetCullMode(StateVariants[variantIndex].cullMode);
+            commandBuffer->SetDepthCompareOp(StateVariants[variantIndex].depthCompareOp);
+        }
+
+        vkCmdBindDescriptorSets(*commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
+            m_pipelineLayout,
+            0, 1, &m_descriptorSet,
+            1, &dynamicOffsets[i]);
+        commandBuffer->DrawIndexed(m_cube.indexCount);
+    }
+
+    commandBuffer->EndRendering();
+    m_stepRecordSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - recordStart).count();
+
+    commandBuffer->TransitionLayout(
+        swapchain->GetCurrentImage(), range,
+        ImageLayoutTransition::FromColorToPresent()
+    );
+    commandBuffer->End();
+    vulkanCtx.SubmitPresent();
+
+    if (++m_stepFrameCount == FramesPerStep)
+    {
+        AdvanceBenchmarkStep();
+    }
+}
+
+void ShaderObjectBenchApp::OnCleanup()
+{
+    auto& vulkanCtx = VulkanContext::Get();
+
+    // 処理中のフレームが参照しているため、パイプラインとディスクリプタはフレームの完了後に破棄する
+    vulkanCtx.DeferDestroy([device = vulkanCtx.GetVkDevice(), pipelines = std::move(m_pipelines), descriptorSet = m_descriptorSet]()
+    {
+        for (auto pipeline : pipelines)
+        {
+            vkDestroyPipeline(device, pipeline, nullptr);
+        }
+        VulkanContext::Get().FreeDescriptorSet(descriptorSet);
+    });
+    m_pipelines.clear();
+    m_descriptorSet = VK_NULL_HANDLE;
+
+    // シェーダーオブジェクト, バッファ, イメージも内部で破棄が遅延される
+    m_shaderObject.reset();
+
+    m_cube.vertexBuffer.reset();
+    m_cube.indexBuffer.reset();
+
+    m_depthBuffer->Cleanup();
+    m_depthBuffer.reset();
+
+    m_resourceUploader.Cleanup();
+}
+
+void ShaderObjectBenchApp::AdvanceBenchmarkStep()
+{
+    std::cout << "[ShaderObject] mode=" << (m_modeSteps[m_stepIndex] == DrawMode::Pipeline ? "pipeline" : "shaderobject")
+        << " objects=" << ObjectCount
+        << " variants=" << std::size(StateVariants)
+        << " record=" << (m_stepRecordSeconds * 1000.0 / m_stepFrameCount) << " ms/frame" << std::endl;
+
+    m_stepIndex = (m_stepIndex + 1) % uint32_t(m_modeSteps.size());
+    m_stepFrameCount = 0;
+    m_stepRecordSeconds = 0.0;
+}
+
+void ShaderObjectBenchApp::CreateDepthBuffer()
+{
+    auto& vulkanCtx = VulkanContext::Get();
+    auto& swapchain = vulkanCtx.GetSwapchain();
+    auto extent = swapchain->GetExtent();
+    m_depthBuffer = DepthBuffer::Create(extent, VK_FORMAT_D32_SFLOAT);
+}
+
+void ShaderObjectBenchApp::CreateCubeGeometry()
+{
+    const glm::vec3 A(-0.5f, 0.5f, 0.5f), B(-0.5f, -0.5f, 0.5f),
+        C(0.5f, 0.5f, 0.5f), D(0.5f, -0.5f, 0.5f),
+        E(-0.5f, 0.5f, -0.5f), F(-0.5f, -0.5f, -0.5f),
+        G(0.5f, 0.5f, -0.5f), H(0.5f, -0.5f, -0.5f);
+
+    std::vector<Vertex> vertices =
+    {
+        // front
+        { A, { 0.0f, 0.0f, 1.0f }, { 1.0f, 0.0f, 1.0f } },
+        { B, { 0.0f, 0.0f, 1.0f }, { 1.0f, 0.0f, 0.0f } },
+        { C, { 0.0f, 0.0f, 1.0f }, { 1.0f, 1.0f, 1.0f } },
+        { D, { 0.0f, 0.0f, 1.0f }, { 1.0f, 1.0f, 0.0f } },
+        // back
+        { E, { 0.0f, 0.0f, -1.0f }, { 0.0f, 0.0f, 1.0f } },
+        { F, { 0.0f, 0.0f, -1.0f }, { 0.0f, 0.0f, 0.0f } },
+        { G, { 0.0f, 0.0f, -1.0f }, { 0.0f, 1.0f, 1.0f } },
+        { H, { 0.0f, 0.0f, -1.0f }, { 0.0f, 1.0f, 0.0f } },
+        // right
+        { C, { 1.0f, 0.0f, 0.0f }, { 1.0f, 1.0f, 1.0f } },
+        { D, { 1.0f, 0.0f, 0.0f }, { 1.0f, 1.0f, 0.0f } },
+        { G, { 1.0f, 0.0f, 0.0f }, { 0.0f, 1.0f, 1.0f } },
+        { H, { 1.0f, 0.0f, 0.0f }, { 0.0f, 1.0f, 0.0f } },
+        // left
+        { E, { -1.0f, 0.0f, 0.0f }, { 0.0f, 0.0f, 1.0f } },
+        { F, { -1.0f, 0.0f, 0.0f }, { 0.0f, 0.0f, 0.0f } },
+        { A, { -1.0f, 0.0f, 0.0f }, { 1.0f, 0.0f, 1.0f } },
+        { B, { -1.0f, 0.0f, 0.0f }, { 1.0f, 0.0f, 0.0f } },
+        // top
+        { E, { 0.0f, 1.0f, 0.0f }, { 0.0f, 0.0f, 1.0f } },
+        { A, { 0.0f, 1.0f, 0.0f }, { 1.0f, 0.0f, 1.0f } },
+        { G, { 0.0f, 1.0f, 0.0f }, { 0.0f, 1.0f, 1.0f } },
+        { C, { 0.0f, 1.0f, 0.0f }, { 1.0f, 1.0f, 1.0f } },
+        // bottom
+        { B, { 0.0f, -1.0f, 0.0f }, { 1.0f, 0.0f, 0.0f } },
+        { F, { 0.0f, -1.0f, 0.0f }, { 0.0f, 0.0f, 0.0f } },
+        { D, { 0.0f, -1.0f, 0.0f }, { 1.0f, 1.0f, 0.0f } },
+        { H, { 0.0f, -1.0f, 0.0f }, { 0.0f, 1.0f, 0.0f } },
+    };
+    std::vector<uint32_t> indices = {
+        0, 1, 2, 2, 1, 3,       // front
+        6, 7, 4, 4, 7, 5,       // back
+        8, 9, 10, 10, 9, 11,    // right
+        12, 13, 14, 14, 13, 15, // left
+        16, 17, 18, 18, 17, 19, // top
+        20, 21, 22, 22, 21, 23, // bottom
+    };
+
+    VkDeviceSize bufferSize;
+    VkMemoryPropertyFlags memProps = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+    bufferSize = sizeof(Vertex) * vertices.size();
+    m_cube.vertexBuffer = VertexBuffer::Create(bufferSize, memProps);
+    m_resourceUploader.UploadBuffer(m_cube.vertexBuffer.get(), vertices.data(), bufferSize, VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT);
+
+    bufferSize = sizeof(uint32_t) * indices.size();
+    m_cube.indexBuffer = IndexBuffer::Create(bufferSize, memProps);
+    m_resourceUploader.UploadBuffer(m_cube.indexBuffer.get(), indices.data(), bufferSize, VK_ACCESS_INDEX_READ_BIT);
+    m_cube.indexCount = uint32_t(indices.size());
+
+    // 完了は待たず、最初のフレームの提出で転送完了を待機させる
+    m_resourceUploader.Submit();
+}
+
+void ShaderObjectBenchApp::CreatePipelineLayout()
+{
+    //パイプラインとシェーダーオブジェクトで同じセットレイアウトを使うため、リフレクションから共有のものを得る
+    auto& vulkanCtx = VulkanContext::Get();
+    VkShaderModule vertShaderModule = loader::LoadShaderModule(GetAssetPath(AssetType::Shader, "simpleCube/cube.vert.spv"));
+    VkShaderModule fragShaderModule = loader::LoadShaderModule(GetAssetPath(AssetType::Shader, "simpleCube/cube.frag.spv"));
+
+    PipelineReflection reflection;
+    reflection.AddShaderModule(vertShaderModule).AddShaderModule(fragShaderModule);
+    reflection.SetDescriptorType(0, 0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC);
+    auto layout = vulkanCtx.GetPipelineLayoutCache().Acquire(reflection);
+    m_descriptorSetLayout = layout.setLayouts.at(0);
+    m_pipelineLayout = layout.pipelineLayout;
+
+    loader::ReleaseShaderModule(vertShaderModule);
+    loader::ReleaseShaderModule(fragShaderModule);
+}
+
+void ShaderObjectBenchApp::CreateDescriptorSets()
+{
+    //全フレーム, 全オブジェクトでフレームのリングを指す1つのセットを共有する
+    auto& vulkanCtx = VulkanContext::Get();
+    m_descriptorSet = vulkanCtx.AllocateDescriptorSet(m_descriptorSetLayout);
+    UpdateDescriptorSets();
+}
+
+void ShaderObjectBenchApp::UpdateDescriptorSets()
+{
+    auto& vulkanCtx = VulkanContext::Get();
+    auto& uniformRing = vulkanCtx.GetFrameUniformRing();
+    auto bufferInfo = uniformRing.GetDescriptorInfo(sizeof(ObjectConstants));
+    VkWriteDescriptorSet write{
+        .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+        .dstSet = m_descriptorSet,
+        .dstBinding = 0,
+        .dstArrayElement = 0,
+        .descriptorCount = 1,
+        .descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,
+        .pBufferInfo = &bufferInfo,
+    };
+    vkUpdateDescriptorSets(vulkanCtx.GetVkDevice(), 1, &write, 0, nullptr);
+    m_uniformRingGeneration = uniformRing.GetGeneration();
+}
+
+void ShaderObjectBenchApp::CreatePipelines()
+{
+    auto& vulkanCtx = VulkanContext::Get();
+    auto& swapchain = vulkanCtx.GetSwapchain();
+
+    //ステートの違いを描画時の切り替えで比べるため、ダイナミックステートは使わずに全て焼き込む
+    //登録簿で共有されないよう直接作成する(パイプラインキャッシュは通常通り使う)
+    const auto start = std::chrono::steady_clock::now();
+    auto vertShaderModule = loader::LoadShaderModule(GetAssetPath(AssetType::Shader, "simpleCube/cube.vert.spv"));
+    auto fragShaderModule = loader::LoadShaderModule(GetAssetPath(AssetType::Shader, "simpleCube/cube.frag.spv"));
+    double firstUseMilliseconds = 0.0;
+    for (const auto& variant : StateVariants)
+    {
+        GraphicsPipelineBuilder builder{};
+        builder.AddShaderStage(VK_SHADER_STAGE_VERTEX_BIT, vertShaderModule);
+        builder.AddShaderStage(VK_SHADER_STAGE_FRAGMENT_BIT, fragShaderModule);
+        builder.SetVertexInput(&VertexBinding, 1, VertexAttributes, uint32_t(std::size(VertexAttributes)));
+        builder.SetViewport(swapchain->GetExtent());
+        builder.SetPipelineLayout(m_pipelineLayout);
+
+        VkPipelineDepthStencilStateCreateInfo depthStencilState{
+            .sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO,
+            .depthTestEnable = VK_TRUE,
+            .depthWriteEnable = VK_TRUE,
+            .depthCompareOp = variant.depthCompareOp,
+        };
+        builder.SetDepthStencilState(depthStencilState);
+
+        VkPipelineRasterizationStateCreateInfo rasterizerState{
+            .sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO,
+            .depthClampEnable = VK_FALSE,
+            .rasterizerDiscardEnable = VK_FALSE,
+            .polygonMode = VK_POLYGON_MODE_FILL,
+            .cullMode = variant.cullMode,
+            .frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE,
+            .depthBiasEnable = VK_FALSE,
+            .lineWidth = 1.0f,
+        };
+        builder.SetRasterizationState(rasterizerState);
+        builder.UseDynamicRendering(swapchain->GetFormat().format, m_depthBuffer->GetFormat());
+
+        auto pipeline = builder.Build();
+        if (pipeline == VK_NULL_HANDLE)
+        {
+            throw std::runtime_error("failed to create graphics pipeline!");
+        }
+        m_pipelines.push_back(pipeline);
+        if (m_pipelines.size() == 1)
+        {
+            firstUseMilliseconds = ElapsedMilliseconds(start);
+        }
+    }
+    const double totalMilliseconds = ElapsedMilliseconds(start);
+
+    loader::ReleaseShaderModule(vertShaderModule);
+    loader::ReleaseShaderModule(fragShaderModule);
+
+    //キャッシュがファイルから読めた場合は2回目以降の起動となり、コンパイル済みの結果が使われうる
+    std::cout << "[ShaderObject] pipeline first-use=" << firstUseMilliseconds << " ms"
+        << " all " << m_pipelines.size() << " variants=" << totalMilliseconds << " ms"
+        << (vulkanCtx.GetPipelineCache().IsLoadedFromFile() ? " (warm pipeline cache)" : "") << std::endl;
+}
+
+void ShaderObjectBenchApp::CreateShaderObject()
+{
+    if (!VulkanContext::Get().IsShaderObjectSupported())
+    {
+        std::cout << "[ShaderObject] VK_EXT_shader_object unavailable, measuring pipelines only" << std::endl;
+        return;
+    }
+
+    //ステートは描画時に設定するため、組み合わせの数によらず1つで済む
+    const auto start = std::chrono::steady_clock::now();
+    ShaderObjectBuilder builder{};
+    builder.AddShaderStage(VK_SHADER_STAGE_VERTEX_BIT, loader::LoadShaderCode(GetAssetPath(AssetType::Shader, "simpleCube/cube.vert.spv")));
+    builder.AddShaderStage(VK_SHADER_STAGE_FRAGMENT_BIT, loader::LoadShaderCode(GetAssetPath(AssetType::Shader, "simpleCube/cube.frag.spv")));
+    builder.SetDescriptorSetLayouts(&m_descriptorSetLayout, 1);
+    m_shaderObject = builder.Build();
+    if (m_shaderObject == nullptr)
+    {
+        throw std::runtime_error("failed to create shader objects!");
+    }
+
+    std::cout << "[ShaderObject] shaderobject first-use=" << ElapsedMilliseconds(start) << " ms"
+        << " (covers all " << std::size(StateVariants) << " variants)" << std::endl;
+}
\ No newline at end of file
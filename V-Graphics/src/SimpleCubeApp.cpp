@@ -1,3 +1,5 @@
+#include <cassert>
+#include <cmath>
 #include <thread>
 #include <chrono>
 #include <stdexcept>
@@ -10,17 +12,17 @@
 #include "core/ShaderLoader.h"
 #include "core/AssetPath.h"
 #include "core/GraphicsPipelineBuilder.h"
+#include "core/ShaderReflection.h"
+#include "core/UniformRing.h"
 
 void SimpleCubeApp::OnInitialize()
 {
     m_resourceUploader.Initialize();
 
-    CreateDepthBuffer();
     //CreateCubeGeometry();
     CreateSphereGeometry();
-    CreateDescriptorSetLayout();
+    CreatePipelineLayout();
 
-    CreateUniformBuffers();
     CreateDescriptorSets();
 
     CreateGraphicsPipeline();
@@ -42,14 +44,18 @@ void SimpleCubeApp::OnDrawFrame()
         return;
     }
 
+    // 同時処理フレーム数の変更でリングが作り直されていれば、セットを書き直す(処理中のフレームはない)
+    if (m_uniformRingGeneration != vulkanCtx.GetFrameUniformRing().GetGeneration())
+    {
+        UpdateDescriptorSets();
+    }
+
 
-    auto frameIndex = vulkanCtx.GetCurrentFrameIndex();
     auto* frameCtx = vulkanCtx.GetCurrentFrameContext();
 
-    // SceneConstantsXV
+    // SceneConstantsを更新する
     SceneConstants sceneConstants{};
-    auto& ubo = m_uniformBuffers[frameIndex];
-    
+
     auto eyePos = glm::vec3(2, 1, 4);
     sceneConstants.mtxWorld = glm::mat4(1.0f);
     sceneConstants.mtxWorld = glm::rotate(glm::mat4(1.0f), time, glm::vec3(0.0f, 1.0f, 0.0f));
@@ -70,76 +76,68 @@ void SimpleCubeApp::OnDrawFrame()
     ));
     sceneConstants.lightDir = glm::vec4(lightDir, 0.0f);
 
-    if (void* p = ubo->Map(); p != nullptr)
-    {
-        memcpy(p, &sceneConstants, sizeof(sceneConstants));
-        ubo->Unmap();
-    }
+    // フレームのリングに書き込み、動的オフセットで参照する
+    auto sceneAllocation = vulkanCtx.GetFrameUniformRing().Push(sceneConstants);
 
 
     auto& commandBuffer = frameCtx->commandBuffer;
     commandBuffer->Begin();
 
-    // `OFUNDEFINED  COLOR_ATTACHMENT_OPTIMAL
-    // VK_ATTACHMENT_LOAD_OP_CLEARŵ߁AUNDEFINEDwJڂŖȂ
-    VkImageSubresourceRange range{
-        .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
-        .baseMipLevel = 0, .levelCount = 1,
-        .baseArrayLayer = 0, .layerCount = 1,
-    };
-    commandBuffer->TransitionLayout(
-        swapchain->GetCurrentImage(), range,
-        ImageLayoutTransition::FromUndefinedToColorAttachment()
-    );
-
-    // Color
-    VkRenderingAttachmentInfo colorAttachment{
-        .sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO,
-        .imageView = swapchain->GetCurrentView(),
-        .imageLayout = VK_IMAGE_LAYOUT_ATTACHMENT_OPTIMAL,
-        .loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR,
-        .storeOp = VK_ATTACHMENT_STORE_OP_STORE,
-        .clearValue = VkClearValue{.color = {{0.2f, 0.1f, 0.1f, 0.0f}} }
-    };
-    // Depth
-    VkRenderingAttachmentInfo depthAttachment{
-        .sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO,
-        .imageView = m_depthBuffer->GetVkImageView(),
-        .imageLayout = VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL,
-        .loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR,
-        .storeOp = VK_ATTACHMENT_STORE_OP_STORE,
-        .clearValue = {.depthStencil = { 1.0f, 0 } }
-    };
-    VkRenderingInfo renderingInfo{
-        .sType = VK_STRUCTURE_TYPE_RENDERING_INFO,
-        .renderArea = { {0, 0}, extent },
-        .layerCount = 1,
-        .colorAttachmentCount = 1,
-        .pColorAttachments = &colorAttachment,
-        .pDepthAttachment = &depthAttachment,
-    };
-    vkCmdBeginRendering(*commandBuffer, &renderingInfo);
-
-    // --- oCh`
-    vkCmdBindPipeline(*commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipeline);
-
-    auto vb = m_cube.vertexBuffer->GetVkBuffer();
-    VkDeviceSize offsets[] = { 0 };
-    vkCmdBindVertexBuffers(*commandBuffer, 0, 1, &vb, offsets);
-    vkCmdBindIndexBuffer(*commandBuffer, m_cube.indexBuffer->GetVkBuffer(), 0, VK_INDEX_TYPE_UINT32);
-
-    vkCmdBindDescriptorSets(*commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
-        m_pipelineLayout,
-        0, 1, &m_descriptorSets[frameIndex],
-        0, nullptr);
-    vkCmdDrawIndexed(*commandBuffer, m_cube.indexCount, 1, 0, 0, 0);
-
-    vkCmdEndRendering(*commandBuffer);
+    // フレームの構成をレンダーグラフで組み立てる
+    // スワップチェインのイメージは取得の待機ステージから使い始め、最後に表示用レイアウトへ遷移させる
+    // 深度バッファはこのフレームの中だけで使う一時イメージとし、解像度の変更にもグラフが合わせる
+    m_renderGraph.Reset();
+    auto backBuffer = m_renderGraph.ImportImage("BackBuffer",
+        swapchain->GetCurrentImage(), swapchain->GetCurrentView(), swapchain->GetFormat().format, extent,
+        RenderGraph::ResourceState{
+            .layout = VK_IMAGE_LAYOUT_UNDEFINED,
+            .stage = VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT,
+        },
+        RenderGraph::ResourceState{
+            .layout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
+            .stage = VK_PIPELINE_STAGE_2_BOTTOM_OF_PIPE_BIT,
+        });
+    auto depthBuffer = m_renderGraph.CreateImage("Depth", RenderGraph::ImageDesc{ .extent = extent, .format = DepthFormat });
+
+    m_renderGraph.AddPass("Scene",
+        [&](RenderGraph::PassBuilder& builder)
+        {
+            builder.WriteColor(backBuffer, VK_ATTACHMENT_LOAD_OP_CLEAR, VkClearColorValue{ {0.2f, 0.1f, 0.1f, 0.0f} });
+            builder.WriteDepth(depthBuffer, VK_ATTACHMENT_LOAD_OP_CLEAR);
+        },
+        [&](CommandBuffer& cmd)
+        {
+            // --- バインド＆描画
+            // パイプラインの作成が終わるまではクリアのみ行う
+            VkPipeline pipeline = m_pipeline.Get();
+            if (pipeline == VK_NULL_HANDLE)
+            {
+                return;
+            }
+            vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+            cmd.SetViewport(extent);
+            cmd.SetPrimitiveTopology(VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST);
+            cmd.SetCullMode(VK_CULL_MODE_BACK_BIT);
+            cmd.SetFrontFace(VK_FRONT_FACE_COUNTER_CLOCKWISE);
+            cmd.SetDepthTestEnable(true);
+            cmd.SetDepthWriteEnable(true);
+            cmd.SetDepthCompareOp(VK_COMPARE_OP_LESS);
+
+            auto vb = m_cube.vertexBuffer->GetVkBuffer();
+            VkDeviceSize offsets[] = { 0 };
+            vkCmdBindVertexBuffers(cmd, 0, 1, &vb, offsets);
+            vkCmdBindIndexBuffer(cmd, m_cube.indexBuffer->GetVkBuffer(), 0, VK_INDEX_TYPE_UINT32);
+
+            vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS,
+                m_pipelineLayout,
+                0, 1, &m_descriptorSet,
+                1, &sceneAllocation.dynamicOffset);
+            cmd.DrawIndexed(m_cube.indexCount);
+        });
+
+    m_renderGraph.Compile();
+    m_renderGraph.Execute(*commandBuffer);
 
-    commandBuffer->TransitionLayout(
-        swapchain->GetCurrentImage(), range,
-        ImageLayoutTransition::FromColorToPresent()
-    );
     commandBuffer->End();
     vulkanCtx.SubmitPresent();
 }
@@ -149,46 +147,29 @@ void SimpleCubeApp::OnCleanup()
     auto& vulkanCtx = VulkanContext::Get();
     auto device = vulkanCtx.GetVkDevice();
 
-    // GPUԂAChɂȂ̂҂ĂnJn
-    vkDeviceWaitIdle(device);
-
-    // pCvCj
-    vkDestroyPipeline(device, m_pipeline, nullptr);
+    // パイプラインは登録簿が最後の参照の解放時に破棄を遅延する
+    vulkanCtx.GetPipelineRegistry().Release(m_pipeline);
 
-    // CubeWIg̔j
+    // 処理中のフレームが参照しているため、ディスクリプタはフレームの完了後に解放する
+    // レイアウトはPipelineLayoutCacheが共有しているため破棄しない
+    vulkanCtx.DeferDestroy([descriptorSet = m_descriptorSet]()
+    {
+        VulkanContext::Get().FreeDescriptorSet(descriptorSet);
+    });
+    m_pipeline = {};
+    m_pipelineLayout = VK_NULL_HANDLE;
+    m_descriptorSet = VK_NULL_HANDLE;
+    m_descriptorSetLayout = VK_NULL_HANDLE;
+
+    // バッファ, イメージも内部で破棄が遅延される
     m_cube.vertexBuffer.reset();
     m_cube.indexBuffer.reset();
 
-    // fBXNv^j
-    for (auto& ds : m_descriptorSets)
-    {
-        vulkanCtx.FreeDescriptorSet(ds);
-    }
-
-    // Uniformobt@j
-    for (auto& ubo : m_uniformBuffers)
-    {
-        ubo->Cleanup();
-    }
-
-    // fvXobt@j
-    m_depthBuffer->Cleanup();
-    m_depthBuffer.reset();
-
-    vkDestroyDescriptorSetLayout(device, m_descriptorSetLayout, nullptr);
-    vkDestroyPipelineLayout(device, m_pipelineLayout, nullptr);
+    m_renderGraph.Cleanup();
 
     m_resourceUploader.Cleanup();
 }
 
-void SimpleCubeApp::CreateDepthBuffer()
-{
-    auto& vulkanCtx = VulkanContext::Get();
-    auto& swapchain = vulkanCtx.GetSwapchain();
-    auto extent = swapchain->GetExtent();
-    m_depthBuffer = DepthBuffer::Create(extent, VK_FORMAT_D32_SFLOAT);
-}
-
 void SimpleCubeApp::CreateCubeGeometry()
 {
     const glm::vec3 A(-0.5f, 0.5f, 0.5f), B(-0.5f, -0.5f, 0.5f),
@@ -249,7 +230,8 @@ void SimpleCubeApp::CreateCubeGeometry()
     m_resourceUploader.UploadBuffer(m_cube.indexBuffer.get(), indices.data(), bufferSize, VK_ACCESS_INDEX_READ_BIT);
     m_cube.indexCount = indices.size();
 
-    m_resourceUploader.SubmitAndWait();
+    // 完了は待たず、最初のフレームの提出で転送完了を待機させる
+    m_resourceUploader.Submit();
 }
 
 void SimpleCubeApp::CreateSphereGeometry()
@@ -269,9 +251,9 @@ void SimpleCubeApp::CreateSphereGeometry()
         {
             auto sliceAngle = slice * sliceStep;
 
-            auto x = std::cosf(stackAngle) * std::cosf(sliceAngle);
-            auto y = std::sinf(stackAngle);
-            auto z = std::cosf(stackAngle) * std::sinf(sliceAngle);
+            auto x = std::cos(stackAngle) * std::cos(sliceAngle);
+            auto y = std::sin(stackAngle);
+            auto z = std::cos(stackAngle) * std::sin(sliceAngle);
 
             Vertex v;
             v.position = glm::vec3(x, y, z);
@@ -309,85 +291,59 @@ void SimpleCubeApp::CreateSphereGeometry()
     m_resourceUploader.UploadBuffer(m_cube.indexBuffer.get(), indices.data(), bufferSize, VK_ACCESS_INDEX_READ_BIT);
     m_cube.indexCount = indices.size();
 
-    m_resourceUploader.SubmitAndWait();
+    // 完了は待たず、最初のフレームの提出で転送完了を待機させる
+    m_resourceUploader.Submit();
 }
 
-void SimpleCubeApp::CreateDescriptorSetLayout()
+void SimpleCubeApp::CreatePipelineLayout()
 {
-    VkDescriptorSetLayoutBinding uboLayoutBinding{
-        .binding = 0,
-        .descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
-        .descriptorCount = 1,
-        .stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
-        .pImmutableSamplers = nullptr,
-    };
-    VkDescriptorSetLayoutCreateInfo layoutInfo{
-        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
-        .bindingCount = 1,
-        .pBindings = &uboLayoutBinding,
-    };
-    auto device = VulkanContext::Get().GetVkDevice();
-    if (vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &m_descriptorSetLayout) != VK_SUCCESS)
-    {
-        throw std::runtime_error("failed to create descriptor set layout!");
-    }
+    // セットレイアウト, パイプラインレイアウトはシェーダーのリフレクションから組み立て、同じ内容のものを共有する
+    auto& vulkanCtx = VulkanContext::Get();
+    VkShaderModule vertShaderModule = loader::LoadShaderModule(GetAssetPath(AssetType::Shader, "simpleCube/cube.vert.spv"));
+    VkShaderModule fragShaderModule = loader::LoadShaderModule(GetAssetPath(AssetType::Shader, "simpleCube/cube.frag.spv"));
+
+    PipelineReflection reflection;
+    reflection.AddShaderModule(vertShaderModule).AddShaderModule(fragShaderModule);
+    // SceneConstantsはフレームのリングを動的オフセットで参照する
+    reflection.SetDescriptorType(0, 0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC);
+    auto layout = vulkanCtx.GetPipelineLayoutCache().Acquire(reflection);
+    m_descriptorSetLayout = layout.setLayouts.at(0);
+    m_pipelineLayout = layout.pipelineLayout;
+
+    loader::ReleaseShaderModule(vertShaderModule);
+    loader::ReleaseShaderModule(fragShaderModule);
 }
 
-void SimpleCubeApp::CreateUniformBuffers()
+void SimpleCubeApp::CreateDescriptorSets()
 {
+    // フレームのリングを指すセットを1つだけ作り、フレーム毎の定数は動的オフセットで切り替える
     auto& vulkanCtx = VulkanContext::Get();
-    assert(vulkanCtx.MaxInflightFrames == m_uniformBuffers.size());
-
-    for (uint32_t i = 0; i < m_uniformBuffers.size(); ++i)
-    {
-        m_uniformBuffers[i] = UniformBuffer::Create(sizeof(SceneConstants));
-    }
+    m_descriptorSet = vulkanCtx.AllocateDescriptorSet(m_descriptorSetLayout);
+    UpdateDescriptorSets();
 }
 
-void SimpleCubeApp::CreateDescriptorSets()
+void SimpleCubeApp::UpdateDescriptorSets()
 {
     auto& vulkanCtx = VulkanContext::Get();
-    for (uint32_t i = 0; i < m_descriptorSets.size(); ++i)
-    {
-        m_descriptorSets[i] = vulkanCtx.AllocateDescriptorSet(m_descriptorSetLayout);
-
-        VkDescriptorBufferInfo bufferInfo{
-            .buffer = m_uniformBuffers[i]->GetVkBuffer(),
-            .offset = 0,
-            .range = sizeof(SceneConstants),
-        };
-
-        VkWriteDescriptorSet write{
-            .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
-            .dstSet = m_descriptorSets[i],
-            .dstBinding = 0,
-            .dstArrayElement = 0,
-            .descriptorCount = 1,
-            .descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
-            .pBufferInfo = &bufferInfo,
-        };
-        vkUpdateDescriptorSets(vulkanCtx.GetVkDevice(), 1, &write, 0, nullptr);
-    }
+    auto& uniformRing = vulkanCtx.GetFrameUniformRing();
+    auto bufferInfo = uniformRing.GetDescriptorInfo(sizeof(SceneConstants));
+    VkWriteDescriptorSet write{
+        .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+        .dstSet = m_descriptorSet,
+        .dstBinding = 0,
+        .dstArrayElement = 0,
+        .descriptorCount = 1,
+        .descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,
+        .pBufferInfo = &bufferInfo,
+    };
+    vkUpdateDescriptorSets(vulkanCtx.GetVkDevice(), 1, &write, 0, nullptr);
+    m_uniformRingGeneration = uniformRing.GetGeneration();
 }
 
 void SimpleCubeApp::CreateGraphicsPipeline()
 {
     auto& vulkanCtx = VulkanContext::Get();
     auto& swapchain = vulkanCtx.GetSwapchain();
-    auto device = vulkanCtx.GetVkDevice();
-
-    // pCvCCAEgɍ\
-    VkPipelineLayoutCreateInfo layoutInfo{
-        .sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
-        .setLayoutCount = 1,
-        .pSetLayouts = &m_descriptorSetLayout,
-        .pushConstantRangeCount = 0,
-        .pPushConstantRanges = nullptr
-    };
-    if (vkCreatePipelineLayout(device, &layoutInfo, nullptr, &m_pipelineLayout) != VK_SUCCESS)
-    {
-        throw std::runtime_error("failed to create pipeline layout!");
-    }
 
     VkShaderModule vertShaderModule = loader::LoadShaderModule(GetAssetPath(AssetType::Shader, "simpleCube/cube.vert.spv"));
     VkShaderModule fragShaderModule = loader::LoadShaderModule(GetAssetPath(AssetType::Shader, "simpleCube/cube.frag.spv"));
@@ -406,47 +362,26 @@ void SimpleCubeApp::CreateGraphicsPipeline()
             .pName = "main",
         }
     };
-    // oCfBOi1̒_obt@oCfBOj
-    VkVertexInputBindingDescription bindingDescription{
-        .binding = 0,
-        .stride = sizeof(Vertex),
-        .inputRate = VK_VERTEX_INPUT_RATE_VERTEX
-    };
-
-    // ilocation 0: position, location 1: normal, location 2: colorj
-    std::array<VkVertexInputAttributeDescription, 3> attributeDescriptions{
-        VkVertexInputAttributeDescription{
-            .location = 0,
-            .binding = 0,
-            .format = VK_FORMAT_R32G32B32_SFLOAT,
-            .offset = offsetof(Vertex, position)
-        },
-        VkVertexInputAttributeDescription{
-            .location = 1,
-            .binding = 0,
-            .format = VK_FORMAT_R32G32B32_SFLOAT,
-            .offset = offsetof(Vertex, normal)
-        },
-        VkVertexInputAttributeDescription{
-            .location = 2,
-            .binding = 0,
-            .format = VK_FORMAT_R32G32B32_SFLOAT,
-            .offset = offsetof(Vertex, color)
-        }
-    };
+    // 頂点入力はcube.vertの入力(location 0: position, location 1: normal, location 2: color)から組み立てる
+    auto vertexInput = PipelineReflection{}.AddShaderModule(vertShaderModule).GetVertexInputState();
+    assert(vertexInput.binding.stride == sizeof(Vertex) && "Vertex does not match cube.vert inputs");
 
     GraphicsPipelineBuilder builder{};
     builder.AddShaderStage(VK_SHADER_STAGE_VERTEX_BIT, vertShaderModule);
-    builder.AddShaderStage(VK_SHADER_STAGE_FRAGMENT_BIT, fragShaderModule);
+    //鏡面反射の鋭さはシェーダーを分けずに特殊化定数で決める
+    FragmentSpecialization fragmentSpecialization{ .shininess = 32.0f };
+    builder.AddShaderStage(VK_SHADER_STAGE_FRAGMENT_BIT, fragShaderModule,
+        SpecializationConstants::Create(fragmentSpecialization,
+            SpecializationConstant<&FragmentSpecialization::shininess>{ 0 }));
     builder.SetVertexInput(
-        &bindingDescription, 1,
-        attributeDescriptions.data(), uint32_t(attributeDescriptions.size())
+        &vertexInput.binding, 1,
+        vertexInput.attributes.data(), uint32_t(vertexInput.attributes.size())
     );
-    auto swapchainExtent = swapchain->GetExtent();
-    builder.SetViewport(swapchainExtent);
+    // ビューポート, カリング, デプスは描画時に設定し、リサイズで作り直さずに済むようにする
+    builder.UseDynamicState();
     builder.SetPipelineLayout(m_pipelineLayout);
 
-    // fvXobt@Ɍݒ
+    // デプスバッファに向けた設定
     VkPipelineDepthStencilStateCreateInfo depthStencilState{
         .sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO,
         .depthTestEnable = VK_TRUE,
@@ -455,7 +390,7 @@ void SimpleCubeApp::CreateGraphicsPipeline()
     };
     builder.SetDepthStencilState(depthStencilState);
 
-    // wʂJOݒ
+    // 背面をカリングする設定
     VkPipelineRasterizationStateCreateInfo rasterizerState{
         .sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO,
         .depthClampEnable = VK_FALSE,
@@ -469,11 +404,13 @@ void SimpleCubeApp::CreateGraphicsPipeline()
     builder.SetRasterizationState(rasterizerState);
 
     auto colorFormat = swapchain->GetFormat().format;
-    auto depthFormat = m_depthBuffer->GetFormat();
-    builder.UseDynamicRendering(colorFormat, depthFormat);
+    builder.UseDynamicRendering(colorFormat, DepthFormat);
 
-    m_pipeline = builder.Build();
+    // 部分毎のライブラリをリンクして直ちに使い始め、最適化したものはワーカースレッドで作成する
+    // パイプラインライブラリが使えなければ、起動を止めないようワーカースレッドで通常の作成を行う
+    m_pipeline = vulkanCtx.GetPipelineRegistry().AcquireFastLinked(builder);
 
-    vkDestroyShaderModule(device, vertShaderModule, nullptr);
-    vkDestroyShaderModule(device, fragShaderModule, nullptr);
+    // 登録簿が作成中も参照を持つため、モジュールはすぐに手放してよい
+    loader::ReleaseShaderModule(vertShaderModule);
+    loader::ReleaseShaderModule(fragShaderModule);
 }
\ No newline at end of file
@@ -1,4 +1,4 @@
-#include <array>
+#include <cassert>
 #include <chrono>
 #include <thread>
 
@@ -6,6 +6,7 @@
 #include "core/VulkanContext.h"
 #include "core/Swapchain.h"
 #include "core/GraphicsPipelineBuilder.h"
+#include "core/ShaderReflection.h"
 #include "core/ShaderLoader.h"
 #include "core/AssetPath.h"
 #include "SimpleCubeApp.h"
@@ -32,8 +33,8 @@ void TriangleApp::OnDrawFrame()
     auto& commandBuffer = frameCtx->commandBuffer;
     commandBuffer->Begin();
 
-    //`O:UNDEFINED  COLOR_ATTACHMENT_OPTIMAL
-    //VK_ATTACHMENT_LOAD_OP_CLEARŵ߁AUNDEFINEDwJڂŖȂ
+    //描画前:UNDEFINED → COLOR_ATTACHMENT_OPTIMAL
+    //VK_ATTACHMENT_LOAD_OP_CLEAR指定のため、常にUNDEFINED指定遷移で問題なし
     VkImageSubresourceRange range{
       .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
       .baseMipLevel = 0, .levelCount = 1,
@@ -57,18 +58,18 @@ void TriangleApp::OnDrawFrame()
         .layerCount = 1,
         .colorAttachmentCount = 1,
         .pColorAttachments = &colorAttachment};
-    vkCmdBeginRendering(*commandBuffer, &renderingInfo);
+    commandBuffer->BeginRendering(renderingInfo);
 
-    //Op`̕`
+    //三角形の描画
     vkCmdBindPipeline(*commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipeline);
     auto vb = m_vertexBuffer->GetVkBuffer();
     VkDeviceSize offsets[] = { 0 };
     vkCmdBindVertexBuffers(*commandBuffer, 0, 1, &vb, offsets);
-    vkCmdDraw(*commandBuffer, 3, 1, 0, 0);
+    commandBuffer->Draw(3);
 
-    vkCmdEndRendering(*commandBuffer);
+    commandBuffer->EndRendering();
 
-    //\pCAEgύX
+    //表示用レイアウト変更
     commandBuffer->TransitionLayout(
         swapchain->GetCurrentImage(), range,
         ImageLayoutTransition::FromColorToPresent());
@@ -82,17 +83,13 @@ void TriangleApp::OnCleanup()
     auto& vulkanCtx = VulkanContext::Get();
     auto device = vulkanCtx.GetVkDevice();
 
-    //GPUAChɂȂ̂҂ČnJn
+    //GPUがアイドルになるのを待って後始末を開始
     vkDeviceWaitIdle(device);
 
     if (m_pipeline != VK_NULL_HANDLE)
     {
         vkDestroyPipeline(device, m_pipeline, nullptr);
     }
-    if (m_pipelineLayout != VK_NULL_HANDLE)
-    {
-        vkDestroyPipelineLayout(device, m_pipelineLayout, nullptr);
-    }
     m_vertexBuffer->Cleanup();
     m_vertexBuffer.reset();
 }
@@ -105,9 +102,9 @@ void TriangleApp::InitializeTriangleVertexBuffer()
 {
     const std::vector<Vertex> triangleVertices =
     {
-        { { -0.5f, -0.5f, 0.0f }, { 1.0f, 0.0f, 0.0f } }, // 
-        { {  0.5f, -0.5f, 0.0f }, { 0.0f, 1.0f, 0.0f } }, // 
-        { {  0.0f,  0.5f, 0.0f }, { 0.0f, 0.0f, 1.0f } }, // 
+        { { -0.5f, -0.5f, 0.0f }, { 1.0f, 0.0f, 0.0f } }, // 赤
+        { {  0.5f, -0.5f, 0.0f }, { 0.0f, 1.0f, 0.0f } }, // 緑
+        { {  0.0f,  0.5f, 0.0f }, { 0.0f, 0.0f, 1.0f } }, // 青
     };
     VkDeviceSize bufferSize = sizeof(Vertex) * triangleVertices.size();
     m_vertexBuffer = VertexBuffer::Create(bufferSize, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
@@ -121,49 +118,23 @@ void TriangleApp::InitializeGraphicsPipeline()
     auto& vulkanCtx = VulkanContext::Get();
     auto& swapchain = vulkanCtx.GetSwapchain();
 
-    // PipelineLayout̍쐬
-    VkPipelineLayoutCreateInfo layoutInfo{
-        .sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO
-    };
-    auto result = vkCreatePipelineLayout(vulkanCtx.GetVkDevice(), &layoutInfo, nullptr, &m_pipelineLayout);
-    if (result != VK_SUCCESS)
-    {
-        throw std::runtime_error("failed to create pipeline layout !");
-    }
-    vulkanCtx.SetDebugObjectName(m_pipelineLayout, VK_OBJECT_TYPE_PIPELINE_LAYOUT, "MyPipelineLayout");
-
     VkShaderModule vertShaderModule = loader::LoadShaderModule(GetAssetPath(AssetType::Shader, "triangle/triangle.vert.spv"));
     VkShaderModule fragShaderModule = loader::LoadShaderModule(GetAssetPath(AssetType::Shader, "triangle/triangle.frag.spv"));
 
-    // oCfBOi1̒_obt@oCfBOj
-    VkVertexInputBindingDescription bindingDescription{
-        .binding = 0,
-        .stride = sizeof(Vertex),
-        .inputRate = VK_VERTEX_INPUT_RATE_VERTEX
-    };
-
-    // ilocation 0: position, location 1: colorj
-    std::array<VkVertexInputAttributeDescription, 2> attributeDescriptions{
-        VkVertexInputAttributeDescription{
-            .location = 0,
-            .binding = 0,
-            .format = VK_FORMAT_R32G32B32_SFLOAT,
-            .offset = offsetof(Vertex, position)
-        },
-        VkVertexInputAttributeDescription{
-            .location = 1,
-            .binding = 0,
-            .format = VK_FORMAT_R32G32B32_SFLOAT,
-            .offset = offsetof(Vertex, color)
-        }
-    };
+    // PipelineLayoutと頂点入力(location 0: position, location 1: color)はシェーダーのリフレクションから得る
+    // ディスクリプタを使わないため、空のレイアウトが共有される
+    PipelineReflection reflection;
+    reflection.AddShaderModule(vertShaderModule).AddShaderModule(fragShaderModule);
+    m_pipelineLayout = vulkanCtx.GetPipelineLayoutCache().Acquire(reflection).pipelineLayout;
+    auto vertexInput = reflection.GetVertexInputState();
+    assert(vertexInput.binding.stride == sizeof(Vertex) && "Vertex does not match triangle.vert inputs");
 
     GraphicsPipelineBuilder builder{};
     builder.AddShaderStage(VK_SHADER_STAGE_VERTEX_BIT, vertShaderModule);
     builder.AddShaderStage(VK_SHADER_STAGE_FRAGMENT_BIT, fragShaderModule);
     builder.SetVertexInput(
-        &bindingDescription, 1,
-        attributeDescriptions.data(), uint32_t(attributeDescriptions.size())
+        &vertexInput.binding, 1,
+        vertexInput.attributes.data(), uint32_t(vertexInput.attributes.size())
     );
     auto swapchainExtent = swapchain->GetExtent();
     VkRect2D scissor = {
@@ -184,7 +155,6 @@ void TriangleApp::InitializeGraphicsPipeline()
 
     m_pipeline = builder.Build();
 
-    auto device = vulkanCtx.GetVkDevice();
-    vkDestroyShaderModule(device, vertShaderModule, nullptr);
-    vkDestroyShaderModule(device, fragShaderModule, nullptr);
+    loader::ReleaseShaderModule(vertShaderModule);
+    loader::ReleaseShaderModule(fragShaderModule);
 }
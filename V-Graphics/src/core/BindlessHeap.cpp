@@ -0,0 +1,221 @@
+#include <algorithm>
+
+#include "core/BindlessHeap.h"
+#include "core/VulkanContext.h"
+
+/*************************************************
+public
+*************************************************/
+
+bool BindlessHeap::Initialize(VkDevice device, VkPhysicalDevice physicalDevice)
+{
+    m_device = device;
+    m_bindings.clear();
+
+    //UPDATE_AFTER_BINDのディスクリプタ数の上限を取得
+    VkPhysicalDeviceVulkan12Properties vulkan12Props{
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_PROPERTIES,
+    };
+    VkPhysicalDeviceProperties2 props2{
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2,
+        .pNext = &vulkan12Props,
+    };
+    vkGetPhysicalDeviceProperties2(physicalDevice, &props2);
+
+    const uint32_t limits[BindingMax] = {
+        std::min(vulkan12Props.maxDescriptorSetUpdateAfterBindStorageBuffers, vulkan12Props.maxPerStageDescriptorUpdateAfterBindStorageBuffers),
+        std::min(vulkan12Props.maxDescriptorSetUpdateAfterBindSampledImages, vulkan12Props.maxPerStageDescriptorUpdateAfterBindSampledImages),
+        std::min(vulkan12Props.maxDescriptorSetUpdateAfterBindSamplers, vulkan12Props.maxPerStageDescriptorUpdateAfterBindSamplers),
+    };
+
+    //全バインディングを部分的なバインドと、バインド後の更新を許可して作成する
+    std::vector<VkDescriptorBindingFlags> bindingFlags;
+    std::vector<VkDescriptorPoolSize> poolSizes;
+    for (uint32_t i = 0; i < BindingMax; ++i)
+    {
+        auto& slots = m_slots[i];
+        slots = Slots{};
+        slots.capacity = std::min(DesiredCapacities[i], limits[i]);
+
+        m_bindings.push_back({
+            .binding = i,
+            .descriptorType = DescriptorTypes[i],
+            .descriptorCount = slots.capacity,
+            .stageFlags = VK_SHADER_STAGE_ALL,
+        });
+        bindingFlags.push_back(
+            VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT |
+            VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT |
+            VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT);
+        poolSizes.push_back({
+            .type = DescriptorTypes[i],
+            .descriptorCount = slots.capacity,
+        });
+    }
+
+    VkDescriptorSetLayoutBindingFlagsCreateInfo bindingFlagsCI{
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO,
+        .bindingCount = uint32_t(bindingFlags.size()),
+        .pBindingFlags = bindingFlags.data(),
+    };
+    VkDescriptorSetLayoutCreateInfo layoutCI{
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+        .pNext = &bindingFlagsCI,
+        .flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT,
+        .bindingCount = uint32_t(m_bindings.size()),
+        .pBindings = m_bindings.data(),
+    };
+    if (vkCreateDescriptorSetLayout(m_device, &layoutCI, nullptr, &m_layout) != VK_SUCCESS)
+    {
+        return false;
+    }
+
+    VkDescriptorPoolCreateInfo poolCI{
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+        .flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT,
+        .maxSets = 1,
+        .poolSizeCount = uint32_t(poolSizes.size()),
+        .pPoolSizes = poolSizes.data(),
+    };
+    if (vkCreateDescriptorPool(m_device, &poolCI, nullptr, &m_pool) != VK_SUCCESS)
+    {
+        return false;
+    }
+
+    VkDescriptorSetAllocateInfo allocInfo{
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+        .descriptorPool = m_pool,
+        .descriptorSetCount = 1,
+        .pSetLayouts = &m_layout,
+    };
+    return vkAllocateDescriptorSets(m_device, &allocInfo, &m_descriptorSet) == VK_SUCCESS;
+}
+
+void BindlessHeap::Cleanup()
+{
+    //セットはプールと一緒に破棄される
+    vkDestroyDescriptorPool(m_device, m_pool, nullptr);
+    vkDestroyDescriptorSetLayout(m_device, m_layout, nullptr);
+    m_pool = VK_NULL_HANDLE;
+    m_layout = VK_NULL_HANDLE;
+    m_bindings.clear();
+    m_descriptorSet = VK_NULL_HANDLE;
+}
+
+uint32_t BindlessHeap::RegisterStorageBuffer(const VkDescriptorBufferInfo& bufferInfo)
+{
+    uint32_t index = AllocateIndex(StorageBufferBinding);
+    if (index == InvalidIndex)
+    {
+        return InvalidIndex;
+    }
+
+    VkWriteDescriptorSet write{
+        .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+        .dstSet = m_descriptorSet,
+        .dstBinding = StorageBufferBinding,
+        .dstArrayElement = index,
+        .descriptorCount = 1,
+        .descriptorType = DescriptorTypes[StorageBufferBinding],
+        .pBufferInfo = &bufferInfo,
+    };
+    vkUpdateDescriptorSets(m_device, 1, &write, 0, nullptr);
+    return index;
+}
+
+uint32_t BindlessHeap::RegisterSampledImage(VkImageView imageView, VkImageLayout layout)
+{
+    uint32_t index = AllocateIndex(SampledImageBinding);
+    if (index == InvalidIndex)
+    {
+        return InvalidIndex;
+    }
+
+    VkDescriptorImageInfo imageInfo{
+        .imageView = imageView,
+        .imageLayout = layout,
+    };
+    VkWriteDescriptorSet write{
+        .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+        .dstSet = m_descriptorSet,
+        .dstBinding = SampledImageBinding,
+        .dstArrayElement = index,
+        .descriptorCount = 1,
+        .descriptorType = DescriptorTypes[SampledImageBinding],
+        .pImageInfo = &imageInfo,
+    };
+    vkUpdateDescriptorSets(m_device, 1, &write, 0, nullptr);
+    return index;
+}
+
+uint32_t BindlessHeap::RegisterSampler(VkSampler sampler)
+{
+    uint32_t index = AllocateIndex(SamplerBinding);
+    if (index == InvalidIndex)
+    {
+        return InvalidIndex;
+    }
+
+    VkDescriptorImageInfo imageInfo{
+        .sampler = sampler,
+    };
+    VkWriteDescriptorSet write{
+        .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+        .dstSet = m_descriptorSet,
+        .dstBinding = SamplerBinding,
+        .dstArrayElement = index,
+        .descriptorCount = 1,
+        .descriptorType = DescriptorTypes[SamplerBinding],
+        .pImageInfo = &imageInfo,
+    };
+    vkUpdateDescriptorSets(m_device, 1, &write, 0, nullptr);
+    return index;
+}
+
+void BindlessHeap::Release(Binding binding, uint32_t index)
+{
+    if (index == InvalidIndex)
+    {
+        return;
+    }
+    const uint64_t retireValue = VulkanContext::Get().GetCurrentFrameTimelineValue();
+
+    std::lock_guard lock(m_mutex);
+    m_slots[binding].retiredIndices.emplace_back(retireValue, index);
+}
+
+void BindlessHeap::Bind(VkCommandBuffer commandBuffer, VkPipelineBindPoint bindPoint, VkPipelineLayout pipelineLayout, uint32_t setIndex) const
+{
+    vkCmdBindDescriptorSets(commandBuffer, bindPoint, pipelineLayout, setIndex, 1, &m_descriptorSet, 0, nullptr);
+}
+
+/*************************************************
+private
+*************************************************/
+
+uint32_t BindlessHeap::AllocateIndex(Binding binding)
+{
+    const uint64_t completedValue = VulkanContext::Get().GetCompletedTimelineValue();
+
+    std::lock_guard lock(m_mutex);
+    auto& slots = m_slots[binding];
+
+    //GPUが参照し終えた返却済みインデックスを再利用可能にする
+    while (!slots.retiredIndices.empty() && slots.retiredIndices.front().first <= completedValue)
+    {
+        slots.freeIndices.push_back(slots.retiredIndices.front().second);
+        slots.retiredIndices.pop_front();
+    }
+
+    if (!slots.freeIndices.empty())
+    {
+        uint32_t index = slots.freeIndices.back();
+        slots.freeIndices.pop_back();
+        return index;
+    }
+    if (slots.nextIndex < slots.capacity)
+    {
+        return slots.nextIndex++;
+    }
+    return InvalidIndex;
+}
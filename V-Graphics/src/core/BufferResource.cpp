@@ -18,42 +18,36 @@ void* VertexBuffer::Map()
 {
     if (!(m_memProps & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)) return nullptr;
 
-    void* mapped = nullptr;
-    vkMapMemory(VulkanContext::Get().GetVkDevice(), m_memory, 0, m_size, 0, &mapped);
-    return mapped;
+    return m_allocation.mappedData;
 }
 
 void VertexBuffer::Unmap()
 {
-    if (!(m_memProps & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)) return;
-    vkUnmapMemory(VulkanContext::Get().GetVkDevice(), m_memory);
+    //メモリはアロケータが常にマップしているため、解除はせず書き込みのフラッシュのみ行う
+    Flush();
 }
 
-bool StagingBuffer::Initialize(VkDeviceSize size)
+bool StagingBuffer::Initialize(VkDeviceSize size, VkMemoryPropertyFlags memProps)
 {
+    //HOST_CACHEDで作成した場合はGPUからの読み戻し先としても使えるよう、コピー先にもする
     VkBufferCreateInfo bufferInfo{
         .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
         .size = size,
-        .usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+        .usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
 .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
     };
-    VkMemoryPropertyFlags memProps = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
     SetAccessFlags(VK_ACCESS_HOST_WRITE_BIT);
     return CreateBuffer(bufferInfo, memProps);
 }
 
 void* StagingBuffer::Map()
 {
-    void* mapped = nullptr;
-    VkDevice device = VulkanContext::Get().GetVkDevice();
-    vkMapMemory(device, m_memory, 0, m_size, 0, &mapped);
-    return mapped;
+    return m_allocation.mappedData;
 }
 
 void StagingBuffer::Unmap()
 {
-    VkDevice device = VulkanContext::Get().GetVkDevice();
-    vkUnmapMemory(device, m_memory);
+    Flush();
 }
 
 bool IndexBuffer::Initialize(VkDeviceSize size, VkMemoryPropertyFlags memProps)
@@ -72,19 +66,15 @@ void* IndexBuffer::Map()
 {
     if (!(m_memProps & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)) return nullptr;
 
-    void* mapped = nullptr;
-    vkMapMemory(VulkanContext::Get().GetVkDevice(), m_memory, 0, m_size, 0, &mapped);
-    return mapped;
+    return m_allocation.mappedData;
 }
 
 void IndexBuffer::Unmap()
 {
-    if (!(m_memProps & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)) return;
-
-    vkUnmapMemory(VulkanContext::Get().GetVkDevice(), m_memory);
+    Flush();
 }
 
-bool UniformBuffer::Initialize(VkDeviceSize size)
+bool UniformBuffer::Initialize(VkDeviceSize size, VkMemoryPropertyFlags memProps)
 {
     VkBufferCreateInfo bufferInfo{
         .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
@@ -92,19 +82,40 @@ bool UniformBuffer::Initialize(VkDeviceSize size)
         .usage = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
         .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
     };
-    VkMemoryPropertyFlags memProps = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
     SetAccessFlags(VK_ACCESS_SHADER_READ_BIT);
     return CreateBuffer(bufferInfo, memProps);
 }
 
 void* UniformBuffer::Map()
 {
-    void* mapped = nullptr;
-    vkMapMemory(VulkanContext::Get().GetVkDevice(), m_memory, 0, m_size, 0, &mapped);
-    return mapped;
+    return m_allocation.mappedData;
 }
 
 void UniformBuffer::Unmap()
 {
-    vkUnmapMemory(VulkanContext::Get().GetVkDevice(), m_memory);
-}
\ No newline at end of file
+    Flush();
+}
+
+bool StorageBuffer::Initialize(VkDeviceSize size, VkMemoryPropertyFlags memProps)
+{
+    VkBufferCreateInfo bufferInfo{
+        .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+        .size = size,
+        .usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+        .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+    };
+    SetAccessFlags(VK_ACCESS_SHADER_READ_BIT);
+    return CreateBuffer(bufferInfo, memProps);
+}
+
+void* StorageBuffer::Map()
+{
+    if (!(m_memProps & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)) return nullptr;
+
+    return m_allocation.mappedData;
+}
+
+void StorageBuffer::Unmap()
+{
+    Flush();
+}
@@ -1,19 +1,46 @@
+#include <algorithm>
+
 #include "core/CommandBuffer.h"
+#include "core/ShaderObject.h"
+#include "core/ImageResource.h"
+#include "core/BufferResource.h"
 
-CommandBuffer::CommandBuffer(VkCommandBuffer commandBuffer)
+namespace
+{
+    //書き込みを含むアクセス(後のアクセスの前にメモリを見えるようにする必要がある)
+    constexpr VkAccessFlags2 WriteAccessMask =
+        VK_ACCESS_2_SHADER_WRITE_BIT |
+        VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT |
+        VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT |
+        VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT |
+        VK_ACCESS_2_TRANSFER_WRITE_BIT |
+        VK_ACCESS_2_HOST_WRITE_BIT |
+        VK_ACCESS_2_MEMORY_WRITE_BIT |
+        VK_ACCESS_2_ACCELERATION_STRUCTURE_WRITE_BIT_KHR;
+}
+
+CommandBuffer::CommandBuffer(VkCommandBuffer commandBuffer, VkCommandPool commandPool)
 {
 	m_commandBuffer = commandBuffer;
+	m_commandPool = commandPool;
 }
 
 CommandBuffer::~CommandBuffer()
 {
-	auto& vulkanCtx = VulkanContext::Get();
-	vkFreeCommandBuffers(vulkanCtx.GetVkDevice(), vulkanCtx.GetCommandPool(), 1, &m_commandBuffer);
+	if (m_commandPool != VK_NULL_HANDLE)
+	{
+		vkFreeCommandBuffers(VulkanContext::Get().GetVkDevice(), m_commandPool, 1, &m_commandBuffer);
+	}
 	m_commandBuffer = VK_NULL_HANDLE;
 }
 
 void CommandBuffer::Begin(VkCommandBufferUsageFlags usageFlag)
 {
+    m_imageStates.clear();
+    m_bufferStates.clear();
+    m_pendingImageBarriers.clear();
+    m_pendingBufferBarriers.clear();
+
     VkCommandBufferBeginInfo beginInfo
     {
         .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
@@ -22,19 +49,136 @@ void CommandBuffer::Begin(VkCommandBufferUsageFlags usageFlag)
     vkBeginCommandBuffer(m_commandBuffer, &beginInfo);
 }
 
+void CommandBuffer::BeginSecondary(const VkCommandBufferInheritanceRenderingInfo& inheritanceRendering)
+{
+    m_imageStates.clear();
+    m_bufferStates.clear();
+    m_pendingImageBarriers.clear();
+    m_pendingBufferBarriers.clear();
+
+    VkCommandBufferInheritanceInfo inheritanceInfo{
+        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO,
+        .pNext = &inheritanceRendering,
+    };
+    VkCommandBufferBeginInfo beginInfo
+    {
+        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+        .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT,
+        .pInheritanceInfo = &inheritanceInfo,
+    };
+    vkBeginCommandBuffer(m_commandBuffer, &beginInfo);
+}
+
 void CommandBuffer::End()
 {
+    FlushBarriers();
+    WriteBackStates();
     vkEndCommandBuffer(m_commandBuffer);
 }
 
 void CommandBuffer::Reset()
 {
+    //記録したコマンドは実行されないため、状態は書き戻さずに捨てる
+    m_imageStates.clear();
+    m_bufferStates.clear();
+    m_pendingImageBarriers.clear();
+    m_pendingBufferBarriers.clear();
     vkResetCommandBuffer(m_commandBuffer, 0);
 }
 
+void CommandBuffer::RequireImageState(IImageResource& image, VkImageLayout layout,
+    VkPipelineStageFlags2 stage, VkAccessFlags2 access, bool discardContents)
+{
+    auto [it, inserted] = m_imageStates.try_emplace(image.GetVkImage(), ImageState{
+        .resource = &image,
+        .layout = image.GetLayout(),
+        .access = MakeAccessState(image.GetStageFlags(), image.GetAccessFlags()),
+    });
+    auto& state = it->second;
+
+    const bool layoutChange = state.layout != layout;
+    VkPipelineStageFlags2 srcStage = VK_PIPELINE_STAGE_2_NONE;
+    VkAccessFlags2 srcAccess = VK_ACCESS_2_NONE;
+    if (!UpdateAccessState(state.access, layoutChange, stage, access, srcStage, srcAccess))
+    {
+        return;
+    }
+
+    const VkImageLayout oldLayout = (layoutChange && discardContents) ? VK_IMAGE_LAYOUT_UNDEFINED : state.layout;
+    state.layout = layout;
+
+    //保留中のバリアがあれば、間にコマンドがないため1つの遷移にまとめる
+    if (state.access.pendingIndex >= 0)
+    {
+        auto& barrier = m_pendingImageBarriers[state.access.pendingIndex];
+        barrier.dstStageMask |= stage;
+        barrier.dstAccessMask |= access;
+        barrier.newLayout = layout;
+        if (oldLayout == VK_IMAGE_LAYOUT_UNDEFINED)
+        {
+            barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        }
+        return;
+    }
+
+    state.access.pendingIndex = int32_t(m_pendingImageBarriers.size());
+    m_pendingImageBarriers.push_back(VkImageMemoryBarrier2{
+        .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2,
+        .srcStageMask = srcStage,
+        .srcAccessMask = srcAccess,
+        .dstStageMask = stage,
+        .dstAccessMask = access,
+        .oldLayout = oldLayout,
+        .newLayout = layout,
+        .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .image = image.GetVkImage(),
+        .subresourceRange = image.GetSubresourceRange(),
+    });
+}
+
+void CommandBuffer::RequireBufferState(IBufferResource& buffer, VkPipelineStageFlags2 stage, VkAccessFlags2 access)
+{
+    auto [it, inserted] = m_bufferStates.try_emplace(buffer.GetVkBuffer(), BufferState{
+        .resource = &buffer,
+        .access = MakeAccessState(buffer.GetStageFlags(), buffer.GetAccessFlags()),
+    });
+    auto& state = it->second;
+
+    VkPipelineStageFlags2 srcStage = VK_PIPELINE_STAGE_2_NONE;
+    VkAccessFlags2 srcAccess = VK_ACCESS_2_NONE;
+    if (!UpdateAccessState(state.access, false, stage, access, srcStage, srcAccess))
+    {
+        return;
+    }
+
+    if (state.access.pendingIndex >= 0)
+    {
+        auto& barrier = m_pendingBufferBarriers[state.access.pendingIndex];
+        barrier.dstStageMask |= stage;
+        barrier.dstAccessMask |= access;
+        return;
+    }
+
+    state.access.pendingIndex = int32_t(m_pendingBufferBarriers.size());
+    m_pendingBufferBarriers.push_back(VkBufferMemoryBarrier2{
+        .sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2,
+        .srcStageMask = srcStage,
+        .srcAccessMask = srcAccess,
+        .dstStageMask = stage,
+        .dstAccessMask = access,
+        .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .buffer = buffer.GetVkBuffer(),
+        .offset = 0,
+        .size = VK_WHOLE_SIZE,
+    });
+}
+
 void CommandBuffer::TransitionLayout(VkImage image, const VkImageSubresourceRange& range, const ImageLayoutTransition& transition)
 {
-    VkImageMemoryBarrier2 imageBarrier{
+    //同期1のフラグの値はそのまま同期2のフラグとして使える
+    m_pendingImageBarriers.push_back(VkImageMemoryBarrier2{
         .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2,
         .srcStageMask = transition.srcStage,
         .srcAccessMask = transition.srcAccessMask,
@@ -45,11 +189,349 @@ void CommandBuffer::TransitionLayout(VkImage image, const VkImageSubresourceRang
         .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
         .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
         .image = image,
-        .subresourceRange = range};
+        .subresourceRange = range});
+}
+
+void CommandBuffer::FlushBarriers()
+{
+    if (m_pendingImageBarriers.empty() && m_pendingBufferBarriers.empty())
+    {
+        return;
+    }
 
     VkDependencyInfo dependencyInfo{
         .sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
-        .imageMemoryBarrierCount = 1,
-        .pImageMemoryBarriers = &imageBarrier};
+        .bufferMemoryBarrierCount = uint32_t(m_pendingBufferBarriers.size()),
+        .pBufferMemoryBarriers = m_pendingBufferBarriers.data(),
+        .imageMemoryBarrierCount = uint32_t(m_pendingImageBarriers.size()),
+        .pImageMemoryBarriers = m_pendingImageBarriers.data()};
     vkCmdPipelineBarrier2(m_commandBuffer, &dependencyInfo);
+
+    m_pendingImageBarriers.clear();
+    m_pendingBufferBarriers.clear();
+    for (auto& [image, state] : m_imageStates)
+    {
+        state.access.pendingIndex = -1;
+    }
+    for (auto& [buffer, state] : m_bufferStates)
+    {
+        state.access.pendingIndex = -1;
+    }
+}
+
+void CommandBuffer::BeginRendering(const VkRenderingInfo& renderingInfo)
+{
+    FlushBarriers();
+    vkCmdBeginRendering(m_commandBuffer, &renderingInfo);
+}
+
+void CommandBuffer::EndRendering()
+{
+    vkCmdEndRendering(m_commandBuffer);
+}
+
+void CommandBuffer::Draw(uint32_t vertexCount, uint32_t instanceCount, uint32_t firstVertex, uint32_t firstInstance)
+{
+    FlushBarriers();
+    vkCmdDraw(m_commandBuffer, vertexCount, instanceCount, firstVertex, firstInstance);
+}
+
+void CommandBuffer::DrawIndexed(uint32_t indexCount, uint32_t instanceCount, uint32_t firstIndex,
+    int32_t vertexOffset, uint32_t firstInstance)
+{
+    FlushBarriers();
+    vkCmdDrawIndexed(m_commandBuffer, indexCount, instanceCount, firstIndex, vertexOffset, firstInstance);
+}
+
+void CommandBuffer::Dispatch(uint32_t groupCountX, uint32_t groupCountY, uint32_t groupCountZ)
+{
+    FlushBarriers();
+    vkCmdDispatch(m_commandBuffer, groupCountX, groupCountY, groupCountZ);
+}
+
+void CommandBuffer::CopyBuffer(VkBuffer src, VkBuffer dst, const VkBufferCopy& region)
+{
+    FlushBarriers();
+    vkCmdCopyBuffer(m_commandBuffer, src, dst, 1, &region);
+}
+
+void CommandBuffer::CopyBufferToImage(VkBuffer src, VkImage dst, VkImageLayout dstLayout, const VkBufferImageCopy& region)
+{
+    FlushBarriers();
+    vkCmdCopyBufferToImage(m_commandBuffer, src, dst, dstLayout, 1, &region);
+}
+
+void CommandBuffer::SetViewport(VkExtent2D extent)
+{
+    // VK_KHR_Maintenance1 による上下反転
+    VkViewport viewport{
+        .x = 0.0f,
+        .y = float(extent.height),
+        .width = float(extent.width),
+        .height = -float(extent.height),
+        .minDepth = 0.0f,
+        .maxDepth = 1.0f
+    };
+    SetViewport(viewport, VkRect2D{ .offset = { 0, 0 }, .extent = extent });
+}
+
+void CommandBuffer::SetViewport(const VkViewport& viewport, const VkRect2D& scissor)
+{
+    vkCmdSetViewportWithCount(m_commandBuffer, 1, &viewport);
+    vkCmdSetScissorWithCount(m_commandBuffer, 1, &scissor);
+}
+
+void CommandBuffer::SetCullMode(VkCullModeFlags cullMode)
+{
+    vkCmdSetCullMode(m_commandBuffer, cullMode);
+}
+
+void CommandBuffer::SetFrontFace(VkFrontFace frontFace)
+{
+    vkCmdSetFrontFace(m_commandBuffer, frontFace);
+}
+
+void CommandBuffer::SetPrimitiveTopology(VkPrimitiveTopology topology)
+{
+    vkCmdSetPrimitiveTopology(m_commandBuffer, topology);
+}
+
+void CommandBuffer::SetDepthTestEnable(bool enable)
+{
+    vkCmdSetDepthTestEnable(m_commandBuffer, enable ? VK_TRUE : VK_FALSE);
+}
+
+void CommandBuffer::SetDepthWriteEnable(bool enable)
+{
+    vkCmdSetDepthWriteEnable(m_commandBuffer, enable ? VK_TRUE : VK_FALSE);
+}
+
+void CommandBuffer::SetDepthCompareOp(VkCompareOp compareOp)
+{
+    vkCmdSetDepthCompareOp(m_commandBuffer, compareOp);
+}
+
+void CommandBuffer::BindShaderObject(const ShaderObject& shaderObject)
+{
+    shaderObject.Bind(m_commandBuffer);
+}
+
+void CommandBuffer::SetShaderObjectDefaults()
+{
+    auto& vulkanCtx = VulkanContext::Get();
+    const auto& functions = vulkanCtx.GetShaderObjectFunctions();
+    const auto& features = vulkanCtx.GetEnabledFeatures();
+
+    vkCmdSetRasterizerDiscardEnable(m_commandBuffer, VK_FALSE);
+    vkCmdSetDepthBiasEnable(m_commandBuffer, VK_FALSE);
+    vkCmdSetDepthBoundsTestEnable(m_commandBuffer, VK_FALSE);
+    vkCmdSetStencilTestEnable(m_commandBuffer, VK_FALSE);
+    vkCmdSetPrimitiveRestartEnable(m_commandBuffer, VK_FALSE);
+    vkCmdSetLineWidth(m_commandBuffer, 1.0f);
+
+    SetPolygonMode(VK_POLYGON_MODE_FILL);
+    SetRasterizationSamples(VK_SAMPLE_COUNT_1_BIT);
+    const VkSampleMask sampleMask = ~0u;
+    functions.cmdSetSampleMask(m_commandBuffer, VK_SAMPLE_COUNT_1_BIT, &sampleMask);
+    functions.cmdSetAlphaToCoverageEnable(m_commandBuffer, VK_FALSE);
+
+    //機能が有効なものは、シェーダーオブジェクトでは設定が必須になる
+    if (features.depthClamp)
+    {
+        functions.cmdSetDepthClampEnable(m_commandBuffer, VK_FALSE);
+    }
+    if (features.alphaToOne)
+    {
+        functions.cmdSetAlphaToOneEnable(m_commandBuffer, VK_FALSE);
+    }
+    if (features.logicOp)
+    {
+        functions.cmdSetLogicOpEnable(m_commandBuffer, VK_FALSE);
+    }
+
+    SetColorBlend(VkPipelineColorBlendAttachmentState{
+        .blendEnable = VK_FALSE,
+        .colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT,
+    });
+}
+
+void CommandBuffer::SetVertexInput(
+    const VkVertexInputBindingDescription* bindings,
+    uint32_t bindingCount,
+    const VkVertexInputAttributeDescription* attributes,
+    uint32_t attributeCount)
+{
+    std::vector<VkVertexInputBindingDescription2EXT> bindings2;
+    bindings2.reserve(bindingCount);
+    for (uint32_t i = 0; i < bindingCount; ++i)
+    {
+        bindings2.push_back(VkVertexInputBindingDescription2EXT{
+            .sType = VK_STRUCTURE_TYPE_VERTEX_INPUT_BINDING_DESCRIPTION_2_EXT,
+            .binding = bindings[i].binding,
+            .stride = bindings[i].stride,
+            .inputRate = bindings[i].inputRate,
+            .divisor = 1,
+        });
+    }
+    std::vector<VkVertexInputAttributeDescription2EXT> attributes2;
+    attributes2.reserve(attributeCount);
+    for (uint32_t i = 0; i < attributeCount; ++i)
+    {
+        attributes2.push_back(VkVertexInputAttributeDescription2EXT{
+            .sType = VK_STRUCTURE_TYPE_VERTEX_INPUT_ATTRIBUTE_DESCRIPTION_2_EXT,
+            .location = attributes[i].location,
+            .binding = attributes[i].binding,
+            .format = attributes[i].format,
+            .offset = attributes[i].offset,
+        });
+    }
+    VulkanContext::Get().GetShaderObjectFunctions().cmdSetVertexInput(m_commandBuffer,
+        bindingCount, bindings2.data(), attributeCount, attributes2.data());
+}
+
+void CommandBuffer::SetPolygonMode(VkPolygonModeEXT polygonMode)
+{
+    VulkanContext::Get().GetShaderObjectFunctions().cmdSetPolygonMode(m_commandBuffer, polygonMode);
+}
+
+void CommandBuffer::SetRasterizationSamples(VkSampleCountFlagBits samples)
+{
+    VulkanContext::Get().GetShaderObjectFunctions().cmdSetRasterizationSamples(m_commandBuffer, samples);
+}
+
+void CommandBuffer::SetColorBlend(const VkPipelineColorBlendAttachmentState& state)
+{
+    const auto& functions = VulkanContext::Get().GetShaderObjectFunctions();
+    const VkBool32 blendEnable = state.blendEnable;
+    functions.cmdSetColorBlendEnable(m_commandBuffer, 0, 1, &blendEnable);
+    VkColorBlendEquationEXT equation{
+        .srcColorBlendFactor = state.srcColorBlendFactor,
+        .dstColorBlendFactor = state.dstColorBlendFactor,
+        .colorBlendOp = state.colorBlendOp,
+        .srcAlphaBlendFactor = state.srcAlphaBlendFactor,
+        .dstAlphaBlendFactor = state.dstAlphaBlendFactor,
+        .alphaBlendOp = state.alphaBlendOp,
+    };
+    functions.cmdSetColorBlendEquation(m_commandBuffer, 0, 1, &equation);
+    functions.cmdSetColorWriteMask(m_commandBuffer, 0, 1, &state.colorWriteMask);
+}
+
+void CommandBuffer::ExecuteCommands(const std::vector<std::shared_ptr<CommandBuffer>>& commandBuffers)
+{
+    std::vector<VkCommandBuffer> handles;
+    handles.reserve(commandBuffers.size());
+    for (auto& commandBuffer : commandBuffers)
+    {
+        handles.push_back(commandBuffer->Get());
+    }
+    if (!handles.empty())
+    {
+        vkCmdExecuteCommands(m_commandBuffer, uint32_t(handles.size()), handles.data());
+    }
+}
+
+void CommandBuffer::RecordRenderingParallel(const VkRenderingInfo& renderingInfo,
+    const VkCommandBufferInheritanceRenderingInfo& inheritanceRendering,
+    uint32_t itemCount, const SecondaryRecordFunc& record, uint32_t taskCount)
+{
+    auto& vulkanCtx = VulkanContext::Get();
+    auto& workerPool = vulkanCtx.GetWorkerThreadPool();
+
+    //呼び出しスレッドを含めたスレッド数で分割する
+    if (taskCount == 0)
+    {
+        taskCount = workerPool.GetThreadCount() + 1;
+    }
+    taskCount = std::max(1u, std::min(taskCount, itemCount));
+    const uint32_t itemsPerTask = (itemCount + taskCount - 1) / std::max(taskCount, 1u);
+
+    //各タスクは自スレッドのプールから二次コマンドバッファを得て記録する
+    std::vector<std::shared_ptr<CommandBuffer>> secondaries(taskCount);
+    workerPool.ParallelFor(taskCount, [&](uint32_t task)
+    {
+        const uint32_t begin = std::min(task * itemsPerTask, itemCount);
+        const uint32_t end = std::min(begin + itemsPerTask, itemCount);
+
+        auto secondary = vulkanCtx.AcquireFrameCommandBuffer(VK_COMMAND_BUFFER_LEVEL_SECONDARY);
+        secondary->BeginSecondary(inheritanceRendering);
+        if (begin < end)
+        {
+            record(*secondary, begin, end);
+        }
+        secondary->End();
+        secondaries[task] = std::move(secondary);
+    });
+
+    //パスの中身は全て二次コマンドバッファから実行する
+    VkRenderingInfo parallelRenderingInfo = renderingInfo;
+    parallelRenderingInfo.flags |= VK_RENDERING_CONTENTS_SECONDARY_COMMAND_BUFFERS_BIT;
+    BeginRendering(parallelRenderingInfo);
+    ExecuteCommands(secondaries);
+    EndRendering();
+}
+
+CommandBuffer::AccessState CommandBuffer::MakeAccessState(VkPipelineStageFlags2 stage, VkAccessFlags2 access)
+{
+    //GPUで使われていなければ待つものはない(ホストの書き込みは提出時に見えるようになる)
+    if (stage == VK_PIPELINE_STAGE_2_NONE)
+    {
+        return AccessState{ .pendingIndex = -1 };
+    }
+    //書き戻した読み取りは前の記録で見えるようにしてあるため、同じ読み取りはバリアなしで続けられる
+    //書き込みを含む場合は、それ以外の読み取りの前に書き込んだステージを待つ
+    AccessState state{
+        .readStage = stage,
+        .readAccess = access & ~WriteAccessMask,
+        .pendingIndex = -1,
+    };
+    if ((access & WriteAccessMask) != 0)
+    {
+        state.writeStage = stage;
+        state.writeAccess = access & WriteAccessMask;
+    }
+    return state;
+}
+
+bool CommandBuffer::UpdateAccessState(AccessState& state, bool layoutChange,
+    VkPipelineStageFlags2 stage, VkAccessFlags2 access,
+    VkPipelineStageFlags2& srcStage, VkAccessFlags2& srcAccess)
+{
+    const bool write = (access & WriteAccessMask) != 0;
+    if (!layoutChange && !write)
+    {
+        //読み取り同士は待つ必要がない。既にバリアで見えるようにしたステージからの読み取りも同様
+        const bool visible = (stage & ~state.readStage) == 0 && (access & ~state.readAccess) == 0;
+        const bool needsBarrier = state.writeStage != VK_PIPELINE_STAGE_2_NONE && !visible;
+        srcStage = state.writeStage;
+        srcAccess = state.writeAccess;
+        state.readStage |= stage;
+        state.readAccess |= access;
+        return needsBarrier;
+    }
+
+    //書き込み, レイアウト遷移は以前の読み書き全てを待つ。読み取りはメモリを見えるようにする必要がないためステージのみ
+    srcStage = state.writeStage | state.readStage;
+    srcAccess = state.writeAccess;
+    state.writeStage = stage;
+    state.writeAccess = access & WriteAccessMask;
+    state.readStage = write ? VK_PIPELINE_STAGE_2_NONE : stage;
+    state.readAccess = write ? VK_ACCESS_2_NONE : access;
+    return layoutChange || srcStage != VK_PIPELINE_STAGE_2_NONE;
+}
+
+void CommandBuffer::WriteBackStates()
+{
+    for (auto& [image, state] : m_imageStates)
+    {
+        state.resource->SetLayout(state.layout);
+        state.resource->SetStageFlags(state.access.writeStage | state.access.readStage);
+        state.resource->SetAccessFlag(state.access.writeAccess | state.access.readAccess);
+    }
+    for (auto& [buffer, state] : m_bufferStates)
+    {
+        state.resource->SetStageFlags(state.access.writeStage | state.access.readStage);
+        state.resource->SetAccessFlags(state.access.writeAccess | state.access.readAccess);
+    }
+    m_imageStates.clear();
+    m_bufferStates.clear();
 }
\ No newline at end of file
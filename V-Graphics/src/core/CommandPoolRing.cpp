@@ -0,0 +1,123 @@
+#include "core/CommandPoolRing.h"
+#include "core/CommandBuffer.h"
+#include "core/WorkerThreadPool.h"
+
+/*************************************************
+public
+*************************************************/
+
+bool CommandPoolRing::Initialize(VkDevice device, uint32_t queueFamilyIndex, uint32_t slotCount, uint32_t threadCount)
+{
+    m_device = device;
+    m_queueFamilyIndex = queueFamilyIndex;
+    m_currentSlot = 0;
+
+    //スレッド番号は固定のため、各スロットの枠はここで確保しておき以降は増やさない
+    m_slots.resize(slotCount);
+    for (auto& slot : m_slots)
+    {
+        slot.threadPools.resize(threadCount);
+    }
+    return slotCount > 0 && threadCount > 0;
+}
+
+void CommandPoolRing::Cleanup()
+{
+    for (auto& slot : m_slots)
+    {
+        for (auto& threadPool : slot.threadPools)
+        {
+            if (threadPool == nullptr)
+            {
+                continue;
+            }
+            //コマンドバッファはプールの破棄でまとめて解放される
+            threadPool->buffers[0].clear();
+            threadPool->buffers[1].clear();
+            vkDestroyCommandPool(m_device, threadPool->pool, nullptr);
+        }
+    }
+    m_slots.clear();
+}
+
+void CommandPoolRing::BeginSlot(uint32_t slot)
+{
+    for (auto& threadPool : m_slots[slot].threadPools)
+    {
+        if (threadPool == nullptr)
+        {
+            continue;
+        }
+        vkResetCommandPool(m_device, threadPool->pool, 0);
+        threadPool->usedCount[0] = 0;
+        threadPool->usedCount[1] = 0;
+    }
+    //リセットを終えてから公開し、Acquireするスレッドがリセット前のプールを使わないようにする
+    m_currentSlot.store(slot, std::memory_order_release);
+}
+
+std::shared_ptr<CommandBuffer> CommandPoolRing::Acquire(VkCommandBufferLevel level)
+{
+    ThreadPool* threadPool = GetThreadPool(m_currentSlot.load(std::memory_order_acquire));
+    if (threadPool == nullptr)
+    {
+        return nullptr;
+    }
+
+    //リセット済みのコマンドバッファが残っていればそのまま使う
+    auto& buffers = threadPool->buffers[level];
+    auto& usedCount = threadPool->usedCount[level];
+    if (usedCount < buffers.size())
+    {
+        return buffers[usedCount++];
+    }
+
+    VkCommandBufferAllocateInfo commandAI{
+        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+        .commandPool = threadPool->pool,
+        .level = level,
+        .commandBufferCount = 1,
+    };
+    VkCommandBuffer vkCommandBuffer{};
+    if (vkAllocateCommandBuffers(m_device, &commandAI, &vkCommandBuffer) != VK_SUCCESS)
+    {
+        return nullptr;
+    }
+
+    //返却先のプールを渡さず、個別の解放を行わせない
+    buffers.push_back(std::make_shared<CommandBuffer>(vkCommandBuffer));
+    return buffers[usedCount++];
+}
+
+/*************************************************
+private
+*************************************************/
+
+CommandPoolRing::ThreadPool* CommandPoolRing::GetThreadPool(uint32_t slot)
+{
+    //ワーカーの番号で各スロットの枠を選ぶ。枠は対応するスレッドだけが触れるためロックは不要
+    uint32_t threadIndex = WorkerThreadPool::GetCurrentThreadIndex();
+    auto& threadPools = m_slots[slot].threadPools;
+    if (threadIndex >= threadPools.size())
+    {
+        //Initialize後にワーカー数を増やした場合
+        return nullptr;
+    }
+
+    auto& threadPool = threadPools[threadIndex];
+    if (threadPool == nullptr)
+    {
+        VkCommandPoolCreateInfo commandPoolCI{
+            .sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+            .flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT,
+            .queueFamilyIndex = m_queueFamilyIndex,
+        };
+        auto newPool = std::make_unique<ThreadPool>();
+        if (vkCreateCommandPool(m_device, &commandPoolCI, nullptr, &newPool->pool) != VK_SUCCESS)
+        {
+            return nullptr;
+        }
+        threadPool = std::move(newPool);
+    }
+    return threadPool.get();
+}
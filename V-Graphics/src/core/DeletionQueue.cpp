@@ -0,0 +1,63 @@
+#include "core/DeletionQueue.h"
+
+/*************************************************
+public
+*************************************************/
+
+void DeletionQueue::Push(uint64_t timelineValue, Deleter deleter)
+{
+    std::lock_guard lock(m_mutex);
+    m_entries.emplace_back(timelineValue, std::move(deleter));
+}
+
+void DeletionQueue::Collect(uint64_t completedValue)
+{
+    //破棄処理の中から再び登録される場合があるため、取り出してからロック外で実行する
+    std::deque<std::pair<uint64_t, Deleter>> ready;
+    {
+        std::lock_guard lock(m_mutex);
+        while (!m_entries.empty() && m_entries.front().first <= completedValue)
+        {
+            ready.push_back(std::move(m_entries.front()));
+            m_entries.pop_front();
+        }
+    }
+    Execute(ready);
+}
+
+void DeletionQueue::Flush()
+{
+    //破棄処理が新たに登録したものも含めて、空になるまで実行する
+    while (true)
+    {
+        std::deque<std::pair<uint64_t, Deleter>> ready;
+        {
+            std::lock_guard lock(m_mutex);
+            ready.swap(m_entries);
+        }
+        if (ready.empty())
+        {
+            break;
+        }
+        Execute(ready);
+    }
+}
+
+size_t DeletionQueue::GetPendingCount() const
+{
+    std::lock_guard lock(m_mutex);
+    return m_entries.size();
+}
+
+/*************************************************
+private
+*************************************************/
+
+void DeletionQueue::Execute(std::deque<std::pair<uint64_t, Deleter>>& entries)
+{
+    for (auto& entry : entries)
+    {
+        entry.second();
+    }
+    entries.clear();
+}
@@ -0,0 +1,162 @@
+#include <algorithm>
+
+#include "core/DescriptorAllocator.h"
+
+/*************************************************
+public
+*************************************************/
+
+void DescriptorAllocator::Initialize(VkDevice device, uint32_t initialSets, const std::vector<DescriptorPoolRatio>& ratios, bool freeable)
+{
+    m_device = device;
+    m_ratios = ratios;
+    m_freeable = freeable;
+    m_setsPerPool = std::max(initialSets, 1u);
+}
+
+void DescriptorAllocator::Cleanup()
+{
+    std::lock_guard lock(m_mutex);
+    for (auto pool : m_readyPools)
+    {
+        vkDestroyDescriptorPool(m_device, pool, nullptr);
+    }
+    for (auto pool : m_fullPools)
+    {
+        vkDestroyDescriptorPool(m_device, pool, nullptr);
+    }
+    m_readyPools.clear();
+    m_fullPools.clear();
+    m_ownerPools.clear();
+}
+
+bool DescriptorAllocator::Allocate(VkDescriptorSetLayout layout, VkDescriptorSet& descriptorSet, const void* pNext)
+{
+    std::lock_guard lock(m_mutex);
+
+    VkDescriptorSetAllocateInfo allocInfo{
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+        .pNext = pNext,
+        .descriptorSetCount = 1,
+        .pSetLayouts = &layout,
+    };
+
+    //空きのあるプールから確保し、枯渇していれば次のプールで再試行する
+    while (true)
+    {
+        const bool isNewPool = m_readyPools.empty();
+        const bool isLargestPool = m_setsPerPool == MaxSetsPerPool;
+        allocInfo.descriptorPool = GetReadyPool();
+        if (allocInfo.descriptorPool == VK_NULL_HANDLE)
+        {
+            return false;
+        }
+
+        auto result = vkAllocateDescriptorSets(m_device, &allocInfo, &descriptorSet);
+        if (result == VK_SUCCESS)
+        {
+            if (m_freeable)
+            {
+                m_ownerPools[descriptorSet] = allocInfo.descriptorPool;
+            }
+            return true;
+        }
+        if (result != VK_ERROR_OUT_OF_POOL_MEMORY &&
+            result != VK_ERROR_FRAGMENTED_POOL)
+        {
+            return false;
+        }
+
+        m_readyPools.pop_back();
+        m_fullPools.push_back(allocInfo.descriptorPool);
+
+        //最大サイズの新しいプールにも収まらないレイアウトは確保できない
+        if (isNewPool && isLargestPool)
+        {
+            return false;
+        }
+    }
+}
+
+void DescriptorAllocator::Free(VkDescriptorSet descriptorSet)
+{
+    std::lock_guard lock(m_mutex);
+    auto it = m_ownerPools.find(descriptorSet);
+    if (it == m_ownerPools.end())
+    {
+        return;
+    }
+    VkDescriptorPool pool = it->second;
+    m_ownerPools.erase(it);
+    vkFreeDescriptorSets(m_device, pool, 1, &descriptorSet);
+
+    //空きができたため再び確保先の候補に戻す
+    auto full = std::find(m_fullPools.begin(), m_fullPools.end(), pool);
+    if (full != m_fullPools.end())
+    {
+        m_fullPools.erase(full);
+        m_readyPools.insert(m_readyPools.begin(), pool);
+    }
+}
+
+void DescriptorAllocator::Reset()
+{
+    std::lock_guard lock(m_mutex);
+    for (auto pool : m_fullPools)
+    {
+        m_readyPools.push_back(pool);
+    }
+    m_fullPools.clear();
+    for (auto pool : m_readyPools)
+    {
+        vkResetDescriptorPool(m_device, pool, 0);
+    }
+    m_ownerPools.clear();
+}
+
+/*************************************************
+private
+*************************************************/
+
+VkDescriptorPool DescriptorAllocator::CreatePool(uint32_t setCount)
+{
+    std::vector<VkDescriptorPoolSize> poolSizes;
+    for (auto& ratio : m_ratios)
+    {
+        poolSizes.push_back({
+            .type = ratio.type,
+            .descriptorCount = std::max(uint32_t(ratio.ratio * setCount), 1u),
+        });
+    }
+    VkDescriptorPoolCreateInfo poolInfo{
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+        .flags = m_freeable ? VkDescriptorPoolCreateFlags(VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT) : 0u,
+        .maxSets = setCount,
+        .poolSizeCount = uint32_t(poolSizes.size()),
+        .pPoolSizes = poolSizes.data(),
+    };
+
+    VkDescriptorPool pool = VK_NULL_HANDLE;
+    if (vkCreateDescriptorPool(m_device, &poolInfo, nullptr, &pool) != VK_SUCCESS)
+    {
+        return VK_NULL_HANDLE;
+    }
+    return pool;
+}
+
+VkDescriptorPool DescriptorAllocator::GetReadyPool()
+{
+    if (!m_readyPools.empty())
+    {
+        return m_readyPools.back();
+    }
+
+    //プールを追加する度に大きくし、プール数の増加を抑える
+    VkDescriptorPool pool = CreatePool(m_setsPerPool);
+    if (pool != VK_NULL_HANDLE)
+    {
+        m_setsPerPool = std::min(m_setsPerPool * 2, MaxSetsPerPool);
+        m_readyPools.push_back(pool);
+    }
+    return pool;
+}
@@ -0,0 +1,612 @@
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <set>
+
+#include "core/DeviceMemoryAllocator.h"
+
+namespace
+{
+    VkDeviceSize RoundUpPow2(VkDeviceSize value)
+    {
+        VkDeviceSize result = 1;
+        while (result < value)
+        {
+            result <<= 1;
+        }
+        return result;
+    }
+
+    uint32_t Log2(VkDeviceSize value)
+    {
+        uint32_t result = 0;
+        while (value > 1)
+        {
+            value >>= 1;
+            ++result;
+        }
+        return result;
+    }
+}
+
+//1つのVkDeviceMemoryと、その内部のバディ管理情報
+//level 0 がブロック全体、levelが1増える毎に半分のサイズになる
+struct MemoryBlock
+{
+    VkDeviceMemory memory = VK_NULL_HANDLE;
+    VkDeviceSize size = 0;
+    uint32_t memoryTypeIndex = 0;
+    void* mappedData = nullptr;
+
+    uint32_t levelCount = 0;
+    std::vector<std::set<VkDeviceSize>> freeLists;  //level毎の空きオフセット
+    uint32_t allocationCount = 0;
+
+    VkDeviceSize GetLevelSize(uint32_t level) const { return size >> level; }
+
+    //要求サイズを満たす最小のlevelを得る
+    uint32_t GetLevel(VkDeviceSize allocSize) const
+    {
+        return Log2(size) - Log2(allocSize);
+    }
+
+    bool Allocate(uint32_t level, VkDeviceSize& offset)
+    {
+        //要求level以上の大きさを持つ空き領域を探す
+        int32_t found = -1;
+        for (int32_t i = int32_t(level); i >= 0; --i)
+        {
+            if (!freeLists[i].empty())
+            {
+                found = i;
+                break;
+            }
+        }
+        if (found < 0)
+        {
+            return false;
+        }
+
+        auto it = freeLists[found].begin();
+        offset = *it;
+        freeLists[found].erase(it);
+
+        //要求サイズになるまで分割し、後半を空きリストに戻す
+        for (uint32_t i = uint32_t(found) + 1; i <= level; ++i)
+        {
+            freeLists[i].insert(offset + GetLevelSize(i));
+        }
+        ++allocationCount;
+        return true;
+    }
+
+    void Free(VkDeviceSize offset, uint32_t level)
+    {
+        //隣接するバディが空いていれば結合していく
+        while (level > 0)
+        {
+            VkDeviceSize buddy = offset ^ GetLevelSize(level);
+            auto it = freeLists[level].find(buddy);
+            if (it == freeLists[level].end())
+            {
+                break;
+            }
+            freeLists[level].erase(it);
+            offset = std::min(offset, buddy);
+            --level;
+        }
+        freeLists[level].insert(offset);
+        --allocationCount;
+    }
+};
+
+MemoryUsage MemoryUsage::FromProperties(VkMemoryPropertyFlags properties)
+{
+    MemoryUsage usage{ .required = properties };
+    if ((properties & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) == 0)
+    {
+        usage.notPreferred |= VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_CACHED_BIT;
+    }
+    else if ((properties & VK_MEMORY_PROPERTY_HOST_CACHED_BIT) == 0)
+    {
+        usage.notPreferred |= VK_MEMORY_PROPERTY_HOST_CACHED_BIT;
+    }
+    //デバッグ用途向けのAMDのデバイスコヒーレントなタイプは遅いため避ける
+    usage.notPreferred |= (VK_MEMORY_PROPERTY_DEVICE_COHERENT_BIT_AMD | VK_MEMORY_PROPERTY_DEVICE_UNCACHED_BIT_AMD) & ~properties;
+    return usage;
+}
+
+/*************************************************
+public
+*************************************************/
+
+DeviceMemoryAllocator::DeviceMemoryAllocator() = default;
+
+DeviceMemoryAllocator::~DeviceMemoryAllocator()
+{
+    Cleanup();
+}
+
+void DeviceMemoryAllocator::Initialize(VkDevice device, VkPhysicalDevice physicalDevice, bool memoryBudget)
+{
+    m_device = device;
+    m_physicalDevice = physicalDevice;
+    m_memoryBudgetSupported = memoryBudget;
+    vkGetPhysicalDeviceMemoryProperties(physicalDevice, &m_memoryProperties);
+
+    VkPhysicalDeviceProperties properties{};
+    vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+    m_bufferImageGranularity = properties.limits.bufferImageGranularity;
+    m_nonCoherentAtomSize = std::max<VkDeviceSize>(properties.limits.nonCoherentAtomSize, 1);
+
+    m_pools.resize(m_memoryProperties.memoryTypeCount * uint32_t(AllocationKind::AllocationKindMax));
+    m_heapStats.resize(m_memoryProperties.memoryHeapCount);
+    m_budgets.resize(m_memoryProperties.memoryHeapCount);
+    FetchBudget();
+
+    //ヒープが小さい場合(BAR領域など)はブロックサイズをヒープの1/8程度に抑える
+    for (uint32_t i = 0; i < m_memoryProperties.memoryTypeCount; ++i)
+    {
+        auto heapIndex = m_memoryProperties.memoryTypes[i].heapIndex;
+        auto heapSize = m_memoryProperties.memoryHeaps[heapIndex].size;
+        VkDeviceSize blockSize = DefaultBlockSize;
+        while (blockSize > MinAllocationSize && blockSize > heapSize / 8)
+        {
+            blockSize >>= 1;
+        }
+
+        for (uint32_t kind = 0; kind < uint32_t(AllocationKind::AllocationKindMax); ++kind)
+        {
+            m_pools[i * uint32_t(AllocationKind::AllocationKindMax) + kind].blockSize = blockSize;
+        }
+    }
+}
+
+void DeviceMemoryAllocator::Cleanup()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (auto& pool : m_pools)
+    {
+        for (auto& block : pool.blocks)
+        {
+            //解放漏れがあればここで検出
+            assert(block->allocationCount == 0);
+            DestroyBlock(block.get());
+        }
+        pool.blocks.clear();
+    }
+    m_pools.clear();
+    m_heapStats.clear();
+    m_budgets.clear();
+    m_device = VK_NULL_HANDLE;
+}
+
+bool DeviceMemoryAllocator::Allocate(const VkMemoryRequirements& requirements, const MemoryUsage& usage,
+    AllocationKind kind, DeviceAllocation& allocation)
+{
+    auto candidates = GetMemoryTypeCandidates(requirements.memoryTypeBits, usage);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (bool withinBudget : { true, false })
+    {
+        for (auto memoryTypeIndex : candidates)
+        {
+            if (AllocateFromType(requirements, memoryTypeIndex, kind, withinBudget, allocation))
+            {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+void DeviceMemoryAllocator::Free(DeviceAllocation& allocation)
+{
+    if (allocation.memory == VK_NULL_HANDLE)
+    {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto& stats = m_heapStats[m_memoryProperties.memoryTypes[allocation.memoryTypeIndex].heapIndex];
+    --stats.allocationCount;
+    stats.allocationBytes -= allocation.size;
+
+    if (allocation.block == nullptr)
+    {
+        //専用割り当てはそのまま解放
+        if (allocation.mappedData != nullptr)
+        {
+            vkUnmapMemory(m_device, allocation.memory);
+        }
+        vkFreeMemory(m_device, allocation.memory, nullptr);
+        --stats.blockCount;
+        stats.blockBytes -= allocation.size;
+    }
+    else
+    {
+        MemoryBlock* block = allocation.block;
+        block->Free(allocation.offset, allocation.level);
+
+        //空になったブロックは、同じプールに他のブロックがあれば返却する(1つは再利用のため残す)
+        if (block->allocationCount == 0)
+        {
+            auto kind = uint32_t(AllocationKind::AllocationKindMax);
+            for (uint32_t k = 0; k < kind; ++k)
+            {
+                auto& pool = m_pools[block->memoryTypeIndex * kind + k];
+                auto it = std::find_if(pool.blocks.begin(), pool.blocks.end(),
+                    [block](const auto& b) { return b.get() == block; });
+                if (it != pool.blocks.end() && pool.blocks.size() > 1)
+                {
+                    DestroyBlock(block);
+                    pool.blocks.erase(it);
+                    break;
+                }
+            }
+        }
+    }
+    allocation = DeviceAllocation{};
+}
+
+bool DeviceMemoryAllocator::AllocateForBuffer(VkBuffer buffer, const MemoryUsage& usage, DeviceAllocation& allocation)
+{
+    VkMemoryRequirements requirements;
+    vkGetBufferMemoryRequirements(m_device, buffer, &requirements);
+    if (!Allocate(requirements, usage, AllocationKind::Linear, allocation))
+    {
+        return false;
+    }
+    if (vkBindBufferMemory(m_device, buffer, allocation.memory, allocation.offset) != VK_SUCCESS)
+    {
+        Free(allocation);
+        return false;
+    }
+    return true;
+}
+
+bool DeviceMemoryAllocator::AllocateForImage(VkImage image, VkImageTiling tiling, const MemoryUsage& usage, DeviceAllocation& allocation)
+{
+    VkMemoryRequirements requirements;
+    vkGetImageMemoryRequirements(m_device, image, &requirements);
+    auto kind = tiling == VK_IMAGE_TILING_OPTIMAL ? AllocationKind::Optimal : AllocationKind::Linear;
+    if (!Allocate(requirements, usage, kind, allocation))
+    {
+        return false;
+    }
+    if (vkBindImageMemory(m_device, image, allocation.memory, allocation.offset) != VK_SUCCESS)
+    {
+        Free(allocation);
+        return false;
+    }
+    return true;
+}
+
+void DeviceMemoryAllocator::Flush(const DeviceAllocation& allocation, VkDeviceSize offset, VkDeviceSize size) const
+{
+    if (allocation.mappedData == nullptr || IsHostCoherent(allocation.memoryTypeIndex))
+    {
+        return;
+    }
+    auto range = GetMappedRange(allocation, offset, size);
+    vkFlushMappedMemoryRanges(m_device, 1, &range);
+}
+
+void DeviceMemoryAllocator::Invalidate(const DeviceAllocation& allocation, VkDeviceSize offset, VkDeviceSize size) const
+{
+    if (allocation.mappedData == nullptr || IsHostCoherent(allocation.memoryTypeIndex))
+    {
+        return;
+    }
+    auto range = GetMappedRange(allocation, offset, size);
+    vkInvalidateMappedMemoryRanges(m_device, 1, &range);
+}
+
+bool DeviceMemoryAllocator::IsHostCoherent(uint32_t memoryTypeIndex) const
+{
+    return (m_memoryProperties.memoryTypes[memoryTypeIndex].propertyFlags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT) != 0;
+}
+
+std::vector<DeviceMemoryAllocator::HeapStatistics> DeviceMemoryAllocator::GetHeapStatistics() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_heapStats;
+}
+
+uint32_t DeviceMemoryAllocator::FindMemoryTypeIndex(uint32_t memoryTypeBits, const MemoryUsage& usage) const
+{
+    auto candidates = GetMemoryTypeCandidates(memoryTypeBits, usage);
+    return candidates.empty() ? UINT32_MAX : candidates.front();
+}
+
+void DeviceMemoryAllocator::UpdateBudget()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    FetchBudget();
+}
+
+std::vector<DeviceMemoryAllocator::HeapBudget> DeviceMemoryAllocator::GetHeapBudgets() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    std::vector<HeapBudget> budgets;
+    for (uint32_t i = 0; i < m_memoryProperties.memoryHeapCount; ++i)
+    {
+        budgets.push_back(GetHeapBudget(i));
+    }
+    return budgets;
+}
+
+/*************************************************
+private
+*************************************************/
+
+std::vector<uint32_t> DeviceMemoryAllocator::GetMemoryTypeCandidates(uint32_t memoryTypeBits, const MemoryUsage& usage) const
+{
+    //preferredの不足数とnotPreferredの該当数の合計が少ないほど優先する(同じならタイプ番号順)
+    std::vector<std::pair<uint32_t, uint32_t>> candidates; //[コスト, タイプ]
+    for (uint32_t i = 0; i < m_memoryProperties.memoryTypeCount; ++i)
+    {
+        const auto flags = m_memoryProperties.memoryTypes[i].propertyFlags;
+        if ((memoryTypeBits & (1u << i)) == 0 ||
+            (flags & usage.required) != usage.required)
+        {
+            continue;
+        }
+        const uint32_t cost =
+            std::popcount(uint32_t(usage.preferred & ~flags)) +
+            std::popcount(uint32_t(usage.notPreferred & flags));
+        candidates.emplace_back(cost, i);
+    }
+    std::stable_sort(candidates.begin(), candidates.end(),
+        [](const auto& a, const auto& b) { return a.first < b.first; });
+
+    std::vector<uint32_t> result;
+    for (auto& candidate : candidates)
+    {
+        result.push_back(candidate.second);
+    }
+    return result;
+}
+
+bool DeviceMemoryAllocator::AllocateFromType(const VkMemoryRequirements& requirements, uint32_t memoryTypeIndex,
+    AllocationKind kind, bool withinBudget, DeviceAllocation& allocation)
+{
+    auto& pool = GetPool(memoryTypeIndex, kind);
+
+    //バディブロックは自身のサイズでアライメントされるため、
+    //サイズをアライメント以上の2のべき乗に切り上げれば配置制約を満たせる
+    VkDeviceSize allocSize = RoundUpPow2(std::max({ requirements.size, requirements.alignment, MinAllocationSize }));
+    if (allocSize > pool.blockSize / 2)
+    {
+        //ブロックの半分を超える大きなリソースは専用に確保する
+        if (withinBudget && !IsWithinBudget(memoryTypeIndex, requirements.size))
+        {
+            return false;
+        }
+        return AllocateDedicated(requirements, memoryTypeIndex, allocation);
+    }
+
+    MemoryBlock* target = nullptr;
+    VkDeviceSize offset = 0;
+    uint32_t level = 0;
+    for (auto& block : pool.blocks)
+    {
+        level = block->GetLevel(allocSize);
+        if (block->Allocate(level, offset))
+        {
+            target = block.get();
+            break;
+        }
+    }
+    if (target == nullptr)
+    {
+        if (withinBudget && !IsWithinBudget(memoryTypeIndex, pool.blockSize))
+        {
+            return false;
+        }
+        target = CreateBlock(memoryTypeIndex, pool.blockSize);
+        if (target == nullptr)
+        {
+            return false;
+        }
+        pool.blocks.emplace_back(target);
+        level = target->GetLevel(allocSize);
+        target->Allocate(level, offset);
+    }
+
+    allocation = DeviceAllocation{
+        .memory = target->memory,
+        .offset = offset,
+        .size = allocSize,
+        .memoryTypeIndex = memoryTypeIndex,
+        .mappedData = target->mappedData ? static_cast<uint8_t*>(target->mappedData) + offset : nullptr,
+        .block = target,
+        .level = level,
+    };
+
+    auto& stats = m_heapStats[m_memoryProperties.memoryTypes[memoryTypeIndex].heapIndex];
+    ++stats.allocationCount;
+    stats.allocationBytes += allocSize;
+    return true;
+}
+
+bool DeviceMemoryAllocator::IsWithinBudget(uint32_t memoryTypeIndex, VkDeviceSize size) const
+{
+    auto budget = GetHeapBudget(m_memoryProperties.memoryTypes[memoryTypeIndex].heapIndex);
+    return budget.usage + size <= budget.budget;
+}
+
+DeviceMemoryAllocator::HeapBudget DeviceMemoryAllocator::GetHeapBudget(uint32_t heapIndex) const
+{
+    const auto& snapshot = m_budgets[heapIndex];
+    const VkDeviceSize blockBytes = m_heapStats[heapIndex].blockBytes;
+
+    HeapBudget budget{
+        .heapSize = m_memoryProperties.memoryHeaps[heapIndex].size,
+        .budget = snapshot.budget,
+    };
+    if (m_memoryBudgetSupported)
+    {
+        //取得後に増減した確保量をドライバの報告値に反映する
+        budget.usage = blockBytes >= snapshot.blockBytes ?
+            snapshot.usage + (blockBytes - snapshot.blockBytes) :
+            snapshot.usage - std::min(snapshot.usage, snapshot.blockBytes - blockBytes);
+    }
+    else
+    {
+        budget.usage = blockBytes;
+    }
+    return budget;
+}
+
+void DeviceMemoryAllocator::FetchBudget()
+{
+    if (!m_memoryBudgetSupported)
+    {
+        for (uint32_t i = 0; i < m_memoryProperties.memoryHeapCount; ++i)
+        {
+            m_budgets[i].budget = m_memoryProperties.memoryHeaps[i].size / 10 * 8;
+        }
+        return;
+    }
+
+    VkPhysicalDeviceMemoryBudgetPropertiesEXT budgetProps{
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT,
+    };
+    VkPhysicalDeviceMemoryProperties2 memoryProps2{
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2,
+        .pNext = &budgetProps,
+    };
+    vkGetPhysicalDeviceMemoryProperties2(m_physicalDevice, &memoryProps2);
+
+    for (uint32_t i = 0; i < m_memoryProperties.memoryHeapCount; ++i)
+    {
+        auto& snapshot = m_budgets[i];
+        snapshot.budget = budgetProps.heapBudget[i];
+        snapshot.usage = budgetProps.heapUsage[i];
+        snapshot.blockBytes = m_heapStats[i].blockBytes;
+
+        //ドライバによっては0を返すため、その場合はヒープサイズから見積もる
+        if (snapshot.budget == 0)
+        {
+            snapshot.budget = m_memoryProperties.memoryHeaps[i].size / 10 * 8;
+        }
+    }
+}
+
+MemoryBlock* DeviceMemoryAllocator::CreateBlock(uint32_t memoryTypeIndex, VkDeviceSize size)
+{
+    VkMemoryAllocateInfo allocInfo{
+        .sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
+        .allocationSize = size,
+        .memoryTypeIndex = memoryTypeIndex,
+    };
+    VkDeviceMemory memory = VK_NULL_HANDLE;
+    if (vkAllocateMemory(m_device, &allocInfo, nullptr, &memory) != VK_SUCCESS)
+    {
+        return nullptr;
+    }
+
+    auto* block = new MemoryBlock();
+    block->memory = memory;
+    block->size = size;
+    block->memoryTypeIndex = memoryTypeIndex;
+    block->levelCount = Log2(size / MinAllocationSize) + 1;
+    block->freeLists.resize(block->levelCount);
+    block->freeLists[0].insert(0);
+
+    //HOST_VISIBLEなブロックは作成時に1度だけマップし、以降はオフセットで参照する
+    if (IsHostVisible(memoryTypeIndex))
+    {
+        vkMapMemory(m_device, memory, 0, VK_WHOLE_SIZE, 0, &block->mappedData);
+    }
+
+    auto& stats = m_heapStats[m_memoryProperties.memoryTypes[memoryTypeIndex].heapIndex];
+    ++stats.blockCount;
+    stats.blockBytes += size;
+    return block;
+}
+
+void DeviceMemoryAllocator::DestroyBlock(MemoryBlock* block)
+{
+    if (block->mappedData != nullptr)
+    {
+        vkUnmapMemory(m_device, block->memory);
+    }
+    vkFreeMemory(m_device, block->memory, nullptr);
+
+    auto& stats = m_heapStats[m_memoryProperties.memoryTypes[block->memoryTypeIndex].heapIndex];
+    --stats.blockCount;
+    stats.blockBytes -= block->size;
+}
+
+bool DeviceMemoryAllocator::AllocateDedicated(const VkMemoryRequirements& requirements, uint32_t memoryTypeIndex, DeviceAllocation& allocation)
+{
+    VkMemoryAllocateInfo allocInfo{
+        .sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
+        .allocationSize = requirements.size,
+        .memoryTypeIndex = memoryTypeIndex,
+    };
+    VkDeviceMemory memory = VK_NULL_HANDLE;
+    if (vkAllocateMemory(m_device, &allocInfo, nullptr, &memory) != VK_SUCCESS)
+    {
+        return false;
+    }
+
+    void* mapped = nullptr;
+    if (IsHostVisible(memoryTypeIndex))
+    {
+        vkMapMemory(m_device, memory, 0, VK_WHOLE_SIZE, 0, &mapped);
+    }
+
+    allocation = DeviceAllocation{
+        .memory = memory,
+        .offset = 0,
+        .size = requirements.size,
+        .memoryTypeIndex = memoryTypeIndex,
+        .mappedData = mapped,
+        .block = nullptr,
+    };
+
+    auto& stats = m_heapStats[m_memoryProperties.memoryTypes[memoryTypeIndex].heapIndex];
+    ++stats.blockCount;
+    stats.blockBytes += requirements.size;
+    ++stats.allocationCount;
+    stats.allocationBytes += requirements.size;
+    return true;
+}
+
+DeviceMemoryAllocator::MemoryPool& DeviceMemoryAllocator::GetPool(uint32_t memoryTypeIndex, AllocationKind kind)
+{
+    //粒度制約がなければリニア, ノンリニアを同じプールで扱う
+    if (m_bufferImageGranularity <= 1)
+    {
+        kind = AllocationKind::Linear;
+    }
+    return m_pools[memoryTypeIndex * uint32_t(AllocationKind::AllocationKindMax) + uint32_t(kind)];
+}
+
+bool DeviceMemoryAllocator::IsHostVisible(uint32_t memoryTypeIndex) const
+{
+    return (m_memoryProperties.memoryTypes[memoryTypeIndex].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) != 0;
+}
+
+VkMappedMemoryRange DeviceMemoryAllocator::GetMappedRange(const DeviceAllocation& allocation, VkDeviceSize offset, VkDeviceSize size) const
+{
+    //VkDeviceMemory内の位置に変換し、割り当ての終端で切り詰める
+    const VkDeviceSize allocationEnd = allocation.offset + allocation.size;
+    const VkDeviceSize begin = std::min(allocation.offset + offset, allocationEnd);
+    const VkDeviceSize end = (size == VK_WHOLE_SIZE) ? allocationEnd : std::min(begin + size, allocationEnd);
+
+    //アトム境界へ広げる(メモリ終端を超える場合はVK_WHOLE_SIZEで指定する)
+    const VkDeviceSize memorySize = allocation.block ? allocation.block->size : allocation.size;
+    const VkDeviceSize alignedBegin = begin / m_nonCoherentAtomSize * m_nonCoherentAtomSize;
+    const VkDeviceSize alignedEnd = (end + m_nonCoherentAtomSize - 1) / m_nonCoherentAtomSize * m_nonCoherentAtomSize;
+
+    return VkMappedMemoryRange{
+        .sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE,
+        .memory = allocation.memory,
+        .offset = alignedBegin,
+        .size = alignedEnd >= memorySize ? VK_WHOLE_SIZE : alignedEnd - alignedBegin,
+    };
+}
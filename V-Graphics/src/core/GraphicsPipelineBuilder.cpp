@@ -1,12 +1,43 @@
 #include "core/GraphicsPipelineBuilder.h"
 #include "core/VulkanContext.h"
+#include "core/Hash.h"
 
-GraphicsPipelineBuilder::GraphicsPipelineBuilder()
+namespace
 {
-    m_vertexInputState = {
-        .sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO,
+    // UseDynamicStateで描画時に設定するステート(全てVulkan 1.3のコア)
+    constexpr VkDynamicState ExtendedDynamicStates[] = {
+        VK_DYNAMIC_STATE_VIEWPORT_WITH_COUNT,
+        VK_DYNAMIC_STATE_SCISSOR_WITH_COUNT,
+        VK_DYNAMIC_STATE_CULL_MODE,
+        VK_DYNAMIC_STATE_FRONT_FACE,
+        VK_DYNAMIC_STATE_PRIMITIVE_TOPOLOGY,
+        VK_DYNAMIC_STATE_DEPTH_TEST_ENABLE,
+        VK_DYNAMIC_STATE_DEPTH_WRITE_ENABLE,
+        VK_DYNAMIC_STATE_DEPTH_COMPARE_OP,
     };
 
+    // 動的トポロジーでもパイプラインに残る区分
+    uint32_t GetTopologyClass(VkPrimitiveTopology topology)
+    {
+        switch (topology)
+        {
+        case VK_PRIMITIVE_TOPOLOGY_POINT_LIST:
+            return 0;
+        case VK_PRIMITIVE_TOPOLOGY_LINE_LIST:
+        case VK_PRIMITIVE_TOPOLOGY_LINE_STRIP:
+        case VK_PRIMITIVE_TOPOLOGY_LINE_LIST_WITH_ADJACENCY:
+        case VK_PRIMITIVE_TOPOLOGY_LINE_STRIP_WITH_ADJACENCY:
+            return 1;
+        case VK_PRIMITIVE_TOPOLOGY_PATCH_LIST:
+            return 3;
+        default:
+            return 2;
+        }
+    }
+}
+
+GraphicsPipelineBuilder::GraphicsPipelineBuilder()
+{
     m_inputAssemblyState = {
         .sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO,
         .topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST,
@@ -38,12 +69,6 @@ GraphicsPipelineBuilder::GraphicsPipelineBuilder()
                           VK_COLOR_COMPONENT_A_BIT
     };
 
-    m_colorBlendState = {
-        .sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO,
-        .attachmentCount = 1,
-        .pAttachments = &m_colorBlendAttachment,
-    };
-
     m_depthStencilState = VkPipelineDepthStencilStateCreateInfo{
         .sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO,
         .depthTestEnable = VK_FALSE,
@@ -55,6 +80,12 @@ GraphicsPipelineBuilder::GraphicsPipelineBuilder()
 }
 
 GraphicsPipelineBuilder& GraphicsPipelineBuilder::AddShaderStage(VkShaderStageFlagBits stage, VkShaderModule module, const char* entry)
+{
+    return AddShaderStage(stage, module, SpecializationConstants{}, entry);
+}
+
+GraphicsPipelineBuilder& GraphicsPipelineBuilder::AddShaderStage(VkShaderStageFlagBits stage, VkShaderModule module,
+    const SpecializationConstants& constants, const char* entry)
 {
     m_shaderStages.push_back({
         .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
@@ -62,6 +93,7 @@ GraphicsPipelineBuilder& GraphicsPipelineBuilder::AddShaderStage(VkShaderStageFl
         .module = module,
         .pName = entry
         });
+    m_specializations.push_back(constants);
     return *this;
 }
 
@@ -71,14 +103,6 @@ GraphicsPipelineBuilder& GraphicsPipelineBuilder::SetVertexInput(
 {
     m_bindingDescriptions.assign(bindings, bindings + bindingCount);
     m_attributeDescriptions.assign(attributes, attributes + attributeCount);
-
-    m_vertexInputState = {
-        .sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO,
-        .vertexBindingDescriptionCount = bindingCount,
-        .pVertexBindingDescriptions = m_bindingDescriptions.data(),
-        .vertexAttributeDescriptionCount = attributeCount,
-        .pVertexAttributeDescriptions = m_attributeDescriptions.data()
-    };
     return *this;
 }
 
@@ -93,7 +117,7 @@ GraphicsPipelineBuilder& GraphicsPipelineBuilder::SetViewport(VkExtent2D extent)
         .maxDepth = 1.0f
     };
 
-    // VK_KHR_Maintenance1 ɂ㉺]
+    // VK_KHR_Maintenance1 による上下反転
     m_viewport.y = float(extent.height);
     m_viewport.height = -float(extent.height);
 
@@ -101,15 +125,6 @@ GraphicsPipelineBuilder& GraphicsPipelineBuilder::SetViewport(VkExtent2D extent)
         .offset = { 0, 0 },
         .extent = extent
     };
-
-    m_viewportState = {
-        .sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO,
-        .viewportCount = 1,
-        .pViewports = &m_viewport,
-        .scissorCount = 1,
-        .pScissors = &m_scissor
-    };
-
     return *this;
 }
 
@@ -117,13 +132,6 @@ GraphicsPipelineBuilder& GraphicsPipelineBuilder::SetViewport(VkViewport& viewpo
 {
     m_viewport = viewport;
     m_scissor = scissor;
-    m_viewportState = {
-        .sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO,
-        .viewportCount = 1,
-        .pViewports = &m_viewport,
-        .scissorCount = 1,
-        .pScissors = &m_scissor
-    };
     return *this;
 }
 
@@ -164,6 +172,12 @@ GraphicsPipelineBuilder& GraphicsPipelineBuilder::UseDynamicRendering(VkFormat c
     return *this;
 }
 
+GraphicsPipelineBuilder& GraphicsPipelineBuilder::UseDynamicState(bool enable)
+{
+    m_dynamicStateEnabled = enable;
+    return *this;
+}
+
 GraphicsPipelineBuilder& GraphicsPipelineBuilder::SetInputAssembly(const VkPipelineInputAssemblyStateCreateInfo& state)
 {
     m_inputAssemblyState = state;
@@ -177,50 +191,357 @@ GraphicsPipelineBuilder& GraphicsPipelineBuilder::SetTessellation(bool enable, c
 }
 
 
-VkPipeline GraphicsPipelineBuilder::Build()
+VkPipeline GraphicsPipelineBuilder::Build() const
 {
-    VkGraphicsPipelineCreateInfo pipelineInfo{
+    VkPipeline pipeline = VK_NULL_HANDLE;
+    auto* builder = this;
+    if (BuildBatch(&builder, 1, &pipeline) != VK_SUCCESS) {
+        return VK_NULL_HANDLE;
+    }
+    return pipeline;
+}
+
+void GraphicsPipelineBuilder::WriteCreateInfo(CreateInfo& createInfo) const
+{
+    // ビルダーをコピーしても参照先がずれないよう、ポインタを含むステートは作成時に組み立てる
+    createInfo.vertexInputState = {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO,
+        .vertexBindingDescriptionCount = uint32_t(m_bindingDescriptions.size()),
+        .pVertexBindingDescriptions = m_bindingDescriptions.data(),
+        .vertexAttributeDescriptionCount = uint32_t(m_attributeDescriptions.size()),
+        .pVertexAttributeDescriptions = m_attributeDescriptions.data()
+    };
+    createInfo.viewportState = {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO,
+        .viewportCount = 1,
+        .pViewports = &m_viewport,
+        .scissorCount = 1,
+        .pScissors = &m_scissor
+    };
+    if (m_dynamicStateEnabled)
+    {
+        // 個数も動的に設定する場合は0を指定する
+        createInfo.viewportState = {
+            .sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO,
+        };
+        createInfo.dynamicState = {
+            .sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO,
+            .dynamicStateCount = uint32_t(std::size(ExtendedDynamicStates)),
+            .pDynamicStates = ExtendedDynamicStates,
+        };
+    }
+    createInfo.colorBlendState = {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO,
+        .attachmentCount = 1,
+        .pAttachments = &m_colorBlendAttachment,
+    };
+
+    // 特殊化定数の情報は作成情報側に置き、ステージから指す
+    createInfo.stages = m_shaderStages;
+    createInfo.specializationInfos.assign(m_shaderStages.size(), VkSpecializationInfo{});
+    createInfo.moduleInfos.assign(m_shaderStages.size(), VkShaderModuleCreateInfo{});
+    auto& shaderModuleCache = VulkanContext::Get().GetShaderModuleCache();
+    for (size_t i = 0; i < m_shaderStages.size(); ++i)
+    {
+        if (!m_specializations[i].IsEmpty())
+        {
+            createInfo.specializationInfos[i] = m_specializations[i].GetInfo();
+            createInfo.stages[i].pSpecializationInfo = &createInfo.specializationInfos[i];
+        }
+
+        // VK_KHR_maintenance5が使えれば、キャッシュが保持しているSPIR-Vをモジュールの代わりに直接渡す
+        auto code = shaderModuleCache.IsInlineModuleSupported() ?
+            shaderModuleCache.GetCode(m_shaderStages[i].module) : std::span<const uint32_t>{};
+        if (!code.empty())
+        {
+            createInfo.moduleInfos[i] = {
+                .sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO,
+                .codeSize = code.size_bytes(),
+                .pCode = code.data(),
+            };
+            createInfo.stages[i].pNext = &createInfo.moduleInfos[i];
+            createInfo.stages[i].module = VK_NULL_HANDLE;
+        }
+    }
+
+    createInfo.pipeline = {
         .sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO,
-        .stageCount = static_cast<uint32_t>(m_shaderStages.size()),
-        .pStages = m_shaderStages.data(),
-        .pVertexInputState = &m_vertexInputState,
+        .stageCount = static_cast<uint32_t>(createInfo.stages.size()),
+        .pStages = createInfo.stages.data(),
+        .pVertexInputState = &createInfo.vertexInputState,
         .pInputAssemblyState = &m_inputAssemblyState,
-        .pViewportState = &m_viewportState,
+        .pViewportState = &createInfo.viewportState,
         .pRasterizationState = &m_rasterizerState,
         .pMultisampleState = &m_multisampleState,
         .pDepthStencilState = &m_depthStencilState,
-        .pColorBlendState = &m_colorBlendState,
+        .pColorBlendState = &createInfo.colorBlendState,
+        .pDynamicState = m_dynamicStateEnabled ? &createInfo.dynamicState : nullptr,
         .layout = m_pipelineLayout,
     };
 
-    VkPipelineRenderingCreateInfo renderingInfo{};
     if (m_useRenderPass)
     {
-        pipelineInfo.renderPass = m_renderPass;
-        pipelineInfo.subpass = m_subpass;
+        createInfo.pipeline.renderPass = m_renderPass;
+        createInfo.pipeline.subpass = m_subpass;
     }
     else
     {
-        renderingInfo = {
+        createInfo.renderingInfo = {
             .sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO,
             .colorAttachmentCount = 1,
             .pColorAttachmentFormats = &m_colorFormat,
             .depthAttachmentFormat = m_depthFormat,
         };
-        pipelineInfo.pNext = &renderingInfo;
-        pipelineInfo.renderPass = VK_NULL_HANDLE;
-        pipelineInfo.subpass = 0;
+        createInfo.pipeline.pNext = &createInfo.renderingInfo;
+        createInfo.pipeline.renderPass = VK_NULL_HANDLE;
+        createInfo.pipeline.subpass = 0;
     }
 
     if (m_tessellationEnabled)
     {
-        pipelineInfo.pTessellationState = &m_tessellationState;
+        createInfo.pipeline.pTessellationState = &m_tessellationState;
+    }
+}
+
+void GraphicsPipelineBuilder::WriteLibraryCreateInfo(CreateInfo& createInfo, VkGraphicsPipelineLibraryFlagsEXT parts) const
+{
+    WriteCreateInfo(createInfo);
+
+    // シェーダーは含める部分に属するものだけを渡す
+    std::erase_if(createInfo.stages, [parts](const VkPipelineShaderStageCreateInfo& stage)
+    {
+        const bool isFragment = stage.stage == VK_SHADER_STAGE_FRAGMENT_BIT;
+        return isFragment ?
+            (parts & VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_SHADER_BIT_EXT) == 0 :
+            (parts & VK_GRAPHICS_PIPELINE_LIBRARY_PRE_RASTERIZATION_SHADERS_BIT_EXT) == 0;
+    });
+    createInfo.pipeline.stageCount = uint32_t(createInfo.stages.size());
+    createInfo.pipeline.pStages = createInfo.stages.data();
+
+    createInfo.libraryInfo = {
+        .sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_LIBRARY_CREATE_INFO_EXT,
+        .pNext = createInfo.pipeline.pNext,
+        .flags = parts,
     };
+    createInfo.pipeline.pNext = &createInfo.libraryInfo;
+    createInfo.pipeline.flags |=
+        VK_PIPELINE_CREATE_LIBRARY_BIT_KHR |
+        VK_PIPELINE_CREATE_RETAIN_LINK_TIME_OPTIMIZATION_INFO_BIT_EXT;
+}
 
-    auto device = VulkanContext::Get().GetVkDevice();
-    VkPipeline pipeline = VK_NULL_HANDLE;
-    if (vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &pipeline) != VK_SUCCESS) {
-        return VK_NULL_HANDLE;
+VkResult GraphicsPipelineBuilder::BuildBatch(const GraphicsPipelineBuilder* const* builders, uint32_t count, VkPipeline* pipelines)
+{
+    std::vector<CreateInfo> createInfos(count);
+    std::vector<VkGraphicsPipelineCreateInfo> pipelineInfos(count);
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        builders[i]->WriteCreateInfo(createInfos[i]);
+        pipelineInfos[i] = createInfos[i].pipeline;
+    }
+
+    auto& vulkanCtx = VulkanContext::Get();
+    auto result = vulkanCtx.GetPipelineCache().CreateGraphicsPipelines(count, pipelineInfos.data(), pipelines);
+    if (result != VK_SUCCESS)
+    {
+        // 失敗時に作成済みのものが残らないよう、全て破棄して揃える
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            vkDestroyPipeline(vulkanCtx.GetVkDevice(), pipelines[i], nullptr);
+            pipelines[i] = VK_NULL_HANDLE;
+        }
+    }
+    return result;
+}
+
+uint64_t GraphicsPipelineBuilder::GetStateHash(std::vector<uint8_t>* state) const
+{
+    Hasher hasher(state);
+    HashVertexInputState(hasher);
+    HashPreRasterizationState(hasher);
+    HashFragmentShaderState(hasher);
+    HashFragmentOutputState(hasher);
+    return hasher.Get();
+}
+
+uint64_t GraphicsPipelineBuilder::GetLibraryStateHash(VkGraphicsPipelineLibraryFlagBitsEXT part, std::vector<uint8_t>* state) const
+{
+    Hasher hasher(state);
+    hasher.Add(part);
+    switch (part)
+    {
+    case VK_GRAPHICS_PIPELINE_LIBRARY_VERTEX_INPUT_INTERFACE_BIT_EXT:
+        HashVertexInputState(hasher);
+        break;
+    case VK_GRAPHICS_PIPELINE_LIBRARY_PRE_RASTERIZATION_SHADERS_BIT_EXT:
+        HashPreRasterizationState(hasher);
+        break;
+    case VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_SHADER_BIT_EXT:
+        HashFragmentShaderState(hasher);
+        break;
+    default:
+        HashFragmentOutputState(hasher);
+        break;
+    }
+    return hasher.Get();
+}
+
+std::vector<VkShaderModule> GraphicsPipelineBuilder::GetShaderModules() const
+{
+    std::vector<VkShaderModule> modules;
+    for (const auto& stage : m_shaderStages)
+    {
+        modules.push_back(stage.module);
+    }
+    return modules;
+}
+
+void GraphicsPipelineBuilder::HashShaderStage(Hasher& hasher, size_t index) const
+{
+    const auto& stage = m_shaderStages[index];
+    hasher.Add(stage.stage);
+    // キャッシュのモジュールは内容で区別し、解放後に読み直しても同じキーになるようにする
+    const uint64_t contentHash = VulkanContext::Get().GetShaderModuleCache().GetContentHash(stage.module);
+    if (contentHash != 0)
+    {
+        hasher.Add(contentHash);
+    }
+    else
+    {
+        hasher.Add(stage.module);
+    }
+    hasher.AddString(stage.pName);
+    m_specializations[index].AddToHash(hasher);
+}
+
+void GraphicsPipelineBuilder::HashVertexInputState(Hasher& hasher) const
+{
+    hasher.Add(m_bindingDescriptions.size());
+    for (const auto& binding : m_bindingDescriptions)
+    {
+        hasher.Add(binding.binding).Add(binding.stride).Add(binding.inputRate);
+    }
+    hasher.Add(m_attributeDescriptions.size());
+    for (const auto& attribute : m_attributeDescriptions)
+    {
+        hasher.Add(attribute.location).Add(attribute.binding).Add(attribute.format).Add(attribute.offset);
+    }
+
+    // 動的に設定するステートは含めない
+    hasher.Add(m_dynamicStateEnabled);
+    if (m_dynamicStateEnabled)
+    {
+        hasher.Add(GetTopologyClass(m_inputAssemblyState.topology));
+    }
+    else
+    {
+        hasher.Add(m_inputAssemblyState.topology);
+    }
+    hasher.Add(m_inputAssemblyState.primitiveRestartEnable);
+}
+
+void GraphicsPipelineBuilder::HashPreRasterizationState(Hasher& hasher) const
+{
+    for (size_t i = 0; i < m_shaderStages.size(); ++i)
+    {
+        if (m_shaderStages[i].stage != VK_SHADER_STAGE_FRAGMENT_BIT)
+        {
+            HashShaderStage(hasher, i);
+        }
+    }
+
+    hasher.Add(m_tessellationEnabled);
+    if (m_tessellationEnabled)
+    {
+        hasher.Add(m_tessellationState.patchControlPoints);
+    }
+
+    hasher.Add(m_dynamicStateEnabled);
+    if (!m_dynamicStateEnabled)
+    {
+        hasher.Add(m_viewport.x).Add(m_viewport.y).Add(m_viewport.width).Add(m_viewport.height)
+            .Add(m_viewport.minDepth).Add(m_viewport.maxDepth);
+        hasher.Add(m_scissor.offset.x).Add(m_scissor.offset.y).Add(m_scissor.extent.width).Add(m_scissor.extent.height);
+    }
+
+    const auto& raster = m_rasterizerState;
+    if (!m_dynamicStateEnabled)
+    {
+        hasher.Add(raster.cullMode).Add(raster.frontFace);
+    }
+    hasher.Add(raster.depthClampEnable).Add(raster.rasterizerDiscardEnable).Add(raster.polygonMode)
+        .Add(raster.depthBiasEnable)
+        .Add(raster.depthBiasConstantFactor).Add(raster.depthBiasClamp).Add(raster.depthBiasSlopeFactor)
+        .Add(raster.lineWidth);
+
+    hasher.Add(m_pipelineLayout);
+    HashRenderingState(hasher, false);
+}
+
+void GraphicsPipelineBuilder::HashFragmentShaderState(Hasher& hasher) const
+{
+    for (size_t i = 0; i < m_shaderStages.size(); ++i)
+    {
+        if (m_shaderStages[i].stage == VK_SHADER_STAGE_FRAGMENT_BIT)
+        {
+            HashShaderStage(hasher, i);
+        }
+    }
+
+    const auto& depth = m_depthStencilState;
+    hasher.Add(m_dynamicStateEnabled);
+    if (!m_dynamicStateEnabled)
+    {
+        hasher.Add(depth.depthTestEnable).Add(depth.depthWriteEnable).Add(depth.depthCompareOp);
+    }
+    hasher.Add(depth.depthBoundsTestEnable).Add(depth.stencilTestEnable);
+    if (depth.depthBoundsTestEnable)
+    {
+        hasher.Add(depth.minDepthBounds).Add(depth.maxDepthBounds);
+    }
+    if (depth.stencilTestEnable)
+    {
+        for (const auto& op : { depth.front, depth.back })
+        {
+            hasher.Add(op.failOp).Add(op.passOp).Add(op.depthFailOp).Add(op.compareOp)
+                .Add(op.compareMask).Add(op.writeMask).Add(op.reference);
+        }
+    }
+
+    HashMultisampleState(hasher);
+    hasher.Add(m_pipelineLayout);
+    HashRenderingState(hasher, false);
+}
+
+void GraphicsPipelineBuilder::HashFragmentOutputState(Hasher& hasher) const
+{
+    const auto& blend = m_colorBlendAttachment;
+    hasher.Add(blend.blendEnable).Add(blend.colorWriteMask);
+    if (blend.blendEnable)
+    {
+        hasher.Add(blend.srcColorBlendFactor).Add(blend.dstColorBlendFactor).Add(blend.colorBlendOp)
+            .Add(blend.srcAlphaBlendFactor).Add(blend.dstAlphaBlendFactor).Add(blend.alphaBlendOp);
+    }
+
+    HashMultisampleState(hasher);
+    HashRenderingState(hasher, true);
+}
+
+void GraphicsPipelineBuilder::HashMultisampleState(Hasher& hasher) const
+{
+    const auto& multisample = m_multisampleState;
+    hasher.Add(multisample.rasterizationSamples).Add(multisample.sampleShadingEnable).Add(multisample.minSampleShading)
+        .Add(multisample.alphaToCoverageEnable).Add(multisample.alphaToOneEnable);
+}
+
+void GraphicsPipelineBuilder::HashRenderingState(Hasher& hasher, bool includeFormats) const
+{
+    hasher.Add(m_useRenderPass);
+    if (m_useRenderPass)
+    {
+        hasher.Add(m_renderPass).Add(m_subpass);
+    }
+    else if (includeFormats)
+    {
+        hasher.Add(m_colorFormat).Add(m_depthFormat);
     }
-    return pipeline;
 }
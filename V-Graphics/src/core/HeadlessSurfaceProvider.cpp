@@ -0,0 +1,21 @@
+#include "core/HeadlessSurfaceProvider.h"
+
+HeadlessSurfaceProvider::HeadlessSurfaceProvider(uint32_t width, uint32_t height)
+    :m_width(width), m_height(height)
+{
+}
+
+VkSurfaceKHR HeadlessSurfaceProvider::CreateSurface([[maybe_unused]] VkInstance instance)
+{
+    return VK_NULL_HANDLE;
+}
+
+uint32_t HeadlessSurfaceProvider::GetFramebufferWidth() const
+{
+    return m_width;
+}
+
+uint32_t HeadlessSurfaceProvider::GetFramebufferHeight() const
+{
+    return m_height;
+}
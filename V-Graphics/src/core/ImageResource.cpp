@@ -10,6 +10,7 @@ bool DepthBuffer::Initialize(VkExtent2D extent, VkFormat depthFormat)
     m_format = depthFormat;
     m_extent = extent;
     m_mipLevels = 1;
+    m_usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
 
     VkImageCreateInfo createInfo{
         .sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
@@ -20,7 +21,7 @@ bool DepthBuffer::Initialize(VkExtent2D extent, VkFormat depthFormat)
         .arrayLayers = 1,
         .samples = VK_SAMPLE_COUNT_1_BIT,
         .tiling = VK_IMAGE_TILING_OPTIMAL,
-        .usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT,
+        .usage = m_usage,
         .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
         .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
     };
@@ -30,22 +31,9 @@ bool DepthBuffer::Initialize(VkExtent2D extent, VkFormat depthFormat)
         return false;
     }
 
-    // v̎擾
-    VkMemoryRequirements memRequirements;
-    vkGetImageMemoryRequirements(device, m_image, &memRequirements);
-
+    // メモリをブロックから切り出してバインド
     VkMemoryPropertyFlags memProps = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
-    VkMemoryAllocateInfo allocInfo{
-        .sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
-        .allocationSize = memRequirements.size,
-        .memoryTypeIndex = vulkanCtx.FindMemoryType(memRequirements, memProps)
-    };
-    if (vkAllocateMemory(device, &allocInfo, nullptr, &m_memory) != VK_SUCCESS)
-    {
-        return false;
-    }
-
-    if (vkBindImageMemory(device, m_image, m_memory, 0) != VK_SUCCESS)
+    if (!vulkanCtx.GetMemoryAllocator().AllocateForImage(m_image, createInfo.tiling, memProps, m_allocation))
     {
         return false;
     }
@@ -56,7 +44,7 @@ bool DepthBuffer::Initialize(VkExtent2D extent, VkFormat depthFormat)
         .baseArrayLayer = 0, .layerCount = 1,
     };
 
-    // r[̍쐬
+    // ビューの作成
     VkImageViewCreateInfo viewCreateInfo{
         .sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
         .image = m_image,
@@ -72,23 +60,140 @@ bool DepthBuffer::Initialize(VkExtent2D extent, VkFormat depthFormat)
 }
 
 void DepthBuffer::Cleanup()
+{
+    ReleaseBindlessIndex();
+    DeferDestroyImage(m_imageView);
+    m_imageView = VK_NULL_HANDLE;
+}
+
+bool ColorBuffer::Initialize(VkExtent2D extent, VkFormat colorFormat, VkImageUsageFlags usage)
 {
     auto& vulkanCtx = VulkanContext::Get();
     auto device = vulkanCtx.GetVkDevice();
 
-    if (m_imageView != VK_NULL_HANDLE)
+    m_format = colorFormat;
+    m_extent = extent;
+    m_mipLevels = 1;
+    m_usage = usage;
+
+    VkImageCreateInfo createInfo{
+        .sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
+        .imageType = VK_IMAGE_TYPE_2D,
+        .format = m_format,
+        .extent = { extent.width, extent.height, 1 },
+        .mipLevels = 1,
+        .arrayLayers = 1,
+        .samples = VK_SAMPLE_COUNT_1_BIT,
+        .tiling = VK_IMAGE_TILING_OPTIMAL,
+        .usage = usage,
+        .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+        .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+    };
+
+    if (vkCreateImage(device, &createInfo, nullptr, &m_image) != VK_SUCCESS)
     {
-        vkDestroyImageView(device, m_imageView, nullptr);
+        return false;
     }
-    if (m_image != VK_NULL_HANDLE)
+
+    // メモリをブロックから切り出してバインド
+    VkMemoryPropertyFlags memProps = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+    if (!vulkanCtx.GetMemoryAllocator().AllocateForImage(m_image, createInfo.tiling, memProps, m_allocation))
     {
-        vkDestroyImage(device, m_image, nullptr);
+        return false;
     }
-    if (m_memory != VK_NULL_HANDLE)
+
+    m_subresourceRange = {
+        .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+        .baseMipLevel = 0, .levelCount = createInfo.mipLevels,
+        .baseArrayLayer = 0, .layerCount = 1,
+    };
+
+    // ビューの作成
+    VkImageViewCreateInfo viewCreateInfo{
+        .sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+        .image = m_image,
+        .viewType = VK_IMAGE_VIEW_TYPE_2D,
+        .format = createInfo.format,
+        .subresourceRange = m_subresourceRange,
+    };
+    if (vkCreateImageView(device, &viewCreateInfo, nullptr, &m_imageView) != VK_SUCCESS)
     {
-        vkFreeMemory(device, m_memory, nullptr);
+        return false;
     }
-    m_image = VK_NULL_HANDLE;
+    return true;
+}
+
+void ColorBuffer::Cleanup()
+{
+    ReleaseBindlessIndex();
+    DeferDestroyImage(m_imageView);
     m_imageView = VK_NULL_HANDLE;
-    m_memory = VK_NULL_HANDLE;
-}
\ No newline at end of file
+}
+
+bool TransientImage::Initialize(VkExtent2D extent, VkFormat format, VkImageUsageFlags usage, VkImageAspectFlags aspect)
+{
+    auto device = VulkanContext::Get().GetVkDevice();
+
+    m_format = format;
+    m_extent = extent;
+    m_mipLevels = 1;
+    m_usage = usage;
+
+    VkImageCreateInfo createInfo{
+        .sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
+        .imageType = VK_IMAGE_TYPE_2D,
+        .format = m_format,
+        .extent = { extent.width, extent.height, 1 },
+        .mipLevels = 1,
+        .arrayLayers = 1,
+        .samples = VK_SAMPLE_COUNT_1_BIT,
+        .tiling = VK_IMAGE_TILING_OPTIMAL,
+        .usage = usage,
+        .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+        .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+    };
+    if (vkCreateImage(device, &createInfo, nullptr, &m_image) != VK_SUCCESS)
+    {
+        return false;
+    }
+
+    m_subresourceRange = {
+        .aspectMask = aspect,
+        .baseMipLevel = 0, .levelCount = createInfo.mipLevels,
+        .baseArrayLayer = 0, .layerCount = 1,
+    };
+    return true;
+}
+
+VkMemoryRequirements TransientImage::GetMemoryRequirements() const
+{
+    VkMemoryRequirements requirements{};
+    vkGetImageMemoryRequirements(VulkanContext::Get().GetVkDevice(), m_image, &requirements);
+    return requirements;
+}
+
+bool TransientImage::BindMemory(VkDeviceMemory memory, VkDeviceSize offset)
+{
+    auto device = VulkanContext::Get().GetVkDevice();
+    if (vkBindImageMemory(device, m_image, memory, offset) != VK_SUCCESS)
+    {
+        return false;
+    }
+
+    VkImageViewCreateInfo viewCreateInfo{
+        .sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+        .image = m_image,
+        .viewType = VK_IMAGE_VIEW_TYPE_2D,
+        .format = m_format,
+        .subresourceRange = m_subresourceRange,
+    };
+    return vkCreateImageView(device, &viewCreateInfo, nullptr, &m_imageView) == VK_SUCCESS;
+}
+
+void TransientImage::Cleanup()
+{
+    //m_allocationは空のため、イメージとビューのみ破棄される
+    ReleaseBindlessIndex();
+    DeferDestroyImage(m_imageView);
+    m_imageView = VK_NULL_HANDLE;
+}
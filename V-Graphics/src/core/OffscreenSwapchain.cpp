@@ -0,0 +1,56 @@
+#include <algorithm>
+#include <stdexcept>
+
+#include "core/OffscreenSwapchain.h"
+#include "core/VulkanContext.h"
+
+/*************************************************
+public
+*************************************************/
+
+bool OffscreenSwapchain::Recreate(uint32_t width, uint32_t height)
+{
+    Cleanup();
+
+    VkExtent2D extent{ width, height };
+    const uint32_t imageCount = std::max(MinImageCount, VulkanContext::Get().GetMaxInflightFrames() + 1);
+    for (uint32_t i = 0; i < imageCount; ++i)
+    {
+        auto colorBuffer = ColorBuffer::Create(extent, ImageFormat);
+        if (!colorBuffer)
+        {
+            throw std::runtime_error("Failed to create offscreen swapchain image");
+        }
+        m_images.push_back(colorBuffer->GetVkImage());
+        m_imageViews.push_back(colorBuffer->GetVkImageView());
+        m_colorBuffers.push_back(std::move(colorBuffer));
+    }
+
+    m_imageFormat = { ImageFormat, VK_COLOR_SPACE_SRGB_NONLINEAR_KHR };
+    m_imageExtent = extent;
+    m_currentIndex = 0;
+    m_acquireCount = 0;
+    return true;
+}
+
+void OffscreenSwapchain::Cleanup()
+{
+    //イメージビューはColorBuffer側で破棄されるため、参照を外すだけでよい
+    m_images.clear();
+    m_imageViews.clear();
+    m_colorBuffers.clear();
+}
+
+VkResult OffscreenSwapchain::AcquireNextImage()
+{
+    //Presentエンジンを介さないため、待機なしで次のイメージへ進める
+    //イメージの再利用は呼び出し側のフレームフェンスで保護される
+    m_currentIndex = uint32_t(m_acquireCount % m_images.size());
+    ++m_acquireCount;
+    return VK_SUCCESS;
+}
+
+VkResult OffscreenSwapchain::QueuePresent(VkQueue queuePresent)
+{
+    return VK_SUCCESS;
+}
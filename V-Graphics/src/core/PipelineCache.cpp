@@ -0,0 +1,242 @@
+#include <cstring>
+#include <fstream>
+#include <mutex>
+
+#include "core/PipelineCache.h"
+#include "core/WorkerThreadPool.h"
+
+/*************************************************
+public
+*************************************************/
+
+bool PipelineCache::Initialize(VkDevice device, const VkPhysicalDeviceProperties& properties, const std::filesystem::path& filePath)
+{
+    m_device = device;
+    m_filePath = filePath;
+    m_vendorID = properties.vendorID;
+    m_deviceID = properties.deviceID;
+    std::memcpy(m_cacheUUID, properties.pipelineCacheUUID, VK_UUID_SIZE);
+
+    auto initialData = LoadFile();
+    VkPipelineCacheCreateInfo cacheCI{
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO,
+        .initialDataSize = initialData.size(),
+        .pInitialData = initialData.empty() ? nullptr : initialData.data(),
+    };
+    auto result = vkCreatePipelineCache(m_device, &cacheCI, nullptr, &m_cache);
+    if (result != VK_SUCCESS && !initialData.empty())
+    {
+        //ヘッダーが一致してもドライバーが受け付けないデータであれば、空のキャッシュで作り直す
+        cacheCI.initialDataSize = 0;
+        cacheCI.pInitialData = nullptr;
+        initialData.clear();
+        result = vkCreatePipelineCache(m_device, &cacheCI, nullptr, &m_cache);
+    }
+    m_loadedFromFile = result == VK_SUCCESS && !initialData.empty();
+    return result == VK_SUCCESS;
+}
+
+void PipelineCache::Cleanup()
+{
+    if (m_cache == VK_NULL_HANDLE)
+    {
+        return;
+    }
+    Save();
+    for (auto& [threadIndex, workerCache] : m_workerCaches)
+    {
+        vkDestroyPipelineCache(m_device, workerCache, nullptr);
+    }
+    m_workerCaches.clear();
+    vkDestroyPipelineCache(m_device, m_cache, nullptr);
+    m_cache = VK_NULL_HANDLE;
+    m_loadedFromFile = false;
+}
+
+bool PipelineCache::Save()
+{
+    if (m_cache == VK_NULL_HANDLE || m_filePath.empty())
+    {
+        return false;
+    }
+
+    MergeWorkerCaches();
+    auto data = GetData();
+    if (data.empty())
+    {
+        return false;
+    }
+
+    std::error_code ec;
+    if (m_filePath.has_parent_path())
+    {
+        std::filesystem::create_directories(m_filePath.parent_path(), ec);
+    }
+
+    auto tempPath = m_filePath;
+    tempPath += ".tmp";
+    {
+        std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+        if (!file.write(data.data(), std::streamsize(data.size())))
+        {
+            return false;
+        }
+    }
+    std::filesystem::rename(tempPath, m_filePath, ec);
+    if (ec)
+    {
+        std::filesystem::remove(tempPath, ec);
+        return false;
+    }
+    return true;
+}
+
+VkResult PipelineCache::CreateGraphicsPipelines(uint32_t count, const VkGraphicsPipelineCreateInfo* createInfos, VkPipeline* pipelines)
+{
+    VkPipelineCache workerCache = GetWorkerCache();
+    if (workerCache == VK_NULL_HANDLE)
+    {
+        std::shared_lock lock(m_mutex);
+        return vkCreateGraphicsPipelines(m_device, m_cache, count, createInfos, nullptr, pipelines);
+    }
+
+    //本体(ファイルから読み込んだ分を含む)にあるものはコンパイルせずに作成する
+    std::vector<VkGraphicsPipelineCreateInfo> cachedInfos(createInfos, createInfos + count);
+    for (auto& info : cachedInfos)
+    {
+        info.flags |= VK_PIPELINE_CREATE_FAIL_ON_PIPELINE_COMPILE_REQUIRED_BIT;
+    }
+    VkResult result;
+    {
+        std::shared_lock lock(m_mutex);
+        result = vkCreateGraphicsPipelines(m_device, m_cache, count, cachedInfos.data(), nullptr, pipelines);
+    }
+    if (result != VK_PIPELINE_COMPILE_REQUIRED)
+    {
+        return result;
+    }
+
+    //コンパイルが必要なものだけをスレッドのキャッシュで作成する。本体のロックは取らず、新しい内容だけがそちらに入る
+    std::vector<VkGraphicsPipelineCreateInfo> compileInfos;
+    std::vector<uint32_t> compileIndices;
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        if (pipelines[i] == VK_NULL_HANDLE)
+        {
+            compileInfos.push_back(createInfos[i]);
+            compileIndices.push_back(i);
+        }
+    }
+    std::vector<VkPipeline> compiled(compileInfos.size(), VK_NULL_HANDLE);
+    result = vkCreateGraphicsPipelines(m_device, workerCache, uint32_t(compileInfos.size()), compileInfos.data(), nullptr, compiled.data());
+    for (size_t i = 0; i < compiled.size(); ++i)
+    {
+        pipelines[compileIndices[i]] = compiled[i];
+    }
+    return result;
+}
+
+/*************************************************
+private
+*************************************************/
+
+std::vector<char> PipelineCache::LoadFile() const
+{
+    if (m_filePath.empty())
+    {
+        return {};
+    }
+    std::ifstream file(m_filePath, std::ios::binary | std::ios::ate);
+    if (!file)
+    {
+        return {};
+    }
+    std::vector<char> data(size_t(file.tellg()));
+    file.seekg(0);
+    if (!file.read(data.data(), std::streamsize(data.size())) || !IsCompatible(data))
+    {
+        return {};
+    }
+    return data;
+}
+
+VkPipelineCache PipelineCache::GetWorkerCache()
+{
+    const uint32_t threadIndex = WorkerThreadPool::GetCurrentThreadIndex();
+    if (threadIndex == 0)
+    {
+        return VK_NULL_HANDLE;
+    }
+    {
+        std::shared_lock lock(m_mutex);
+        auto it = m_workerCaches.find(threadIndex);
+        if (it != m_workerCaches.end())
+        {
+            return it->second;
+        }
+    }
+
+    //同じ番号のスレッドは同時に1つしかないため、作成は他のスレッドと競合しない
+    //Saveが作成中にも統合できるよう、ドライバー内部の同期は省かせない
+    VkPipelineCacheCreateInfo cacheCI{
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO,
+    };
+    VkPipelineCache cache = VK_NULL_HANDLE;
+    if (vkCreatePipelineCache(m_device, &cacheCI, nullptr, &cache) != VK_SUCCESS)
+    {
+        return VK_NULL_HANDLE;
+    }
+    std::unique_lock lock(m_mutex);
+    m_workerCaches.emplace(threadIndex, cache);
+    return cache;
+}
+
+void PipelineCache::MergeWorkerCaches()
+{
+    //ワーカーが使用中の場合もあるため破棄はしない(Cleanupまで保持する)
+    //スレッドのキャッシュにはコンパイルしたものしか入らないため、統合するのはこのセッションで新しく作った内容のみ
+    std::unique_lock lock(m_mutex);
+    std::vector<VkPipelineCache> workerCaches;
+    for (auto& [threadIndex, workerCache] : m_workerCaches)
+    {
+        workerCaches.push_back(workerCache);
+    }
+    if (!workerCaches.empty())
+    {
+        vkMergePipelineCaches(m_device, m_cache, uint32_t(workerCaches.size()), workerCaches.data());
+    }
+}
+
+std::vector<char> PipelineCache::GetData()
+{
+    std::shared_lock lock(m_mutex);
+    size_t dataSize = 0;
+    if (vkGetPipelineCacheData(m_device, m_cache, &dataSize, nullptr) != VK_SUCCESS || dataSize == 0)
+    {
+        return {};
+    }
+    std::vector<char> data(dataSize);
+    if (vkGetPipelineCacheData(m_device, m_cache, &dataSize, data.data()) != VK_SUCCESS)
+    {
+        return {};
+    }
+    data.resize(dataSize);
+    return data;
+}
+
+bool PipelineCache::IsCompatible(const std::vector<char>& data) const
+{
+    //ドライバーの更新やGPUの交換で互換性のなくなったデータは渡さない
+    VkPipelineCacheHeaderVersionOne header{};
+    if (data.size() < sizeof(header))
+    {
+        return false;
+    }
+    std::memcpy(&header, data.data(), sizeof(header));
+    return header.headerSize >= sizeof(header) &&
+        header.headerSize <= data.size() &&
+        header.headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE &&
+        header.vendorID == m_vendorID &&
+        header.deviceID == m_deviceID &&
+        std::memcmp(header.pipelineCacheUUID, m_cacheUUID, VK_UUID_SIZE) == 0;
+}
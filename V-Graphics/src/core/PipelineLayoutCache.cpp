@@ -0,0 +1,230 @@
+#include <algorithm>
+#include <stdexcept>
+
+#include "core/PipelineLayoutCache.h"
+#include "core/ShaderReflection.h"
+#include "core/Hash.h"
+
+namespace
+{
+    //pImmutableSamplersは有無のみ比べる(サンプラーは別に比べる)
+    bool IsSameBinding(const VkDescriptorSetLayoutBinding& a, const VkDescriptorSetLayoutBinding& b)
+    {
+        return a.binding == b.binding && a.descriptorType == b.descriptorType &&
+            a.descriptorCount == b.descriptorCount && a.stageFlags == b.stageFlags &&
+            (a.pImmutableSamplers != nullptr) == (b.pImmutableSamplers != nullptr);
+    }
+
+    bool IsSameRange(const VkPushConstantRange& a, const VkPushConstantRange& b)
+    {
+        return a.stageFlags == b.stageFlags && a.offset == b.offset && a.size == b.size;
+    }
+
+    //シェーダーが宣言したbindingを登録済みのbindingで賄えるか
+    //実行時の大きさの配列(リフレクションでは数が0)に限る。通常のbindingは登録したレイアウトのプールの制約を受けないよう、置き換えない
+    bool IsCoveredBinding(const VkDescriptorSetLayoutBinding& binding, const VkDescriptorSetLayoutBinding& registered)
+    {
+        return binding.binding == registered.binding && binding.descriptorType == registered.descriptorType &&
+            binding.descriptorCount == 0 &&
+            (binding.stageFlags & ~registered.stageFlags) == 0 &&
+            binding.pImmutableSamplers == nullptr;
+    }
+}
+
+/*************************************************
+public
+*************************************************/
+
+void PipelineLayoutCache::Initialize(VkDevice device)
+{
+    m_device = device;
+    m_hits = 0;
+    m_misses = 0;
+}
+
+void PipelineLayoutCache::Cleanup()
+{
+    std::lock_guard lock(m_mutex);
+    for (auto& [key, entry] : m_pipelineLayouts)
+    {
+        vkDestroyPipelineLayout(m_device, entry.pipelineLayout, nullptr);
+    }
+    for (auto& [key, entry] : m_setLayouts)
+    {
+        vkDestroyDescriptorSetLayout(m_device, entry.setLayout, nullptr);
+    }
+    m_pipelineLayouts.clear();
+    m_setLayouts.clear();
+    m_registeredSetLayouts.clear();
+}
+
+VkDescriptorSetLayout PipelineLayoutCache::AcquireSetLayout(std::span<const VkDescriptorSetLayoutBinding> bindings)
+{
+    std::vector<VkDescriptorSetLayoutBinding> sorted(bindings.begin(), bindings.end());
+    std::sort(sorted.begin(), sorted.end(), [](const VkDescriptorSetLayoutBinding& a, const VkDescriptorSetLayoutBinding& b)
+    {
+        return a.binding < b.binding;
+    });
+
+    Hasher hasher;
+    std::vector<VkSampler> immutableSamplers;
+    hasher.Add(sorted.size());
+    for (const auto& binding : sorted)
+    {
+        hasher.Add(binding.binding).Add(binding.descriptorType).Add(binding.descriptorCount).Add(binding.stageFlags);
+        hasher.Add(binding.pImmutableSamplers != nullptr);
+        if (binding.pImmutableSamplers != nullptr)
+        {
+            for (uint32_t i = 0; i < binding.descriptorCount; ++i)
+            {
+                hasher.Add(binding.pImmutableSamplers[i]);
+                immutableSamplers.push_back(binding.pImmutableSamplers[i]);
+            }
+        }
+    }
+    uint64_t key = hasher.Get();
+
+    std::lock_guard lock(m_mutex);
+    //ハッシュが衝突した場合は、内容が一致するものか空いているキーまで進める
+    for (auto it = m_setLayouts.find(key); it != m_setLayouts.end(); it = m_setLayouts.find(++key))
+    {
+        const auto& entry = it->second;
+        if (std::ranges::equal(entry.bindings, sorted, IsSameBinding) && entry.immutableSamplers == immutableSamplers)
+        {
+            ++m_hits;
+            return entry.setLayout;
+        }
+    }
+
+    ++m_misses;
+    VkDescriptorSetLayoutCreateInfo layoutInfo{
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+        .bindingCount = uint32_t(sorted.size()),
+        .pBindings = sorted.data(),
+    };
+    VkDescriptorSetLayout setLayout = VK_NULL_HANDLE;
+    if (vkCreateDescriptorSetLayout(m_device, &layoutInfo, nullptr, &setLayout) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create descriptor set layout!");
+    }
+    m_setLayouts.emplace(key, SetLayoutEntry{
+        .setLayout = setLayout,
+        .bindings = std::move(sorted),
+        .immutableSamplers = std::move(immutableSamplers),
+    });
+    return setLayout;
+}
+
+VkPipelineLayout PipelineLayoutCache::AcquirePipelineLayout(std::span<const VkDescriptorSetLayout> setLayouts,
+    std::span<const VkPushConstantRange> pushConstantRanges)
+{
+    //セットレイアウトはこのキャッシュで共有されるため、ハンドルで比べれば内容で比べたことになる
+    Hasher hasher;
+    hasher.Add(setLayouts.size());
+    for (auto setLayout : setLayouts)
+    {
+        hasher.Add(setLayout);
+    }
+    hasher.Add(pushConstantRanges.size());
+    for (const auto& range : pushConstantRanges)
+    {
+        hasher.Add(range.stageFlags).Add(range.offset).Add(range.size);
+    }
+    uint64_t key = hasher.Get();
+
+    std::lock_guard lock(m_mutex);
+    for (auto it = m_pipelineLayouts.find(key); it != m_pipelineLayouts.end(); it = m_pipelineLayouts.find(++key))
+    {
+        const auto& entry = it->second;
+        if (std::ranges::equal(entry.setLayouts, setLayouts) &&
+            std::ranges::equal(entry.pushConstantRanges, pushConstantRanges, IsSameRange))
+        {
+            ++m_hits;
+            return entry.pipelineLayout;
+        }
+    }
+
+    ++m_misses;
+    VkPipelineLayoutCreateInfo layoutInfo{
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+        .setLayoutCount = uint32_t(setLayouts.size()),
+        .pSetLayouts = setLayouts.data(),
+        .pushConstantRangeCount = uint32_t(pushConstantRanges.size()),
+        .pPushConstantRanges = pushConstantRanges.data(),
+    };
+    VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
+    if (vkCreatePipelineLayout(m_device, &layoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create pipeline layout!");
+    }
+    m_pipelineLayouts.emplace(key, PipelineLayoutEntry{
+        .pipelineLayout = pipelineLayout,
+        .setLayouts = { setLayouts.begin(), setLayouts.end() },
+        .pushConstantRanges = { pushConstantRanges.begin(), pushConstantRanges.end() },
+    });
+    return pipelineLayout;
+}
+
+PipelineLayoutCache::Layout PipelineLayoutCache::Acquire(const PipelineReflection& reflection)
+{
+    Layout layout;
+    for (uint32_t set = 0; set < reflection.GetSetCount(); ++set)
+    {
+        auto bindings = reflection.GetSetLayoutBindings(set);
+        VkDescriptorSetLayout setLayout = FindRegisteredSetLayout(bindings);
+        layout.setLayouts.push_back(setLayout != VK_NULL_HANDLE ? setLayout : AcquireSetLayout(bindings));
+    }
+    layout.pipelineLayout = AcquirePipelineLayout(layout.setLayouts, reflection.GetPushConstantRanges());
+    return layout;
+}
+
+void PipelineLayoutCache::RegisterSetLayout(VkDescriptorSetLayout setLayout, std::span<const VkDescriptorSetLayoutBinding> bindings)
+{
+    std::lock_guard lock(m_mutex);
+    m_registeredSetLayouts.push_back(SetLayoutEntry{
+        .setLayout = setLayout,
+        .bindings = { bindings.begin(), bindings.end() },
+    });
+}
+
+PipelineLayoutCache::Stats PipelineLayoutCache::GetStats() const
+{
+    std::lock_guard lock(m_mutex);
+    return Stats{
+        .hits = m_hits,
+        .misses = m_misses,
+        .setLayoutCount = uint32_t(m_setLayouts.size()),
+        .pipelineLayoutCount = uint32_t(m_pipelineLayouts.size()),
+    };
+}
+
+/*************************************************
+private
+*************************************************/
+
+VkDescriptorSetLayout PipelineLayoutCache::FindRegisteredSetLayout(std::span<const VkDescriptorSetLayoutBinding> bindings)
+{
+    //使われていないset番号の空のレイアウトは通常のキャッシュで共有する
+    if (bindings.empty())
+    {
+        return VK_NULL_HANDLE;
+    }
+
+    std::lock_guard lock(m_mutex);
+    for (const auto& entry : m_registeredSetLayouts)
+    {
+        const bool covered = std::ranges::all_of(bindings, [&entry](const VkDescriptorSetLayoutBinding& binding)
+        {
+            return std::ranges::any_of(entry.bindings, [&binding](const VkDescriptorSetLayoutBinding& registered)
+            {
+                return IsCoveredBinding(binding, registered);
+            });
+        });
+        if (covered)
+        {
+            ++m_hits;
+            return entry.setLayout;
+        }
+    }
+    return VK_NULL_HANDLE;
+}
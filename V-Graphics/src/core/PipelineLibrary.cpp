@@ -0,0 +1,145 @@
+#include <iterator>
+
+#include "core/PipelineLibrary.h"
+#include "core/GraphicsPipelineBuilder.h"
+#include "core/VulkanContext.h"
+
+/*************************************************
+public
+*************************************************/
+
+void PipelineLibrary::Initialize(VkDevice device, bool supported)
+{
+    m_device = device;
+    m_supported = supported;
+}
+
+void PipelineLibrary::Cleanup()
+{
+    std::lock_guard lock(m_mutex);
+    for (auto& [key, part] : m_parts)
+    {
+        vkDestroyPipeline(m_device, part.library, nullptr);
+    }
+    m_parts.clear();
+}
+
+VkPipeline PipelineLibrary::Link(const GraphicsPipelineBuilder& builder, bool optimize)
+{
+    if (!m_supported)
+    {
+        return builder.Build();
+    }
+
+    const VkGraphicsPipelineLibraryFlagBitsEXT parts[] = {
+        VK_GRAPHICS_PIPELINE_LIBRARY_VERTEX_INPUT_INTERFACE_BIT_EXT,
+        VK_GRAPHICS_PIPELINE_LIBRARY_PRE_RASTERIZATION_SHADERS_BIT_EXT,
+        VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_SHADER_BIT_EXT,
+        VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_OUTPUT_INTERFACE_BIT_EXT,
+    };
+    VkPipeline libraries[std::size(parts)]{};
+    for (size_t i = 0; i < std::size(parts); ++i)
+    {
+        libraries[i] = GetOrCreatePart(builder, parts[i]);
+        if (libraries[i] == VK_NULL_HANDLE)
+        {
+            return VK_NULL_HANDLE;
+        }
+    }
+
+    VkPipelineLibraryCreateInfoKHR libraryInfo{
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_LIBRARY_CREATE_INFO_KHR,
+        .libraryCount = uint32_t(std::size(libraries)),
+        .pLibraries = libraries,
+    };
+    VkGraphicsPipelineCreateInfo pipelineInfo{
+        .sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO,
+        .pNext = &libraryInfo,
+        .flags = optimize ? VkPipelineCreateFlags(VK_PIPELINE_CREATE_LINK_TIME_OPTIMIZATION_BIT_EXT) : 0u,
+        .layout = builder.GetPipelineLayout(),
+    };
+
+    VkPipeline pipeline = VK_NULL_HANDLE;
+    if (VulkanContext::Get().GetPipelineCache().CreateGraphicsPipelines(1, &pipelineInfo, &pipeline) != VK_SUCCESS)
+    {
+        return VK_NULL_HANDLE;
+    }
+    if (optimize)
+    {
+        ++m_optimizedCount;
+    }
+    else
+    {
+        ++m_linkCount;
+    }
+    return pipeline;
+}
+
+PipelineLibrary::Stats PipelineLibrary::GetStats() const
+{
+    std::lock_guard lock(m_mutex);
+    return Stats{
+        .partHits = m_partHits,
+        .partMisses = m_partMisses,
+        .linkCount = m_linkCount,
+        .optimizedCount = m_optimizedCount,
+        .libraryCount = uint32_t(m_parts.size()),
+    };
+}
+
+/*************************************************
+private
+*************************************************/
+
+VkPipeline PipelineLibrary::GetOrCreatePart(const GraphicsPipelineBuilder& builder, VkGraphicsPipelineLibraryFlagBitsEXT part)
+{
+    std::vector<uint8_t> state;
+    const uint64_t key = builder.GetLibraryStateHash(part, &state);
+    {
+        std::lock_guard lock(m_mutex);
+        auto it = FindPart(key, state);
+        if (it != m_parts.end())
+        {
+            ++m_partHits;
+            return it->second.library;
+        }
+    }
+
+    ++m_partMisses;
+    GraphicsPipelineBuilder::CreateInfo createInfo;
+    builder.WriteLibraryCreateInfo(createInfo, part);
+    VkPipeline library = VK_NULL_HANDLE;
+    if (VulkanContext::Get().GetPipelineCache().CreateGraphicsPipelines(1, &createInfo.pipeline, &library) != VK_SUCCESS)
+    {
+        return VK_NULL_HANDLE;
+    }
+
+    std::lock_guard lock(m_mutex);
+    auto it = FindPart(key, state);
+    if (it != m_parts.end())
+    {
+        //他スレッドが先に同じ部分を作成していた
+        vkDestroyPipeline(m_device, library, nullptr);
+        return it->second.library;
+    }
+
+    //衝突したものがあれば、空いているキーに登録する
+    uint64_t freeKey = key;
+    while (m_parts.contains(freeKey))
+    {
+        ++freeKey;
+    }
+    m_parts.emplace(freeKey, Part{ .library = library, .state = std::move(state) });
+    return library;
+}
+
+std::unordered_map<uint64_t, PipelineLibrary::Part>::iterator PipelineLibrary::FindPart(uint64_t key, const std::vector<uint8_t>& state)
+{
+    //ハッシュが衝突した場合は、ステートが一致するものか空いているキーまで進める
+    auto it = m_parts.find(key);
+    while (it != m_parts.end() && it->second.state != state)
+    {
+        it = m_parts.find(++key);
+    }
+    return it;
+}
@@ -0,0 +1,325 @@
+#include <algorithm>
+#include <memory>
+
+#include "core/PipelineRegistry.h"
+#include "core/VulkanContext.h"
+
+/*************************************************
+public
+*************************************************/
+
+void PipelineRegistry::Initialize(VkDevice device)
+{
+    m_device = device;
+    m_hits = 0;
+    m_misses = 0;
+}
+
+void PipelineRegistry::Cleanup()
+{
+    std::lock_guard lock(m_mutex);
+    for (auto& [key, entry] : m_entries)
+    {
+        vkDestroyPipeline(m_device, entry.future.get(), nullptr);
+        vkDestroyPipeline(m_device, entry.optimized->load(), nullptr);
+    }
+    m_entries.clear();
+    m_keys.clear();
+}
+
+VkPipeline PipelineRegistry::Acquire(const GraphicsPipelineBuilder& builder)
+{
+    std::vector<PendingBuild> pendingBuilds;
+    auto handle = Lookup(builder, pendingBuilds);
+
+    //コンパイルは重いため、他スレッドの検索を止めないようロックの外で作成する
+    for (auto& pendingBuild : pendingBuilds)
+    {
+        Complete(pendingBuild, builder.Build());
+    }
+    return handle.Wait();
+}
+
+PipelineHandle PipelineRegistry::AcquireAsync(const GraphicsPipelineBuilder& builder)
+{
+    std::vector<PendingBuild> pendingBuilds;
+    auto handle = Lookup(builder, pendingBuilds);
+    if (pendingBuilds.empty())
+    {
+        return handle;
+    }
+
+    //std::functionはコピー可能である必要があるため、promiseはshared_ptrで持たせる
+    auto pendingBuild = std::make_shared<PendingBuild>(std::move(pendingBuilds.front()));
+    VulkanContext::Get().GetWorkerThreadPool().Enqueue([this, builder, pendingBuild]()
+    {
+        //コンパイル結果はワーカースレッドのキャッシュに入る(PipelineCache::CreateGraphicsPipelines)
+        Complete(*pendingBuild, builder.Build());
+    });
+    return handle;
+}
+
+std::vector<PipelineHandle> PipelineRegistry::AcquireBatch(const std::vector<GraphicsPipelineBuilder>& builders)
+{
+    std::vector<PipelineHandle> handles(builders.size());
+    std::vector<PendingBuild> pendingBuilds;
+    std::vector<size_t> pendingIndices;
+    for (size_t i = 0; i < builders.size(); ++i)
+    {
+        //バッチ内で重複するステートは、先に登録した作成待ちを共有する
+        const size_t pendingCount = pendingBuilds.size();
+        handles[i] = Lookup(builders[i], pendingBuilds);
+        if (pendingBuilds.size() != pendingCount)
+        {
+            pendingIndices.push_back(i);
+        }
+    }
+    if (pendingBuilds.empty())
+    {
+        return handles;
+    }
+
+    //ワーカー毎に1回の作成呼び出しにまとめる
+    struct Batch
+    {
+        std::vector<GraphicsPipelineBuilder> builders;
+        std::vector<PendingBuild> pendingBuilds;
+    };
+    auto& workerThreadPool = VulkanContext::Get().GetWorkerThreadPool();
+    const size_t batchCount = std::min<size_t>(std::max(workerThreadPool.GetThreadCount(), 1u), pendingBuilds.size());
+    const size_t batchSize = (pendingBuilds.size() + batchCount - 1) / batchCount;
+    for (size_t begin = 0; begin < pendingBuilds.size(); begin += batchSize)
+    {
+        const size_t end = std::min(begin + batchSize, pendingBuilds.size());
+        auto batch = std::make_shared<Batch>();
+        for (size_t i = begin; i < end; ++i)
+        {
+            batch->builders.push_back(builders[pendingIndices[i]]);
+            batch->pendingBuilds.push_back(std::move(pendingBuilds[i]));
+        }
+
+        workerThreadPool.Enqueue([this, batch]()
+        {
+            const uint32_t count = uint32_t(batch->builders.size());
+            std::vector<const GraphicsPipelineBuilder*> builderPtrs;
+            for (const auto& builder : batch->builders)
+            {
+                builderPtrs.push_back(&builder);
+            }
+            std::vector<VkPipeline> pipelines(count, VK_NULL_HANDLE);
+            if (GraphicsPipelineBuilder::BuildBatch(builderPtrs.data(), count, pipelines.data()) != VK_SUCCESS)
+            {
+                //1つの失敗で全てを失わないよう、個別に作り直す
+                for (uint32_t i = 0; i < count; ++i)
+                {
+                    pipelines[i] = batch->builders[i].Build();
+                }
+            }
+            for (uint32_t i = 0; i < count; ++i)
+            {
+                Complete(batch->pendingBuilds[i], pipelines[i]);
+            }
+        });
+    }
+    return handles;
+}
+
+PipelineHandle PipelineRegistry::AcquireFastLinked(const GraphicsPipelineBuilder& builder, bool optimizeInBackground)
+{
+    auto& pipelineLibrary = VulkanContext::Get().GetPipelineLibrary();
+    if (!pipelineLibrary.IsSupported())
+    {
+        return AcquireAsync(builder);
+    }
+
+    std::vector<PendingBuild> pendingBuilds;
+    auto handle = Lookup(builder, pendingBuilds);
+    if (pendingBuilds.empty())
+    {
+        return handle;
+    }
+
+    const uint64_t key = pendingBuilds.front().key;
+    const uint64_t id = pendingBuilds.front().id;
+    auto shaderModules = pendingBuilds.front().shaderModules;
+    VkPipeline pipeline = pipelineLibrary.Link(builder);
+    Complete(pendingBuilds.front(), pipeline);
+    if (pipeline != VK_NULL_HANDLE && optimizeInBackground)
+    {
+        //最適化が終わるまで、登録が外れてもモジュールの参照を持っておく
+        VulkanContext::Get().GetWorkerThreadPool().Enqueue([this, builder, key, id, shaderModules]()
+        {
+            CompleteOptimized(key, id, VulkanContext::Get().GetPipelineLibrary().Link(builder, true));
+        });
+    }
+    return handle;
+}
+
+void PipelineRegistry::Release(VkPipeline pipeline)
+{
+    if (pipeline == VK_NULL_HANDLE)
+    {
+        return;
+    }
+
+    std::lock_guard lock(m_mutex);
+    auto key = m_keys.find(pipeline);
+    if (key != m_keys.end())
+    {
+        ReleaseEntry(m_entries.find(key->second));
+    }
+}
+
+void PipelineRegistry::Release(const PipelineHandle& handle)
+{
+    if (!handle.IsValid())
+    {
+        return;
+    }
+
+    std::lock_guard lock(m_mutex);
+    auto it = m_entries.find(handle.m_key);
+    if (it != m_entries.end() && it->second.id == handle.m_id)
+    {
+        ReleaseEntry(it);
+    }
+}
+
+PipelineRegistry::Stats PipelineRegistry::GetStats() const
+{
+    std::lock_guard lock(m_mutex);
+    uint32_t pendingCount = 0;
+    for (const auto& [key, entry] : m_entries)
+    {
+        if (entry.future.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+        {
+            ++pendingCount;
+        }
+    }
+    return Stats{
+        .hits = m_hits,
+        .misses = m_misses,
+        .pipelineCount = uint32_t(m_entries.size()) - pendingCount,
+        .pendingCount = pendingCount,
+    };
+}
+
+/*************************************************
+private
+*************************************************/
+
+PipelineHandle PipelineRegistry::Lookup(const GraphicsPipelineBuilder& builder, std::vector<PendingBuild>& pendingBuilds)
+{
+    std::vector<uint8_t> state;
+    uint64_t key = builder.GetStateHash(&state);
+
+    std::lock_guard lock(m_mutex);
+    //ハッシュが衝突した場合は、ステートが一致するものか空いているキーまで進める
+    auto it = m_entries.find(key);
+    while (it != m_entries.end() && it->second.state != state)
+    {
+        it = m_entries.find(++key);
+    }
+    if (it != m_entries.end())
+    {
+        ++m_hits;
+    }
+    else
+    {
+        //作成中も登録しておき、同じステートの要求には同じ完了を待たせる
+        ++m_misses;
+        PendingBuild pendingBuild{
+            .key = key,
+            .id = ++m_nextId,
+            .shaderModules = VulkanContext::Get().GetShaderModuleCache().Retain(builder.GetShaderModules()),
+        };
+        it = m_entries.emplace(key, Entry{
+            .future = pendingBuild.promise.get_future().share(),
+            .optimized = std::make_shared<std::atomic<VkPipeline>>(VK_NULL_HANDLE),
+            .id = pendingBuild.id,
+            .state = std::move(state),
+            .shaderModules = pendingBuild.shaderModules,
+        }).first;
+        pendingBuilds.push_back(std::move(pendingBuild));
+    }
+
+    ++it->second.refCount;
+    PipelineHandle handle;
+    handle.m_key = key;
+    handle.m_id = it->second.id;
+    handle.m_future = it->second.future;
+    handle.m_optimized = it->second.optimized;
+    return handle;
+}
+
+void PipelineRegistry::Complete(PendingBuild& pendingBuild, VkPipeline pipeline)
+{
+    //ReleaseEntryが完了済みかを正しく判断できるよう、登録の更新と通知はロック内でまとめて行う
+    std::lock_guard lock(m_mutex);
+    auto it = m_entries.find(pendingBuild.key);
+    const bool isRegistered = it != m_entries.end() && it->second.id == pendingBuild.id;
+    if (!isRegistered)
+    {
+        //作成中に全ての参照が手放された。まだどのコマンドも参照していないため直ちに破棄する
+        vkDestroyPipeline(m_device, pipeline, nullptr);
+        pipeline = VK_NULL_HANDLE;
+    }
+    else if (pipeline == VK_NULL_HANDLE)
+    {
+        //失敗したステートは登録から外し、次の要求で作成し直す
+        m_entries.erase(it);
+    }
+    else
+    {
+        m_keys[pipeline] = pendingBuild.key;
+    }
+    pendingBuild.promise.set_value(pipeline);
+}
+
+void PipelineRegistry::CompleteOptimized(uint64_t key, uint64_t id, VkPipeline pipeline)
+{
+    if (pipeline == VK_NULL_HANDLE)
+    {
+        return;
+    }
+
+    std::lock_guard lock(m_mutex);
+    auto it = m_entries.find(key);
+    if (it == m_entries.end() || it->second.id != id)
+    {
+        //最適化中に全ての参照が手放された
+        vkDestroyPipeline(m_device, pipeline, nullptr);
+        return;
+    }
+    //リンクしただけのものは記録済みのコマンドが参照しうるため、登録の解放時まで残す
+    it->second.optimized->store(pipeline);
+    m_keys[pipeline] = key;
+}
+
+void PipelineRegistry::ReleaseEntry(std::unordered_map<uint64_t, Entry>::iterator it)
+{
+    if (--it->second.refCount > 0)
+    {
+        return;
+    }
+
+    //作成中であれば、作成の完了時(Complete)に破棄される
+    auto future = it->second.future;
+    VkPipeline optimized = it->second.optimized->load();
+    m_entries.erase(it);
+    if (future.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+    {
+        return;
+    }
+
+    VkPipeline pipeline = future.get();
+    m_keys.erase(pipeline);
+    m_keys.erase(optimized);
+
+    //処理中のフレームが参照している可能性があるため、完了後に破棄する
+    VulkanContext::Get().DeferDestroy([device = m_device, pipeline, optimized]()
+    {
+        vkDestroyPipeline(device, pipeline, nullptr);
+        vkDestroyPipeline(device, optimized, nullptr);
+    });
+}
@@ -0,0 +1,616 @@
+#include <algorithm>
+#include <stdexcept>
+
+#include "core/RenderGraph.h"
+#include "core/BufferResource.h"
+#include "core/Hash.h"
+
+namespace
+{
+    //状態を追跡していないイメージを、Execute中だけCommandBufferの追跡に載せるためのラッパー
+    class ExternalImage final : public IImageResource
+    {
+    public:
+        ExternalImage(VkImage image, VkImageView imageView, VkFormat format, VkExtent2D extent,
+            VkImageAspectFlags aspect, const RenderGraph::ResourceState& state)
+            : m_image(image), m_imageView(imageView), m_format(format), m_extent(extent),
+            m_layout(state.layout), m_stageFlags(state.stage), m_accessFlags(state.access)
+        {
+            m_subresourceRange = {
+                .aspectMask = aspect,
+                .baseMipLevel = 0, .levelCount = 1,
+                .baseArrayLayer = 0, .layerCount = 1,
+            };
+        }
+
+        VkFormat GetFormat() const override { return m_format; }
+        VkExtent2D GetExtent() const override { return m_extent; }
+        uint32_t GetMipmapCount() const override { return 1; }
+
+        VkImage GetVkImage() const override { return m_image; }
+        VkImageView GetVkImageView() const override { return m_imageView; }
+        VkImageSubresourceRange GetSubresourceRange() const override { return m_subresourceRange; }
+
+        void SetAccessFlag(const VkAccessFlags2 flags) override { m_accessFlags = flags; }
+        VkAccessFlags2 GetAccessFlags() const override { return m_accessFlags; }
+        void SetStageFlags(const VkPipelineStageFlags2 flags) override { m_stageFlags = flags; }
+        VkPipelineStageFlags2 GetStageFlags() const override { return m_stageFlags; }
+
+        void SetLayout(VkImageLayout layout) override { m_layout = layout; }
+        VkImageLayout GetLayout() const override { return m_layout; }
+
+        uint32_t GetBindlessIndex() override { return BindlessHeap::InvalidIndex; }
+
+    private:
+        VkImage m_image;
+        VkImageView m_imageView;
+        VkFormat m_format;
+        VkExtent2D m_extent;
+        VkImageSubresourceRange m_subresourceRange{};
+        VkImageLayout m_layout;
+        VkPipelineStageFlags2 m_stageFlags;
+        VkAccessFlags2 m_accessFlags;
+    };
+
+    VkImageAspectFlags GetAspectFlags(VkFormat format)
+    {
+        switch (format)
+        {
+        case VK_FORMAT_D16_UNORM:
+        case VK_FORMAT_X8_D24_UNORM_PACK32:
+        case VK_FORMAT_D32_SFLOAT:
+            return VK_IMAGE_ASPECT_DEPTH_BIT;
+        case VK_FORMAT_D16_UNORM_S8_UINT:
+        case VK_FORMAT_D24_UNORM_S8_UINT:
+        case VK_FORMAT_D32_SFLOAT_S8_UINT:
+            return VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT;
+        case VK_FORMAT_S8_UINT:
+            return VK_IMAGE_ASPECT_STENCIL_BIT;
+        default:
+            return VK_IMAGE_ASPECT_COLOR_BIT;
+        }
+    }
+}
+
+/*************************************************
+PassBuilder
+*************************************************/
+
+RenderGraph::PassBuilder& RenderGraph::PassBuilder::WriteColor(ImageHandle image, VkAttachmentLoadOp loadOp, VkClearColorValue clearColor)
+{
+    //ブレンドで描画先を読むため、アクセスには読み取りも含める
+    UseImage(image, VK_IMAGE_LAYOUT_ATTACHMENT_OPTIMAL,
+        VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT,
+        VK_ACCESS_2_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT,
+        VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT, loadOp == VK_ATTACHMENT_LOAD_OP_LOAD, true);
+    m_graph.m_passes[m_passIndex].colorAttachments.push_back(Attachment{
+        .image = image,
+        .layout = VK_IMAGE_LAYOUT_ATTACHMENT_OPTIMAL,
+        .loadOp = loadOp,
+        .clearValue = {.color = clearColor },
+    });
+    return *this;
+}
+
+RenderGraph::PassBuilder& RenderGraph::PassBuilder::WriteDepth(ImageHandle image, VkAttachmentLoadOp loadOp, float clearDepth)
+{
+    UseImage(image, VK_IMAGE_LAYOUT_ATTACHMENT_OPTIMAL,
+        VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT,
+        VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+        VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, loadOp == VK_ATTACHMENT_LOAD_OP_LOAD, true);
+    m_graph.m_passes[m_passIndex].depthAttachment = Attachment{
+        .image = image,
+        .layout = VK_IMAGE_LAYOUT_ATTACHMENT_OPTIMAL,
+        .loadOp = loadOp,
+        .clearValue = {.depthStencil = { clearDepth, 0 } },
+    };
+    return *this;
+}
+
+RenderGraph::PassBuilder& RenderGraph::PassBuilder::ReadDepth(ImageHandle image)
+{
+    //サンプルと同じレイアウトにし、深度を参照するパスが続いても遷移しないようにする
+    UseImage(image, VK_IMAGE_LAYOUT_READ_ONLY_OPTIMAL,
+        VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT,
+        VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT,
+        VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, true, false);
+    m_graph.m_passes[m_passIndex].depthAttachment = Attachment{
+        .image = image,
+        .layout = VK_IMAGE_LAYOUT_READ_ONLY_OPTIMAL,
+        .loadOp = VK_ATTACHMENT_LOAD_OP_LOAD,
+    };
+    return *this;
+}
+
+RenderGraph::PassBuilder& RenderGraph::PassBuilder::SampleImage(ImageHandle image, VkPipelineStageFlags2 stage)
+{
+    return UseImage(image, VK_IMAGE_LAYOUT_READ_ONLY_OPTIMAL, stage, VK_ACCESS_2_SHADER_SAMPLED_READ_BIT,
+        VK_IMAGE_USAGE_SAMPLED_BIT, true, false);
+}
+
+RenderGraph::PassBuilder& RenderGraph::PassBuilder::WriteStorageImage(ImageHandle image, VkPipelineStageFlags2 stage, bool discardContents)
+{
+    return UseImage(image, VK_IMAGE_LAYOUT_GENERAL, stage,
+        VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+        VK_IMAGE_USAGE_STORAGE_BIT, !discardContents, true);
+}
+
+RenderGraph::PassBuilder& RenderGraph::PassBuilder::CopySource(ImageHandle image)
+{
+    return UseImage(image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_PIPELINE_STAGE_2_TRANSFER_BIT,
+        VK_ACCESS_2_TRANSFER_READ_BIT, VK_IMAGE_USAGE_TRANSFER_SRC_BIT, true, false);
+}
+
+RenderGraph::PassBuilder& RenderGraph::PassBuilder::CopyDestination(ImageHandle image, bool discardContents)
+{
+    return UseImage(image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_PIPELINE_STAGE_2_TRANSFER_BIT,
+        VK_ACCESS_2_TRANSFER_WRITE_BIT, VK_IMAGE_USAGE_TRANSFER_DST_BIT, !discardContents, true);
+}
+
+RenderGraph::PassBuilder& RenderGraph::PassBuilder::ReadBuffer(BufferHandle buffer, VkPipelineStageFlags2 stage, VkAccessFlags2 access)
+{
+    if (buffer >= m_graph.m_buffers.size())
+    {
+        throw std::runtime_error("RenderGraph: invalid buffer handle in pass " + m_graph.m_passes[m_passIndex].name);
+    }
+    m_graph.m_passes[m_passIndex].bufferUsages.push_back(BufferUsage{
+        .buffer = buffer, .stage = stage, .access = access, .write = false });
+    return *this;
+}
+
+RenderGraph::PassBuilder& RenderGraph::PassBuilder::WriteBuffer(BufferHandle buffer, VkPipelineStageFlags2 stage, VkAccessFlags2 access)
+{
+    if (buffer >= m_graph.m_buffers.size())
+    {
+        throw std::runtime_error("RenderGraph: invalid buffer handle in pass " + m_graph.m_passes[m_passIndex].name);
+    }
+    m_graph.m_passes[m_passIndex].bufferUsages.push_back(BufferUsage{
+        .buffer = buffer, .stage = stage, .access = access, .write = true });
+    return *this;
+}
+
+RenderGraph::PassBuilder& RenderGraph::PassBuilder::SetSideEffect()
+{
+    m_graph.m_passes[m_passIndex].sideEffect = true;
+    return *this;
+}
+
+RenderGraph::PassBuilder& RenderGraph::PassBuilder::UseImage(ImageHandle image, VkImageLayout layout,
+    VkPipelineStageFlags2 stage, VkAccessFlags2 access, VkImageUsageFlags usage, bool read, bool write)
+{
+    if (image >= m_graph.m_images.size())
+    {
+        throw std::runtime_error("RenderGraph: invalid image handle in pass " + m_graph.m_passes[m_passIndex].name);
+    }
+    m_graph.m_passes[m_passIndex].imageUsages.push_back(ImageUsage{
+        .image = image,
+        .layout = layout,
+        .stage = stage,
+        .access = access,
+        .usageFlags = usage,
+        .read = read,
+        .write = write,
+    });
+    return *this;
+}
+
+/*************************************************
+public
+*************************************************/
+
+void RenderGraph::Cleanup()
+{
+    Reset();
+    ReleaseTransientImages();
+}
+
+void RenderGraph::Reset()
+{
+    m_passes.clear();
+    m_images.clear();
+    m_buffers.clear();
+    m_compiled = false;
+}
+
+RenderGraph::ImageHandle RenderGraph::ImportImage(const std::string& name, IImageResource& image, const ResourceState& finalState)
+{
+    ImageNode node;
+    node.name = name;
+    node.resource = &image;
+    node.imported = true;
+    node.finalState = finalState;
+    m_images.push_back(std::move(node));
+    return ImageHandle(m_images.size() - 1);
+}
+
+RenderGraph::ImageHandle RenderGraph::ImportImage(const std::string& name, VkImage image, VkImageView imageView, VkFormat format,
+    VkExtent2D extent, const ResourceState& initialState, const ResourceState& finalState)
+{
+    ImageNode node;
+    node.name = name;
+    node.external = std::make_unique<ExternalImage>(image, imageView, format, extent, GetAspectFlags(format), initialState);
+    node.resource = node.external.get();
+    node.imported = true;
+    node.initialState = initialState;
+    node.finalState = finalState;
+    m_images.push_back(std::move(node));
+    return ImageHandle(m_images.size() - 1);
+}
+
+RenderGraph::BufferHandle RenderGraph::ImportBuffer(const std::string& name, IBufferResource& buffer)
+{
+    m_buffers.push_back(BufferNode{ .name = name, .resource = &buffer });
+    return BufferHandle(m_buffers.size() - 1);
+}
+
+RenderGraph::ImageHandle RenderGraph::CreateImage(const std::string& name, const ImageDesc& desc)
+{
+    ImageNode node;
+    node.name = name;
+    node.desc = desc;
+    m_images.push_back(std::move(node));
+    return ImageHandle(m_images.size() - 1);
+}
+
+void RenderGraph::AddPass(const std::string& name, const SetupFunc& setup, ExecuteFunc execute)
+{
+    m_passes.push_back(Pass{ .name = name, .execute = std::move(execute) });
+    PassBuilder builder(*this, uint32_t(m_passes.size() - 1));
+    setup(builder);
+}
+
+void RenderGraph::Compile()
+{
+    m_stats = Stats{ .passCount = uint32_t(m_passes.size()) };
+
+    CullPasses();
+    ComputeLifetimes();
+    AllocateTransientImages();
+    m_compiled = true;
+}
+
+void RenderGraph::Execute(CommandBuffer& commandBuffer)
+{
+    if (!m_compiled)
+    {
+        throw std::runtime_error("RenderGraph: Execute called before Compile");
+    }
+
+    //一時イメージは内容を引き継がないため、UNDEFINEDから始める
+    //同じメモリを前に使ったイメージ(前回のフレームの最後のものを含む)の使われ方を引き継ぎ、最初の使用前にそれを待たせる
+    for (auto& slot : m_memorySlots)
+    {
+        VkPipelineStageFlags2 previousStage = slot.lastStage;
+        VkAccessFlags2 previousAccess = slot.lastAccess;
+        for (auto physicalIndex : slot.images)
+        {
+            const auto& physical = m_physicalImages[physicalIndex];
+            const auto& node = m_images[physical.node];
+            physical.image->SetLayout(VK_IMAGE_LAYOUT_UNDEFINED);
+            physical.image->SetStageFlags(previousStage);
+            physical.image->SetAccessFlag(previousAccess);
+            previousStage = node.lastStage;
+            previousAccess = node.lastAccess;
+        }
+        slot.lastStage = previousStage;
+        slot.lastAccess = previousAccess;
+    }
+
+    for (auto& pass : m_passes)
+    {
+        if (pass.culled)
+        {
+            continue;
+        }
+
+        //要求した状態のバリアはレンダリングの開始(または直前のFlushBarriers)でまとめて発行される
+        for (const auto& usage : pass.imageUsages)
+        {
+            commandBuffer.RequireImageState(*m_images[usage.image].resource,
+                usage.layout, usage.stage, usage.access, !usage.read);
+        }
+        for (const auto& usage : pass.bufferUsages)
+        {
+            commandBuffer.RequireBufferState(*m_buffers[usage.buffer].resource, usage.stage, usage.access);
+        }
+
+        const bool hasDepth = pass.depthAttachment.image != InvalidHandle;
+        if (pass.colorAttachments.empty() && !hasDepth)
+        {
+            commandBuffer.FlushBarriers();
+            pass.execute(commandBuffer);
+            continue;
+        }
+
+        VkExtent2D extent{};
+        std::vector<VkRenderingAttachmentInfo> colorInfos;
+        colorInfos.reserve(pass.colorAttachments.size());
+        for (const auto& attachment : pass.colorAttachments)
+        {
+            auto* image = m_images[attachment.image].resource;
+            extent = image->GetExtent();
+            colorInfos.push_back(VkRenderingAttachmentInfo{
+                .sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO,
+                .imageView = image->GetVkImageView(),
+                .imageLayout = attachment.layout,
+                .loadOp = attachment.loadOp,
+                .storeOp = VK_ATTACHMENT_STORE_OP_STORE,
+                .clearValue = attachment.clearValue,
+            });
+        }
+        VkRenderingAttachmentInfo depthInfo{};
+        bool hasStencil = false;
+        if (hasDepth)
+        {
+            auto* image = m_images[pass.depthAttachment.image].resource;
+            extent = image->GetExtent();
+            hasStencil = (image->GetSubresourceRange().aspectMask & VK_IMAGE_ASPECT_STENCIL_BIT) != 0;
+            depthInfo = VkRenderingAttachmentInfo{
+                .sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO,
+                .imageView = image->GetVkImageView(),
+                .imageLayout = pass.depthAttachment.layout,
+                .loadOp = pass.depthAttachment.loadOp,
+                .storeOp = VK_ATTACHMENT_STORE_OP_STORE,
+                .clearValue = pass.depthAttachment.clearValue,
+            };
+        }
+        VkRenderingInfo renderingInfo{
+            .sType = VK_STRUCTURE_TYPE_RENDERING_INFO,
+            .renderArea = { {0, 0}, extent },
+            .layerCount = 1,
+            .colorAttachmentCount = uint32_t(colorInfos.size()),
+            .pColorAttachments = colorInfos.data(),
+            .pDepthAttachment = hasDepth ? &depthInfo : nullptr,
+            .pStencilAttachment = hasStencil ? &depthInfo : nullptr,
+        };
+        commandBuffer.BeginRendering(renderingInfo);
+        pass.execute(commandBuffer);
+        commandBuffer.EndRendering();
+    }
+
+    //インポートしたイメージを指定された状態で返す(バリアは記録の終了時にまとめて発行される)
+    for (const auto& node : m_images)
+    {
+        if (node.imported && node.finalState.layout != VK_IMAGE_LAYOUT_UNDEFINED)
+        {
+            commandBuffer.RequireImageState(*node.resource,
+                node.finalState.layout, node.finalState.stage, node.finalState.access);
+        }
+    }
+}
+
+IImageResource* RenderGraph::GetImage(ImageHandle image) const
+{
+    if (image >= m_images.size())
+    {
+        return nullptr;
+    }
+    return m_images[image].resource;
+}
+
+/*************************************************
+private
+*************************************************/
+
+void RenderGraph::CullPasses()
+{
+    //後ろのパスから、出力に必要なイメージを書くパスだけを残していく
+    //インポートしたリソースは外から見えるため最後まで必要とする
+    //以前の内容を読まずに書くパスより前の書き込みは、その後のパスからは見えないため不要になる
+    std::vector<bool> needed(m_images.size());
+    for (size_t i = 0; i < m_images.size(); ++i)
+    {
+        needed[i] = m_images[i].imported;
+    }
+
+    for (auto pass = m_passes.rbegin(); pass != m_passes.rend(); ++pass)
+    {
+        bool alive = pass->sideEffect;
+        for (const auto& usage : pass->imageUsages)
+        {
+            alive = alive || (usage.write && needed[usage.image]);
+        }
+        //バッファはインポートしたものだけのため、書き込むパスは常に残す
+        for (const auto& usage : pass->bufferUsages)
+        {
+            alive = alive || usage.write;
+        }
+
+        pass->culled = !alive;
+        if (!alive)
+        {
+            ++m_stats.culledPassCount;
+            continue;
+        }
+        for (const auto& usage : pass->imageUsages)
+        {
+            if (usage.write && !usage.read)
+            {
+                needed[usage.image] = false;
+            }
+        }
+        for (const auto& usage : pass->imageUsages)
+        {
+            if (usage.read)
+            {
+                needed[usage.image] = true;
+            }
+        }
+    }
+}
+
+void RenderGraph::ComputeLifetimes()
+{
+    for (uint32_t passIndex = 0; passIndex < uint32_t(m_passes.size()); ++passIndex)
+    {
+        const auto& pass = m_passes[passIndex];
+        if (pass.culled)
+        {
+            continue;
+        }
+        for (const auto& usage : pass.imageUsages)
+        {
+            auto& node = m_images[usage.image];
+            if (node.imported)
+            {
+                continue;
+            }
+            if (node.firstPass == UINT32_MAX)
+            {
+                if (usage.read)
+                {
+                    throw std::runtime_error("RenderGraph: pass " + pass.name + " reads " + node.name + " before it is written");
+                }
+                node.firstPass = passIndex;
+            }
+            node.lastPass = passIndex;
+            node.usage |= usage.usageFlags;
+
+            //次に同じメモリを使うイメージは、最後の書き込みとその後の読み取りを待つ
+            if (usage.write)
+            {
+                node.lastStage = usage.stage;
+                node.lastAccess = usage.access;
+            }
+            else
+            {
+                node.lastStage |= usage.stage;
+                node.lastAccess |= usage.access;
+            }
+        }
+    }
+}
+
+void RenderGraph::AllocateTransientImages()
+{
+    std::vector<uint32_t> transients;
+    Hasher hasher;
+    for (uint32_t i = 0; i < uint32_t(m_images.size()); ++i)
+    {
+        const auto& node = m_images[i];
+        if (node.imported || node.firstPass == UINT32_MAX)
+        {
+            continue;
+        }
+        transients.push_back(i);
+        hasher.Add(node.desc.extent.width).Add(node.desc.extent.height).Add(node.desc.format);
+        hasher.Add(node.usage).Add(node.firstPass).Add(node.lastPass);
+    }
+    hasher.Add(transients.size());
+    const uint64_t key = hasher.Get();
+
+    if (key != m_transientKey)
+    {
+        ReleaseTransientImages();
+
+        for (auto nodeIndex : transients)
+        {
+            const auto& node = m_images[nodeIndex];
+            auto image = TransientImage::Create(node.desc.extent, node.desc.format, node.usage, GetAspectFlags(node.desc.format));
+            if (!image)
+            {
+                throw std::runtime_error("RenderGraph: failed to create transient image " + node.name);
+            }
+            const auto requirements = image->GetMemoryRequirements();
+            m_physicalImages.push_back(PhysicalImage{ .image = std::move(image), .size = requirements.size });
+        }
+
+        //大きいものから順に、寿命が重ならずメモリタイプが共通するメモリ領域へ詰める
+        std::vector<uint32_t> order(transients.size());
+        for (uint32_t i = 0; i < uint32_t(order.size()); ++i)
+        {
+            order[i] = i;
+        }
+        std::stable_sort(order.begin(), order.end(), [this](uint32_t a, uint32_t b)
+        {
+            return m_physicalImages[a].size > m_physicalImages[b].size;
+        });
+        for (auto physicalIndex : order)
+        {
+            const auto& node = m_images[transients[physicalIndex]];
+            const auto requirements = m_physicalImages[physicalIndex].image->GetMemoryRequirements();
+
+            auto slot = std::find_if(m_memorySlots.begin(), m_memorySlots.end(), [&](const MemorySlot& slot)
+            {
+                if ((slot.requirements.memoryTypeBits & requirements.memoryTypeBits) == 0)
+                {
+                    return false;
+                }
+                return std::ranges::all_of(slot.images, [&](uint32_t other)
+                {
+                    const auto& otherNode = m_images[transients[other]];
+                    return node.lastPass < otherNode.firstPass || otherNode.lastPass < node.firstPass;
+                });
+            });
+            if (slot == m_memorySlots.end())
+            {
+                m_memorySlots.push_back(MemorySlot{ .requirements = requirements });
+                slot = m_memorySlots.end() - 1;
+            }
+            else
+            {
+                slot->requirements.size = std::max(slot->requirements.size, requirements.size);
+                slot->requirements.alignment = std::max(slot->requirements.alignment, requirements.alignment);
+                slot->requirements.memoryTypeBits &= requirements.memoryTypeBits;
+            }
+            slot->images.push_back(physicalIndex);
+            m_physicalImages[physicalIndex].slot = uint32_t(slot - m_memorySlots.begin());
+        }
+
+        auto& allocator = VulkanContext::Get().GetMemoryAllocator();
+        for (auto& slot : m_memorySlots)
+        {
+            std::sort(slot.images.begin(), slot.images.end(), [&](uint32_t a, uint32_t b)
+            {
+                return m_images[transients[a]].firstPass < m_images[transients[b]].firstPass;
+            });
+            if (!allocator.Allocate(slot.requirements, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, AllocationKind::Optimal, slot.allocation))
+            {
+                throw std::runtime_error("RenderGraph: failed to allocate transient memory");
+            }
+            for (auto physicalIndex : slot.images)
+            {
+                if (!m_physicalImages[physicalIndex].image->BindMemory(slot.allocation.memory, slot.allocation.offset))
+                {
+                    throw std::runtime_error("RenderGraph: failed to bind transient image " + m_images[transients[physicalIndex]].name);
+                }
+            }
+        }
+        m_transientKey = key;
+    }
+
+    //同じ内容のグラフでは一時イメージは宣言順に並ぶため、番号で今回のノードと結び付けられる
+    m_stats.transientImageCount = uint32_t(transients.size());
+    m_stats.memorySlotCount = uint32_t(m_memorySlots.size());
+    for (uint32_t i = 0; i < uint32_t(transients.size()); ++i)
+    {
+        auto& physical = m_physicalImages[i];
+        auto& node = m_images[transients[i]];
+        physical.node = transients[i];
+        node.physicalIndex = i;
+        node.resource = physical.image.get();
+        m_stats.unaliasedBytes += physical.size;
+    }
+    for (const auto& slot : m_memorySlots)
+    {
+        m_stats.transientBytes += slot.requirements.size;
+    }
+}
+
+void RenderGraph::ReleaseTransientImages()
+{
+    //イメージはそれぞれのCleanupで破棄が遅延される。メモリも同じく現在のフレームを終えてから解放する
+    m_physicalImages.clear();
+    for (auto& slot : m_memorySlots)
+    {
+        if (slot.allocation.memory != VK_NULL_HANDLE)
+        {
+            VulkanContext::Get().DeferDestroy([allocation = slot.allocation]() mutable
+            {
+                VulkanContext::Get().GetMemoryAllocator().Free(allocation);
+            });
+        }
+    }
+    m_memorySlots.clear();
+    m_transientKey = 0;
+}
@@ -1,31 +1,55 @@
 #include "core/ResourceUploader.h"
 
-bool ResourceUploader::Initialize()
+bool ResourceUploader::Initialize(VkDeviceSize stagingSize)
 {
-    VkDevice device = VulkanContext::Get().GetVkDevice();
+    auto& vulkanCtx = VulkanContext::Get();
+    VkDevice device = vulkanCtx.GetVkDevice();
+
+    //転送キューのファミリーで、提出単位にリセットするコマンドプールを用意
+    if (!m_commandPools.Initialize(device, vulkanCtx.GetTransferFamily(), CommandSlotCount, vulkanCtx.GetWorkerThreadPool().GetThreadCount() + 1))
+    {
+        return false;
+    }
+
+    //提出毎に値を進めるタイムラインセマフォ
+    VkSemaphoreTypeCreateInfo timelineCI{
+        .sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO,
+        .semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE,
+        .initialValue = 0,
+    };
+    VkSemaphoreCreateInfo semaphoreCI{
+        .sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,
+        .pNext = &timelineCI,
+    };
+    if (vkCreateSemaphore(device, &semaphoreCI, nullptr, &m_timelineSemaphore) != VK_SUCCESS)
+    {
+        return false;
+    }
+    m_lastTicket = 0;
 
-    //tFX̍쐬i1Ŏg񂵁j
-    VkFenceCreateInfo fenceInfo{};
-    fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
-    auto result = vkCreateFence(device, &fenceInfo, nullptr, &m_transferFence);
-    return result == VK_SUCCESS;
+    //ステージングバッファは常駐させて使い回す
+    return m_stagingRing.Initialize(stagingSize);
 }
 
 void ResourceUploader::Cleanup()
 {
     VkDevice device = VulkanContext::Get().GetVkDevice();
-    vkDestroyFence(device, m_transferFence, nullptr);
-    m_transferFence = VK_NULL_HANDLE;
+
+    //実行中の転送を待ってから破棄する
+    Wait(m_lastTicket);
+    RetireCompleted();
+
+    m_stagingRing.Cleanup();
+    m_commandPools.Cleanup();
+    vkDestroySemaphore(device, m_timelineSemaphore, nullptr);
+    m_timelineSemaphore = VK_NULL_HANDLE;
 }
 
 bool ResourceUploader::UploadBuffer(IBufferResource* target, const void* pData, size_t size, VkAccessFlags nextAccessMask)
 {
-    VulkanContext& context = VulkanContext::Get();
-    VkDevice device = context.GetVkDevice();
-
     if (target->IsHostAccessible())
     {
-        // ڏ݂\Ȃ߁Aŏ
+        // 直接書き込みが可能なため、ここで処理
         if (void* p = target->Map(); p != nullptr)
         {
             memcpy(p, pData, size);
@@ -35,68 +59,121 @@ bool ResourceUploader::UploadBuffer(IBufferResource* target, const void* pData,
         return false;
     }
 
-    auto stagingBuffer = StagingBuffer::Create(size);
-    if (!stagingBuffer)
-    {
-        return false;
-    }
+    RetireCompleted();
 
-    void* mapped = stagingBuffer->Map();
-    std::memcpy(mapped, pData, size);
-    stagingBuffer->Unmap();
+    // リングの空きに収まる単位で書き込み、転送を登録していく
+    auto src = static_cast<const uint8_t*>(pData);
+    VkDeviceSize written = 0;
+    while (written < size)
+    {
+        StagingRing::Region region{};
+        if (!m_stagingRing.Allocate(size - written, region))
+        {
+            // 空きがなければ登録済みの転送を提出し、最も古い提出の完了を待ってリングを空ける
+            if (!m_transferEntries.empty())
+            {
+                Submit();
+            }
+            if (m_inflightTickets.empty())
+            {
+                return false;
+            }
+            Wait(m_inflightTickets.front());
+            RetireCompleted();
+            continue;
+        }
 
-    m_transferEntries.emplace_back(PendingTransfer{
-        .stagingBuffer = std::move(stagingBuffer),
-        .destinationBuffer = target,
-        .dstAccessMask = nextAccessMask,
-        });
+        std::memcpy(region.mapped, src + written, region.size);
+        m_stagingRing.Flush(region);
+        m_transferEntries.emplace_back(PendingTransfer{
+            .stagingBuffer = region.buffer,
+            .srcOffset = region.offset,
+            .destinationBuffer = target,
+            .dstOffset = written,
+            .size = region.size,
+            .dstAccessMask = nextAccessMask,
+            });
+        written += region.size;
+    }
     return true;
 }
 
-void ResourceUploader::SubmitAndWait()
+UploadTicket ResourceUploader::Submit()
 {
+    if (m_transferEntries.empty())
+    {
+        return m_lastTicket;
+    }
+
     VulkanContext& vulkanCtx = VulkanContext::Get();
-    VkDevice device = vulkanCtx.GetVkDevice();
-    VkCommandPool pool = vulkanCtx.GetCommandPool();
-    VkQueue queue = vulkanCtx.GetGraphicsQueue();
+    VkQueue queue = vulkanCtx.GetTransferQueue();
+    const bool ownershipTransfer = vulkanCtx.HasDedicatedTransferQueue();
 
-    // R}hobt@m
-    auto commandBuffer = vulkanCtx.CreateCommandBuffer();
+    // 今回のチケットが使うスロットのプールを、前回そのスロットを使った提出の完了後にリセットする
+    UploadTicket ticket = m_lastTicket + 1;
+    if (ticket > CommandSlotCount)
+    {
+        Wait(ticket - CommandSlotCount);
+    }
+    m_commandPools.BeginSlot(uint32_t(ticket % CommandSlotCount));
+    auto commandBuffer = m_commandPools.Acquire();
     commandBuffer->Begin(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
 
-    // ]ɂׂċL^
-    for (auto& entry : m_transferEntries)
+    // 転送処理を先にすべて記録(同じ転送先への連続したコピーは1回のコマンドにまとめる)
+    std::vector<VkBufferCopy> regions;
+    for (size_t i = 0; i < m_transferEntries.size(); ++i)
     {
-        IBufferResource* dst = entry.destinationBuffer;
-        auto& src = entry.stagingBuffer;
-
-        VkBufferCopy copyRegion{};
-        copyRegion.srcOffset = 0;
-        copyRegion.dstOffset = 0;
-        copyRegion.size = dst->GetBufferSize();
+        auto& entry = m_transferEntries[i];
+        regions.push_back(VkBufferCopy{
+            .srcOffset = entry.srcOffset,
+            .dstOffset = entry.dstOffset,
+            .size = entry.size,
+            });
 
-        vkCmdCopyBuffer(*commandBuffer, src->GetVkBuffer(), dst->GetVkBuffer(), 1, &copyRegion);
+        bool isLast = (i + 1 == m_transferEntries.size());
+        if (isLast ||
+            m_transferEntries[i + 1].destinationBuffer != entry.destinationBuffer ||
+            m_transferEntries[i + 1].stagingBuffer != entry.stagingBuffer)
+        {
+            vkCmdCopyBuffer(*commandBuffer, entry.stagingBuffer, entry.destinationBuffer->GetVkBuffer(),
+                uint32_t(regions.size()), regions.data());
+            regions.clear();
+        }
     }
 
-    // ]oA܂Ƃ߂1񔭍s
+    // 転送後バリアをまとめて1回発行
+    // 転送専用キューを使う場合はここで所有権を解放し、グラフィックスキュー側で取得する
     std::vector<VkBufferMemoryBarrier2> barriers;
     for (auto& entry : m_transferEntries)
     {
         IBufferResource* dst = entry.destinationBuffer;
-        auto dstAccessMask = dst->GetAccessFlags();
 
         VkBufferMemoryBarrier2 barrier{
             .sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2,
             .srcStageMask = VK_PIPELINE_STAGE_2_TRANSFER_BIT,
             .srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT,
             .dstStageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT,
-            .dstAccessMask = dstAccessMask,
+            .dstAccessMask = entry.dstAccessMask,
             .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
             .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
             .buffer = dst->GetVkBuffer(),
-            .offset = 0,
-            .size = dst->GetBufferSize()
+            .offset = entry.dstOffset,
+            .size = entry.size
         };
+        if (ownershipTransfer)
+        {
+            VkBufferMemoryBarrier2 acquire = barrier;
+            acquire.srcStageMask = VK_PIPELINE_STAGE_2_NONE;
+            acquire.srcAccessMask = VK_ACCESS_2_NONE;
+            acquire.srcQueueFamilyIndex = vulkanCtx.GetTransferFamily();
+            acquire.dstQueueFamilyIndex = vulkanCtx.GetGraphicsFamily();
+            vulkanCtx.AddQueueOwnershipAcquire(acquire);
+
+            barrier.dstStageMask = VK_PIPELINE_STAGE_2_NONE;
+            barrier.dstAccessMask = VK_ACCESS_2_NONE;
+            barrier.srcQueueFamilyIndex = vulkanCtx.GetTransferFamily();
+            barrier.dstQueueFamilyIndex = vulkanCtx.GetGraphicsFamily();
+        }
         barriers.push_back(barrier);
     }
 
@@ -109,19 +186,76 @@ void ResourceUploader::SubmitAndWait()
         };
         vkCmdPipelineBarrier2(*commandBuffer, &depInfo);
     }
-
     commandBuffer->End();
-    auto cmd = commandBuffer->Get();
-    VkSubmitInfo submitInfo{};
-    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-    submitInfo.commandBufferCount = 1;
-    submitInfo.pCommandBuffers = &cmd;
 
-    // R}hobt@sA܂őҋ@
-    vkResetFences(device, 1, &m_transferFence);
-    vkQueueSubmit(queue, 1, &submitInfo, m_transferFence);
-    vkWaitForFences(device, 1, &m_transferFence, VK_TRUE, UINT64_MAX);
+    // 完了時にタイムラインセマフォへチケット値をシグナルする
+    m_lastTicket = ticket;
+    VkCommandBufferSubmitInfo commandInfo{
+        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_SUBMIT_INFO,
+        .commandBuffer = commandBuffer->Get(),
+    };
+    VkSemaphoreSubmitInfo signalInfo{
+        .sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO,
+        .semaphore = m_timelineSemaphore,
+        .value = ticket,
+        .stageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT,
+    };
+    VkSubmitInfo2 submitInfo{
+        .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO_2,
+        .commandBufferInfoCount = 1,
+        .pCommandBufferInfos = &commandInfo,
+        .signalSemaphoreInfoCount = 1,
+        .pSignalSemaphoreInfos = &signalInfo,
+    };
+    vkQueueSubmit2(queue, 1, &submitInfo, VK_NULL_HANDLE);
+
+    // 使用したリング領域を今回の提出に紐づける
+    m_stagingRing.CloseSubmission(ticket);
+    m_inflightTickets.push_back(ticket);
+
+    // 次のフレームはアップロード完了を待ってから実行する
+    vulkanCtx.AddFrameWaitSemaphore(m_timelineSemaphore, ticket, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT);
 
     m_transferEntries.clear();
-    commandBuffer.reset();
-}
\ No newline at end of file
+    return ticket;
+}
+
+bool ResourceUploader::IsComplete(UploadTicket ticket) const
+{
+    uint64_t completed = 0;
+    vkGetSemaphoreCounterValue(VulkanContext::Get().GetVkDevice(), m_timelineSemaphore, &completed);
+    return completed >= ticket;
+}
+
+void ResourceUploader::Wait(UploadTicket ticket)
+{
+    VkSemaphoreWaitInfo waitInfo{
+        .sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO,
+        .semaphoreCount = 1,
+        .pSemaphores = &m_timelineSemaphore,
+        .pValues = &ticket,
+    };
+    vkWaitSemaphores(VulkanContext::Get().GetVkDevice(), &waitInfo, UINT64_MAX);
+}
+
+void ResourceUploader::SubmitAndWait()
+{
+    Wait(Submit());
+    RetireCompleted();
+}
+
+/*************************************************
+private
+*************************************************/
+
+void ResourceUploader::RetireCompleted()
+{
+    uint64_t completed = 0;
+    vkGetSemaphoreCounterValue(VulkanContext::Get().GetVkDevice(), m_timelineSemaphore, &completed);
+
+    m_stagingRing.Reclaim(completed);
+    while (!m_inflightTickets.empty() && m_inflightTickets.front() <= completed)
+    {
+        m_inflightTickets.pop_front();
+    }
+}
@@ -1,36 +1,35 @@
-#include <fstream>
+#include <stdexcept>
 
 #include "core/ShaderLoader.h"
+#include "core/MappedFile.h"
 
 namespace loader
 {
-    VkShaderModule loader::LoadShaderModule(const std::filesystem::path& shaderSpvPath)
+    std::vector<uint32_t> LoadShaderCode(const std::filesystem::path& shaderSpvPath)
     {
-        //t@CoCiœǂݍ
-        std::ifstream file(shaderSpvPath, std::ios::ate | std::ios::binary);
-        if (!file.is_open())
+        //ファイルをマップして読み込み
+        MappedFile file;
+        if (!file.Open(shaderSpvPath))
         {
             throw std::runtime_error("Failed to open shader file: " + shaderSpvPath.string());
         }
 
-        size_t fileSize = static_cast<size_t>(file.tellg());
-        std::vector<char> buffer(fileSize);
-        file.seekg(0).read(buffer.data(), fileSize);
-        file.close();
-
-        //VkShaderModuleCreateInfoɃoCif[^ݒ
-        VkShaderModuleCreateInfo createInfo{};
-        createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-        createInfo.codeSize = buffer.size();
-        createInfo.pCode = reinterpret_cast<const uint32_t*>(buffer.data());
-
-        VkDevice device = VulkanContext::Get().GetVkDevice();
-        VkShaderModule shaderModule{};
-        auto result = vkCreateShaderModule(device, &createInfo, nullptr, &shaderModule);
-        if (result != VK_SUCCESS)
+        //SPIR-Vは32bitワードの列
+        if (file.GetSize() % sizeof(uint32_t) != 0)
         {
-            throw std::runtime_error("Failed to create shader module from: " + shaderSpvPath.string());
+            throw std::runtime_error("Invalid SPIR-V size: " + shaderSpvPath.string());
         }
-        return shaderModule;
+        auto words = static_cast<const uint32_t*>(file.GetData());
+        return std::vector<uint32_t>(words, words + file.GetSize() / sizeof(uint32_t));
+    }
+
+    VkShaderModule LoadShaderModule(const std::filesystem::path& shaderSpvPath)
+    {
+        return VulkanContext::Get().GetShaderModuleCache().Acquire(shaderSpvPath);
+    }
+
+    void ReleaseShaderModule(VkShaderModule shaderModule)
+    {
+        VulkanContext::Get().GetShaderModuleCache().Release(shaderModule);
     }
 }
\ No newline at end of file
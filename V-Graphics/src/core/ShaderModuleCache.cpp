@@ -0,0 +1,248 @@
+#include <algorithm>
+#include <stdexcept>
+
+#include "core/ShaderModuleCache.h"
+#include "core/MappedFile.h"
+#include "core/Hash.h"
+
+/*************************************************
+public
+*************************************************/
+
+void ShaderModuleCache::Initialize(VkDevice device, bool inlineModuleSupported)
+{
+    m_device = device;
+    m_inlineModuleSupported = inlineModuleSupported;
+    m_hits = 0;
+    m_misses = 0;
+}
+
+void ShaderModuleCache::Cleanup()
+{
+    std::lock_guard lock(m_mutex);
+    for (auto& [key, entry] : m_entries)
+    {
+        vkDestroyShaderModule(m_device, entry.module, nullptr);
+    }
+    m_entries.clear();
+    m_keys.clear();
+    m_paths.clear();
+}
+
+VkShaderModule ShaderModuleCache::Acquire(const std::filesystem::path& path)
+{
+    //更新日時が変わっていなければ、前回読み込んだ内容のモジュールをそのまま返す
+    std::error_code error;
+    const auto lastWriteTime = std::filesystem::last_write_time(path, error);
+    const auto pathKey = path.lexically_normal().generic_string();
+    if (!error)
+    {
+        std::lock_guard lock(m_mutex);
+        auto cached = m_paths.find(pathKey);
+        if (cached != m_paths.end() && cached->second.lastWriteTime == lastWriteTime)
+        {
+            auto it = m_entries.find(cached->second.key);
+            if (it != m_entries.end())
+            {
+                ++m_hits;
+                ++it->second.refCount;
+                return it->second.module;
+            }
+        }
+    }
+
+    //マップは複製する間だけ開く。ハッシュと比較は複製した内容で行う
+    std::vector<uint32_t> code;
+    {
+        MappedFile file;
+        if (!file.Open(path))
+        {
+            throw std::runtime_error("Failed to open shader file: " + path.string());
+        }
+        if (file.GetSize() % sizeof(uint32_t) != 0)
+        {
+            throw std::runtime_error("Invalid SPIR-V size: " + path.string());
+        }
+        const auto* words = static_cast<const uint32_t*>(file.GetData());
+        code.assign(words, words + file.GetSize() / sizeof(uint32_t));
+    }
+
+    std::lock_guard lock(m_mutex);
+    const uint64_t key = AcquireCode(std::move(code));
+    if (!error)
+    {
+        m_paths[pathKey] = PathEntry{ .key = key, .lastWriteTime = lastWriteTime };
+    }
+    return m_entries.at(key).module;
+}
+
+VkShaderModule ShaderModuleCache::Acquire(const uint32_t* code, size_t codeSize)
+{
+    if (codeSize == 0 || codeSize % sizeof(uint32_t) != 0)
+    {
+        throw std::runtime_error("Invalid SPIR-V size");
+    }
+
+    std::vector<uint32_t> copiedCode(code, code + codeSize / sizeof(uint32_t));
+    std::lock_guard lock(m_mutex);
+    const uint64_t key = AcquireCode(std::move(copiedCode));
+    return m_entries.at(key).module;
+}
+
+void ShaderModuleCache::Release(VkShaderModule module)
+{
+    if (module == VK_NULL_HANDLE)
+    {
+        return;
+    }
+
+    std::lock_guard lock(m_mutex);
+    ReleaseLocked(module);
+}
+
+std::shared_ptr<const void> ShaderModuleCache::Retain(const std::vector<VkShaderModule>& modules)
+{
+    auto retained = std::make_unique<std::vector<VkShaderModule>>();
+    {
+        std::lock_guard lock(m_mutex);
+        for (auto module : modules)
+        {
+            auto key = m_keys.find(module);
+            if (key != m_keys.end())
+            {
+                ++m_entries.at(key->second).refCount;
+                retained->push_back(module);
+            }
+        }
+    }
+    if (retained->empty())
+    {
+        return nullptr;
+    }
+
+    return std::shared_ptr<const void>(retained.release(), [this](std::vector<VkShaderModule>* retained)
+    {
+        {
+            std::lock_guard lock(m_mutex);
+            for (auto module : *retained)
+            {
+                ReleaseLocked(module);
+            }
+        }
+        delete retained;
+    });
+}
+
+uint64_t ShaderModuleCache::GetContentHash(VkShaderModule module) const
+{
+    std::lock_guard lock(m_mutex);
+    auto key = m_keys.find(module);
+    return key != m_keys.end() ? key->second : 0;
+}
+
+std::span<const uint32_t> ShaderModuleCache::GetCode(VkShaderModule module) const
+{
+    std::lock_guard lock(m_mutex);
+    auto key = m_keys.find(module);
+    if (key == m_keys.end())
+    {
+        return {};
+    }
+    return m_entries.at(key->second).code;
+}
+
+const ShaderReflection* ShaderModuleCache::GetReflection(VkShaderModule module) const
+{
+    std::lock_guard lock(m_mutex);
+    auto key = m_keys.find(module);
+    if (key == m_keys.end())
+    {
+        return nullptr;
+    }
+    const auto& reflection = m_entries.at(key->second).reflection;
+    return reflection.IsValid() ? &reflection : nullptr;
+}
+
+ShaderModuleCache::Stats ShaderModuleCache::GetStats() const
+{
+    std::lock_guard lock(m_mutex);
+    Stats stats{
+        .hits = m_hits,
+        .misses = m_misses,
+        .moduleCount = uint32_t(m_entries.size()),
+    };
+    for (const auto& [key, entry] : m_entries)
+    {
+        stats.codeSize += entry.code.size() * sizeof(uint32_t);
+    }
+    return stats;
+}
+
+/*************************************************
+private
+*************************************************/
+
+uint64_t ShaderModuleCache::AcquireCode(std::vector<uint32_t>&& code)
+{
+    //ハッシュが衝突した場合は、内容が一致するものか空いているキーまで進める(0は未登録を表すため使わない)
+    uint64_t key = Hasher().AddBytes(code.data(), code.size() * sizeof(uint32_t)).Get();
+    for (;; ++key)
+    {
+        if (key == 0)
+        {
+            continue;
+        }
+        auto it = m_entries.find(key);
+        if (it == m_entries.end())
+        {
+            break;
+        }
+        if (std::ranges::equal(it->second.code, code))
+        {
+            ++m_hits;
+            ++it->second.refCount;
+            return key;
+        }
+    }
+
+    ++m_misses;
+    auto& entry = m_entries[key];
+    entry.code = std::move(code);
+
+    VkShaderModuleCreateInfo createInfo{
+        .sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO,
+        .codeSize = entry.code.size() * sizeof(uint32_t),
+        .pCode = entry.code.data(),
+    };
+    if (vkCreateShaderModule(m_device, &createInfo, nullptr, &entry.module) != VK_SUCCESS)
+    {
+        m_entries.erase(key);
+        throw std::runtime_error("Failed to create shader module");
+    }
+    entry.refCount = 1;
+    m_keys[entry.module] = key;
+
+    //解析できないものもモジュールとしては使えるため、リフレクションを持たないだけにする
+    entry.reflection.Parse(entry.code);
+    return key;
+}
+
+void ShaderModuleCache::ReleaseLocked(VkShaderModule module)
+{
+    auto key = m_keys.find(module);
+    if (key == m_keys.end())
+    {
+        return;
+    }
+    auto it = m_entries.find(key->second);
+    if (--it->second.refCount > 0)
+    {
+        return;
+    }
+
+    //作成済みのパイプラインはモジュールを参照しないため、直ちに破棄してよい
+    vkDestroyShaderModule(m_device, module, nullptr);
+    std::erase_if(m_paths, [removedKey = key->second](const auto& path) { return path.second.key == removedKey; });
+    m_entries.erase(it);
+    m_keys.erase(key);
+}
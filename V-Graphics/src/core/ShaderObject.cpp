@@ -0,0 +1,185 @@
+#include <algorithm>
+#include <iterator>
+
+#include "core/ShaderObject.h"
+#include "core/VulkanContext.h"
+
+#define VK_GET_DEVICE_PROC_ADDR(device, name) \
+    reinterpret_cast<PFN_##name>(vkGetDeviceProcAddr(device, #name))
+
+void ShaderObjectFunctions::Load(VkDevice device)
+{
+    createShaders = VK_GET_DEVICE_PROC_ADDR(device, vkCreateShadersEXT);
+    destroyShader = VK_GET_DEVICE_PROC_ADDR(device, vkDestroyShaderEXT);
+    cmdBindShaders = VK_GET_DEVICE_PROC_ADDR(device, vkCmdBindShadersEXT);
+
+    cmdSetVertexInput = VK_GET_DEVICE_PROC_ADDR(device, vkCmdSetVertexInputEXT);
+    cmdSetPolygonMode = VK_GET_DEVICE_PROC_ADDR(device, vkCmdSetPolygonModeEXT);
+    cmdSetRasterizationSamples = VK_GET_DEVICE_PROC_ADDR(device, vkCmdSetRasterizationSamplesEXT);
+    cmdSetSampleMask = VK_GET_DEVICE_PROC_ADDR(device, vkCmdSetSampleMaskEXT);
+    cmdSetAlphaToCoverageEnable = VK_GET_DEVICE_PROC_ADDR(device, vkCmdSetAlphaToCoverageEnableEXT);
+    cmdSetAlphaToOneEnable = VK_GET_DEVICE_PROC_ADDR(device, vkCmdSetAlphaToOneEnableEXT);
+    cmdSetLogicOpEnable = VK_GET_DEVICE_PROC_ADDR(device, vkCmdSetLogicOpEnableEXT);
+    cmdSetDepthClampEnable = VK_GET_DEVICE_PROC_ADDR(device, vkCmdSetDepthClampEnableEXT);
+    cmdSetColorBlendEnable = VK_GET_DEVICE_PROC_ADDR(device, vkCmdSetColorBlendEnableEXT);
+    cmdSetColorBlendEquation = VK_GET_DEVICE_PROC_ADDR(device, vkCmdSetColorBlendEquationEXT);
+    cmdSetColorWriteMask = VK_GET_DEVICE_PROC_ADDR(device, vkCmdSetColorWriteMaskEXT);
+}
+
+/*************************************************
+ShaderObject
+*************************************************/
+
+void ShaderObject::Cleanup()
+{
+    if (m_shaders.empty())
+    {
+        return;
+    }
+
+    VulkanContext::Get().DeferDestroy([device = m_device, shaders = std::move(m_shaders)]()
+    {
+        auto destroyShader = VulkanContext::Get().GetShaderObjectFunctions().destroyShader;
+        for (auto shader : shaders)
+        {
+            destroyShader(device, shader, nullptr);
+        }
+    });
+    m_shaders.clear();
+    m_stages.clear();
+}
+
+bool ShaderObject::HasStage(VkShaderStageFlagBits stage) const
+{
+    return std::find(m_stages.begin(), m_stages.end(), stage) != m_stages.end();
+}
+
+void ShaderObject::Bind(VkCommandBuffer commandBuffer) const
+{
+    const auto& functions = VulkanContext::Get().GetShaderObjectFunctions();
+    if (HasStage(VK_SHADER_STAGE_COMPUTE_BIT))
+    {
+        functions.cmdBindShaders(commandBuffer, uint32_t(m_stages.size()), m_stages.data(), m_shaders.data());
+        return;
+    }
+
+    //前に結び付けたシェーダーが残らないよう、使わないステージにはVK_NULL_HANDLEを結び付ける
+    //テッセレーション, ジオメトリは機能が有効な場合のみ指定できる
+    const auto& features = VulkanContext::Get().GetEnabledFeatures();
+    std::vector<VkShaderStageFlagBits> stages = { VK_SHADER_STAGE_VERTEX_BIT, VK_SHADER_STAGE_FRAGMENT_BIT };
+    if (features.tessellationShader)
+    {
+        stages.push_back(VK_SHADER_STAGE_TESSELLATION_CONTROL_BIT);
+        stages.push_back(VK_SHADER_STAGE_TESSELLATION_EVALUATION_BIT);
+    }
+    if (features.geometryShader)
+    {
+        stages.push_back(VK_SHADER_STAGE_GEOMETRY_BIT);
+    }
+
+    std::vector<VkShaderEXT> shaders(stages.size(), VK_NULL_HANDLE);
+    for (size_t i = 0; i < m_stages.size(); ++i)
+    {
+        auto it = std::find(stages.begin(), stages.end(), m_stages[i]);
+        if (it != stages.end())
+        {
+            shaders[std::distance(stages.begin(), it)] = m_shaders[i];
+        }
+    }
+    functions.cmdBindShaders(commandBuffer, uint32_t(stages.size()), stages.data(), shaders.data());
+}
+
+/*************************************************
+ShaderObjectBuilder
+*************************************************/
+
+ShaderObjectBuilder& ShaderObjectBuilder::AddShaderStage(VkShaderStageFlagBits stage, std::vector<uint32_t> code, const char* entry)
+{
+    return AddShaderStage(stage, std::move(code), SpecializationConstants{}, entry);
+}
+
+ShaderObjectBuilder& ShaderObjectBuilder::AddShaderStage(VkShaderStageFlagBits stage, std::vector<uint32_t> code,
+    const SpecializationConstants& constants, const char* entry)
+{
+    m_stages.push_back(Stage{ .stage = stage, .code = std::move(code), .entry = entry, .constants = constants });
+    return *this;
+}
+
+ShaderObjectBuilder& ShaderObjectBuilder::SetDescriptorSetLayouts(const VkDescriptorSetLayout* setLayouts, uint32_t count)
+{
+    m_setLayouts.assign(setLayouts, setLayouts + count);
+    return *this;
+}
+
+ShaderObjectBuilder& ShaderObjectBuilder::SetPushConstantRanges(const VkPushConstantRange* ranges, uint32_t count)
+{
+    m_pushConstantRanges.assign(ranges, ranges + count);
+    return *this;
+}
+
+std::shared_ptr<ShaderObject> ShaderObjectBuilder::Build() const
+{
+    auto& vulkanCtx = VulkanContext::Get();
+    if (!vulkanCtx.IsShaderObjectSupported() || m_stages.empty())
+    {
+        return nullptr;
+    }
+
+    //ステージのビットの並びはパイプラインの処理順と同じため、ビット順に並べて次のステージを決める
+    std::vector<const Stage*> stages;
+    for (const auto& stage : m_stages)
+    {
+        stages.push_back(&stage);
+    }
+    std::sort(stages.begin(), stages.end(), [](const Stage* a, const Stage* b) { return a->stage < b->stage; });
+
+    //コンピュートは単独で作成する。グラフィックスの複数ステージはリンクし、ステージ間の最適化を許す
+    const bool link = stages.size() > 1;
+    std::vector<VkSpecializationInfo> specializationInfos(stages.size());
+    std::vector<VkShaderCreateInfoEXT> createInfos;
+    for (size_t i = 0; i < stages.size(); ++i)
+    {
+        specializationInfos[i] = stages[i]->constants.GetInfo();
+        createInfos.push_back(VkShaderCreateInfoEXT{
+            .sType = VK_STRUCTURE_TYPE_SHADER_CREATE_INFO_EXT,
+            .flags = link ? VkShaderCreateFlagsEXT(VK_SHADER_CREATE_LINK_STAGE_BIT_EXT) : 0u,
+            .stage = stages[i]->stage,
+            .nextStage = i + 1 < stages.size() ? VkShaderStageFlags(stages[i + 1]->stage) : 0u,
+            .codeType = VK_SHADER_CODE_TYPE_SPIRV_EXT,
+            .codeSize = stages[i]->code.size() * sizeof(uint32_t),
+            .pCode = stages[i]->code.data(),
+            .pName = stages[i]->entry,
+            .setLayoutCount = uint32_t(m_setLayouts.size()),
+            .pSetLayouts = m_setLayouts.data(),
+            .pushConstantRangeCount = uint32_t(m_pushConstantRanges.size()),
+            .pPushConstantRanges = m_pushConstantRanges.data(),
+            .pSpecializationInfo = stages[i]->constants.IsEmpty() ? nullptr : &specializationInfos[i],
+        });
+    }
+
+    auto shaderObject = ShaderObject::Create();
+    shaderObject->m_device = vulkanCtx.GetVkDevice();
+    shaderObject->m_shaders.resize(stages.size(), VK_NULL_HANDLE);
+    const auto& functions = vulkanCtx.GetShaderObjectFunctions();
+    auto result = functions.createShaders(shaderObject->m_device,
+        uint32_t(createInfos.size()), createInfos.data(), nullptr, shaderObject->m_shaders.data());
+    if (result != VK_SUCCESS)
+    {
+        //リンクの失敗時も作成できたものが返る場合があるため破棄する
+        for (auto shader : shaderObject->m_shaders)
+        {
+            if (shader != VK_NULL_HANDLE)
+            {
+                functions.destroyShader(shaderObject->m_device, shader, nullptr);
+            }
+        }
+        shaderObject->m_shaders.clear();
+        return nullptr;
+    }
+
+    for (const auto* stage : stages)
+    {
+        shaderObject->m_stages.push_back(stage->stage);
+    }
+    return shaderObject;
+}
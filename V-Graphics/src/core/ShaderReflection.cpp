@@ -0,0 +1,608 @@
+#include <algorithm>
+#include <stdexcept>
+
+#include "core/ShaderReflection.h"
+#include "core/VulkanContext.h"
+
+namespace
+{
+    //SPIR-Vの仕様で定められた値のうち、解析に使うもの
+    constexpr uint32_t SpirvMagic = 0x07230203;
+    constexpr uint32_t SpirvHeaderWords = 5;
+
+    enum Op : uint32_t
+    {
+        OpEntryPoint = 15,
+        OpTypeVoid = 19,
+        OpTypeBool = 20,
+        OpTypeInt = 21,
+        OpTypeFloat = 22,
+        OpTypeVector = 23,
+        OpTypeMatrix = 24,
+        OpTypeImage = 25,
+        OpTypeSampler = 26,
+        OpTypeSampledImage = 27,
+        OpTypeArray = 28,
+        OpTypeRuntimeArray = 29,
+        OpTypeStruct = 30,
+        OpTypePointer = 32,
+        OpConstant = 43,
+        OpSpecConstant = 50,
+        OpVariable = 59,
+        OpDecorate = 71,
+        OpMemberDecorate = 72,
+        OpTypeAccelerationStructureKHR = 5341,
+    };
+    enum Decoration : uint32_t
+    {
+        DecorationBufferBlock = 3,
+        DecorationArrayStride = 6,
+        DecorationMatrixStride = 7,
+        DecorationBuiltIn = 11,
+        DecorationLocation = 30,
+        DecorationBinding = 33,
+        DecorationDescriptorSet = 34,
+        DecorationOffset = 35,
+    };
+    enum StorageClass : uint32_t
+    {
+        StorageClassUniformConstant = 0,
+        StorageClassInput = 1,
+        StorageClassUniform = 2,
+        StorageClassPushConstant = 9,
+        StorageClassStorageBuffer = 12,
+    };
+    constexpr uint32_t DimBuffer = 5;
+    constexpr uint32_t DimSubpassData = 6;
+    constexpr uint32_t ImageSampledStorage = 2; //OpTypeImageのSampledが2であればストレージイメージ
+
+    VkShaderStageFlagBits ToShaderStage(uint32_t executionModel)
+    {
+        switch (executionModel)
+        {
+        case 0: return VK_SHADER_STAGE_VERTEX_BIT;
+        case 1: return VK_SHADER_STAGE_TESSELLATION_CONTROL_BIT;
+        case 2: return VK_SHADER_STAGE_TESSELLATION_EVALUATION_BIT;
+        case 3: return VK_SHADER_STAGE_GEOMETRY_BIT;
+        case 4: return VK_SHADER_STAGE_FRAGMENT_BIT;
+        case 5: return VK_SHADER_STAGE_COMPUTE_BIT;
+        case 5364: return VK_SHADER_STAGE_TASK_BIT_EXT;
+        case 5365: return VK_SHADER_STAGE_MESH_BIT_EXT;
+        default: return VkShaderStageFlagBits(0);
+        }
+    }
+
+    //頂点入力の成分の型とビット幅, 成分数からフォーマットを求める(対応しないものはUNDEFINED)
+    VkFormat ToVertexFormat(uint32_t op, uint32_t width, bool isSigned, uint32_t componentCount)
+    {
+        static constexpr VkFormat Float32[] = { VK_FORMAT_R32_SFLOAT, VK_FORMAT_R32G32_SFLOAT, VK_FORMAT_R32G32B32_SFLOAT, VK_FORMAT_R32G32B32A32_SFLOAT };
+        static constexpr VkFormat Sint32[] = { VK_FORMAT_R32_SINT, VK_FORMAT_R32G32_SINT, VK_FORMAT_R32G32B32_SINT, VK_FORMAT_R32G32B32A32_SINT };
+        static constexpr VkFormat Uint32[] = { VK_FORMAT_R32_UINT, VK_FORMAT_R32G32_UINT, VK_FORMAT_R32G32B32_UINT, VK_FORMAT_R32G32B32A32_UINT };
+        static constexpr VkFormat Float64[] = { VK_FORMAT_R64_SFLOAT, VK_FORMAT_R64G64_SFLOAT, VK_FORMAT_R64G64B64_SFLOAT, VK_FORMAT_R64G64B64A64_SFLOAT };
+        static constexpr VkFormat Float16[] = { VK_FORMAT_R16_SFLOAT, VK_FORMAT_R16G16_SFLOAT, VK_FORMAT_R16G16B16_SFLOAT, VK_FORMAT_R16G16B16A16_SFLOAT };
+
+        if (componentCount == 0 || componentCount > 4)
+        {
+            return VK_FORMAT_UNDEFINED;
+        }
+        const VkFormat* formats = nullptr;
+        if (op == OpTypeFloat)
+        {
+            formats = width == 32 ? Float32 : width == 64 ? Float64 : width == 16 ? Float16 : nullptr;
+        }
+        else if (op == OpTypeInt && width == 32)
+        {
+            formats = isSigned ? Sint32 : Uint32;
+        }
+        return formats ? formats[componentCount - 1] : VK_FORMAT_UNDEFINED;
+    }
+
+    //IDごとの定義と装飾を集めたもの
+    struct SpirvModule
+    {
+        struct Decorations
+        {
+            uint32_t set = 0;
+            uint32_t binding = 0;
+            uint32_t location = UINT32_MAX;
+            uint32_t arrayStride = 0;
+            bool builtIn = false;
+            bool bufferBlock = false;
+        };
+        struct MemberDecorations
+        {
+            uint32_t offset = 0;
+            uint32_t matrixStride = 0;
+        };
+
+        uint32_t executionModel = UINT32_MAX;
+        std::vector<std::span<const uint32_t>> defs; //型, 定数, 変数の命令(結果のIDで引く)
+        std::vector<Decorations> decorations;
+        std::map<std::pair<uint32_t, uint32_t>, MemberDecorations> memberDecorations;
+        std::vector<uint32_t> variables;
+
+        bool Load(std::span<const uint32_t> code)
+        {
+            if (code.size() < SpirvHeaderWords || code[0] != SpirvMagic)
+            {
+                return false;
+            }
+            const uint32_t bound = code[3];
+            defs.assign(bound, {});
+            decorations.assign(bound, {});
+
+            for (size_t pos = SpirvHeaderWords; pos < code.size();)
+            {
+                const uint32_t wordCount = code[pos] >> 16;
+                const uint32_t opcode = code[pos] & 0xffff;
+                if (wordCount == 0 || pos + wordCount > code.size())
+                {
+                    return false;
+                }
+                auto inst = code.subspan(pos, wordCount);
+                pos += wordCount;
+
+                switch (opcode)
+                {
+                case OpEntryPoint:
+                    if (executionModel == UINT32_MAX && wordCount >= 3)
+                    {
+                        executionModel = inst[1];
+                    }
+                    break;
+                case OpDecorate:
+                    if (wordCount >= 3 && inst[1] < bound)
+                    {
+                        AddDecoration(decorations[inst[1]], inst[2], wordCount >= 4 ? inst[3] : 0);
+                    }
+                    break;
+                case OpMemberDecorate:
+                    if (wordCount >= 5)
+                    {
+                        auto& member = memberDecorations[{ inst[1], inst[2] }];
+                        if (inst[3] == DecorationOffset)
+                        {
+                            member.offset = inst[4];
+                        }
+                        else if (inst[3] == DecorationMatrixStride)
+                        {
+                            member.matrixStride = inst[4];
+                        }
+                    }
+                    break;
+                case OpConstant:
+                case OpSpecConstant:
+                    if (wordCount >= 4 && inst[2] < bound)
+                    {
+                        defs[inst[2]] = inst;
+                    }
+                    break;
+                case OpVariable:
+                    if (wordCount >= 4 && inst[2] < bound)
+                    {
+                        defs[inst[2]] = inst;
+                        variables.push_back(inst[2]);
+                    }
+                    break;
+                default:
+                    //型の命令は結果のIDが1ワード目にある
+                    if (((opcode >= OpTypeVoid && opcode <= OpTypePointer) || opcode == OpTypeAccelerationStructureKHR) &&
+                        wordCount >= 2 && inst[1] < bound)
+                    {
+                        defs[inst[1]] = inst;
+                    }
+                    break;
+                }
+            }
+            return executionModel != UINT32_MAX;
+        }
+
+        static void AddDecoration(Decorations& decoration, uint32_t kind, uint32_t value)
+        {
+            switch (kind)
+            {
+            case DecorationDescriptorSet: decoration.set = value; break;
+            case DecorationBinding: decoration.binding = value; break;
+            case DecorationLocation: decoration.location = value; break;
+            case DecorationArrayStride: decoration.arrayStride = value; break;
+            case DecorationBuiltIn: decoration.builtIn = true; break;
+            case DecorationBufferBlock: decoration.bufferBlock = true; break;
+            default: break;
+            }
+        }
+
+        //定義のない(範囲外を含む)IDは0
+        uint32_t GetOp(uint32_t id) const
+        {
+            return id < defs.size() && !defs[id].empty() ? defs[id][0] & 0xffff : 0;
+        }
+        //配列の長さなど、整数定数の値(特殊化定数は既定値)
+        uint32_t GetConstant(uint32_t id) const
+        {
+            const uint32_t op = GetOp(id);
+            return (op == OpConstant || op == OpSpecConstant) ? defs[id][3] : 0;
+        }
+
+        //ブロック内の型のバイト数(実行時の大きさの配列は0)
+        uint32_t GetTypeSize(uint32_t typeId, uint32_t matrixStride = 0) const
+        {
+            const uint32_t op = GetOp(typeId);
+            if (op == 0)
+            {
+                return 0;
+            }
+            const auto& inst = defs[typeId];
+            switch (op)
+            {
+            case OpTypeBool:
+                return 4;
+            case OpTypeInt:
+            case OpTypeFloat:
+                return inst[2] / 8;
+            case OpTypeVector:
+                return GetTypeSize(inst[2]) * inst[3];
+            case OpTypeMatrix:
+                return (matrixStride != 0 ? matrixStride : GetTypeSize(inst[2])) * inst[3];
+            case OpTypeArray:
+            {
+                const uint32_t stride = decorations[typeId].arrayStride;
+                return (stride != 0 ? stride : GetTypeSize(inst[2], matrixStride)) * GetConstant(inst[3]);
+            }
+            case OpTypeStruct:
+            {
+                uint32_t size = 0;
+                for (uint32_t member = 0; member + 2 < inst.size(); ++member)
+                {
+                    size = std::max(size, GetMemberEnd(typeId, member));
+                }
+                return size;
+            }
+            default:
+                return 0;
+            }
+        }
+
+        //構造体のmember番目のメンバーの終わりのオフセット
+        uint32_t GetMemberEnd(uint32_t structId, uint32_t member) const
+        {
+            auto it = memberDecorations.find({ structId, member });
+            const auto decoration = it != memberDecorations.end() ? it->second : MemberDecorations{};
+            return decoration.offset + GetTypeSize(defs[structId][2 + member], decoration.matrixStride);
+        }
+
+        //変数の型から配列を外して、ディスクリプタの種類と数を求める
+        bool GetDescriptor(uint32_t typeId, uint32_t storageClass, VkDescriptorType& type, uint32_t& count) const
+        {
+            count = 1;
+            for (uint32_t op = GetOp(typeId); op == OpTypeArray || op == OpTypeRuntimeArray; op = GetOp(typeId))
+            {
+                count = op == OpTypeArray ? count * GetConstant(defs[typeId][3]) : 0;
+                typeId = defs[typeId][2];
+            }
+
+            switch (storageClass)
+            {
+            case StorageClassUniform:
+                //古い形式のストレージバッファはUniformにBufferBlockを付けて宣言される
+                type = decorations[typeId].bufferBlock ? VK_DESCRIPTOR_TYPE_STORAGE_BUFFER : VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+                return true;
+            case StorageClassStorageBuffer:
+                type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+                return true;
+            default:
+                break;
+            }
+
+            switch (GetOp(typeId))
+            {
+            case OpTypeSampler:
+                type = VK_DESCRIPTOR_TYPE_SAMPLER;
+                return true;
+            case OpTypeSampledImage:
+                type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+                return true;
+            case OpTypeAccelerationStructureKHR:
+                type = VK_DESCRIPTOR_TYPE_ACCELERATION_STRUCTURE_KHR;
+                return true;
+            case OpTypeImage:
+            {
+                const auto& inst = defs[typeId];
+                const bool storage = inst[7] == ImageSampledStorage;
+                if (inst[3] == DimBuffer)
+                {
+                    type = storage ? VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER : VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER;
+                }
+                else if (inst[3] == DimSubpassData)
+                {
+                    type = VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
+                }
+                else
+                {
+                    type = storage ? VK_DESCRIPTOR_TYPE_STORAGE_IMAGE : VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+                }
+                return true;
+            }
+            default:
+                return false;
+            }
+        }
+
+        //頂点入力を加える。行列, 配列は連続するlocationに列, 要素毎に割り当てる
+        bool AddVertexInputs(uint32_t typeId, uint32_t location, std::vector<ShaderReflection::VertexInput>& inputs) const
+        {
+            const uint32_t op = GetOp(typeId);
+            if (op == 0)
+            {
+                return false;
+            }
+            const auto& inst = defs[typeId];
+            switch (op)
+            {
+            case OpTypeMatrix:
+            case OpTypeArray:
+            {
+                const uint32_t count = op == OpTypeMatrix ? inst[3] : GetConstant(inst[3]);
+                for (uint32_t i = 0; i < count; ++i)
+                {
+                    if (!AddVertexInputs(inst[2], location + i, inputs))
+                    {
+                        return false;
+                    }
+                }
+                return count > 0;
+            }
+            case OpTypeVector:
+            case OpTypeInt:
+            case OpTypeFloat:
+            {
+                const bool isVector = op == OpTypeVector;
+                const uint32_t componentId = isVector ? inst[2] : typeId;
+                const uint32_t componentOp = GetOp(componentId);
+                if (componentOp != OpTypeInt && componentOp != OpTypeFloat)
+                {
+                    return false;
+                }
+                const auto& component = defs[componentId];
+                const uint32_t width = component[2];
+                const bool isSigned = componentOp == OpTypeInt && component[3] != 0;
+                const uint32_t componentCount = isVector ? inst[3] : 1;
+                const VkFormat format = ToVertexFormat(componentOp, width, isSigned, componentCount);
+                if (format == VK_FORMAT_UNDEFINED)
+                {
+                    return false;
+                }
+                inputs.push_back(ShaderReflection::VertexInput{
+                    .location = location,
+                    .format = format,
+                    .size = width / 8 * componentCount,
+                });
+                return true;
+            }
+            default:
+                return false;
+            }
+        }
+    };
+}
+
+/*************************************************
+ShaderReflection
+*************************************************/
+
+bool ShaderReflection::Parse(std::span<const uint32_t> code)
+{
+    *this = ShaderReflection{};
+
+    SpirvModule module;
+    if (!module.Load(code))
+    {
+        return false;
+    }
+    const VkShaderStageFlagBits stage = ToShaderStage(module.executionModel);
+    if (stage == 0)
+    {
+        return false;
+    }
+
+    std::vector<DescriptorBinding> bindings;
+    VkPushConstantRange pushConstantRange{};
+    std::vector<VertexInput> vertexInputs;
+    for (uint32_t id : module.variables)
+    {
+        const auto& variable = module.defs[id];
+        const uint32_t storageClass = variable[3];
+        if (module.GetOp(variable[1]) != OpTypePointer)
+        {
+            return false;
+        }
+        const uint32_t typeId = module.defs[variable[1]][3];
+        const auto& decoration = module.decorations[id];
+
+        switch (storageClass)
+        {
+        case StorageClassUniformConstant:
+        case StorageClassUniform:
+        case StorageClassStorageBuffer:
+        {
+            DescriptorBinding binding{ .set = decoration.set, .binding = decoration.binding };
+            if (!module.GetDescriptor(typeId, storageClass, binding.type, binding.count))
+            {
+                return false;
+            }
+            bindings.push_back(binding);
+            break;
+        }
+        case StorageClassPushConstant:
+        {
+            //ステージが使うメンバーの範囲だけを宣言するシェーダーもあるため、先頭のメンバーのオフセットから数える
+            if (module.GetOp(typeId) != OpTypeStruct)
+            {
+                return false;
+            }
+            const auto& block = module.defs[typeId];
+            uint32_t begin = UINT32_MAX;
+            uint32_t end = 0;
+            for (uint32_t member = 0; member + 2 < block.size(); ++member)
+            {
+                auto it = module.memberDecorations.find({ typeId, member });
+                begin = std::min(begin, it != module.memberDecorations.end() ? it->second.offset : 0u);
+                end = std::max(end, module.GetMemberEnd(typeId, member));
+            }
+            if (end > begin)
+            {
+                pushConstantRange = { .stageFlags = VkShaderStageFlags(stage), .offset = begin, .size = end - begin };
+            }
+            break;
+        }
+        case StorageClassInput:
+            if (stage == VK_SHADER_STAGE_VERTEX_BIT && !decoration.builtIn && decoration.location != UINT32_MAX)
+            {
+                if (!module.AddVertexInputs(typeId, decoration.location, vertexInputs))
+                {
+                    return false;
+                }
+            }
+            break;
+        default:
+            break;
+        }
+    }
+
+    std::sort(bindings.begin(), bindings.end(), [](const DescriptorBinding& a, const DescriptorBinding& b)
+    {
+        return a.set != b.set ? a.set < b.set : a.binding < b.binding;
+    });
+    std::sort(vertexInputs.begin(), vertexInputs.end(), [](const VertexInput& a, const VertexInput& b)
+    {
+        return a.location < b.location;
+    });
+
+    m_stage = stage;
+    m_bindings = std::move(bindings);
+    m_pushConstantRange = pushConstantRange;
+    m_vertexInputs = std::move(vertexInputs);
+    return true;
+}
+
+/*************************************************
+PipelineReflection
+*************************************************/
+
+PipelineReflection& PipelineReflection::AddStage(const ShaderReflection& reflection)
+{
+    if (!reflection.IsValid())
+    {
+        throw std::runtime_error("shader reflection is not available");
+    }
+
+    const VkShaderStageFlagBits stage = reflection.GetStage();
+    for (const auto& binding : reflection.GetDescriptorBindings())
+    {
+        auto [it, inserted] = m_bindings.try_emplace(BindingKey(binding.set, binding.binding),
+            Binding{ .type = binding.type, .count = binding.count, .stageFlags = 0 });
+        if (!inserted && (it->second.type != binding.type || it->second.count != binding.count))
+        {
+            throw std::runtime_error("descriptor binding differs between shader stages");
+        }
+        it->second.stageFlags |= stage;
+    }
+
+    const auto& range = reflection.GetPushConstantRange();
+    if (range.size > 0)
+    {
+        if (m_pushConstantRange.size == 0)
+        {
+            m_pushConstantRange = range;
+        }
+        else
+        {
+            //ステージ毎に範囲を分けるとvkCmdPushConstantsで重なる範囲のステージを全て指定する必要があるため、1つにまとめる
+            const uint32_t end = std::max(m_pushConstantRange.offset + m_pushConstantRange.size, range.offset + range.size);
+            m_pushConstantRange.offset = std::min(m_pushConstantRange.offset, range.offset);
+            m_pushConstantRange.size = end - m_pushConstantRange.offset;
+            m_pushConstantRange.stageFlags |= range.stageFlags;
+        }
+    }
+
+    if (stage == VK_SHADER_STAGE_VERTEX_BIT)
+    {
+        m_vertexInputs = reflection.GetVertexInputs();
+    }
+    return *this;
+}
+
+PipelineReflection& PipelineReflection::AddShaderModule(VkShaderModule module)
+{
+    const auto* reflection = VulkanContext::Get().GetShaderModuleCache().GetReflection(module);
+    if (reflection == nullptr)
+    {
+        throw std::runtime_error("shader module has no reflection (not loaded through ShaderModuleCache, or unsupported SPIR-V)");
+    }
+    return AddStage(*reflection);
+}
+
+PipelineReflection& PipelineReflection::SetDescriptorType(uint32_t set, uint32_t binding, VkDescriptorType type)
+{
+    m_typeOverrides[BindingKey(set, binding)] = type;
+    return *this;
+}
+
+PipelineReflection& PipelineReflection::SetDescriptorCount(uint32_t set, uint32_t binding, uint32_t count)
+{
+    m_countOverrides[BindingKey(set, binding)] = count;
+    return *this;
+}
+
+uint32_t PipelineReflection::GetSetCount() const
+{
+    return m_bindings.empty() ? 0 : uint32_t(m_bindings.rbegin()->first >> 32) + 1;
+}
+
+std::vector<VkDescriptorSetLayoutBinding> PipelineReflection::GetSetLayoutBindings(uint32_t set) const
+{
+    std::vector<VkDescriptorSetLayoutBinding> bindings;
+    for (auto it = m_bindings.lower_bound(BindingKey(set, 0)); it != m_bindings.end() && (it->first >> 32) == set; ++it)
+    {
+        auto type = m_typeOverrides.find(it->first);
+        auto count = m_countOverrides.find(it->first);
+        bindings.push_back(VkDescriptorSetLayoutBinding{
+            .binding = uint32_t(it->first),
+            .descriptorType = type != m_typeOverrides.end() ? type->second : it->second.type,
+            .descriptorCount = count != m_countOverrides.end() ? count->second : it->second.count,
+            .stageFlags = it->second.stageFlags,
+            .pImmutableSamplers = nullptr,
+        });
+    }
+    return bindings;
+}
+
+std::vector<VkPushConstantRange> PipelineReflection::GetPushConstantRanges() const
+{
+    if (m_pushConstantRange.size == 0)
+    {
+        return {};
+    }
+    return { m_pushConstantRange };
+}
+
+PipelineReflection::VertexInputState PipelineReflection::GetVertexInputState(uint32_t binding) const
+{
+    VertexInputState state;
+    uint32_t offset = 0;
+    for (const auto& input : m_vertexInputs)
+    {
+        state.attributes.push_back(VkVertexInputAttributeDescription{
+            .location = input.location,
+            .binding = binding,
+            .format = input.format,
+            .offset = offset,
+        });
+        offset += input.size;
+    }
+    state.binding = {
+        .binding = binding,
+        .stride = offset,
+        .inputRate = VK_VERTEX_INPUT_RATE_VERTEX,
+    };
+    return state;
+}
@@ -0,0 +1,83 @@
+#include <algorithm>
+
+#include "core/StagingRing.h"
+
+bool StagingRing::Initialize(VkDeviceSize size)
+{
+    m_buffer = StagingBuffer::Create(size);
+    if (!m_buffer)
+    {
+        return false;
+    }
+
+    //常時マップされているため、以降のアップロードはmemcpyのみで済む
+    m_mapped = static_cast<uint8_t*>(m_buffer->Map());
+    m_capacity = size;
+    m_head = m_tail = m_closedHead = 0;
+    m_submissions.clear();
+    return m_mapped != nullptr;
+}
+
+void StagingRing::Cleanup()
+{
+    m_submissions.clear();
+    m_mapped = nullptr;
+    m_buffer.reset();
+    m_capacity = 0;
+}
+
+bool StagingRing::Allocate(VkDeviceSize size, Region& region)
+{
+    uint64_t start = (m_head + CopyAlignment - 1) & ~(CopyAlignment - 1);
+    uint64_t offset = start % m_capacity;
+
+    //バッファ終端をまたぐ場合は先頭まで読み飛ばす
+    if (offset + CopyAlignment > m_capacity)
+    {
+        start += m_capacity - offset;
+        offset = 0;
+    }
+
+    uint64_t used = start - m_tail;
+    if (used >= m_capacity)
+    {
+        return false;
+    }
+
+    //空き容量とバッファ終端までの長さのうち、小さい方まで確保できる
+    VkDeviceSize available = std::min<VkDeviceSize>(m_capacity - used, m_capacity - offset);
+    VkDeviceSize allocSize = std::min(size, available);
+
+    region = Region{
+        .buffer = m_buffer->GetVkBuffer(),
+        .offset = offset,
+        .size = allocSize,
+        .mapped = m_mapped + offset,
+    };
+    m_head = start + allocSize;
+    return true;
+}
+
+void StagingRing::Flush(const Region& region)
+{
+    m_buffer->Flush(region.offset, region.size);
+}
+
+void StagingRing::CloseSubmission(uint64_t ticket)
+{
+    if (m_head == m_closedHead)
+    {
+        return;
+    }
+    m_submissions.push_back({ ticket, m_head });
+    m_closedHead = m_head;
+}
+
+void StagingRing::Reclaim(uint64_t completedTicket)
+{
+    while (!m_submissions.empty() && m_submissions.front().ticket <= completedTicket)
+    {
+        m_tail = m_submissions.front().head;
+        m_submissions.pop_front();
+    }
+}
@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <cassert>
 #include <stdexcept>
 
@@ -28,7 +29,7 @@ bool Swapchain::Recreate(uint32_t width, uint32_t height)
     std::vector<VkSurfaceFormatKHR> formats(count);
     vkGetPhysicalDeviceSurfaceFormatsKHR(vkPhysicalDevice, surface, &count, formats.data());
 
-    //o̓tH[}bgI
+    //出力フォーマット選択
     VkSurfaceFormatKHR format = formats[0];
     for (auto& surfaceFormat : formats)
     {
@@ -43,12 +44,13 @@ bool Swapchain::Recreate(uint32_t width, uint32_t height)
             break;
         }
     }
-    auto imageCount = std::max(3u, caps.minImageCount);
+    auto presentMode = SelectPresentMode();
+    auto imageCount = SelectImageCount(caps, presentMode);
 
     VkSwapchainCreateInfoKHR info{};
     info.sType = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR;
     info.surface = surface;
-    info.minImageCount = caps.minImageCount + 1;
+    info.minImageCount = imageCount;
     info.imageFormat = format.format;
     info.imageColorSpace = format.colorSpace;
     info.imageExtent = extent;
@@ -57,22 +59,25 @@ bool Swapchain::Recreate(uint32_t width, uint32_t height)
     info.imageSharingMode = VK_SHARING_MODE_EXCLUSIVE;
     info.preTransform = VK_SURFACE_TRANSFORM_IDENTITY_BIT_KHR;
     info.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
-    info.presentMode = VK_PRESENT_MODE_FIFO_KHR;
+    info.presentMode = presentMode;
     info.clipped = VK_TRUE;
     info.oldSwapchain = m_swapchain;
 
-    //GPUAChԂɂȂĂXbv`FC()쐬
-    vkDeviceWaitIdle(vkDevice);
-
+    //古いスワップチェインを渡して作成し、表示中のイメージを引き継がせる
     VkSwapchainKHR swapchain{};
     if (vkCreateSwapchainKHR(vkDevice, &info, nullptr, &swapchain) != VK_SUCCESS)
     {
         throw std::runtime_error("Failed to create swapchain");
     }
 
+    //処理中のフレームが古いイメージ, セマフォを参照しているため、破棄はフレームの完了後に行う
+    RetireResources();
+
     m_swapchain = swapchain;
     m_imageFormat = format;
     m_imageExtent = extent;
+    m_presentMode = presentMode;
+    m_currentIndex = 0;
 
     vkGetSwapchainImagesKHR(vkDevice, m_swapchain, &imageCount, nullptr);
     m_images.resize(imageCount);
@@ -126,6 +131,7 @@ void Swapchain::Cleanup()
     }
     m_images.clear();
     m_imageViews.clear();
+    DestroyFrameContext();
 }
 
 VkResult Swapchain::AcquireNextImage()
@@ -133,20 +139,21 @@ VkResult Swapchain::AcquireNextImage()
     auto& vulkanCtx = VulkanContext::Get();
     auto vkDevice = vulkanCtx.GetVkDevice();
 
-    //v[e[V҂ŎgpZ}tH̎擾
+    //プレゼンテーション完了待ちで使用するセマフォの取得
     assert(!m_presentSemaphoreList.empty());
     VkSemaphore acquireSemaphore = m_presentSemaphoreList.back();
     m_presentSemaphoreList.pop_back();
 
-    //p\ȃC[W擾łȂ΁AXgɖ߂
+    //利用可能なイメージが取得できなければ、リストに戻す
+    //SUBOPTIMALの場合はイメージが取得されセマフォもシグナルされるため、そのまま使用する
     auto result = vkAcquireNextImageKHR(vkDevice, m_swapchain, UINT64_MAX, acquireSemaphore, VK_NULL_HANDLE, &m_currentIndex);
-    if (result != VK_SUCCESS)
+    if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR)
     {
         m_presentSemaphoreList.push_back(acquireSemaphore);
         return result;
     }
 
-    //p\ȃC[W擾ł΁AOɎgpĂZ}tH, `u
+    //利用可能なイメージが取得できれば、前に使用していたセマフォ, 描画先を置き換える
     VkSemaphore oldSemaphore = m_frames[m_currentIndex].presentComplete;
     if (oldSemaphore != VK_NULL_HANDLE)
     {
@@ -185,6 +192,90 @@ VkSemaphore Swapchain::GetRenderCompleteSemaphore() const
 private
 *************************************************/
 
+VkPresentModeKHR Swapchain::SelectPresentMode() const
+{
+    auto& vulkanCtx = VulkanContext::Get();
+    uint32_t count = 0;
+    vkGetPhysicalDeviceSurfacePresentModesKHR(vulkanCtx.GetVkPhysicalDevice(), vulkanCtx.GetSurface(), &count, nullptr);
+    std::vector<VkPresentModeKHR> supportedModes(count);
+    vkGetPhysicalDeviceSurfacePresentModesKHR(vulkanCtx.GetVkPhysicalDevice(), vulkanCtx.GetSurface(), &count, supportedModes.data());
+
+    //希望するモードが非対応であれば、性質の近いモードを順に試す(FIFOは常にサポートされている)
+    std::vector<VkPresentModeKHR> candidates = { m_desiredPresentMode };
+    switch (m_desiredPresentMode)
+    {
+    case VK_PRESENT_MODE_MAILBOX_KHR:
+        candidates.push_back(VK_PRESENT_MODE_IMMEDIATE_KHR);
+        break;
+    case VK_PRESENT_MODE_IMMEDIATE_KHR:
+        candidates.push_back(VK_PRESENT_MODE_MAILBOX_KHR);
+        break;
+    default:
+        break;
+    }
+    for (auto mode : candidates)
+    {
+        if (std::find(supportedModes.begin(), supportedModes.end(), mode) != supportedModes.end())
+        {
+            return mode;
+        }
+    }
+    return VK_PRESENT_MODE_FIFO_KHR;
+}
+
+uint32_t Swapchain::SelectImageCount(const VkSurfaceCapabilitiesKHR& caps, VkPresentModeKHR presentMode) const
+{
+    //MAILBOXは表示中, 待機中に加えて描画先が必要なため3枚、それ以外は最小数+1枚とする
+    uint32_t imageCount = m_desiredImageCount;
+    if (imageCount == 0)
+    {
+        imageCount = (presentMode == VK_PRESENT_MODE_MAILBOX_KHR) ? 3u : caps.minImageCount + 1;
+    }
+    imageCount = std::max(imageCount, caps.minImageCount);
+    if (caps.maxImageCount > 0) //0は上限なし
+    {
+        imageCount = std::min(imageCount, caps.maxImageCount);
+    }
+    return imageCount;
+}
+
+void Swapchain::RetireResources()
+{
+    if (m_swapchain == VK_NULL_HANDLE)
+    {
+        return;
+    }
+
+    std::vector<VkSemaphore> semaphores = std::move(m_presentSemaphoreList);
+    for (auto& frame : m_frames)
+    {
+        semaphores.push_back(frame.renderComplete);
+        semaphores.push_back(frame.presentComplete);
+    }
+    VulkanContext::Get().DeferDestroy([
+        device = VulkanContext::Get().GetVkDevice(),
+        swapchain = m_swapchain,
+        imageViews = std::move(m_imageViews),
+        semaphores = std::move(semaphores)]()
+    {
+        for (auto view : imageViews)
+        {
+            vkDestroyImageView(device, view, nullptr);
+        }
+        for (auto semaphore : semaphores)
+        {
+            vkDestroySemaphore(device, semaphore, nullptr);
+        }
+        vkDestroySwapchainKHR(device, swapchain, nullptr);
+    });
+
+    m_swapchain = VK_NULL_HANDLE;
+    m_images.clear();
+    m_imageViews.clear();
+    m_frames.clear();
+    m_presentSemaphoreList.clear();
+}
+
 void Swapchain::CreateFrameContext()
 {
     auto& vulkanCtx = VulkanContext::Get();
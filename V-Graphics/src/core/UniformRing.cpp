@@ -0,0 +1,77 @@
+#include <algorithm>
+
+#include "core/UniformRing.h"
+
+bool UniformRing::Initialize(uint32_t slotCount, VkDeviceSize slotSize)
+{
+    const auto& limits = VulkanContext::Get().GetPhysicalDeviceProperties().limits;
+
+    //スロットの境界はノンコヒーレントなメモリのフラッシュ単位にも揃える
+    m_alignment = std::max<VkDeviceSize>(limits.minUniformBufferOffsetAlignment, 1);
+    const VkDeviceSize slotAlignment = std::max(m_alignment, limits.nonCoherentAtomSize);
+    m_slotSize = (slotSize + slotAlignment - 1) / slotAlignment * slotAlignment;
+    m_slotCount = std::max(slotCount, 1u);
+
+    //末尾の確保でも動的オフセット + rangeがバッファに収まるよう、最大range分の余白を付ける
+    m_maxRange = std::min<VkDeviceSize>(limits.maxUniformBufferRange, 65536);
+    m_buffer = UniformBuffer::Create(m_slotSize * m_slotCount + m_maxRange);
+    if (!m_buffer)
+    {
+        return false;
+    }
+
+    m_mapped = static_cast<uint8_t*>(m_buffer->Map());
+    m_currentSlot = 0;
+    ++m_generation;
+    m_used = 0;
+    return m_mapped != nullptr;
+}
+
+void UniformRing::Cleanup()
+{
+    m_mapped = nullptr;
+    m_buffer.reset();
+    m_slotCount = 0;
+    m_slotSize = 0;
+    m_used = 0;
+}
+
+void UniformRing::BeginSlot(uint32_t slot)
+{
+    m_currentSlot = slot % m_slotCount;
+    m_used = 0;
+}
+
+UniformRing::Allocation UniformRing::Allocate(VkDeviceSize size)
+{
+    const VkDeviceSize alignedSize = (size + m_alignment - 1) / m_alignment * m_alignment;
+    const VkDeviceSize offset = m_used.fetch_add(alignedSize);
+    if (offset + alignedSize > m_slotSize)
+    {
+        return {};
+    }
+
+    const VkDeviceSize bufferOffset = m_slotSize * m_currentSlot + offset;
+    return Allocation{
+        .mapped = m_mapped + bufferOffset,
+        .dynamicOffset = uint32_t(bufferOffset),
+    };
+}
+
+void UniformRing::Flush()
+{
+    const VkDeviceSize used = GetUsedSize();
+    if (used > 0)
+    {
+        m_buffer->Flush(m_slotSize * m_currentSlot, used);
+    }
+}
+
+VkDescriptorBufferInfo UniformRing::GetDescriptorInfo(VkDeviceSize range) const
+{
+    return VkDescriptorBufferInfo{
+        .buffer = m_buffer->GetVkBuffer(),
+        .offset = 0,
+        .range = std::min(range, m_maxRange),
+    };
+}
@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <cassert>
 #include <stdexcept>
 #include <iostream>
@@ -5,6 +6,9 @@
 
 #include "core/VulkanContext.h"
 #include "core/Swapchain.h"
+#include "core/OffscreenSwapchain.h"
+#include "core/UniformRing.h"
+#include "core/ISurfaceProvider.h"
 
 #define VK_GET_INSTANCE_PROC_ADDR(instance, name, ...) \
     reinterpret_cast<PFN_##name>(vkGetInstanceProcAddr(instance, #name))
@@ -26,17 +30,50 @@ void VulkanContext::Initialize(const char* appName, ISurfaceProvider* surfacePro
     PickPhysicalDevice();
     CreateDebugMessenger();
     CreateLogicalDevice();
+
+    m_memoryAllocator = std::make_unique<DeviceMemoryAllocator>();
+    m_memoryAllocator->Initialize(m_vkDevice, m_vkPhysicalDevice, IsDeviceExtensionSupported(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME));
+
+    CreatePipelineCache();
+    CreateTimelineSemaphore();
     CreateCommandPool();
-    CreateDescriptorPool();
+    CreateDescriptorAllocator();
+    CreateBindlessHeap();
+
+    if (m_workerThreadCount == UINT32_MAX)
+    {
+        m_workerThreadCount = std::max(std::thread::hardware_concurrency(), 1u) - 1;
+    }
+    m_workerThreadPool.Initialize(m_workerThreadCount);
 }
 
 void VulkanContext::Cleanup()
 {
-    //foCXAChԂɂȂĂji߂
+    //デバイスがアイドル状態になってから破棄処理を進める
     vkDeviceWaitIdle(m_vkDevice);
 
+    m_workerThreadPool.Cleanup();
+    m_deletionQueue.Flush();
+    m_pipelineRegistry.Cleanup();
+    m_pipelineLibrary.Cleanup();
+    m_pipelineCache.Cleanup();
+    m_shaderModuleCache.Cleanup();
+    m_pipelineLayoutCache.Cleanup();
     DestroyFrameContexts();
+    if (m_frameUniformRing)
+    {
+        m_frameUniformRing->Cleanup();
+        m_frameUniformRing.reset();
+    }
     vkDestroyCommandPool(m_vkDevice, m_commandPool, nullptr);
+    m_descriptorAllocator.Cleanup();
+    if (m_bindlessHeap)
+    {
+        m_bindlessHeap->Cleanup();
+        m_bindlessHeap.reset();
+    }
+    vkDestroySemaphore(m_vkDevice, m_timelineSemaphore, nullptr);
+    m_timelineSemaphore = VK_NULL_HANDLE;
 
     if (m_debugMessenger != VK_NULL_HANDLE)
     {
@@ -60,6 +97,11 @@ void VulkanContext::Cleanup()
         m_surface = VK_NULL_HANDLE;
     }
 
+    //ここまでの後始末で登録された破棄を実行し、全リソースの解放後にメモリブロックを返却
+    m_deletionQueue.Flush();
+    m_memoryAllocator->Cleanup();
+    m_memoryAllocator.reset();
+
     vkDestroyDevice(m_vkDevice, nullptr);
     vkDestroyInstance(m_vkInstance, nullptr);
     m_vkDevice = VK_NULL_HANDLE;
@@ -70,15 +112,24 @@ void VulkanContext::RecreateSwapchain()
 {
     if (m_swapchain == nullptr)
     {
-        m_swapchain = std::make_unique<Swapchain>();
+        if (IsHeadless())
+        {
+            m_swapchain = std::make_unique<OffscreenSwapchain>();
+        }
+        else
+        {
+            m_swapchain = std::make_unique<Swapchain>();
+        }
     }
+    m_swapchain->SetPresentMode(m_presentMode);
+    m_swapchain->SetDesiredImageCount(m_swapchainImageCount);
 
-    if (m_surface == VK_NULL_HANDLE)
+    if (m_surface == VK_NULL_HANDLE && !IsHeadless())
     {
         CreateSurface();
     }
 
-    //𑜓x𓾂ăXbv`FC쐬
+    //解像度情報を得てスワップチェイン作成
     auto width = m_surfaceProvider->GetFramebufferWidth();
     auto height = m_surfaceProvider->GetFramebufferHeight();
     m_swapchain->Recreate(width, height);
@@ -86,6 +137,23 @@ void VulkanContext::RecreateSwapchain()
     CreateFrameContexts();
 }
 
+bool VulkanContext::IsHeadless() const
+{
+    return m_surfaceProvider != nullptr && m_surfaceProvider->IsHeadless();
+}
+
+bool VulkanContext::IsDeviceExtensionSupported(const char* extensionName) const
+{
+    for (const auto& ext : m_deviceExtensions)
+    {
+        if (strcmp(ext.extensionName, extensionName) == 0)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
 std::shared_ptr<CommandBuffer> VulkanContext::CreateCommandBuffer()
 {
     VkCommandBufferAllocateInfo commandAI
@@ -98,20 +166,19 @@ std::shared_ptr<CommandBuffer> VulkanContext::CreateCommandBuffer()
     VkCommandBuffer commandBuffer{};
     vkAllocateCommandBuffers(m_vkDevice, &commandAI, &commandBuffer);
 
-    return std::make_shared<CommandBuffer>(commandBuffer);
+    return std::make_shared<CommandBuffer>(commandBuffer, m_commandPool);
 }
 
-VkDescriptorSet VulkanContext::AllocateDescriptorSet(VkDescriptorSetLayout layout)
+std::shared_ptr<CommandBuffer> VulkanContext::AcquireFrameCommandBuffer(VkCommandBufferLevel level)
 {
-    VkDescriptorSetAllocateInfo allocInfo{
-        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
-        .descriptorPool = m_descriptorPool,
-        .descriptorSetCount = 1,
-        .pSetLayouts = &layout,
-    };
+    return m_frameCommandPools.Acquire(level);
+}
 
+VkDescriptorSet VulkanContext::AllocateDescriptorSet(VkDescriptorSetLayout layout)
+{
+    //プールが枯渇した場合はアロケータがプールを追加するため、失敗はメモリ不足のみ
     VkDescriptorSet descriptorSet;
-    if (vkAllocateDescriptorSets(m_vkDevice, &allocInfo, &descriptorSet) != VK_SUCCESS)
+    if (!m_descriptorAllocator.Allocate(layout, descriptorSet))
     {
         throw std::runtime_error("failed to allocate descriptor set!");
     }
@@ -121,61 +188,249 @@ VkDescriptorSet VulkanContext::AllocateDescriptorSet(VkDescriptorSetLayout layou
 
 void VulkanContext::FreeDescriptorSet(VkDescriptorSet descriptorSet)
 {
-    vkFreeDescriptorSets(m_vkDevice, m_descriptorPool, 1, &descriptorSet);
+    m_descriptorAllocator.Free(descriptorSet);
+}
+
+VkDescriptorSet VulkanContext::AllocateFrameDescriptorSet(VkDescriptorSetLayout layout)
+{
+    VkDescriptorSet descriptorSet;
+    if (!GetCurrentFrameContext()->descriptorAllocator->Allocate(layout, descriptorSet))
+    {
+        throw std::runtime_error("failed to allocate frame descriptor set!");
+    }
+
+    return descriptorSet;
 }
 
 VkResult VulkanContext::AcquireNextImage()
 {
+    //このフレームコンテキストを前回使用した提出の完了を待つ
     auto* frame = GetCurrentFrameContext();
-    auto fence = frame->inflightFence;
-    vkWaitForFences(m_vkDevice, 1, &fence, VK_TRUE, UINT64_MAX);
+    WaitTimelineValue(frame->timelineValue);
+
+    //GPUが処理を終えたフレームで登録された破棄を実行する
+    m_deletionQueue.Collect(GetCompletedTimelineValue());
+
+    //完了したフレームのコマンドプールをまとめてリセットし、コマンドバッファを払い出し直す
+    m_frameCommandPools.BeginSlot(m_currentFrameIndex);
+    frame->commandBuffer = m_frameCommandPools.Acquire();
+    frame->acquireCommandBuffer = nullptr;
+    frame->descriptorAllocator->Reset();
+    m_frameUniformRing->BeginSlot(m_currentFrameIndex);
+    m_memoryAllocator->UpdateBudget();
 
     auto result = m_swapchain->AcquireNextImage();
-    if (result == VK_SUCCESS)
+    if (result == VK_ERROR_OUT_OF_DATE_KHR) //最小化時の対策
     {
-        vkResetFences(m_vkDevice, 1, &fence);
+        ResizeSwapchain();
     }
-    else if (result == VK_ERROR_OUT_OF_DATE_KHR) //ŏ̑΍
+    else if (result == VK_SUBOPTIMAL_KHR)
     {
-        auto width = m_surfaceProvider->GetFramebufferWidth();
-        auto height = m_surfaceProvider->GetFramebufferHeight();
-        if (width > 0 &&
-            height > 0)
-        {
-            m_swapchain->Recreate(width, height);
-        }
+        //イメージは取得済みのためこのフレームは描画し、表示後に作り直す
+        m_swapchainSuboptimal = true;
+        result = VK_SUCCESS;
     }
 
-    assert(result != VK_ERROR_DEVICE_LOST); //foCXXgԂȂ炱Œ~
+    assert(result != VK_ERROR_DEVICE_LOST); //デバイスロスト状態ならここで停止
     return result;
 }
 
 void VulkanContext::SubmitPresent()
 {
     auto& frame = m_frameContext[GetCurrentFrameIndex()];
+    m_frameUniformRing->Flush();
 
-    VkPipelineStageFlags waitStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-    VkSubmitInfo submitInfo{
-        .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO
-    };
-    //{t[ŎgpZ}tH擾
+    //本フレームで使用するセマフォを取得する
     VkSemaphore renderCompleteSem = m_swapchain->GetRenderCompleteSemaphore();
     VkSemaphore presentCompleteSem = m_swapchain->GetPresentCompleteSemaphore();
 
-    VkCommandBuffer commandBuffer = frame.commandBuffer->Get();
-    submitInfo.commandBufferCount = 1;
-    submitInfo.pCommandBuffers = &commandBuffer;
-    submitInfo.pWaitDstStageMask = &waitStageMask;
-    submitInfo.waitSemaphoreCount = 1;
-    submitInfo.pWaitSemaphores = &presentCompleteSem;
-    submitInfo.signalSemaphoreCount = 1;
-    submitInfo.pSignalSemaphores = &renderCompleteSem;
-    auto result = vkQueueSubmit(m_graphicsQueue, 1, &submitInfo, frame.inflightFence);
-    assert(result != VK_ERROR_DEVICE_LOST); //foCXXgԂȂ炱Œ~
-
-    //܂łŃOtBbNXL[PresentT|[gĂ邱Ƃ̓`FbNς
-    m_swapchain->QueuePresent(m_graphicsQueue);
+    //アップロード完了などの登録済み待機に、イメージ取得の待機を加える
+    //オフスクリーン描画ではPresentエンジンとの同期が不要なためセマフォを使わない
+    std::vector<VkSemaphoreSubmitInfo> waitInfos = std::move(m_pendingFrameWaits);
+    m_pendingFrameWaits.clear();
+    if (presentCompleteSem != VK_NULL_HANDLE)
+    {
+        waitInfos.push_back({
+            .sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO,
+            .semaphore = presentCompleteSem,
+            .stageMask = VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT,
+        });
+    }
+    //フレーム完了の判定用に、タイムラインセマフォへ次の値をシグナルする
+    frame.timelineValue = ++m_submittedTimelineValue;
+    std::vector<VkSemaphoreSubmitInfo> signalInfos;
+    signalInfos.push_back({
+        .sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO,
+        .semaphore = m_timelineSemaphore,
+        .value = frame.timelineValue,
+        .stageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT,
+    });
+    if (renderCompleteSem != VK_NULL_HANDLE)
+    {
+        signalInfos.push_back({
+            .sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO,
+            .semaphore = renderCompleteSem,
+            .stageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT,
+        });
+    }
+
+    //所有権の取得が必要なバッファがあれば、フレームのコマンドより先に実行する
+    std::vector<VkCommandBufferSubmitInfo> commandInfos;
+    if (!m_pendingAcquireBarriers.empty())
+    {
+        if (frame.acquireCommandBuffer == nullptr)
+        {
+            frame.acquireCommandBuffer = m_frameCommandPools.Acquire();
+        }
+        auto& acquireCommand = frame.acquireCommandBuffer;
+        acquireCommand->Begin(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+        VkDependencyInfo depInfo{
+            .sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+            .bufferMemoryBarrierCount = uint32_t(m_pendingAcquireBarriers.size()),
+            .pBufferMemoryBarriers = m_pendingAcquireBarriers.data(),
+        };
+        vkCmdPipelineBarrier2(*acquireCommand, &depInfo);
+        acquireCommand->End();
+        m_pendingAcquireBarriers.clear();
+
+        commandInfos.push_back({
+            .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_SUBMIT_INFO,
+            .commandBuffer = acquireCommand->Get(),
+        });
+    }
+    commandInfos.push_back({
+        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_SUBMIT_INFO,
+        .commandBuffer = frame.commandBuffer->Get(),
+    });
+
+    VkSubmitInfo2 submitInfo{
+        .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO_2,
+        .waitSemaphoreInfoCount = uint32_t(waitInfos.size()),
+        .pWaitSemaphoreInfos = waitInfos.data(),
+        .commandBufferInfoCount = uint32_t(commandInfos.size()),
+        .pCommandBufferInfos = commandInfos.data(),
+        .signalSemaphoreInfoCount = uint32_t(signalInfos.size()),
+        .pSignalSemaphoreInfos = signalInfos.data(),
+    };
+    auto result = vkQueueSubmit2(m_graphicsQueue, 1, &submitInfo, VK_NULL_HANDLE);
+    assert(result != VK_ERROR_DEVICE_LOST); //デバイスロスト状態ならここで停止
+
+    //ここまででグラフィックスキューがPresentをサポートしていることはチェック済み
+    auto presentResult = m_swapchain->QueuePresent(m_graphicsQueue);
     AdvanceFrame();
+
+    if (presentResult == VK_ERROR_OUT_OF_DATE_KHR ||
+        presentResult == VK_SUBOPTIMAL_KHR ||
+        m_swapchainSuboptimal)
+    {
+        ResizeSwapchain();
+    }
+}
+
+void VulkanContext::SetMaxInflightFrames(uint32_t count)
+{
+    count = std::max(count, 1u);
+    if (count == m_maxInflightFrames)
+    {
+        return;
+    }
+    m_maxInflightFrames = count;
+
+    //作成済みであれば、処理中のフレームの完了を待ってからスワップチェインごと作り直す
+    //(オフスクリーンのイメージ数が同時処理フレーム数に依存するため)
+    if (!m_frameContext.empty())
+    {
+        WaitTimelineValue(m_submittedTimelineValue);
+        RecreateSwapchain();
+    }
+}
+
+void VulkanContext::SetPresentMode(VkPresentModeKHR presentMode)
+{
+    m_presentMode = presentMode;
+    if (m_swapchain)
+    {
+        m_swapchain->SetPresentMode(presentMode);
+        ResizeSwapchain();
+    }
+}
+
+void VulkanContext::SetSwapchainImageCount(uint32_t count)
+{
+    m_swapchainImageCount = count;
+    if (m_swapchain)
+    {
+        m_swapchain->SetDesiredImageCount(count);
+        ResizeSwapchain();
+    }
+}
+
+void VulkanContext::SetWorkerThreadCount(uint32_t count)
+{
+    m_workerThreadCount = count;
+    if (m_vkDevice != VK_NULL_HANDLE)
+    {
+        m_workerThreadPool.Initialize(count);
+    }
+
+    //フレームのコマンドプールはスレッド数分の枠で作るため、作成済みであれば作り直す
+    if (!m_frameContext.empty())
+    {
+        WaitTimelineValue(m_submittedTimelineValue);
+        RecreateSwapchain();
+    }
+}
+
+void VulkanContext::DeferDestroy(DeletionQueue::Deleter deleter)
+{
+    m_deletionQueue.Push(GetCurrentFrameTimelineValue(), std::move(deleter));
+}
+
+uint64_t VulkanContext::GetCompletedTimelineValue() const
+{
+    uint64_t value = 0;
+    vkGetSemaphoreCounterValue(m_vkDevice, m_timelineSemaphore, &value);
+    return value;
+}
+
+bool VulkanContext::WaitTimelineValue(uint64_t value, uint64_t timeout) const
+{
+    if (value == 0)
+    {
+        return true;
+    }
+    VkSemaphoreWaitInfo waitInfo{
+        .sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO,
+        .semaphoreCount = 1,
+        .pSemaphores = &m_timelineSemaphore,
+        .pValues = &value,
+    };
+    return vkWaitSemaphores(m_vkDevice, &waitInfo, timeout) == VK_SUCCESS;
+}
+
+void VulkanContext::AddFrameWaitSemaphore(VkSemaphore semaphore, uint64_t value, VkPipelineStageFlags2 stageMask)
+{
+    //同じセマフォへの待機は値の大きい方へまとめる
+    for (auto& wait : m_pendingFrameWaits)
+    {
+        if (wait.semaphore == semaphore)
+        {
+            wait.value = std::max(wait.value, value);
+            wait.stageMask |= stageMask;
+            return;
+        }
+    }
+    m_pendingFrameWaits.push_back({
+        .sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO,
+        .semaphore = semaphore,
+        .value = value,
+        .stageMask = stageMask,
+    });
+}
+
+void VulkanContext::AddQueueOwnershipAcquire(const VkBufferMemoryBarrier2& barrier)
+{
+    m_pendingAcquireBarriers.push_back(barrier);
 }
 
 /*************************************************
@@ -196,13 +451,16 @@ void VulkanContext::CreateInstance(const char* appName)
     std::vector<const char*> layerList;
 
 #if DEBUG || _DEBUG
-    //JA؃C[ƈꕔg@\L
+    //開発時、検証レイヤーと一部拡張機能有効化
     extensionList.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
     layerList.push_back("VK_LAYER_KHRONOS_validation");
 #endif
 
-    //GLFWLg@\
-    GetWindowSystemExtensions(extensionList);
+    //GLFWから有効化する拡張機能名を回収(ヘッドレスでは未設定)
+    if (GetWindowSystemExtensions)
+    {
+        GetWindowSystemExtensions(extensionList);
+    }
 
     VkInstanceCreateInfo createInfo{};
     createInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
@@ -222,7 +480,7 @@ void VulkanContext::CreateSurface()
 {
     m_surface = m_surfaceProvider->CreateSurface(m_vkInstance);
 
-    //OtBbNXL[̓T[tFXPresent𔭍sł邩𒲍
+    //グラフィックスキューはサーフェスへPresentを発行できるかを調査
     VkBool32 present = false;
     vkGetPhysicalDeviceSurfaceSupportKHR(m_vkPhysicalDevice, m_graphicsQueueFamilyIndex, m_surface, &present);
     if (present == VK_FALSE)
@@ -233,27 +491,32 @@ void VulkanContext::CreateSurface()
 
 void VulkanContext::PickPhysicalDevice()
 {
-    //GPUnh擾
+    //GPUハンドル取得
     uint32_t count = 0;
     vkEnumeratePhysicalDevices(m_vkInstance, &count, nullptr);
     std::vector<VkPhysicalDevice> devices(count);
     vkEnumeratePhysicalDevices(m_vkInstance, &count, devices.data());
     m_vkPhysicalDevice = devices[0];
 
-    //擾
+    //情報取得
     vkGetPhysicalDeviceMemoryProperties(m_vkPhysicalDevice, &m_memoryProperties);
     vkGetPhysicalDeviceProperties(m_vkPhysicalDevice, &m_physicalDeviceProperties);
+
+    uint32_t extCount = 0;
+    vkEnumerateDeviceExtensionProperties(m_vkPhysicalDevice, nullptr, &extCount, nullptr);
+    m_deviceExtensions.resize(extCount);
+    vkEnumerateDeviceExtensionProperties(m_vkPhysicalDevice, nullptr, &extCount, m_deviceExtensions.data());
 }
 
 void VulkanContext::CreateLogicalDevice()
 {
-    //L[t@~[擾
+    //キューファミリー情報取得
     uint32_t queueCount = 0;
     vkGetPhysicalDeviceQueueFamilyProperties(m_vkPhysicalDevice, &queueCount, nullptr);
     std::vector<VkQueueFamilyProperties> queues(queueCount);
     vkGetPhysicalDeviceQueueFamilyProperties(m_vkPhysicalDevice, &queueCount, queues.data());
 
-    //OtBbNXR}hłt@~[̃CfbNX擾
+    //グラフィックスコマンドを処理できるファミリーのインデックス取得
     m_graphicsQueueFamilyIndex = ~0u;
     for (uint32_t i = 0; const auto& props : queues)
     {
@@ -265,31 +528,81 @@ void VulkanContext::CreateLogicalDevice()
         ++i;
     }
 
-    //g@\̐ݒ
+    //グラフィックス, コンピュートを持たない転送専用のファミリーがあれば転送に使用する
+    m_transferQueueFamilyIndex = m_graphicsQueueFamilyIndex;
+    for (uint32_t i = 0; const auto& props : queues)
+    {
+        const bool isTransferOnly =
+            (props.queueFlags & VK_QUEUE_TRANSFER_BIT) &&
+            !(props.queueFlags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT));
+        if (isTransferOnly && props.queueCount > 0)
+        {
+            m_transferQueueFamilyIndex = i;
+            break;
+        }
+        ++i;
+    }
+
+    //拡張機能の設定
     BuildVkFeatures();
-    std::vector<const char*> deviceExtensions =
+    std::vector<const char*> deviceExtensions;
+
+    //ヘッドレスでもPRESENT_SRCレイアウトを扱えるよう、サポートされていれば有効にする
+    if (!IsHeadless() || IsDeviceExtensionSupported(VK_KHR_SWAPCHAIN_EXTENSION_NAME))
     {
-        VK_KHR_SWAPCHAIN_EXTENSION_NAME,
-    };
+        deviceExtensions.push_back(VK_KHR_SWAPCHAIN_EXTENSION_NAME);
+    }
 
-    //㉺킹邽߂ɗLƂ
+    //上下方向を合わせるために有効とする
     deviceExtensions.push_back(VK_KHR_MAINTENANCE1_EXTENSION_NAME);
 
+    //パイプラインの部分毎の作成と高速リンク
+    if (m_pipelineLibrarySupported)
+    {
+        deviceExtensions.push_back(VK_KHR_PIPELINE_LIBRARY_EXTENSION_NAME);
+        deviceExtensions.push_back(VK_EXT_GRAPHICS_PIPELINE_LIBRARY_EXTENSION_NAME);
+    }
+
+    //パイプラインを作らずにシェーダーとステートを直接設定する描画
+    if (m_shaderObjectSupported)
+    {
+        deviceExtensions.push_back(VK_EXT_SHADER_OBJECT_EXTENSION_NAME);
+    }
+
+    //シェーダーモジュールを作らずにSPIR-Vをパイプライン作成へ直接渡す
+    if (m_maintenance5Supported)
+    {
+        deviceExtensions.push_back(VK_KHR_MAINTENANCE_5_EXTENSION_NAME);
+    }
+
+    //ヒープの予算を見てメモリタイプを選ぶため、サポートされていれば有効にする
+    if (IsDeviceExtensionSupported(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME))
+    {
+        deviceExtensions.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+    }
+
     float priority = 1.0f;
+    std::vector<VkDeviceQueueCreateInfo> queueInfos;
     VkDeviceQueueCreateInfo queueInfo{};
     queueInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
     queueInfo.queueFamilyIndex = m_graphicsQueueFamilyIndex;
     queueInfo.queueCount = 1;
     queueInfo.pQueuePriorities = &priority;
+    queueInfos.push_back(queueInfo);
+    if (m_transferQueueFamilyIndex != m_graphicsQueueFamilyIndex)
+    {
+        queueInfo.queueFamilyIndex = m_transferQueueFamilyIndex;
+        queueInfos.push_back(queueInfo);
+    }
 
     VkDeviceCreateInfo deviceInfo{};
     deviceInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
-    deviceInfo.queueCreateInfoCount = 1;
-    deviceInfo.pQueueCreateInfos = &queueInfo;
+    deviceInfo.queueCreateInfoCount = uint32_t(queueInfos.size());
+    deviceInfo.pQueueCreateInfos = queueInfos.data();
     deviceInfo.enabledExtensionCount = uint32_t(deviceExtensions.size());
     deviceInfo.ppEnabledExtensionNames = deviceExtensions.data();
 
-    //Lɂ@\Xg pNext  VkPhysicalDeviceFeatures2 \̂Aēn
+    //有効にする機能リスト情報は pNext に VkPhysicalDeviceFeatures2 構造体を連結して渡す
     deviceInfo.pNext = &m_physDevFeatures;
     deviceInfo.pEnabledFeatures = nullptr;
 
@@ -300,14 +613,33 @@ void VulkanContext::CreateLogicalDevice()
     }
 
     vkGetDeviceQueue(m_vkDevice, m_graphicsQueueFamilyIndex, 0, &m_graphicsQueue);
+    vkGetDeviceQueue(m_vkDevice, m_transferQueueFamilyIndex, 0, &m_transferQueue);
+
+    if (m_shaderObjectSupported)
+    {
+        m_shaderObjectFunctions.Load(m_vkDevice);
+    }
 }
 
 void VulkanContext::AdvanceFrame()
 {
-    m_currentFrameIndex = (m_currentFrameIndex + 1) % MaxInflightFrames;
+    m_currentFrameIndex = (m_currentFrameIndex + 1) % m_maxInflightFrames;
+}
+
+void VulkanContext::ResizeSwapchain()
+{
+    //最小化中はサイズが0になるため、元に戻るまで作り直さない
+    auto width = m_surfaceProvider->GetFramebufferWidth();
+    auto height = m_surfaceProvider->GetFramebufferHeight();
+    if (width > 0 &&
+        height > 0)
+    {
+        m_swapchain->Recreate(width, height);
+        m_swapchainSuboptimal = false;
+    }
 }
 
-//\̂pNextqȗ̂߂̃ev[g
+//構造体のpNextを繋ぐ処理簡略化のためのテンプレート
 template<typename T>
 void BuildVkExtensionChain(T& last)
 {
@@ -322,17 +654,81 @@ void BuildVkExtensionChain(T& current, U& next, Rest&... rest)
 
 void VulkanContext::BuildVkFeatures()
 {
-    //foCXT|[g͈͂̏擾AĝL
-    //ŃT|[gȂ@\LɂƃfoCX쐬ɃG[ƂȂ
+    //デバイスからサポート範囲の情報を取得後、使うものを有効化
+    //ここでサポートされない機能を有効にするとデバイス作成時にエラーとなる
     BuildVkExtensionChain(
         m_physDevFeatures, m_vulkan11Features, m_vulkan12Features, m_vulkan13Features
     );
-    //T|[gԎ擾
+
+    //拡張機能の構造体は、使うものだけをVulkan 1.3の機能の後ろに繋ぐ
+    auto linkExtensionFeatures = [this](std::initializer_list<std::pair<bool, void*>> features)
+    {
+        void** next = &m_vulkan13Features.pNext;
+        for (auto [use, feature] : features)
+        {
+            if (use)
+            {
+                *next = feature;
+                next = &static_cast<VkBaseOutStructure*>(feature)->pNext;
+            }
+        }
+        *next = nullptr;
+    };
+
+    //パイプラインライブラリ, シェーダーオブジェクトは拡張機能があれば機能の対応状況も問い合わせる
+    const bool hasPipelineLibraryExtensions =
+        m_pipelineLibraryEnabled &&
+        IsDeviceExtensionSupported(VK_KHR_PIPELINE_LIBRARY_EXTENSION_NAME) &&
+        IsDeviceExtensionSupported(VK_EXT_GRAPHICS_PIPELINE_LIBRARY_EXTENSION_NAME);
+    const bool hasShaderObjectExtension = IsDeviceExtensionSupported(VK_EXT_SHADER_OBJECT_EXTENSION_NAME);
+    const bool hasMaintenance5Extension = IsDeviceExtensionSupported(VK_KHR_MAINTENANCE_5_EXTENSION_NAME);
+    linkExtensionFeatures({
+        { hasPipelineLibraryExtensions, &m_graphicsPipelineLibraryFeatures },
+        { hasShaderObjectExtension, &m_shaderObjectFeatures },
+        { hasMaintenance5Extension, &m_maintenance5Features },
+    });
+
+    //サポート状態取得
     vkGetPhysicalDeviceFeatures2(m_vkPhysicalDevice, &m_physDevFeatures);
 
-    //@\L
+    //使わない拡張機能の構造体は、デバイス作成時に渡さないよう繋ぎから外す
+    m_pipelineLibrarySupported = hasPipelineLibraryExtensions && m_graphicsPipelineLibraryFeatures.graphicsPipelineLibrary;
+    m_shaderObjectSupported = hasShaderObjectExtension && m_shaderObjectFeatures.shaderObject;
+    m_maintenance5Supported = hasMaintenance5Extension && m_maintenance5Features.maintenance5;
+    linkExtensionFeatures({
+        { m_pipelineLibrarySupported, &m_graphicsPipelineLibraryFeatures },
+        { m_shaderObjectSupported, &m_shaderObjectFeatures },
+        { m_maintenance5Supported, &m_maintenance5Features },
+    });
+
+    //機能有効化
     m_vulkan13Features.dynamicRendering = VK_TRUE;
     m_vulkan13Features.synchronization2 = VK_TRUE;
+    m_vulkan13Features.pipelineCreationCacheControl = VK_TRUE; //ワーカーでキャッシュにあるかを先に確かめる
+    m_vulkan12Features.timelineSemaphore = VK_TRUE;
+
+    //バインドレスに必要なディスクリプタインデキシングの機能が揃っていれば有効化
+    auto& f12 = m_vulkan12Features;
+    m_bindlessSupported =
+        f12.descriptorIndexing &&
+        f12.runtimeDescriptorArray &&
+        f12.descriptorBindingPartiallyBound &&
+        f12.descriptorBindingUpdateUnusedWhilePending &&
+        f12.descriptorBindingStorageBufferUpdateAfterBind &&
+        f12.descriptorBindingSampledImageUpdateAfterBind &&
+        f12.shaderStorageBufferArrayNonUniformIndexing &&
+        f12.shaderSampledImageArrayNonUniformIndexing;
+    if (m_bindlessSupported)
+    {
+        f12.descriptorIndexing = VK_TRUE;
+        f12.runtimeDescriptorArray = VK_TRUE;
+        f12.descriptorBindingPartiallyBound = VK_TRUE;
+        f12.descriptorBindingUpdateUnusedWhilePending = VK_TRUE;
+        f12.descriptorBindingStorageBufferUpdateAfterBind = VK_TRUE;
+        f12.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+        f12.shaderStorageBufferArrayNonUniformIndexing = VK_TRUE;
+        f12.shaderSampledImageArrayNonUniformIndexing = VK_TRUE;
+    }
 }
 
 void VulkanContext::CreateCommandPool()
@@ -346,27 +742,58 @@ void VulkanContext::CreateCommandPool()
     vkCreateCommandPool(m_vkDevice, &commandPoolCI, nullptr, &m_commandPool);
 }
 
-void VulkanContext::CreateDescriptorPool()
+void VulkanContext::CreatePipelineCache()
 {
-    std::vector<VkDescriptorPoolSize> poolSizes = {
-        {
-            .type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
-            .descriptorCount = 4096
-        },
-        // ̃fBXNv^KvɂȂ炱ɒǉ
-    };
-    VkDescriptorPoolCreateInfo poolInfo{
-        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
-        .flags = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT,
-        .maxSets = 4096,
-        .poolSizeCount = uint32_t(poolSizes.size()),
-        .pPoolSizes = poolSizes.data(),
-    };
+    std::filesystem::path filePath;
+    if (!m_pipelineCacheDirectory.empty())
+    {
+        filePath = m_pipelineCacheDirectory / "pipeline_cache.bin";
+    }
+    if (!m_pipelineCache.Initialize(m_vkDevice, m_physicalDeviceProperties, filePath))
+    {
+        throw std::runtime_error("failed to create pipeline cache!");
+    }
+    m_pipelineRegistry.Initialize(m_vkDevice);
+    m_pipelineLibrary.Initialize(m_vkDevice, m_pipelineLibrarySupported);
+    m_shaderModuleCache.Initialize(m_vkDevice, m_maintenance5Supported);
+    m_pipelineLayoutCache.Initialize(m_vkDevice);
+}
+
+void VulkanContext::CreateDescriptorAllocator()
+{
+    //常駐用はセット単位で解放できるプールにする
+    m_descriptorAllocator.Initialize(m_vkDevice, 256, GetDefaultDescriptorRatios(), true);
+}
 
-    if (vkCreateDescriptorPool(m_vkDevice, &poolInfo, nullptr, &m_descriptorPool) != VK_SUCCESS)
+void VulkanContext::CreateBindlessHeap()
+{
+    if (!m_bindlessSupported)
+    {
+        return;
+    }
+    m_bindlessHeap = std::make_unique<BindlessHeap>();
+    if (!m_bindlessHeap->Initialize(m_vkDevice, m_vkPhysicalDevice))
     {
-        throw std::runtime_error("failed to create descriptor pool!");
+        throw std::runtime_error("Failed to create bindless descriptor heap");
     }
+
+    //リフレクションで作るパイプラインレイアウトが、ヒープのセットをそのまま使えるようにする
+    m_pipelineLayoutCache.RegisterSetLayout(m_bindlessHeap->GetDescriptorSetLayout(), m_bindlessHeap->GetSetLayoutBindings());
+}
+
+const std::vector<DescriptorPoolRatio>& VulkanContext::GetDefaultDescriptorRatios()
+{
+    //1セットあたりの平均個数の見積もり(不足すれば新しいプールが追加される)
+    static const std::vector<DescriptorPoolRatio> ratios = {
+        { VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 2.0f },
+        { VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1.0f },
+        { VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1.0f },
+        { VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 2.0f },
+        { VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, 1.0f },
+        { VK_DESCRIPTOR_TYPE_SAMPLER, 0.5f },
+        { VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 0.5f },
+    };
+    return ratios;
 }
 
 VKAPI_ATTR VkBool32 VKAPI_CALL VulkanDebugCallback(
@@ -413,17 +840,18 @@ void VulkanContext::CreateDebugMessenger()
 
 uint32_t VulkanContext::FindMemoryType(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties) const
 {
-    for (uint32_t i = 0; i < m_memoryProperties.memoryTypeCount; i++)
+    return FindMemoryType(requirements, MemoryUsage::FromProperties(properties));
+}
+
+uint32_t VulkanContext::FindMemoryType(const VkMemoryRequirements& requirements, const MemoryUsage& usage) const
+{
+    //memoryTypeBitsに含まれ、必須のプロパティを満たすタイプのうち最も条件に合うもの
+    auto index = m_memoryAllocator->FindMemoryTypeIndex(requirements.memoryTypeBits, usage);
+    if (index == UINT32_MAX)
     {
-        const bool isTypeCompatible = (requirements.memoryTypeBits & (1 << i)) != 0;
-        const bool hasDesiredProperties = (m_memoryProperties.memoryTypes[i].propertyFlags & properties) == properties;
-        if (isTypeCompatible && hasDesiredProperties)
-        {
-            //vpeB𖞂AmemoryTypeBitsɊ܂܂Ă
-            return i;
-        }
+        throw std::runtime_error("Failed to find suitable memory type!");
     }
-    throw std::runtime_error("Failed to find suitable memory type!");
+    return index;
 }
 
 void VulkanContext::SetDebugObjectName(void* objectHandle, VkObjectType type, const char* name)
@@ -442,26 +870,64 @@ void VulkanContext::SetDebugObjectName(void* objectHandle, VkObjectType type, co
 #endif
 }
 
+void VulkanContext::CreateTimelineSemaphore()
+{
+    VkSemaphoreTypeCreateInfo timelineCI{
+        .sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO,
+        .semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE,
+        .initialValue = 0,
+    };
+    VkSemaphoreCreateInfo semaphoreCI{
+        .sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,
+        .pNext = &timelineCI,
+    };
+    if (vkCreateSemaphore(m_vkDevice, &semaphoreCI, nullptr, &m_timelineSemaphore) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to create timeline semaphore");
+    }
+    m_submittedTimelineValue = 0;
+}
+
 void VulkanContext::CreateFrameContexts()
 {
-    m_frameContext.resize(MaxInflightFrames);
-    for (auto& frame : m_frameContext)
+    //フレーム毎・スレッド毎のコマンドプールを用意する
+    if (!m_frameCommandPools.Initialize(m_vkDevice, m_graphicsQueueFamilyIndex, m_maxInflightFrames, m_workerThreadPool.GetThreadCount() + 1))
+    {
+        throw std::runtime_error("Failed to create frame command pools");
+    }
+
+    //定数用のリングはスロット数が変わる場合のみ作り直す(スワップチェインの再作成では維持する)
+    if (m_frameUniformRing == nullptr)
+    {
+        m_frameUniformRing = std::make_unique<UniformRing>();
+    }
+    if (m_frameUniformRing->GetSlotCount() != m_maxInflightFrames)
     {
-        frame.commandBuffer = CreateCommandBuffer();
-        VkFenceCreateInfo fenceCI
+        m_frameUniformRing->Cleanup();
+        if (!m_frameUniformRing->Initialize(m_maxInflightFrames))
         {
-            .sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO,
-            .flags = VK_FENCE_CREATE_SIGNALED_BIT,
-        };
-        vkCreateFence(m_vkDevice, &fenceCI, nullptr, &frame.inflightFence);
+            throw std::runtime_error("Failed to create frame uniform ring");
+        }
+    }
+
+    m_frameContext.resize(m_maxInflightFrames);
+    for (auto& frame : m_frameContext)
+    {
+        frame.timelineValue = 0;
+        frame.descriptorAllocator = std::make_unique<DescriptorAllocator>();
+        frame.descriptorAllocator->Initialize(m_vkDevice, 1024, GetDefaultDescriptorRatios(), false);
     }
+    m_currentFrameIndex = 0;
 }
 
 void VulkanContext::DestroyFrameContexts()
 {
+    //コマンドバッファを解放する前に、提出済みの全フレームの完了を待つ
+    WaitTimelineValue(m_submittedTimelineValue);
     for (auto& frame : m_frameContext)
     {
-        vkDestroyFence(m_vkDevice, frame.inflightFence, nullptr);
+        frame.descriptorAllocator->Cleanup();
     }
     m_frameContext.clear();
+    m_frameCommandPools.Cleanup();
 }
\ No newline at end of file
@@ -0,0 +1,131 @@
+#include <algorithm>
+#include <atomic>
+#include <memory>
+
+#include "core/WorkerThreadPool.h"
+
+namespace
+{
+    thread_local uint32_t t_threadIndex = 0;
+}
+
+/*************************************************
+public
+*************************************************/
+
+WorkerThreadPool::~WorkerThreadPool()
+{
+    Cleanup();
+}
+
+void WorkerThreadPool::Initialize(uint32_t threadCount)
+{
+    Cleanup();
+
+    m_stopping = false;
+    for (uint32_t i = 0; i < threadCount; ++i)
+    {
+        m_threads.emplace_back([this, i]() { WorkerMain(i + 1); });
+    }
+}
+
+void WorkerThreadPool::Cleanup()
+{
+    {
+        std::lock_guard lock(m_mutex);
+        m_stopping = true;
+    }
+    m_condition.notify_all();
+    for (auto& thread : m_threads)
+    {
+        thread.join();
+    }
+    m_threads.clear();
+}
+
+uint32_t WorkerThreadPool::GetCurrentThreadIndex()
+{
+    return t_threadIndex;
+}
+
+void WorkerThreadPool::Enqueue(std::function<void()> job)
+{
+    //ワーカーがいない場合はその場で実行する
+    if (m_threads.empty())
+    {
+        job();
+        return;
+    }
+
+    {
+        std::lock_guard lock(m_mutex);
+        m_jobs.push_back(std::move(job));
+    }
+    m_condition.notify_one();
+}
+
+void WorkerThreadPool::ParallelFor(uint32_t taskCount, const std::function<void(uint32_t)>& func)
+{
+    if (taskCount == 0)
+    {
+        return;
+    }
+
+    //タスク番号を先着順に取り合う
+    //ワーカーが呼び出し終了後に参照してもよいよう、共有状態はshared_ptrで保持する
+    struct SharedState
+    {
+        std::atomic<uint32_t> nextTask{ 0 };
+        std::atomic<uint32_t> finishedTask{ 0 };
+        std::mutex mutex;
+        std::condition_variable finished;
+    };
+    auto state = std::make_shared<SharedState>();
+    auto drain = [state, taskCount, &func]()
+    {
+        for (uint32_t task = state->nextTask++; task < taskCount; task = state->nextTask++)
+        {
+            func(task);
+            if (++state->finishedTask == taskCount)
+            {
+                std::lock_guard lock(state->mutex);
+                state->finished.notify_all();
+            }
+        }
+    };
+
+    //呼び出しスレッドの分を除いた数だけワーカーへ投入する
+    uint32_t helperCount = std::min(GetThreadCount(), taskCount - 1);
+    for (uint32_t i = 0; i < helperCount; ++i)
+    {
+        Enqueue(drain);
+    }
+    drain();
+
+    std::unique_lock lock(state->mutex);
+    state->finished.wait(lock, [&]() { return state->finishedTask == taskCount; });
+}
+
+/*************************************************
+private
+*************************************************/
+
+void WorkerThreadPool::WorkerMain(uint32_t threadIndex)
+{
+    t_threadIndex = threadIndex;
+    while (true)
+    {
+        std::function<void()> job;
+        {
+            std::unique_lock lock(m_mutex);
+            m_condition.wait(lock, [this]() { return m_stopping || !m_jobs.empty(); });
+            if (m_jobs.empty())
+            {
+                return;
+            }
+            job = std::move(m_jobs.front());
+            m_jobs.pop_front();
+        }
+        job();
+    }
+}
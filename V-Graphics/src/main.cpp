@@ -1,70 +1,315 @@
+#if defined(_WIN32)
 #include <Windows.h>
+#endif
 #include <filesystem>
-
-#define GLFW_INCLUDE_VULKAN
-#include <GLFW/glfw3.h>
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
 
 #include "core/AssetPath.h"
 #include "core/VulkanContext.h"
+#include "core/HeadlessSurfaceProvider.h"
+#include "core/RenderGraph.h"
+#if defined(VGRAPHICS_WITH_GLFW)
 #include "core/GLFWSurfaceProvider.h"
+#endif
 #include "SimpleCubeApp.h"
+#include "TriangleApp.h"
+#include "ParallelDrawApp.h"
+#include "ShaderObjectBenchApp.h"
+
+namespace
+{
+	//コマンドライン引数から得る起動設定
+	struct LaunchOptions
+	{
+		bool headless = false;
+		uint32_t frameCount = 1000;
+		uint32_t width = 1280;
+		uint32_t height = 720;
+		uint32_t inflightFrames = VulkanContext::DefaultMaxInflightFrames;
+		uint32_t workerThreads = UINT32_MAX; //UINT32_MAXはコア数から決定
+		VkPresentModeKHR presentMode = VK_PRESENT_MODE_FIFO_KHR;
+		uint32_t swapchainImages = 0; //0は表示モードから決定
+		std::string appName = "cube";
+		std::filesystem::path assetDir;
+		std::filesystem::path cacheDir; //パイプラインキャッシュの保存先
+		bool pipelineLibrary = true;    //VK_EXT_graphics_pipeline_libraryを使うか
+	};
+
+	LaunchOptions ParseLaunchOptions(const std::vector<std::string>& args)
+	{
+		LaunchOptions options{};
+		for (size_t i = 0; i < args.size(); ++i)
+		{
+			const auto& arg = args[i];
+			const bool hasValue = i + 1 < args.size();
+			if (arg == "--headless")
+			{
+				options.headless = true;
+			}
+			else if (arg == "--frames" && hasValue)
+			{
+				options.frameCount = uint32_t(std::stoul(args[++i]));
+			}
+			else if (arg == "--width" && hasValue)
+			{
+				options.width = uint32_t(std::stoul(args[++i]));
+			}
+			else if (arg == "--height" && hasValue)
+			{
+				options.height = uint32_t(std::stoul(args[++i]));
+			}
+			else if (arg == "--inflight" && hasValue)
+			{
+				options.inflightFrames = uint32_t(std::stoul(args[++i]));
+			}
+			else if (arg == "--threads" && hasValue)
+			{
+				options.workerThreads = uint32_t(std::stoul(args[++i]));
+			}
+			else if (arg == "--present" && hasValue)
+			{
+				const auto& mode = args[++i];
+				options.presentMode =
+					mode == "mailbox" ? VK_PRESENT_MODE_MAILBOX_KHR :
+					mode == "immediate" ? VK_PRESENT_MODE_IMMEDIATE_KHR :
+					mode == "relaxed" ? VK_PRESENT_MODE_FIFO_RELAXED_KHR :
+					VK_PRESENT_MODE_FIFO_KHR;
+			}
+			else if (arg == "--images" && hasValue)
+			{
+				options.swapchainImages = uint32_t(std::stoul(args[++i]));
+			}
+			else if (arg == "--app" && hasValue)
+			{
+				options.appName = args[++i];
+			}
+			else if (arg == "--assets" && hasValue)
+			{
+				options.assetDir = args[++i];
+			}
+			else if (arg == "--no-pipeline-library")
+			{
+				options.pipelineLibrary = false;
+			}
+			else if (arg == "--cache" && hasValue)
+			{
+				options.cacheDir = args[++i];
+			}
+		}
+		return options;
+	}
+
+	std::unique_ptr<ISampleApp> CreateSampleApp(const std::string& name)
+	{
+		if (name == "triangle")
+		{
+			return std::make_unique<TriangleApp>();
+		}
+		if (name == "parallel")
+		{
+			return std::make_unique<ParallelDrawApp>();
+		}
+		if (name == "shaderobject")
+		{
+			return std::make_unique<ShaderObjectBenchApp>();
+		}
+		return std::make_unique<SimpleCubeApp>();
+	}
+
+#if defined(VGRAPHICS_WITH_GLFW)
+	//ウィンドウを作成し、閉じられるまで描画を続ける
+	int RunWindowed(const LaunchOptions& options)
+	{
+		//GLFW初期化
+		glfwInit();
+		glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
+		glfwWindowHint(GLFW_RESIZABLE, GLFW_FALSE);
+
+		//ウィンドウ作成
+		GLFWwindow* window = glfwCreateWindow(int(options.width), int(options.height), "DirectX999999999999", nullptr, nullptr);
+		GLFWSurfaceProvider surfaceProvider(window);
+
+		//必要な拡張機能を取得し、Vulkan初期化
+		auto& vulkanCtx = VulkanContext::Get();
+		vulkanCtx.GetWindowSystemExtensions = [=](auto& extensionList)
+		{
+			uint32_t extCount = 0;
+			const char** extensions = glfwGetRequiredInstanceExtensions(&extCount);
+			if (extCount > 0)
+			{
+				extensionList.insert(extensionList.end(), extensions, extensions + extCount);
+			}
+		};
+		vulkanCtx.SetMaxInflightFrames(options.inflightFrames);
+		vulkanCtx.SetWorkerThreadCount(options.workerThreads);
+		vulkanCtx.SetPresentMode(options.presentMode);
+		vulkanCtx.SetSwapchainImageCount(options.swapchainImages);
+		vulkanCtx.SetPipelineCacheDirectory(options.cacheDir);
+		vulkanCtx.SetPipelineLibraryEnabled(options.pipelineLibrary);
+		vulkanCtx.Initialize("Window", &surfaceProvider);
+		vulkanCtx.RecreateSwapchain();
+
+		//アプリケーション初期化
+		auto app = CreateSampleApp(options.appName);
+		app->OnInitialize();
+
+		//メッセージループ
+		while (glfwWindowShouldClose(window) == GLFW_FALSE)
+		{
+			glfwPollEvents();
+			app->OnDrawFrame();
+		}
+
+		//終了処理
+		app->OnCleanup();
+		vulkanCtx.Cleanup();
+
+		glfwDestroyWindow(window);
+		glfwTerminate();
+		return 0;
+	}
+#endif
+
+	//ウィンドウを持たずに指定フレーム数を可能な限り速く描画し、スループットを出力する
+	int RunHeadless(const LaunchOptions& options)
+	{
+		HeadlessSurfaceProvider surfaceProvider(options.width, options.height);
+
+		auto& vulkanCtx = VulkanContext::Get();
+		vulkanCtx.SetMaxInflightFrames(options.inflightFrames);
+		vulkanCtx.SetWorkerThreadCount(options.workerThreads);
+		vulkanCtx.SetPipelineCacheDirectory(options.cacheDir);
+		vulkanCtx.SetPipelineLibraryEnabled(options.pipelineLibrary);
+		vulkanCtx.Initialize("Headless", &surfaceProvider);
+		vulkanCtx.RecreateSwapchain();
+
+		auto app = CreateSampleApp(options.appName);
+		app->OnInitialize();
 
+		const auto startTime = std::chrono::steady_clock::now();
+		for (uint32_t i = 0; i < options.frameCount; ++i)
+		{
+			app->OnDrawFrame();
+		}
+		vkDeviceWaitIdle(vulkanCtx.GetVkDevice());
+		const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+
+		std::cout << "[Headless] " << options.appName << " "
+			<< options.width << "x" << options.height << ": "
+			<< options.frameCount << " frames in " << seconds << " s ("
+			<< (seconds > 0.0 ? options.frameCount / seconds : 0.0) << " fps)" << std::endl;
+		std::cout << "[PipelineCache] "
+			<< (vulkanCtx.GetPipelineCache().IsLoadedFromFile() ? "loaded from " : "created empty, saving to ")
+			<< options.cacheDir.string() << std::endl;
+		const auto registryStats = vulkanCtx.GetPipelineRegistry().GetStats();
+		std::cout << "[PipelineRegistry] " << registryStats.pipelineCount << " pipelines, "
+			<< registryStats.hits << " hits / " << registryStats.misses << " misses"
+			<< " (" << registryStats.pendingCount << " compiling)" << std::endl;
+		const auto& pipelineLibrary = vulkanCtx.GetPipelineLibrary();
+		if (pipelineLibrary.IsSupported())
+		{
+			const auto libraryStats = pipelineLibrary.GetStats();
+			std::cout << "[PipelineLibrary] " << libraryStats.libraryCount << " libraries ("
+				<< libraryStats.partHits << " reused / " << libraryStats.partMisses << " created), "
+				<< libraryStats.linkCount << " linked, " << libraryStats.optimizedCount << " optimized" << std::endl;
+		}
+		else
+		{
+			std::cout << "[PipelineLibrary] unavailable, using monolithic builds" << std::endl;
+		}
+		const auto& shaderModuleCache = vulkanCtx.GetShaderModuleCache();
+		const auto moduleStats = shaderModuleCache.GetStats();
+		std::cout << "[ShaderModuleCache] " << moduleStats.moduleCount << " modules ("
+			<< moduleStats.codeSize << " bytes), "
+			<< moduleStats.hits << " hits / " << moduleStats.misses << " misses"
+			<< (shaderModuleCache.IsInlineModuleSupported() ? ", inline SPIR-V" : "") << std::endl;
+		const auto layoutStats = vulkanCtx.GetPipelineLayoutCache().GetStats();
+		std::cout << "[PipelineLayoutCache] " << layoutStats.setLayoutCount << " set layouts, "
+			<< layoutStats.pipelineLayoutCount << " pipeline layouts, "
+			<< layoutStats.hits << " hits / " << layoutStats.misses << " misses" << std::endl;
+		if (const auto* renderGraph = app->GetRenderGraph())
+		{
+			//最後に組み立てたフレームのグラフ
+			const auto& graphStats = renderGraph->GetStats();
+			std::cout << "[RenderGraph] " << graphStats.passCount << " passes ("
+				<< graphStats.culledPassCount << " culled), "
+				<< graphStats.transientImageCount << " transient images in "
+				<< graphStats.memorySlotCount << " allocations, "
+				<< (graphStats.transientBytes >> 10) << " KiB (unaliased "
+				<< (graphStats.unaliasedBytes >> 10) << " KiB)" << std::endl;
+		}
+
+		//ヒープ毎のメモリ使用量と予算
+		const auto heapBudgets = vulkanCtx.GetMemoryAllocator().GetHeapBudgets();
+		for (size_t i = 0; i < heapBudgets.size(); ++i)
+		{
+			std::cout << "[Memory] heap" << i << ": "
+				<< (heapBudgets[i].usage >> 20) << " / " << (heapBudgets[i].budget >> 20) << " MiB budget"
+				<< " (heap " << (heapBudgets[i].heapSize >> 20) << " MiB)" << std::endl;
+		}
+
+		app->OnCleanup();
+		vulkanCtx.Cleanup();
+		return 0;
+	}
+
+	int Run(const std::filesystem::path& exeDir, const std::vector<std::string>& args)
+	{
+		auto options = ParseLaunchOptions(args);
+
+		std::filesystem::path assetDir = options.assetDir.empty() ? exeDir / "../../assets" : options.assetDir;
+		SetAssetRootPath(assetDir);
+		if (options.cacheDir.empty())
+		{
+			options.cacheDir = exeDir / "cache";
+		}
+
+#if defined(VGRAPHICS_WITH_GLFW)
+		return options.headless ? RunHeadless(options) : RunWindowed(options);
+#else
+		//ウィンドウ表示なしでビルドした場合は常にヘッドレスで描画する
+		if (!options.headless)
+		{
+			std::cout << "[Headless] built without GLFW, running headless" << std::endl;
+		}
+		return RunHeadless(options);
+#endif
+	}
+}
+
+#if defined(_WIN32)
 int __stdcall wWinMain(_In_ HINSTANCE hInstance,
 	_In_opt_ HINSTANCE hPrevInstance,
 	_In_ LPWSTR lpCmdLine,
 	_In_ int nCmdShow)
 {
-	//exêfBNgJgfBNgɐݒ
+	//exeのあるディレクトリをカレントディレクトリに設定
 	wchar_t exePath[MAX_PATH];
 	GetModuleFileNameW(nullptr, exePath, MAX_PATH);
 	std::filesystem::path exeDir = std::filesystem::path(exePath).parent_path();
 	SetCurrentDirectoryW(exeDir.c_str());
 
-	std::filesystem::path assetDir = exeDir / "../../assets";
-	SetAssetRootPath(assetDir);
-
 	UNREFERENCED_PARAMETER(hPrevInstance);
 	UNREFERENCED_PARAMETER(lpCmdLine);
 
-	//GLFW
-	glfwInit();
-	glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
-	glfwWindowHint(GLFW_RESIZABLE, GLFW_FALSE);
-
-	//EBhE쐬
-	GLFWwindow* window = glfwCreateWindow(1280, 720, "DirectX999999999999", nullptr, nullptr);
-	GLFWSurfaceProvider surfaceProvider(window);
-
-	//KvȊg@\擾AVulkan
-	auto& vulkanCtx = VulkanContext::Get();
-	vulkanCtx.GetWindowSystemExtensions = [=](auto& extensionList)
+	std::vector<std::string> args;
+	for (int i = 1; i < __argc; ++i)
 	{
-		uint32_t extCount = 0;
-		const char** extensions = glfwGetRequiredInstanceExtensions(&extCount);
-		if (extCount > 0)
-		{
-			extensionList.insert(extensionList.end(), extensions, extensions + extCount);
-		}
-	};
-	vulkanCtx.Initialize("Window", &surfaceProvider);
-	vulkanCtx.RecreateSwapchain();
-
-	//AvP[V
-	SimpleCubeApp app{};
-	app.OnInitialize();
-
-	//bZ[W[v
-	while (glfwWindowShouldClose(window) == GLFW_FALSE)
-	{
-		glfwPollEvents();
-		app.OnDrawFrame();
+		args.push_back(std::filesystem::path(__wargv[i]).string());
 	}
+	return Run(exeDir, args);
+}
+#else
+int main(int argc, char** argv)
+{
+	//実行ファイルのあるディレクトリを基準にアセットを探す
+	std::filesystem::path exeDir = std::filesystem::canonical("/proc/self/exe").parent_path();
 
-	//I
-	app.OnCleanup();
-	vulkanCtx.Cleanup();
-
-	glfwDestroyWindow(window);
-	glfwTerminate();
-	return 0;
-}
\ No newline at end of file
+	std::vector<std::string> args(argv + 1, argv + argc);
+	return Run(exeDir, args);
+}
+#endif
@@ -0,0 +1,43 @@
+#version 450
+#extension GL_EXT_nonuniform_qualifier : require
+layout(location = 0) in vec3 inPos;
+layout(location = 1) in vec3 inNormal;
+layout(location=2) in vec3 inColor;
+
+layout(location=0) out vec3 outNormal;
+layout(location=1) out vec3 outColor;
+layout(location=2) out vec3 outWorldPosition;
+
+// フレーム共通の定数(cube.fragと同じブロック。matWorldは使わない)
+layout(set=0,binding=0)
+uniform SceneConstants
+{
+  mat4 matWorld;
+  mat4 matView;
+  mat4 matProj;
+  vec4 lightDir;
+  vec4 eyePosition;
+};
+
+// バインドレスヒープのストレージバッファ配列
+layout(set=1,binding=0) readonly buffer ObjectTransforms
+{
+  mat4 matWorld[];
+} g_buffers[];
+
+// 描画毎に参照するバッファとオブジェクトの番号
+layout(push_constant) uniform DrawConstants
+{
+  uint transformBufferIndex;
+  uint objectIndex;
+};
+
+void main()
+{
+  mat4 world = g_buffers[transformBufferIndex].matWorld[objectIndex];
+  vec4 worldPosition = world * vec4(inPos, 1.0);
+  gl_Position = matProj * matView * worldPosition;
+  outNormal = mat3(world) * inNormal;
+  outColor = inColor;
+  outWorldPosition = worldPosition.xyz;
+}
\ No newline at end of file
@@ -6,6 +6,9 @@ layout(location=2) in vec3 inWorldPosition;
 
 layout(location=0) out vec4 outColor;
 
+// 特殊化定数(パイプライン作成時に差し替え可能)
+layout(constant_id=0) const float SHININESS = 20.0;
+
 layout(set=0,binding=0)
 uniform SceneConstants
 {
@@ -34,8 +37,7 @@ void main()
     const vec3 Ks = vec3(1.0); // 鏡面反射係数
     vec3 toEyeDir = normalize(eyePosition.xyz - inWorldPosition.xyz);
     vec3 R = normalize(reflect(-toLightDir, N));
-    const float shininess = 20;
-    light += lightColor * Ks * pow(max(dot(toEyeDir, R), 0), shininess);
+    light += lightColor * Ks * pow(max(dot(toEyeDir, R), 0), SHININESS);
   }
 
   // ambient